@@ -0,0 +1,36 @@
+#include "Args.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+std::vector<int> parseList(const char* arg){
+  std::vector<int> values;
+  for(const char* p = arg; *p; ){
+    values.push_back(atoi(p));
+    p = strchr(p, ',');
+    if(!p){
+      break;
+    }
+    p++;
+  }
+  return values;
+}
+
+bool parseArgs(int argc, char** argv, uint32_t* seed, const char** tracePath, const OptionHandler& handler){
+  for(int i = 1; i < argc; i++){
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : "";
+    int used = handler(arg, value);
+    if(used > 0){
+      i += used - 1;
+    }
+    else if(!strcmp(arg, "--seed")){ *seed = strtoul(value, NULL, 10); i++; }
+    else if(tracePath && !strcmp(arg, "--trace")){ *tracePath = value; i++; }
+    else{
+      fprintf(stderr, "unknown option %s\n", arg);
+      return false;
+    }
+  }
+  return true;
+}
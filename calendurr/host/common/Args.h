@@ -0,0 +1,30 @@
+#ifndef CALENDURR_HOST_ARGS_H
+#define CALENDURR_HOST_ARGS_H
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+/*--------------------------------------------------*/
+/*--        Command lines of the host tools       --*/
+/*--------------------------------------------------*/
+/*  Every bench takes "--name value" options, lists */
+/*  comma separated, and shares --seed (and --trace */
+/*  where it reads recordings); the rest are its    */
+/*  own and go to its handler.                      */
+/*--------------------------------------------------*/
+
+// "2,4,8" -> {2, 4, 8}
+std::vector<int> parseList(const char* arg);
+
+// One tool's options: arg, and value (the next argument or ""); returns
+// how many arguments it took (1 for a flag, 2 with the value), 0 if arg
+// is not one of its own
+typedef std::function<int(const char* arg, const char* value)> OptionHandler;
+
+// Runs argv through handler, then --seed N and, if tracePath is given,
+// --trace FILE; prints "unknown option" and returns false on the first
+// argument nobody takes
+bool parseArgs(int argc, char** argv, uint32_t* seed, const char** tracePath, const OptionHandler& handler);
+
+#endif
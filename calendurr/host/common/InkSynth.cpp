@@ -0,0 +1,66 @@
+#include "InkSynth.h"
+
+#include <math.h>
+
+#include "Recognizer.h"
+
+/*--------------------------------------------------*/
+/*--                synthGlyph()                  --*/
+/*--------------------------------------------------*/
+std::vector<Trace> synthGlyph(const int8_t* path, int x, int y, int width, int height,
+                              int distortion, TraceRandom& rng){
+  std::vector<Trace> strokes;
+
+  double sx = width / 100.0 * (1.0 + rng.range(-distortion, distortion) / 100.0);
+  double sy = height / 100.0 * (1.0 + rng.range(-distortion, distortion) / 100.0);
+  double shear = rng.range(-distortion, distortion) / 100.0;
+  double wobble = distortion / 2.0;
+
+  strokes.emplace_back();
+  double lastX = 0, lastY = 0;
+  bool first = true;
+
+  for(const int8_t* p = path; p[0] != GLYPH_END; ){
+    if(p[0] == GLYPH_PEN_UP){
+      strokes.emplace_back();
+      first = true;
+      p++;
+      continue;
+    }
+
+    double tx = p[0] + rng.range(-(int)wobble, (int)wobble);
+    double ty = p[1] + rng.range(-(int)wobble, (int)wobble);
+    double px = x + tx * sx + (100 - ty) * sy * shear;
+    double py = y + ty * sy;
+    p += 2;
+
+    if(first){
+      strokes.back().push_back({(int)px, (int)py});
+      first = false;
+    }
+    else{
+      // a sample every 3-7 units along the segment
+      double length = sqrt((px - lastX) * (px - lastX) + (py - lastY) * (py - lastY));
+      double done = 0;
+      while((done += rng.range(3, 7)) < length){
+        double t = done / length;
+        strokes.back().push_back({(int)(lastX + (px - lastX) * t + rng.range(-1, 1)),
+                                  (int)(lastY + (py - lastY) * t + rng.range(-1, 1))});
+      }
+      strokes.back().push_back({(int)px, (int)py});
+    }
+    lastX = px;
+    lastY = py;
+  }
+
+  return strokes;
+}
+
+Trace synthDot(int x, int y, TraceRandom& rng){
+  Trace dot;
+  int samples = rng.range(2, 6);
+  for(int i = 0; i < samples; i++){
+    dot.push_back({(int)(x + rng.range(-4, 4)), (int)(y + rng.range(-4, 4))});
+  }
+  return dot;
+}
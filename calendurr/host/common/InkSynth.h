@@ -0,0 +1,28 @@
+#ifndef CALENDURR_HOST_INKSYNTH_H
+#define CALENDURR_HOST_INKSYNTH_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "Trace.h"
+
+/*--------------------------------------------------*/
+/*--        Synthetic handwriting (host)          --*/
+/*--------------------------------------------------*/
+/*  Writes a template path (Recognizer.h format,    */
+/*  0..100 box) as pen samples in pad units, the    */
+/*  way readSensor() would store them: a sample     */
+/*  every few units, each stroke its own Trace.     */
+/*  distortion (percent) scales, shears and jitters */
+/*  every corner of the template independently, so  */
+/*  no two renderings are the same glyph.           */
+/*--------------------------------------------------*/
+
+// Strokes of one glyph with its box at (x, y), width x height
+std::vector<Trace> synthGlyph(const int8_t* path, int x, int y, int width, int height,
+                              int distortion, TraceRandom& rng);
+
+// A small closed loop of a few samples, as left by tapping the pen
+Trace synthDot(int x, int y, TraceRandom& rng);
+
+#endif
@@ -0,0 +1,159 @@
+#include "Trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PointTimes.h"
+#include "Resampler.h"
+
+bool strokeStartAt(const Trace& trace, size_t i){
+  return i == 0 || abs(trace[i][0] - trace[i - 1][0]) > TRACE_PEN_LIFT ||
+         abs(trace[i][1] - trace[i - 1][1]) > TRACE_PEN_LIFT;
+}
+
+bool loadTrace(const char* path, Trace& trace){
+  FILE* f = fopen(path, "r");
+  if(!f){
+    return false;
+  }
+
+  int c;
+  while((c = fgetc(f)) != EOF){
+    if(c != '['){
+      continue;
+    }
+    int x, y;
+    if(fscanf(f, "%d,%d", &x, &y) == 2){
+      trace.push_back({x, y});
+    }
+  }
+
+  fclose(f);
+  return !trace.empty();
+}
+
+/*--------------------------------------------------*/
+/*--              syntheticTrace()                --*/
+/*--------------------------------------------------*/
+/*    Strokes of 20-120 points that drift with a    */
+/*    slowly turning heading and 1-3 unit steps,    */
+/*    roughly what coordz.txt looks like. Each      */
+/*    stroke starts at a new spot on the pad.       */
+/*--------------------------------------------------*/
+Trace syntheticTrace(uint32_t seed, int count){
+  TraceRandom rng(seed);
+  Trace trace;
+  trace.reserve(count);
+
+  int x = 0, y = 0, dx = 0, dy = 0, left = 0;
+  while((int)trace.size() < count){
+    if(left == 0){
+      x = rng.range(200, 3400);
+      y = rng.range(200, 3900);
+      dx = rng.range(-3, 3);
+      dy = rng.range(-3, 3);
+      left = rng.range(20, 120);
+    }
+
+    if(rng.range(0, 7) == 0){
+      dx = rng.range(-3, 3);
+      dy = rng.range(-3, 3);
+    }
+    if(dx == 0 && dy == 0){
+      dx = 1;
+    }
+
+    x = x + dx < 0 ? 0 : (x + dx > 3600 ? 3600 : x + dx);
+    y = y + dy < 0 ? 0 : (y + dy > 4100 ? 4100 : y + dy);
+    trace.push_back({x, y});
+    left--;
+  }
+
+  return trace;
+}
+
+/*--------------------------------------------------*/
+/*--                traceTicks()                  --*/
+/*--------------------------------------------------*/
+TraceTicks traceTicks(const Trace& trace, uint32_t seed){
+  TraceRandom rng(seed);
+  TraceTicks ticks;
+  ticks.reserve(trace.size());
+
+  for(size_t i = 0; i < trace.size(); i++){
+    uint32_t us;
+    if(strokeStartAt(trace, i)){
+      us = rng.range(150000, 600000);
+    }
+    else{
+      us = rng.range(2000, 3000) * (rng.range(0, 9) == 0 ? 2 : 1);
+    }
+    ticks.push_back(us / POINT_TICK_US);
+  }
+
+  return ticks;
+}
+
+/*--------------------------------------------------*/
+/*--               resampleTrace()                --*/
+/*--------------------------------------------------*/
+/*    Same calls as readSensor() / storePoint():    */
+/*    the resampler sees the trace's times in us    */
+/*    and PointClock turns the output back into     */
+/*    ticks.                                        */
+/*--------------------------------------------------*/
+void resampleTrace(const Trace& trace, const TraceTicks& ticks, int step, Trace& out, TraceTicks& outTicks){
+  ArcResampler resampler(step);
+  PointClock clock;
+  PenPoint point;
+  uint32_t us = 0;
+
+  out.clear();
+  outTicks.clear();
+  clock.start(0);
+
+  for(size_t i = 0; i < trace.size(); i++){
+    us += ticks[i] * POINT_TICK_US;
+    if(i > 0 && strokeStartAt(trace, i)){
+      if(resampler.finish(&point)){
+        out.push_back({point.x, point.y});
+        outTicks.push_back(clock.ticks(point.us));
+      }
+    }
+
+    resampler.add(trace[i][0], trace[i][1], us);
+    while(resampler.next(&point)){
+      out.push_back({point.x, point.y});
+      outTicks.push_back(clock.ticks(point.us));
+    }
+  }
+
+  if(resampler.finish(&point)){
+    out.push_back({point.x, point.y});
+    outTicks.push_back(clock.ticks(point.us));
+  }
+}
+
+bool storeTrace(const Trace& trace, const TraceTicks& ticks, PointStore& store){
+  for(size_t i = 0; i < trace.size(); i++){
+    uint32_t tick = i < ticks.size() ? ticks[i] : 0;
+    if(!store.room() || !store.append(trace[i][0], trace[i][1], strokeStartAt(trace, i), tick)){
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<Trace> splitStrokes(const Trace& trace, int maxStep){
+  std::vector<Trace> strokes;
+
+  for(size_t i = 0; i < trace.size(); i++){
+    if(i == 0 || abs(trace[i][0] - trace[i - 1][0]) > maxStep ||
+       abs(trace[i][1] - trace[i - 1][1]) > maxStep){
+      strokes.emplace_back();
+    }
+    strokes.back().push_back(trace[i]);
+  }
+
+  return strokes;
+}
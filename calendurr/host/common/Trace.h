@@ -0,0 +1,83 @@
+#ifndef CALENDURR_HOST_TRACE_H
+#define CALENDURR_HOST_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+#include "PointStore.h"
+
+/*--------------------------------------------------*/
+/*--        Pen traces for the host tools         --*/
+/*--------------------------------------------------*/
+/*  A trace is the list of filtered coordinates the */
+/*  firmware stores in coordz, in capture order.    */
+/*  They come either from a recording in the        */
+/*  "[x,y]," format of "python script to bmp"       */
+/*  (coordz.txt) or from a seeded generator so runs */
+/*  are reproducible.                               */
+/*--------------------------------------------------*/
+
+typedef std::array<int, 2> TracePoint;
+typedef std::vector<TracePoint> Trace;
+
+// Per-point ticks (lib/Protocol/PointTimes.h), one per trace point
+typedef std::vector<uint32_t> TraceTicks;
+
+// A step this large between stored points means the pen was lifted
+#define TRACE_PEN_LIFT 30
+
+// Point i starts a stroke: the first point, or a TRACE_PEN_LIFT jump
+bool strokeStartAt(const Trace& trace, size_t i);
+
+// Reads every "[x,y]" pair in the file; false if nothing could be read
+bool loadTrace(const char* path, Trace& trace);
+
+// Generates count points of handwriting-like strokes from seed
+Trace syntheticTrace(uint32_t seed, int count);
+
+// Timing for a trace that has none (recordings keep no time): a sample
+// every 2-3 ms, sometimes a skipped one, and a pen lift of 150-600 ms
+// wherever the trace jumps
+TraceTicks traceTicks(const Trace& trace, uint32_t seed);
+
+// Runs a timed trace through the firmware's ArcResampler (step pad
+// units), stroke by stroke, into out / outTicks
+void resampleTrace(const Trace& trace, const TraceTicks& ticks, int step, Trace& out, TraceTicks& outTicks);
+
+// Splits a trace into strokes wherever consecutive points jump by more
+// than maxStep (the firmware resets its filter on jumps >= 250)
+std::vector<Trace> splitStrokes(const Trace& trace, int maxStep = 250);
+
+// Stores a trace (with ticks, if the store is timed) the way
+// storePoint() fills coordz, a stroke starting wherever the pen was
+// lifted; false if the store filled up first
+bool storeTrace(const Trace& trace, const TraceTicks& ticks, PointStore& store);
+
+/*------------------------------------------*/
+/*  Small deterministic PRNG (xorshift32)   */
+/*  so every host run can be reproduced     */
+/*  from its seed.                          */
+/*------------------------------------------*/
+class TraceRandom {
+  public:
+    explicit TraceRandom(uint32_t seed) : state(seed ? seed : 0x9E3779B9u) {}
+
+    uint32_t next(){
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      return state;
+    }
+
+    // uniform in [lo, hi]
+    int range(int lo, int hi){
+      return lo + (int)(next() % (uint32_t)(hi - lo + 1));
+    }
+
+  private:
+    uint32_t state;
+};
+
+#endif
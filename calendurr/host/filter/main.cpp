@@ -0,0 +1,361 @@
+/*--------------------------------------------------*/
+/*--         PEN FILTER LAG / JITTER (host)       --*/
+/*--------------------------------------------------*/
+/*  Replays a trace through the firmware's pen      */
+/*  filters (lib/Pen/PenFilter.h) the way           */
+/*  readSensor() feeds them. The trace is taken as  */
+/*  the true pen path; every stroke starts with the */
+/*  pen resting at its first point for a while, and */
+/*  seeded noise is added to each reading. Prints,  */
+/*  per filter and noise level:                     */
+/*    still   RMS wander of the output around where */
+/*            it settles while the pen rests        */
+/*            (jitter), pad units                   */
+/*    lag     how many samples the output runs      */
+/*            behind the truth while it moves (the  */
+/*            delay that fits best)                 */
+/*    fast    the same over the fastest fifth of    */
+/*            the samples                           */
+/*    track   RMS distance while it moves, lag and  */
+/*            all                                   */
+/*                                                  */
+/*  pio run -e native_filter                        */
+/*  .pio/build/native_filter/program \              */
+/*      --trace coordz.txt --beta 5,10,20,40        */
+/*                                                  */
+/*  Options (lists are comma separated):            */
+/*    --noise N,...      reading noise, RMS pad     */
+/*                       units (default 2,4,8)      */
+/*    --cutoff N,...     ONE_EURO_MIN_CUTOFF, mHz   */
+/*    --beta N,...       ONE_EURO_BETA, mHz per     */
+/*                       pad unit/s                 */
+/*    --speed-cutoff N   ONE_EURO_SPEED_CUTOFF, mHz */
+/*    --hold N           resting samples per stroke */
+/*    --trace FILE       recorded coordz.txt        */
+/*    --points N         synthetic trace length     */
+/*    --seed N           generator seed             */
+/*--------------------------------------------------*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "Args.h"
+#include "DeviceTraits.h"
+#include "PenFilter.h"
+#include "PointTimes.h"
+#include "Trace.h"
+
+#define LAG_MAX 40          // samples
+#define LAG_STEP 0.1
+#define HOLD_SETTLE 10      // resting samples left out of "still"
+#define HOLD_US 2500        // reading period while the pen rests
+
+/*------------------------------------------*/
+/*  Reading - one pad reading: where the    */
+/*  pen really was, what was read, and when */
+/*------------------------------------------*/
+struct Reading {
+  double trueX, trueY;
+  int x, y;
+  uint32_t us;
+  bool strokeStart;
+  bool moving;
+};
+
+struct Output {
+  int x, y;
+};
+
+struct Scores {
+  double still;
+  double lag;
+  double fast;
+  double track;
+  double ns;
+};
+
+// Roughly normal, RMS 1: the sum of 12 uniforms
+static double noiseSample(TraceRandom& rng){
+  double sum = 0;
+  for(int i = 0; i < 12; i++){
+    sum += (rng.next() & 0xFFFF) / 65536.0;
+  }
+  return sum - 6;
+}
+
+/*--------------------------------------------------*/
+/*--                makeReadings()                --*/
+/*--------------------------------------------------*/
+/*    The trace with hold resting readings before   */
+/*    each stroke and noise RMS pad units on every  */
+/*    reading, timed by traceTicks().               */
+/*--------------------------------------------------*/
+static std::vector<Reading> makeReadings(const Trace& trace, const TraceTicks& ticks,
+                                         int hold, double noise, uint32_t seed){
+  TraceRandom rng(seed);
+  std::vector<Reading> readings;
+  uint32_t us = 0;
+
+  for(size_t i = 0; i < trace.size(); i++){
+    us += ticks[i] * POINT_TICK_US;
+    bool start = strokeStartAt(trace, i);
+    for(int h = start ? hold : 0; h >= 0; h--){
+      Reading r;
+      r.trueX = trace[i][0];
+      r.trueY = trace[i][1];
+      r.x = (int)lround(r.trueX + noise * noiseSample(rng));
+      r.y = (int)lround(r.trueY + noise * noiseSample(rng));
+      r.us = us;
+      r.strokeStart = start && h == hold;
+      r.moving = h == 0 && !start;
+      readings.push_back(r);
+      if(h > 0){
+        us += HOLD_US;
+      }
+    }
+  }
+
+  return readings;
+}
+
+/*--------------------------------------------------*/
+/*--                 replay()                     --*/
+/*--------------------------------------------------*/
+/*    readSensor() minus the pad: a reading equal   */
+/*    to the last one is skipped (five in a row     */
+/*    reset the filter), a jump of jumpMax or a     */
+/*    lifted pen resets it. The output of a skipped */
+/*    reading is the last one.                      */
+/*--------------------------------------------------*/
+template <typename Filter>
+static double replay(Filter& filter, const std::vector<Reading>& readings, std::vector<Output>& out){
+  int lastX = 0;
+  int lastY = 0;
+  int same = 0;
+  Output current = {0, 0};
+
+  out.resize(readings.size());
+  auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < readings.size(); i++){
+    const Reading& r = readings[i];
+    if(r.strokeStart || abs(lastX - r.x) >= Device::Pad::jumpMax || abs(lastY - r.y) >= Device::Pad::jumpMax){
+      filter.reset();
+      same = 0;
+    }
+    if(r.x != lastX || r.y != lastY || r.strokeStart){
+      filter.add(r.x, r.y, r.us);
+      current.x = filter.x();
+      current.y = filter.y();
+      same = 0;
+    }
+    else if(++same >= 5){
+      filter.reset();
+      same = 0;
+    }
+    out[i] = current;
+    lastX = r.x;
+    lastY = r.y;
+  }
+
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Squared distance from the output to where the pen was shift samples
+// earlier, never reaching back past the start of the stroke
+static double delayedError(const std::vector<Reading>& readings, const std::vector<Output>& out,
+                           size_t i, size_t strokeStart, double shift){
+  double at = (double)i - shift;
+  if(at < (double)strokeStart){
+    at = (double)strokeStart;
+  }
+  size_t k = (size_t)at;
+  double f = at - k;
+  size_t next = k + 1 < readings.size() && k + 1 <= i ? k + 1 : k;
+  double tx = readings[k].trueX + (readings[next].trueX - readings[k].trueX) * f;
+  double ty = readings[k].trueY + (readings[next].trueY - readings[k].trueY) * f;
+  double dx = out[i].x - tx;
+  double dy = out[i].y - ty;
+  return dx * dx + dy * dy;
+}
+
+// The delay that fits the chosen moving samples best
+static double bestLag(const std::vector<Reading>& readings, const std::vector<Output>& out,
+                      const std::vector<size_t>& samples, const std::vector<size_t>& strokeOf){
+  double best = 0;
+  double bestError = -1;
+  for(double shift = 0; shift <= LAG_MAX; shift += LAG_STEP){
+    double error = 0;
+    for(size_t i : samples){
+      error += delayedError(readings, out, i, strokeOf[i], shift);
+    }
+    if(bestError < 0 || error < bestError){
+      best = shift;
+      bestError = error;
+    }
+  }
+  return best;
+}
+
+/*--------------------------------------------------*/
+/*--                  score()                     --*/
+/*--------------------------------------------------*/
+template <typename Filter>
+static Scores score(Filter& filter, const std::vector<Reading>& readings){
+  std::vector<Output> out;
+  Scores s;
+  s.ns = replay(filter, readings, out) / readings.size();
+
+  std::vector<size_t> strokeOf(readings.size());
+  std::vector<size_t> moving;
+  std::vector<double> speeds;
+  std::vector<size_t> resting;
+  double track = 0;
+  size_t stroke = 0;
+  for(size_t i = 0; i < readings.size(); i++){
+    if(readings[i].strokeStart){
+      stroke = i;
+    }
+    strokeOf[i] = stroke;
+    if(readings[i].moving){
+      moving.push_back(i);
+      speeds.push_back(hypot(readings[i].trueX - readings[i - 1].trueX, readings[i].trueY - readings[i - 1].trueY));
+      track += delayedError(readings, out, i, stroke, 0);
+    }
+    else if(i - stroke >= HOLD_SETTLE){
+      resting.push_back(i);
+    }
+  }
+
+  // each rest measured around its own mean, so a filter still settling
+  // on a noisy first reading does not count as jitter
+  double still = 0;
+  for(size_t r = 0; r < resting.size();){
+    size_t end = r;
+    double meanX = 0;
+    double meanY = 0;
+    while(end < resting.size() && strokeOf[resting[end]] == strokeOf[resting[r]]){
+      meanX += out[resting[end]].x;
+      meanY += out[resting[end]].y;
+      end++;
+    }
+    meanX /= end - r;
+    meanY /= end - r;
+    for(; r < end; r++){
+      double dx = out[resting[r]].x - meanX;
+      double dy = out[resting[r]].y - meanY;
+      still += dx * dx + dy * dy;
+    }
+  }
+
+  std::vector<double> sorted = speeds;
+  std::sort(sorted.begin(), sorted.end());
+  double fastSpeed = sorted.empty() ? 0 : sorted[sorted.size() * 4 / 5];
+  std::vector<size_t> fast;
+  for(size_t m = 0; m < moving.size(); m++){
+    if(speeds[m] >= fastSpeed){
+      fast.push_back(moving[m]);
+    }
+  }
+
+  s.still = resting.empty() ? 0 : sqrt(still / resting.size());
+  s.track = moving.empty() ? 0 : sqrt(track / moving.size());
+  s.lag = bestLag(readings, out, moving, strokeOf);
+  s.fast = bestLag(readings, out, fast, strokeOf);
+  return s;
+}
+
+/*------------------------------------------*/
+/*  RawFilter - no filtering, the baseline  */
+/*------------------------------------------*/
+class RawFilter {
+  public:
+    bool add(int x, int y, uint32_t us){
+      (void)us;
+      lastX = x;
+      lastY = y;
+      return false;
+    }
+    void reset(){}
+    int x(){ return lastX; }
+    int y(){ return lastY; }
+
+  private:
+    int lastX = 0;
+    int lastY = 0;
+};
+
+static void printRow(const char* name, double noise, const Scores& s){
+  printf("%-24s %5.1f %7.2f %6.1f %6.1f %7.2f %6.1f\n", name, noise, s.still, s.lag, s.fast, s.track, s.ns);
+}
+
+int main(int argc, char** argv){
+  std::vector<int> noises = {2, 4, 8};
+  std::vector<int> cutoffs = {ONE_EURO_MIN_CUTOFF};
+  std::vector<int> betas = {ONE_EURO_BETA};
+  int speedCutoff = ONE_EURO_SPEED_CUTOFF;
+  int hold = 40;
+  const char* tracePath = NULL;
+  int points = 20000;
+  uint32_t seed = 1;
+
+  bool parsed = parseArgs(argc, argv, &seed, &tracePath, [&](const char* arg, const char* value) {
+    if(!strcmp(arg, "--noise")){ noises = parseList(value); return 2; }
+    if(!strcmp(arg, "--cutoff")){ cutoffs = parseList(value); return 2; }
+    if(!strcmp(arg, "--beta")){ betas = parseList(value); return 2; }
+    if(!strcmp(arg, "--speed-cutoff")){ speedCutoff = atoi(value); return 2; }
+    if(!strcmp(arg, "--hold")){ hold = atoi(value); return 2; }
+    if(!strcmp(arg, "--points")){ points = atoi(value); return 2; }
+    return 0;
+  });
+  if(!parsed){
+    return 1;
+  }
+  if(hold <= HOLD_SETTLE){
+    fprintf(stderr, "--hold must be more than %d\n", HOLD_SETTLE);
+    return 1;
+  }
+
+  Trace trace;
+  if(tracePath){
+    if(!loadTrace(tracePath, trace)){
+      fprintf(stderr, "could not read trace %s\n", tracePath);
+      return 1;
+    }
+  }
+  else{
+    trace = syntheticTrace(seed, points);
+  }
+  TraceTicks ticks = traceTicks(trace, seed);
+
+  printf("%s trace, %zu points, %d resting readings per stroke\n",
+         tracePath ? "recorded" : "synthetic", trace.size(), hold);
+  printf("%-24s %5s %7s %6s %6s %7s %6s\n", "filter", "noise", "still", "lag", "fast", "track", "ns");
+
+  for(int noise : noises){
+    std::vector<Reading> readings = makeReadings(trace, ticks, hold, noise, seed);
+
+    RawFilter raw;
+    printRow("raw", noise, score(raw, readings));
+
+    AverageFilter average(Device::Pad::filterCoeff);
+    printRow("average", noise, score(average, readings));
+
+    for(int cutoff : cutoffs){
+      for(int beta : betas){
+        char name[32];
+        snprintf(name, sizeof(name), "one-euro %d/%d", cutoff, beta);
+        OneEuroFilter euro(cutoff, beta, speedCutoff);
+        printRow(name, noise, score(euro, readings));
+      }
+    }
+    printf("\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,370 @@
+#include "Gateway.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+
+uint64_t gatewayMicros(){
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t percentile(std::vector<uint64_t> samples, double p){
+  if(samples.empty()){
+    return 0;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t i = (size_t)(p / 100.0 * (samples.size() - 1) + 0.5);
+  return samples[std::min(i, samples.size() - 1)];
+}
+
+Gateway::Gateway(OcrBackend& backend, const GatewayConfig& config)
+  : batches(0), backend(backend), config(config), inFlight(0), stopping(false), workersLeft(0) {
+  if(this->config.workers < 1){
+    this->config.workers = 1;
+  }
+  if(this->config.ocrThreads < 1){
+    this->config.ocrThreads = 1;
+  }
+  if(this->config.batchSize < 1){
+    this->config.batchSize = 1;
+  }
+}
+
+Gateway::~Gateway(){
+  stop();
+}
+
+void Gateway::start(){
+  stopping = false;
+  workersLeft = config.workers;
+  for(int i = 0; i < config.workers; i++){
+    workers.emplace_back(&Gateway::workerLoop, this);
+  }
+  for(int i = 0; i < config.ocrThreads; i++){
+    ocrThreads.emplace_back(&Gateway::ocrLoop, this);
+  }
+}
+
+void Gateway::stop(){
+  {
+    std::lock_guard<std::mutex> lock(rasterLock);
+    stopping = true;
+  }
+  rasterReady.notify_all();
+  for(std::thread& t : workers){
+    t.join();
+  }
+  for(std::thread& t : ocrThreads){
+    t.join();
+  }
+  workers.clear();
+  ocrThreads.clear();
+}
+
+int Gateway::addDevice(const std::string& name){
+  std::lock_guard<std::mutex> lock(metricsLock);
+  for(size_t i = 0; i < devices.size(); i++){
+    if(devices[i].name == name){
+      return (int)i;
+    }
+  }
+  devices.emplace_back();
+  devices.back().name = name;
+  return (int)devices.size() - 1;
+}
+
+void Gateway::connected(int device, bool up){
+  std::lock_guard<std::mutex> lock(metricsLock);
+  devices[device].connected = up;
+  if(up){
+    devices[device].connections++;
+  }
+}
+
+void Gateway::packet(int device, uint16_t len){
+  uint64_t now = gatewayMicros();
+  std::lock_guard<std::mutex> lock(metricsLock);
+  DeviceMetrics& d = devices[device];
+  if(d.packets == 0){
+    d.firstPacketUs = now;
+  }
+  d.packets++;
+  d.bytes += len;
+  d.lastPacketUs = now;
+}
+
+void Gateway::protocolErrors(int device, unsigned long count){
+  std::lock_guard<std::mutex> lock(metricsLock);
+  devices[device].protocolErrors += count;
+}
+
+/*--------------------------------------------------*/
+/*--                  submit()                    --*/
+/*--------------------------------------------------*/
+/*    Takes the note out of the session (which      */
+/*    starts the next one empty) and numbers it.    */
+/*--------------------------------------------------*/
+void Gateway::submit(GatewayNote& note){
+  Job job;
+  job.note = std::move(note);
+  note = GatewayNote();
+  job.rasterUs = 0;
+  {
+    std::lock_guard<std::mutex> lock(metricsLock);
+    DeviceMetrics& d = devices[job.note.device];
+    job.note.sequence = d.notes++;
+    d.points += job.note.points.size();
+    inFlight++;
+  }
+  {
+    std::lock_guard<std::mutex> lock(rasterLock);
+    rasterQueue.push_back(std::move(job));
+  }
+  rasterReady.notify_one();
+}
+
+size_t Gateway::pending(){
+  std::lock_guard<std::mutex> lock(metricsLock);
+  return inFlight;
+}
+
+/*--------------------------------------------------*/
+/*--                workerLoop()                  --*/
+/*--------------------------------------------------*/
+void Gateway::workerLoop(){
+  for(;;){
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(rasterLock);
+      rasterReady.wait(lock, [this]() { return stopping || !rasterQueue.empty(); });
+      if(rasterQueue.empty()){
+        break;
+      }
+      job = std::move(rasterQueue.front());
+      rasterQueue.pop_front();
+    }
+
+    rasterize(job.note.points, config.rasterScale, job.image);
+    if(config.dumpDir){
+      char path[512];
+      std::string name;
+      {
+        std::lock_guard<std::mutex> lock(metricsLock);
+        name = devices[job.note.device].name;
+      }
+      std::replace(name.begin(), name.end(), '/', '_');
+      snprintf(path, sizeof(path), "%s/%s-%u.bmp", config.dumpDir, name.c_str(), job.note.sequence);
+      if(!writeBmp(job.image, path)){
+        fprintf(stderr, "could not write %s\n", path);
+      }
+    }
+    job.rasterUs = gatewayMicros();
+
+    {
+      std::lock_guard<std::mutex> lock(ocrLock);
+      ocrQueue.push_back(std::move(job));
+    }
+    ocrReady.notify_one();
+  }
+
+  // the last worker out lets the OCR threads drain and stop
+  {
+    std::lock_guard<std::mutex> lock(ocrLock);
+    workersLeft--;
+  }
+  ocrReady.notify_all();
+}
+
+/*--------------------------------------------------*/
+/*--                  ocrLoop()                   --*/
+/*--------------------------------------------------*/
+/*    Waits for a full batch or for the oldest      */
+/*    image's batchWaitMs to run out; once the      */
+/*    workers are gone, sends what is left.         */
+/*--------------------------------------------------*/
+void Gateway::ocrLoop(){
+  for(;;){
+    std::vector<Job> batch;
+    {
+      std::unique_lock<std::mutex> lock(ocrLock);
+      for(;;){
+        if((int)ocrQueue.size() >= config.batchSize){
+          break;
+        }
+        if(ocrQueue.empty()){
+          if(workersLeft == 0){
+            return;
+          }
+          ocrReady.wait(lock);
+          continue;
+        }
+        uint64_t due = ocrQueue.front().rasterUs + (uint64_t)config.batchWaitMs * 1000;
+        uint64_t now = gatewayMicros();
+        if(now >= due || workersLeft == 0){
+          break;
+        }
+        ocrReady.wait_for(lock, std::chrono::microseconds(due - now));
+      }
+
+      size_t take = std::min(ocrQueue.size(), (size_t)config.batchSize);
+      for(size_t i = 0; i < take; i++){
+        batch.push_back(std::move(ocrQueue.front()));
+        ocrQueue.pop_front();
+      }
+      // another thread can start on what is left
+      if(!ocrQueue.empty()){
+        ocrReady.notify_one();
+      }
+    }
+
+    std::vector<const NoteImage*> images;
+    for(const Job& job : batch){
+      images.push_back(&job.image);
+    }
+    std::vector<std::string> texts;
+    bool ok = backend.recognize(images, texts) && texts.size() == batch.size();
+    finish(batch, texts, ok);
+  }
+}
+
+void Gateway::finish(std::vector<Job>& batch, const std::vector<std::string>& texts, bool ok){
+  uint64_t now = gatewayMicros();
+  std::vector<OcrResult> results;
+
+  {
+    std::lock_guard<std::mutex> lock(metricsLock);
+    batches++;
+    for(size_t i = 0; i < batch.size(); i++){
+      const GatewayNote& note = batch[i].note;
+      DeviceMetrics& d = devices[note.device];
+      OcrResult r;
+      r.device = note.device;
+      r.deviceName = d.name;
+      r.sequence = note.sequence;
+      r.points = (int)note.points.size();
+      r.month = note.month;
+      r.day = note.day;
+      r.hour = note.hour;
+      r.minute = note.minute;
+      r.ok = ok;
+      r.text = ok ? texts[i] : std::string();
+      r.penUpUs = note.penUpUs;
+      r.endUs = note.endUs;
+      r.rasterUs = batch[i].rasterUs;
+      r.resultUs = now;
+      results.push_back(r);
+
+      if(ok){
+        d.results++;
+      }
+      else{
+        d.ocrFailures++;
+      }
+      d.latencyUs.push_back(now - note.penUpUs);
+      if(d.latencyUs.size() > GATEWAY_LATENCY_WINDOW){
+        d.latencyUs.pop_front();
+      }
+      inFlight--;
+    }
+  }
+
+  if(onResult){
+    for(const OcrResult& r : results){
+      onResult(r);
+    }
+  }
+}
+
+/*--------------------------------------------------*/
+/*--               writeMetrics()                 --*/
+/*--------------------------------------------------*/
+/*    Per device: counters, whether it is connected */
+/*    now, rates over the time it was sending, and  */
+/*    latency quantiles. Then the queues.           */
+/*--------------------------------------------------*/
+void Gateway::writeMetrics(FILE* out){
+  std::lock_guard<std::mutex> lock(metricsLock);
+
+  static const struct { const char* name; const char* type; const char* help; } families[] = {
+    {"calendurr_gateway_connected", "gauge", "Device is connected now"},
+    {"calendurr_gateway_connections_total", "counter", "Connections the device made"},
+    {"calendurr_gateway_packets_total", "counter", "Notifications received"},
+    {"calendurr_gateway_bytes_total", "counter", "Notification bytes received"},
+    {"calendurr_gateway_points_total", "counter", "Points in finished notes"},
+    {"calendurr_gateway_notes_total", "counter", "Notes finished (END or link lost after STOP)"},
+    {"calendurr_gateway_results_total", "counter", "Notes the OCR backend read"},
+    {"calendurr_gateway_ocr_failures_total", "counter", "Notes in failed OCR batches"},
+    {"calendurr_gateway_protocol_errors_total", "counter", "Messages out of place or unreadable"},
+    {"calendurr_gateway_bytes_per_second", "gauge", "Bytes over the time the device was sending"},
+    {"calendurr_gateway_points_per_second", "gauge", "Points over the time the device was sending"},
+    {"calendurr_gateway_note_latency_seconds", "summary", "Pen-up (STOP) to OCR result, recent notes"},
+  };
+
+  for(size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++){
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", families[f].name, families[f].help,
+            families[f].name, families[f].type);
+    for(const DeviceMetrics& d : devices){
+      double seconds = (d.lastPacketUs - d.firstPacketUs) / 1e6;
+      const char* name = d.name.c_str();
+      switch(f){
+        case 0: fprintf(out, "%s{device=\"%s\"} %d\n", families[f].name, name, d.connected ? 1 : 0); break;
+        case 1: fprintf(out, "%s{device=\"%s\"} %lu\n", families[f].name, name, d.connections); break;
+        case 2: fprintf(out, "%s{device=\"%s\"} %lu\n", families[f].name, name, d.packets); break;
+        case 3: fprintf(out, "%s{device=\"%s\"} %lu\n", families[f].name, name, d.bytes); break;
+        case 4: fprintf(out, "%s{device=\"%s\"} %lu\n", families[f].name, name, d.points); break;
+        case 5: fprintf(out, "%s{device=\"%s\"} %lu\n", families[f].name, name, d.notes); break;
+        case 6: fprintf(out, "%s{device=\"%s\"} %lu\n", families[f].name, name, d.results); break;
+        case 7: fprintf(out, "%s{device=\"%s\"} %lu\n", families[f].name, name, d.ocrFailures); break;
+        case 8: fprintf(out, "%s{device=\"%s\"} %lu\n", families[f].name, name, d.protocolErrors); break;
+        case 9: fprintf(out, "%s{device=\"%s\"} %.1f\n", families[f].name, name, seconds > 0 ? d.bytes / seconds : 0); break;
+        case 10: fprintf(out, "%s{device=\"%s\"} %.1f\n", families[f].name, name, seconds > 0 ? d.points / seconds : 0); break;
+        default: {
+          std::vector<uint64_t> samples(d.latencyUs.begin(), d.latencyUs.end());
+          uint64_t sum = 0;
+          for(uint64_t s : samples){
+            sum += s;
+          }
+          fprintf(out, "%s{device=\"%s\",quantile=\"0.5\"} %.6f\n", families[f].name, name, percentile(samples, 50) / 1e6);
+          fprintf(out, "%s{device=\"%s\",quantile=\"0.99\"} %.6f\n", families[f].name, name, percentile(samples, 99) / 1e6);
+          fprintf(out, "%s_sum{device=\"%s\"} %.6f\n", families[f].name, name, sum / 1e6);
+          fprintf(out, "%s_count{device=\"%s\"} %zu\n", families[f].name, name, samples.size());
+          break;
+        }
+      }
+    }
+  }
+
+  size_t rasterWaiting, ocrWaiting;
+  {
+    std::lock_guard<std::mutex> rasterHold(rasterLock);
+    rasterWaiting = rasterQueue.size();
+  }
+  {
+    std::lock_guard<std::mutex> ocrHold(ocrLock);
+    ocrWaiting = ocrQueue.size();
+  }
+  fprintf(out, "# HELP calendurr_gateway_raster_queue Notes waiting for a worker\n"
+               "# TYPE calendurr_gateway_raster_queue gauge\ncalendurr_gateway_raster_queue %zu\n", rasterWaiting);
+  fprintf(out, "# HELP calendurr_gateway_ocr_queue Images waiting for a batch\n"
+               "# TYPE calendurr_gateway_ocr_queue gauge\ncalendurr_gateway_ocr_queue %zu\n", ocrWaiting);
+  fprintf(out, "# HELP calendurr_gateway_batches_total OCR calls made\n"
+               "# TYPE calendurr_gateway_batches_total counter\ncalendurr_gateway_batches_total %lu\n", batches);
+  fprintf(out, "# HELP calendurr_gateway_ocr_backend Backend in use\n"
+               "# TYPE calendurr_gateway_ocr_backend gauge\ncalendurr_gateway_ocr_backend{backend=\"%s\"} 1\n",
+          backend.name());
+}
+
+bool Gateway::saveMetrics(const char* path){
+  std::string temp = std::string(path) + ".tmp";
+  FILE* f = fopen(temp.c_str(), "w");
+  if(!f){
+    return false;
+  }
+  writeMetrics(f);
+  if(fclose(f) != 0){
+    return false;
+  }
+  return rename(temp.c_str(), path) == 0;
+}
@@ -0,0 +1,169 @@
+#ifndef CALENDURR_GATEWAY_H
+#define CALENDURR_GATEWAY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Ocr.h"
+#include "Raster.h"
+#include "Session.h"
+
+/*--------------------------------------------------*/
+/*--          NOTE INGEST GATEWAY (host)          --*/
+/*--------------------------------------------------*/
+/*  Takes finished notes from any number of device  */
+/*  sessions and gets them read:                    */
+/*                                                  */
+/*    submit() -> raster queue -> workers           */
+/*    (rasterize) -> OCR queue -> OCR threads       */
+/*    (batches) -> onResult                         */
+/*                                                  */
+/*  An OCR thread sends a batch as soon as          */
+/*  batchSize images wait, or once the oldest has   */
+/*  waited batchWaitMs. Per device it keeps         */
+/*  traffic, notes and the pen-up -> OCR result     */
+/*  latency of the last GATEWAY_LATENCY_WINDOW      */
+/*  notes; writeMetrics() prints them in the        */
+/*  Prometheus text format.                         */
+/*--------------------------------------------------*/
+
+#define GATEWAY_LATENCY_WINDOW 512
+
+/*------------------------------------------*/
+/*  workers - rasterizing threads           */
+/*  ocrThreads - batches in flight at once  */
+/*  batchSize - images per OCR call, at     */
+/*            most                          */
+/*  batchWaitMs - longest an image waits    */
+/*            for a batch to fill           */
+/*  rasterScale - pad units per pixel       */
+/*  dumpDir - every image is also written   */
+/*            there as BMP (NULL: not)      */
+/*------------------------------------------*/
+struct GatewayConfig {
+  int workers = 4;
+  int ocrThreads = 2;
+  int batchSize = 16;
+  uint32_t batchWaitMs = 20;
+  int rasterScale = 1;
+  const char* dumpDir = NULL;
+};
+
+/*------------------------------------------*/
+/*  OcrResult - what onResult gets, with    */
+/*  the times (gatewayMicros()) the note    */
+/*  went through each stage                 */
+/*------------------------------------------*/
+struct OcrResult {
+  int device;
+  std::string deviceName;
+  uint32_t sequence;
+  int points;
+  int month, day, hour, minute;
+  bool ok;
+  std::string text;
+  uint64_t penUpUs;
+  uint64_t endUs;
+  uint64_t rasterUs;      // image ready
+  uint64_t resultUs;
+};
+
+/*------------------------------------------*/
+/*  DeviceMetrics - per device, since the   */
+/*  gateway started                         */
+/*------------------------------------------*/
+struct DeviceMetrics {
+  std::string name;
+  bool connected = false;
+  unsigned long connections = 0;
+  unsigned long packets = 0;
+  unsigned long bytes = 0;
+  unsigned long points = 0;
+  unsigned long notes = 0;
+  unsigned long results = 0;
+  unsigned long ocrFailures = 0;
+  unsigned long protocolErrors = 0;
+  uint64_t firstPacketUs = 0;
+  uint64_t lastPacketUs = 0;
+  std::deque<uint64_t> latencyUs;   // pen-up -> result, newest last
+};
+
+class Gateway {
+  public:
+    Gateway(OcrBackend& backend, const GatewayConfig& config);
+    ~Gateway();
+
+    void start();
+
+    // Finishes every note already submitted, then stops the threads
+    void stop();
+
+    // The device with this name, added if it is new
+    int addDevice(const std::string& name);
+
+    // Transport events, from the transport thread
+    void connected(int device, bool up);
+    void packet(int device, uint16_t len);
+    void protocolErrors(int device, unsigned long count);
+    void submit(GatewayNote& note);
+
+    // Notes submitted but not yet answered
+    size_t pending();
+
+    void writeMetrics(FILE* out);
+    // writeMetrics() to path, replaced in one step; false if it failed
+    bool saveMetrics(const char* path);
+
+    // Called on an OCR thread for every note, in no particular order
+    // across devices
+    std::function<void(const OcrResult&)> onResult;
+
+    unsigned long batches;
+
+  private:
+    struct Job {
+      GatewayNote note;
+      NoteImage image;
+      uint64_t rasterUs;
+    };
+
+    void workerLoop();
+    void ocrLoop();
+    void finish(std::vector<Job>& batch, const std::vector<std::string>& texts, bool ok);
+
+    OcrBackend& backend;
+    GatewayConfig config;
+
+    std::mutex metricsLock;
+    std::deque<DeviceMetrics> devices;
+    size_t inFlight;
+
+    std::mutex rasterLock;
+    std::condition_variable rasterReady;
+    std::deque<Job> rasterQueue;
+    bool stopping;
+
+    std::mutex ocrLock;
+    std::condition_variable ocrReady;
+    std::deque<Job> ocrQueue;
+    int workersLeft;
+
+    std::vector<std::thread> workers;
+    std::vector<std::thread> ocrThreads;
+};
+
+// Microseconds on the clock every stage and the load test use
+uint64_t gatewayMicros();
+
+// p-th percentile (0-100) of samples, 0 if empty
+uint64_t percentile(std::vector<uint64_t> samples, double p);
+
+#endif
@@ -0,0 +1,21 @@
+#include "Ocr.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <thread>
+
+StubOcr::StubOcr(uint32_t baseMs, uint32_t perImageMs) : baseMs(baseMs), perImageMs(perImageMs) {}
+
+bool StubOcr::recognize(const std::vector<const NoteImage*>& images, std::vector<std::string>& texts){
+  std::this_thread::sleep_for(std::chrono::milliseconds(baseMs + perImageMs * images.size()));
+
+  texts.clear();
+  for(const NoteImage* image : images){
+    char text[64];
+    snprintf(text, sizeof(text), "[stub %dx%d, %d strokes, %d px]",
+             image->width, image->height, image->strokes, image->ink);
+    texts.push_back(text);
+  }
+  return true;
+}
@@ -0,0 +1,49 @@
+#ifndef CALENDURR_GATEWAY_OCR_H
+#define CALENDURR_GATEWAY_OCR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Raster.h"
+
+/*--------------------------------------------------*/
+/*--          OCR BACKENDS (gateway)              --*/
+/*--------------------------------------------------*/
+/*  The gateway hands the backend a batch of note   */
+/*  images and gets one text back per image, in     */
+/*  order. recognize() may block (a remote API      */
+/*  call); the gateway runs several batches at once */
+/*  on its OCR threads, so it must be safe to call  */
+/*  from more than one thread.                      */
+/*                                                  */
+/*  StubOcr is the local stand-in for tests and the */
+/*  load test: it waits like a remote service would */
+/*  (baseMs per call plus perImageMs per image) and */
+/*  describes each image instead of reading it.     */
+/*--------------------------------------------------*/
+
+class OcrBackend {
+  public:
+    virtual ~OcrBackend() {}
+
+    // texts gets exactly images.size() entries; false if the whole
+    // batch failed (texts are then left empty)
+    virtual bool recognize(const std::vector<const NoteImage*>& images, std::vector<std::string>& texts) = 0;
+
+    virtual const char* name() = 0;
+};
+
+class StubOcr : public OcrBackend {
+  public:
+    StubOcr(uint32_t baseMs = 40, uint32_t perImageMs = 2);
+
+    bool recognize(const std::vector<const NoteImage*>& images, std::vector<std::string>& texts) override;
+    const char* name() override { return "stub"; }
+
+  private:
+    uint32_t baseMs;
+    uint32_t perImageMs;
+};
+
+#endif
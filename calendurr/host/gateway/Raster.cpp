@@ -0,0 +1,150 @@
+#include "Raster.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void stamp(NoteImage& image, int cx, int cy){
+  const int r = RASTER_PEN / 2;
+  for(int y = cy - r; y <= cy + r; y++){
+    if(y < 0 || y >= image.height){
+      continue;
+    }
+    uint8_t* row = image.pixels.data() + (size_t)y * image.width;
+    for(int x = cx - r; x <= cx + r; x++){
+      if(x < 0 || x >= image.width || (x - cx) * (x - cx) + (y - cy) * (y - cy) > r * r + r){
+        continue;
+      }
+      if(row[x] != RASTER_INK){
+        row[x] = RASTER_INK;
+        image.ink++;
+      }
+    }
+  }
+}
+
+// Bresenham, stamping the pen at every step
+static void line(NoteImage& image, int x0, int y0, int x1, int y1){
+  int dx = abs(x1 - x0);
+  int dy = -abs(y1 - y0);
+  int sx = x0 < x1 ? 1 : -1;
+  int sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+
+  for(;;){
+    stamp(image, x0, y0);
+    if(x0 == x1 && y0 == y1){
+      break;
+    }
+    int e2 = 2 * err;
+    if(e2 >= dy){
+      err += dy;
+      x0 += sx;
+    }
+    if(e2 <= dx){
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                 rasterize()                  --*/
+/*--------------------------------------------------*/
+void rasterize(const Trace& points, int scale, NoteImage& image){
+  image.strokes = 0;
+  image.ink = 0;
+  if(points.empty()){
+    // what the web page makes of an empty note
+    image.width = 100;
+    image.height = 100;
+    image.pixels.assign(100 * 100, RASTER_WHITE);
+    return;
+  }
+
+  int minX = points[0][0], maxX = points[0][0];
+  int minY = points[0][1], maxY = points[0][1];
+  for(const TracePoint& p : points){
+    minX = p[0] < minX ? p[0] : minX;
+    maxX = p[0] > maxX ? p[0] : maxX;
+    minY = p[1] < minY ? p[1] : minY;
+    maxY = p[1] > maxY ? p[1] : maxY;
+  }
+
+  if(scale < 1){
+    scale = 1;
+  }
+  int side = (maxX - minX > maxY - minY ? maxX - minX : maxY - minY) + 1;
+  while((side - 1) / scale + 1 + 2 * RASTER_PADDING > RASTER_MAX_SIDE){
+    scale++;
+  }
+
+  image.width = (maxX - minX) / scale + 1 + 2 * RASTER_PADDING;
+  image.height = (maxY - minY) / scale + 1 + 2 * RASTER_PADDING;
+  image.pixels.assign((size_t)image.width * image.height, RASTER_WHITE);
+
+  int lastX = 0, lastY = 0;
+  for(size_t i = 0; i < points.size(); i++){
+    int x = (points[i][0] - minX) / scale + RASTER_PADDING;
+    int y = (points[i][1] - minY) / scale + RASTER_PADDING;
+    if(strokeStartAt(points, i)){
+      image.strokes++;
+      stamp(image, x, y);
+    }
+    else{
+      line(image, lastX, lastY, x, y);
+    }
+    lastX = x;
+    lastY = y;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                 writeBmp()                   --*/
+/*--------------------------------------------------*/
+/*    BITMAPINFOHEADER, 8 bits with a grey palette, */
+/*    rows bottom-up and padded to 4 bytes.         */
+/*--------------------------------------------------*/
+static void put16(uint8_t* at, uint16_t v){
+  at[0] = v & 0xFF;
+  at[1] = v >> 8;
+}
+
+static void put32(uint8_t* at, uint32_t v){
+  put16(at, v & 0xFFFF);
+  put16(at + 2, v >> 16);
+}
+
+bool writeBmp(const NoteImage& image, const char* path){
+  uint32_t stride = (image.width + 3) & ~3;
+  uint32_t offset = 14 + 40 + 256 * 4;
+  uint8_t header[14 + 40] = {0};
+
+  header[0] = 'B';
+  header[1] = 'M';
+  put32(header + 2, offset + stride * image.height);
+  put32(header + 10, offset);
+  put32(header + 14, 40);
+  put32(header + 18, image.width);
+  put32(header + 22, image.height);
+  put16(header + 26, 1);
+  put16(header + 28, 8);
+  put32(header + 34, stride * image.height);
+  put32(header + 46, 256);
+
+  FILE* f = fopen(path, "wb");
+  if(!f){
+    return false;
+  }
+  fwrite(header, 1, sizeof(header), f);
+  for(int i = 0; i < 256; i++){
+    uint8_t entry[4] = {(uint8_t)i, (uint8_t)i, (uint8_t)i, 0};
+    fwrite(entry, 1, 4, f);
+  }
+  std::vector<uint8_t> row(stride, 0);
+  for(int y = image.height - 1; y >= 0; y--){
+    memcpy(row.data(), image.pixels.data() + (size_t)y * image.width, image.width);
+    fwrite(row.data(), 1, stride, f);
+  }
+  return fclose(f) == 0;
+}
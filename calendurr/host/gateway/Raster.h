@@ -0,0 +1,49 @@
+#ifndef CALENDURR_GATEWAY_RASTER_H
+#define CALENDURR_GATEWAY_RASTER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "Trace.h"
+
+/*--------------------------------------------------*/
+/*--          NOTE RASTERIZER (gateway)           --*/
+/*--------------------------------------------------*/
+/*  Draws a note the way BluetoothPage.js does for  */
+/*  the Vision API: black ink on white, the image   */
+/*  just the note's extent plus RASTER_PADDING, one */
+/*  pixel per pad unit, RASTER_PEN pixels wide.     */
+/*  Consecutive points are joined with a line       */
+/*  (the web page stamps dots, which leaves gaps    */
+/*  once the firmware resamples), except across a   */
+/*  jump of TRACE_PEN_LIFT where the pen was        */
+/*  lifted. Notes wider than RASTER_MAX_SIDE are    */
+/*  scaled down to fit.                             */
+/*--------------------------------------------------*/
+
+#define RASTER_PADDING 10
+#define RASTER_PEN 3
+#define RASTER_MAX_SIDE 2048
+#define RASTER_WHITE 255
+#define RASTER_INK 0
+
+/*------------------------------------------*/
+/*  NoteImage - 8-bit grey, row by row from */
+/*  the top; strokes / ink for the stub OCR */
+/*------------------------------------------*/
+struct NoteImage {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> pixels;
+  int strokes = 0;
+  int ink = 0;          // pixels drawn
+};
+
+// scale: pad units per pixel (1 = the web page)
+void rasterize(const Trace& points, int scale, NoteImage& image);
+
+// 8-bit greyscale BMP, what the web page uploads; false if it could not
+// be written
+bool writeBmp(const NoteImage& image, const char* path);
+
+#endif
@@ -0,0 +1,165 @@
+#include "Session.h"
+
+DeviceSession::DeviceSession(int device)
+  : errors(0), device(device), state(IDLE), haveCounter(false), lastCounter(0), refining(false) {}
+
+void DeviceSession::error(const char* what){
+  errors++;
+  lastError = what;
+}
+
+void DeviceSession::begin(uint64_t nowUs){
+  note = GatewayNote();
+  note.device = device;
+  note.firstUs = nowUs;
+  decoder.start();
+  refining = false;
+  state = COLLECTING;
+}
+
+/*--------------------------------------------------*/
+/*--                   place()                    --*/
+/*--------------------------------------------------*/
+/*    A PROGRESSIVE frame: its points go to their   */
+/*    index, the gaps fill in as the refinement     */
+/*    arrives.                                      */
+/*--------------------------------------------------*/
+void DeviceSession::place(const uint8_t* data, uint16_t len, uint64_t nowUs){
+  ProgressivePoint decoded[NOTE_MAX_PAYLOAD / 5];
+  bool refine = false;
+  int n = parseProgressive(data, len, decoded, NOTE_MAX_PAYLOAD / 5, &refine);
+  if(n == 0){
+    error("empty point packet");
+    return;
+  }
+
+  if(refine){
+    refining = true;
+  }
+  else if(!refining){
+    note.previewUs = nowUs;
+  }
+
+  for(int i = 0; i < n; i++){
+    size_t at = decoded[i].index;
+    if(note.points.size() <= at){
+      note.points.resize(at + 1);
+      note.ticks.resize(at + 1);
+    }
+    note.points[at] = {decoded[i].x, decoded[i].y};
+    note.ticks[at] = decoded[i].ticks;
+  }
+}
+
+bool DeviceSession::finish(uint64_t nowUs){
+  if(note.penUpUs == 0){
+    note.penUpUs = nowUs;
+  }
+  note.endUs = nowUs;
+  state = IDLE;
+  return true;
+}
+
+/*--------------------------------------------------*/
+/*--                  receive()                   --*/
+/*--------------------------------------------------*/
+bool DeviceSession::receive(const uint8_t* data, uint16_t len, uint64_t nowUs){
+  unsigned long counter = 0;
+  MessageType type = parseControl(data, len, &counter);
+
+  if(type != MSG_POINTS && type != MSG_UNKNOWN){
+    if(haveCounter && counter != lastCounter + 1){
+      error("control counter skipped");
+    }
+    haveCounter = true;
+    lastCounter = counter;
+  }
+
+  switch(type){
+    case MSG_START:
+      if(state == COLLECTING && !note.points.empty()){
+        error("START inside a note");
+      }
+      begin(nowUs);
+      break;
+
+    case MSG_POINTS: {
+      if(state != COLLECTING){
+        error("points outside a note");
+        if(state != IDLE){
+          break;
+        }
+        begin(nowUs);
+      }
+      if(data[0] == PROGRESSIVE_TAG){
+        place(data, len, nowUs);
+        break;
+      }
+      TimedPoint decoded[NOTE_MAX_PAYLOAD / 4];
+      int n = decoder.decode(data, len, decoded, NOTE_MAX_PAYLOAD / 4);
+      for(int i = 0; i < n; i++){
+        note.points.push_back({decoded[i].x, decoded[i].y});
+        note.ticks.push_back(decoded[i].ticks);
+      }
+      if(n == 0){
+        error("empty point packet");
+      }
+      break;
+    }
+
+    case MSG_STOP:
+      if(state != COLLECTING){
+        error("STOP without START");
+        if(state == IDLE){
+          begin(nowUs);
+        }
+      }
+      note.penUpUs = nowUs;
+      state = WAITING_FOR_DATE;
+      break;
+
+    case MSG_DATE:
+      if(state != WAITING_FOR_DATE || !parseDate(data, len, &note.month, &note.day)){
+        error("DATE out of place");
+        break;
+      }
+      state = HAS_DATE;
+      break;
+
+    case MSG_TIME:
+      if(state != HAS_DATE || !parseDate(data, len, &note.hour, &note.minute)){
+        error("TIME out of place");
+        note.hour = -1;
+        note.minute = -1;
+      }
+      break;
+
+    case MSG_END:
+      if(state == IDLE){
+        error("END without a note");
+        break;
+      }
+      if(state == COLLECTING){
+        error("END before STOP");
+      }
+      return finish(nowUs);
+
+    default:
+      error("unknown packet");
+      break;
+  }
+
+  return false;
+}
+
+bool DeviceSession::disconnect(uint64_t nowUs){
+  if(state == WAITING_FOR_DATE || state == HAS_DATE){
+    error("link lost before END");
+    return finish(nowUs);
+  }
+  if(state == COLLECTING && !note.points.empty()){
+    error("link lost inside a note");
+  }
+  state = IDLE;
+  return false;
+}
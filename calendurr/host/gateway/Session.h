@@ -0,0 +1,89 @@
+#ifndef CALENDURR_GATEWAY_SESSION_H
+#define CALENDURR_GATEWAY_SESSION_H
+
+#include <stdint.h>
+#include <string>
+
+#include "Protocol.h"
+#include "Trace.h"
+
+/*--------------------------------------------------*/
+/*--        GATEWAY DEVICE SESSION (protocol)     --*/
+/*--------------------------------------------------*/
+/*  One per connected device. Takes the values the  */
+/*  data characteristic notified, in order, and     */
+/*  follows the same messages as BluetoothPage.js:  */
+/*  START -> points -> STOP -> DATE -> TIME         */
+/*  (optional) -> END. Any framing the firmware can */
+/*  send (text, packed, binary, timed or not) is    */
+/*  decoded with lib/Protocol; PROGRESSIVE points   */
+/*  are put back in order by their index.           */
+/*                                                  */
+/*  Unlike host/sim's checker it has no expected    */
+/*  note and keeps going: points without a START    */
+/*  open a note, a missing DATE leaves it at 0/0,   */
+/*  and every such slip is counted in errors.       */
+/*  NOTE_RELIABLE, NOTE_CHANNELS and NOTE_STROKES   */
+/*  frames are not handled here.                    */
+/*--------------------------------------------------*/
+
+/*------------------------------------------*/
+/*  GatewayNote - one finished note         */
+/*  sequence - notes the gateway took from  */
+/*            this device before, over any  */
+/*            connection                    */
+/*  firstUs - first packet of the note      */
+/*  previewUs - the preview pass of a       */
+/*            progressive note was in (0:   */
+/*            not progressive)              */
+/*  penUpUs - STOP arrived (the SEND press) */
+/*  endUs - END arrived (or the link went)  */
+/*------------------------------------------*/
+struct GatewayNote {
+  int device = -1;
+  uint32_t sequence = 0;
+  Trace points;
+  TraceTicks ticks;
+  int month = 0;
+  int day = 0;
+  int hour = -1;
+  int minute = -1;
+  uint64_t firstUs = 0;
+  uint64_t previewUs = 0;
+  uint64_t penUpUs = 0;
+  uint64_t endUs = 0;
+};
+
+class DeviceSession {
+  public:
+    explicit DeviceSession(int device);
+
+    // One notification received at nowUs; true if it finished a note,
+    // which is then in note until the next call
+    bool receive(const uint8_t* data, uint16_t len, uint64_t nowUs);
+
+    // The link went down at nowUs; true if a note had got as far as
+    // STOP and is handed over as it is
+    bool disconnect(uint64_t nowUs);
+
+    GatewayNote note;
+    unsigned long errors;
+    std::string lastError;
+
+  private:
+    enum State { IDLE, COLLECTING, WAITING_FOR_DATE, HAS_DATE };
+
+    void begin(uint64_t nowUs);
+    bool finish(uint64_t nowUs);
+    void error(const char* what);
+    void place(const uint8_t* data, uint16_t len, uint64_t nowUs);
+
+    int device;
+    State state;
+    bool haveCounter;
+    unsigned long lastCounter;
+    PointDecoder decoder;
+    bool refining;
+};
+
+#endif
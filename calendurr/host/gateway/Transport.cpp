@@ -0,0 +1,164 @@
+#include "Transport.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define TRANSPORT_EVENTS 64
+#define TRANSPORT_POLL_MS 100
+
+SeqpacketServer::SeqpacketServer(Gateway& gateway)
+  : accepted(0), gateway(gateway), listenFd(-1), epollFd(-1), running(false) {}
+
+SeqpacketServer::~SeqpacketServer(){
+  stop();
+}
+
+bool SeqpacketServer::listen(const char* socketPath){
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(socketPath) >= sizeof(addr.sun_path)){
+    fprintf(stderr, "socket path too long: %s\n", socketPath);
+    return false;
+  }
+  strcpy(addr.sun_path, socketPath);
+
+  listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(listenFd < 0){
+    perror("socket");
+    return false;
+  }
+  unlink(socketPath);
+  if(bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listenFd, TRANSPORT_BACKLOG) != 0){
+    perror(socketPath);
+    close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+  path = socketPath;
+
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = listenFd;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+  return true;
+}
+
+void SeqpacketServer::start(){
+  running = true;
+  thread = std::thread(&SeqpacketServer::run, this);
+}
+
+void SeqpacketServer::stop(){
+  if(running.exchange(false)){
+    thread.join();
+  }
+  while(!connections.empty()){
+    drop(connections.begin()->first, connections.begin()->second);
+  }
+  if(listenFd >= 0){
+    close(listenFd);
+    unlink(path.c_str());
+    listenFd = -1;
+  }
+  if(epollFd >= 0){
+    close(epollFd);
+    epollFd = -1;
+  }
+}
+
+void SeqpacketServer::run(){
+  epoll_event events[TRANSPORT_EVENTS];
+
+  while(running){
+    int n = epoll_wait(epollFd, events, TRANSPORT_EVENTS, TRANSPORT_POLL_MS);
+    for(int i = 0; i < n; i++){
+      int fd = events[i].data.fd;
+      if(fd == listenFd){
+        acceptAll();
+        continue;
+      }
+      auto found = connections.find(fd);
+      if(found != connections.end() && !readAll(fd, found->second)){
+        drop(fd, found->second);
+      }
+    }
+  }
+}
+
+void SeqpacketServer::acceptAll(){
+  for(;;){
+    int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(fd < 0){
+      return;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    connections[fd] = Connection();
+    accepted++;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                  readAll()                   --*/
+/*--------------------------------------------------*/
+/*    Every datagram waiting on the connection; the */
+/*    first one names the device. false once the    */
+/*    other end has closed it.                      */
+/*--------------------------------------------------*/
+bool SeqpacketServer::readAll(int fd, Connection& connection){
+  uint8_t datagram[NOTE_MAX_PAYLOAD + TRANSPORT_NAME_MAX];
+
+  for(;;){
+    ssize_t n = recv(fd, datagram, sizeof(datagram), MSG_DONTWAIT);
+    if(n == 0){
+      return false;
+    }
+    if(n < 0){
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+
+    if(!connection.session){
+      std::string name((const char*)datagram, n > TRANSPORT_NAME_MAX ? TRANSPORT_NAME_MAX : n);
+      connection.device = gateway.addDevice(name);
+      connection.session.reset(new DeviceSession(connection.device));
+      gateway.connected(connection.device, true);
+      continue;
+    }
+
+    DeviceSession& session = *connection.session;
+    bool done = session.receive(datagram, n > NOTE_MAX_PAYLOAD ? NOTE_MAX_PAYLOAD : n, gatewayMicros());
+    gateway.packet(connection.device, n);
+    if(session.errors != connection.errors){
+      gateway.protocolErrors(connection.device, session.errors - connection.errors);
+      connection.errors = session.errors;
+    }
+    if(done){
+      gateway.submit(session.note);
+    }
+  }
+}
+
+void SeqpacketServer::drop(int fd, Connection& connection){
+  if(connection.session){
+    DeviceSession& session = *connection.session;
+    if(session.disconnect(gatewayMicros())){
+      gateway.submit(session.note);
+    }
+    gateway.protocolErrors(connection.device, session.errors - connection.errors);
+    gateway.connected(connection.device, false);
+  }
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+  close(fd);
+  connections.erase(fd);
+}
@@ -0,0 +1,71 @@
+#ifndef CALENDURR_GATEWAY_TRANSPORT_H
+#define CALENDURR_GATEWAY_TRANSPORT_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "Gateway.h"
+#include "Session.h"
+
+/*--------------------------------------------------*/
+/*--        LOCAL DEVICE TRANSPORT (gateway)      --*/
+/*--------------------------------------------------*/
+/*  A SOCK_SEQPACKET socket in the file system, the */
+/*  same framing host/sim uses between SimLink and  */
+/*  its receiver: one connection per device, one    */
+/*  datagram per notification of the data         */
+/*  characteristic, exactly as the device sent it.  */
+/*  Whatever holds the BLE links (a BlueZ central,  */
+/*  a phone bridge, the load test) connects once    */
+/*  per device and first sends the device's name    */
+/*  (its address, say); a device that reconnects    */
+/*  under the same name keeps its metrics.          */
+/*                                                  */
+/*  One thread serves every connection with epoll.  */
+/*--------------------------------------------------*/
+
+#define TRANSPORT_NAME_MAX 64
+#define TRANSPORT_BACKLOG 1024
+
+class SeqpacketServer {
+  public:
+    explicit SeqpacketServer(Gateway& gateway);
+    ~SeqpacketServer();
+
+    // Binds path (replacing a stale socket there); false on failure
+    bool listen(const char* path);
+
+    void start();
+
+    // Closes every connection (notes past STOP are still handed over)
+    void stop();
+
+    unsigned long accepted;
+
+  private:
+    struct Connection {
+      int device = -1;
+      std::unique_ptr<DeviceSession> session;
+      unsigned long errors = 0;
+    };
+
+    void run();
+    void acceptAll();
+    bool readAll(int fd, Connection& connection);
+    void drop(int fd, Connection& connection);
+
+    Gateway& gateway;
+    std::string path;
+    int listenFd;
+    int epollFd;
+    std::atomic<bool> running;
+    std::thread thread;
+    std::map<int, Connection> connections;
+};
+
+#endif
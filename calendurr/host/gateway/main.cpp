@@ -0,0 +1,400 @@
+/*--------------------------------------------------*/
+/*--         NOTE INGEST GATEWAY (host)           --*/
+/*--------------------------------------------------*/
+/*  Replaces one browser tab per device: accepts    */
+/*  the note streams of many devices at once on a   */
+/*  local socket (Transport.h), decodes them with   */
+/*  the firmware's lib/Protocol, rasterizes them on */
+/*  a worker pool and has them read in batches by   */
+/*  an OCR backend (Ocr.h; the stub stands in for   */
+/*  the Vision API). Metrics per device go to a     */
+/*  Prometheus text file.                           */
+/*                                                  */
+/*  pio run -e native_gateway                       */
+/*  .pio/build/native_gateway/program \             */
+/*      --listen /tmp/calendurr.sock \              */
+/*      --metrics /tmp/calendurr.prom               */
+/*                                                  */
+/*  Without --load (and with no arguments at all)   */
+/*  this is the service: it waits for devices until */
+/*  SIGINT/SIGTERM and prints a line per result.    */
+/*                                                  */
+/*  With --load N it instead runs N simulated       */
+/*  devices against itself over the same socket,    */
+/*  each writing and sending notes like sendData()  */
+/*  does, and reports notes/s and the latency from  */
+/*  pen-up (the SEND press) to the OCR result.      */
+/*                                                  */
+/*  .pio/build/native_gateway/program --load 300    */
+/*                                                  */
+/*  Gateway options:                                */
+/*    --listen PATH      socket, by default         */
+/*                  /tmp/calendurr-gateway.sock     */
+/*    --workers N        rasterizing threads        */
+/*    --ocr-threads N    OCR batches in flight      */
+/*    --batch N          images per OCR call        */
+/*    --batch-ms MS      longest wait for a batch   */
+/*    --ocr-ms MS        stub time per call         */
+/*    --ocr-image-ms MS  stub time per image        */
+/*    --raster-scale N   pad units per pixel        */
+/*    --dump DIR         write every image as BMP   */
+/*    --metrics FILE     Prometheus text file       */
+/*    --metrics-every S  rewrite it this often      */
+/*    --quiet            no line per result         */
+/*  Load test options:                              */
+/*    --load N           simulated devices          */
+/*    --notes N          notes per device           */
+/*    --points N         points per note            */
+/*    --write-ms MS      writing time per note      */
+/*                       (varies +-50%)             */
+/*    --framing F        text, packed, binary,      */
+/*                       progressive                */
+/*    --mtu N            ATT MTU of every link      */
+/*    --packet-us US     time per notification      */
+/*    --seed N           generator seed             */
+/*--------------------------------------------------*/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Gateway.h"
+#include "Ocr.h"
+#include "PointStore.h"
+#include "Protocol.h"
+#include "Trace.h"
+#include "Transport.h"
+
+#define LOAD_MONTH 4
+#define LOAD_DAY 27
+#define LOAD_HOUR 9
+#define LOAD_MINUTE 30
+#define LOAD_CHUNK 100          // points readSensor() lets pile up before sending
+#define LOAD_TIMEOUT_S 60       // after the last device is done
+
+static std::atomic<bool> quit(false);
+
+static void onSignal(int){
+  quit = true;
+}
+
+struct LoadConfig {
+  int devices = 0;
+  int notes = 3;
+  int points = 400;
+  uint32_t writeMs = 2000;
+  uint8_t framing = FRAMING_BINARY;
+  bool progressive = false;
+  uint16_t mtu = 247;
+  uint32_t packetUs = 1250;
+  uint32_t seed = 1;
+};
+
+/*------------------------------------------*/
+/*  SocketLink - a simulated device's BLE   */
+/*  link: one datagram per notify, each     */
+/*  taking packetUs of air time             */
+/*------------------------------------------*/
+class SocketLink : public NoteLink {
+  public:
+    SocketLink(int fd, uint16_t mtu, uint32_t packetUs) : fd(fd), mtu(mtu), packetUs(packetUs) {}
+
+    uint16_t payloadSize() override { return mtu - 3; }
+    bool notify(const uint8_t* data, uint16_t len) override {
+      bool sent = send(fd, data, len, MSG_NOSIGNAL) == (ssize_t)len;
+      std::this_thread::sleep_for(std::chrono::microseconds(packetUs));
+      return sent;
+    }
+    void pause(uint32_t ms) override { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+    uint32_t now() override { return (uint32_t)(gatewayMicros() / 1000); }
+    bool connected() override { return true; }
+
+  private:
+    int fd;
+    uint16_t mtu;
+    uint32_t packetUs;
+};
+
+/*------------------------------------------*/
+/*  LoadDevice - what one simulated device  */
+/*  sent, for checking the results          */
+/*------------------------------------------*/
+struct LoadDevice {
+  std::vector<std::atomic<uint64_t>> penUpUs;
+  std::vector<int> points;
+  std::atomic<int> results;
+  std::atomic<int> wrong;
+  bool failed = false;
+
+  explicit LoadDevice(int notes) : penUpUs(notes), points(notes, 0), results(0), wrong(0) {}
+};
+
+static int connectTo(const char* path){
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if(fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0){
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+// Sends points [from, to) of the note the way sendCoordinates() does
+static void sendChunk(NoteSender& sender, const Trace& trace, const TraceTicks& ticks, size_t from, size_t to){
+  std::vector<uint8_t> bytes((to - from) * POINT_RECORD_MAX);
+  PointStore store(bytes.data(), bytes.size(), true);
+  Trace part(trace.begin() + from, trace.begin() + to);
+  TraceTicks partTicks(ticks.begin() + from, ticks.begin() + to);
+  storeTrace(part, partTicks, store);
+  sender.sendPoints(store);
+}
+
+/*--------------------------------------------------*/
+/*--                runDevice()                   --*/
+/*--------------------------------------------------*/
+/*    connect_callback() sends START. Every note is */
+/*    written over writeMs, a LOAD_CHUNK of points  */
+/*    going out as it fills (the firmware sends     */
+/*    once more than 100 are stored); then SEND:    */
+/*    the rest, STOP, DATE, TIME, END, START.       */
+/*--------------------------------------------------*/
+static void runDevice(int index, const LoadConfig& load, const char* path, LoadDevice& device){
+  TraceRandom rng(load.seed * 7919 + index);
+  char name[TRANSPORT_NAME_MAX];
+  snprintf(name, sizeof(name), "pen-%04d", index);
+
+  // spread the connections over the first writing period
+  std::this_thread::sleep_for(std::chrono::milliseconds(rng.range(0, load.writeMs)));
+  int fd = connectTo(path);
+  if(fd < 0 || send(fd, name, strlen(name), MSG_NOSIGNAL) < 0){
+    device.failed = true;
+    if(fd >= 0){
+      close(fd);
+    }
+    return;
+  }
+
+  SocketLink link(fd, load.mtu, load.packetUs);
+  NoteSender sender(link, load.framing);
+  sender.progressive = load.progressive;
+  sender.sendStart();
+
+  for(int n = 0; n < load.notes; n++){
+    Trace trace = syntheticTrace(load.seed + index * load.notes + n, load.points);
+    TraceTicks ticks = traceTicks(trace, load.seed + n);
+    device.points[n] = (int)trace.size();
+
+    uint32_t writeMs = load.writeMs / 2 + rng.range(0, load.writeMs);
+    size_t chunks = trace.size() / LOAD_CHUNK;
+    size_t sent = 0;
+    for(size_t c = 1; c <= chunks; c++){
+      std::this_thread::sleep_for(std::chrono::milliseconds(writeMs / (chunks + 1)));
+      sendChunk(sender, trace, ticks, sent, c * LOAD_CHUNK);
+      sent = c * LOAD_CHUNK;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(writeMs / (chunks + 1)));
+
+    device.penUpUs[n] = gatewayMicros();
+    if(sent < trace.size()){
+      sendChunk(sender, trace, ticks, sent, trace.size());
+    }
+    sender.sendStop();
+    sender.sendDate(LOAD_MONTH, LOAD_DAY);
+    sender.sendTime(LOAD_HOUR, LOAD_MINUTE);
+    sender.sendEnd();
+    sender.sendStart();
+  }
+
+  close(fd);
+}
+
+/*--------------------------------------------------*/
+/*--                 runLoad()                    --*/
+/*--------------------------------------------------*/
+static int runLoad(const LoadConfig& load, Gateway& gateway, const char* path){
+  std::vector<std::unique_ptr<LoadDevice>> devices;
+  for(int i = 0; i < load.devices; i++){
+    devices.emplace_back(new LoadDevice(load.notes));
+  }
+  std::vector<uint64_t> latencies;
+  std::vector<uint64_t> transportUs, rasterUs, ocrUs;
+  std::mutex resultsLock;
+  std::atomic<int> results(0);
+
+  gateway.onResult = [&](const OcrResult& r){
+    int index = -1;
+    if(sscanf(r.deviceName.c_str(), "pen-%d", &index) != 1 || index < 0 || index >= load.devices ||
+       (int)r.sequence >= load.notes){
+      return;
+    }
+    LoadDevice& device = *devices[index];
+    bool right = r.ok && r.points == device.points[r.sequence] && r.month == LOAD_MONTH && r.day == LOAD_DAY;
+    if(!right){
+      device.wrong++;
+    }
+    device.results++;
+    std::lock_guard<std::mutex> lock(resultsLock);
+    latencies.push_back(r.resultUs - device.penUpUs[r.sequence]);
+    transportUs.push_back(r.endUs - device.penUpUs[r.sequence]);
+    rasterUs.push_back(r.rasterUs - r.endUs);
+    ocrUs.push_back(r.resultUs - r.rasterUs);
+    results++;
+  };
+
+  uint64_t startUs = gatewayMicros();
+  std::vector<std::thread> threads;
+  for(int i = 0; i < load.devices; i++){
+    threads.emplace_back(runDevice, i, std::cref(load), path, std::ref(*devices[i]));
+  }
+  for(std::thread& t : threads){
+    t.join();
+  }
+  uint64_t sentUs = gatewayMicros();
+
+  int expected = load.devices * load.notes;
+  while(results < expected && gatewayMicros() - sentUs < (uint64_t)LOAD_TIMEOUT_S * 1000000 && !quit){
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  uint64_t endUs = gatewayMicros();
+
+  int failedDevices = 0, wrong = 0;
+  for(const auto& d : devices){
+    failedDevices += d->failed;
+    wrong += d->wrong;
+  }
+  std::lock_guard<std::mutex> lock(resultsLock);
+  double seconds = (endUs - startUs) / 1e6;
+  printf("%d devices x %d notes of %d points, %s framing, mtu %u, %u us per packet\n",
+         load.devices, load.notes, load.points,
+         load.progressive ? "progressive" : load.framing == FRAMING_BINARY ? "binary" : load.framing == FRAMING_TEXT_PACKED ? "packed" : "text",
+         load.mtu, load.packetUs);
+  printf("results %d/%d, wrong %d, devices that could not connect %d, %lu OCR batches\n",
+         results.load(), expected, wrong, failedDevices, gateway.batches);
+  printf("%.1f s, %.1f notes/s, %.0f points/s\n", seconds, results / seconds,
+         (double)results * load.points / seconds);
+  printf("%-22s %9s %9s %9s %9s\n", "ms", "p50", "p95", "p99", "max");
+  const struct { const char* name; std::vector<uint64_t>* samples; } rows[] = {
+    {"pen-up -> OCR result", &latencies},
+    {"  pen-up -> END", &transportUs},
+    {"  END -> image", &rasterUs},
+    {"  image -> result", &ocrUs},
+  };
+  for(const auto& row : rows){
+    printf("%-22s %9.1f %9.1f %9.1f %9.1f\n", row.name, percentile(*row.samples, 50) / 1000.0,
+           percentile(*row.samples, 95) / 1000.0, percentile(*row.samples, 99) / 1000.0,
+           percentile(*row.samples, 100) / 1000.0);
+  }
+
+  return results == expected && wrong == 0 && failedDevices == 0 ? 0 : 3;
+}
+
+static uint8_t framingFromName(const char* name){
+  return !strcmp(name, "binary") || !strcmp(name, "progressive") ? FRAMING_BINARY : !strcmp(name, "packed") ? FRAMING_TEXT_PACKED : FRAMING_TEXT;
+}
+
+int main(int argc, char** argv){
+  GatewayConfig config;
+  LoadConfig load;
+  const char* path = "/tmp/calendurr-gateway.sock";
+  const char* metricsPath = NULL;
+  int metricsEvery = 10;
+  uint32_t ocrMs = 40;
+  uint32_t ocrImageMs = 2;
+  bool quiet = false;
+
+  for(int i = 1; i < argc; i++){
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : "";
+
+    if(!strcmp(arg, "--listen")){ path = value; i++; }
+    else if(!strcmp(arg, "--workers")){ config.workers = atoi(value); i++; }
+    else if(!strcmp(arg, "--ocr-threads")){ config.ocrThreads = atoi(value); i++; }
+    else if(!strcmp(arg, "--batch")){ config.batchSize = atoi(value); i++; }
+    else if(!strcmp(arg, "--batch-ms")){ config.batchWaitMs = atoi(value); i++; }
+    else if(!strcmp(arg, "--ocr-ms")){ ocrMs = atoi(value); i++; }
+    else if(!strcmp(arg, "--ocr-image-ms")){ ocrImageMs = atoi(value); i++; }
+    else if(!strcmp(arg, "--raster-scale")){ config.rasterScale = atoi(value); i++; }
+    else if(!strcmp(arg, "--dump")){ config.dumpDir = value; i++; }
+    else if(!strcmp(arg, "--metrics")){ metricsPath = value; i++; }
+    else if(!strcmp(arg, "--metrics-every")){ metricsEvery = atoi(value); i++; }
+    else if(!strcmp(arg, "--quiet")){ quiet = true; }
+    else if(!strcmp(arg, "--load")){ load.devices = atoi(value); i++; }
+    else if(!strcmp(arg, "--notes")){ load.notes = atoi(value); i++; }
+    else if(!strcmp(arg, "--points")){ load.points = atoi(value); i++; }
+    else if(!strcmp(arg, "--write-ms")){ load.writeMs = atoi(value); i++; }
+    else if(!strcmp(arg, "--framing")){ load.framing = framingFromName(value); load.progressive = !strcmp(value, "progressive"); i++; }
+    else if(!strcmp(arg, "--mtu")){ load.mtu = atoi(value); i++; }
+    else if(!strcmp(arg, "--packet-us")){ load.packetUs = atoi(value); i++; }
+    else if(!strcmp(arg, "--seed")){ load.seed = strtoul(value, NULL, 10); i++; }
+    else{
+      fprintf(stderr, "unknown option %s\n", arg);
+      return 2;
+    }
+  }
+  if(load.mtu < NOTE_MIN_PAYLOAD + 3 || load.mtu > NOTE_MAX_PAYLOAD + 3 || load.notes < 1 || load.points < 1){
+    fprintf(stderr, "--mtu is %d to %d, --notes and --points at least 1\n", NOTE_MIN_PAYLOAD + 3, NOTE_MAX_PAYLOAD + 3);
+    return 2;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  StubOcr ocr(ocrMs, ocrImageMs);
+  Gateway gateway(ocr, config);
+  SeqpacketServer server(gateway);
+  if(!server.listen(path)){
+    return 1;
+  }
+  gateway.start();
+  server.start();
+
+  int status = 0;
+  if(load.devices > 0){
+    status = runLoad(load, gateway, path);
+  }
+  else{
+    gateway.onResult = [quiet](const OcrResult& r){
+      if(!quiet){
+        printf("%s #%u %d/%d %d points %.1f ms %s\n", r.deviceName.c_str(), r.sequence, r.month, r.day,
+               r.points, (r.resultUs - r.penUpUs) / 1000.0, r.ok ? r.text.c_str() : "(OCR failed)");
+        fflush(stdout);
+      }
+    };
+    fprintf(stderr, "listening on %s, OCR backend %s; Ctrl-C stops (--load N runs the load test)\n", path,
+            ocr.name());
+
+    uint64_t lastSaveUs = gatewayMicros();
+    while(!quit){
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if(metricsPath && gatewayMicros() - lastSaveUs >= (uint64_t)metricsEvery * 1000000){
+        lastSaveUs = gatewayMicros();
+        if(!gateway.saveMetrics(metricsPath)){
+          fprintf(stderr, "could not write %s\n", metricsPath);
+        }
+      }
+    }
+  }
+
+  server.stop();
+  gateway.stop();
+  if(metricsPath && !gateway.saveMetrics(metricsPath)){
+    fprintf(stderr, "could not write %s\n", metricsPath);
+    status = status ? status : 1;
+  }
+  return status;
+}
@@ -0,0 +1,233 @@
+/*--------------------------------------------------*/
+/*--           INK MIRROR BENCHMARK (host)        --*/
+/*--------------------------------------------------*/
+/*  Draws traces through the firmware's InkMirror   */
+/*  into a 128x64 framebuffer, one point at a time  */
+/*  with a flush after each, the way storePoint()   */
+/*  does. The flushed runs are copied into a second */
+/*  buffer standing in for the panel, which has to  */
+/*  match the framebuffer at the end. Prints pages  */
+/*  and bytes flushed per point, how many pages per */
+/*  second the host gets through, how many the pen  */
+/*  asks for at the trace's sample rate, and what   */
+/*  that costs on the I2C bus next to a full        */
+/*  display() per point.                            */
+/*                                                  */
+/*  pio run -e native_ink                           */
+/*  .pio/build/native_ink/program --window fit \    */
+/*      --trace coordz.txt                          */
+/*                                                  */
+/*  Options (lists are comma separated):            */
+/*    --resample S,...   ArcResampler step, 0 = off */
+/*    --window X0,Y0,X1,Y1  pad area on the screen  */
+/*                       (default INK_PAD_*, or the */
+/*                       trace's own extent with    */
+/*                       "fit")                     */
+/*    --i2c-khz N        bus clock for the estimate */
+/*    --trace FILE       recorded coordz.txt        */
+/*    --points N         synthetic trace length     */
+/*    --rounds N         timing repetitions         */
+/*    --seed N           generator seed             */
+/*--------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "Args.h"
+#include "InkMirror.h"
+#include "PointTimes.h"
+#include "Trace.h"
+
+#define BENCH_WIDTH 128
+#define BENCH_HEIGHT 64
+#define BENCH_FRAME_BYTES (BENCH_WIDTH * BENCH_HEIGHT / 8)
+
+// Bytes on the bus, the way Adafruit_SSD1306 sends them: every command
+// is its own transaction (address, 0x00, command) and data goes out
+// 0x40 plus up to 31 bytes at a time
+#define I2C_COMMAND_BYTES 3
+#define I2C_DATA_CHUNK 31
+#define I2C_BITS_PER_BYTE 9
+
+// Keeps the optimizer from dropping the loops being timed
+static volatile unsigned long sink;
+
+static double elapsedNs(std::chrono::steady_clock::time_point start){
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint32_t dataBusBytes(uint32_t data){
+  return data + (data + I2C_DATA_CHUNK - 1) / I2C_DATA_CHUNK * 2;
+}
+
+/*------------------------------------------*/
+/*  Panel - what the SSD1306 would show,    */
+/*  built only from the flushed runs, and   */
+/*  the bus traffic they took.              */
+/*------------------------------------------*/
+struct Panel {
+  uint8_t frame[BENCH_FRAME_BYTES];
+  uint32_t pages;
+  uint32_t bytes;
+  uint32_t busBytes;
+};
+
+static void sendRun(uint8_t page, uint8_t first, uint8_t last, const uint8_t* bytes, void* context){
+  Panel* panel = (Panel*)context;
+  uint8_t count = last - first + 1;
+  memcpy(panel->frame + page * BENCH_WIDTH + first, bytes, count);
+  panel->pages++;
+  panel->bytes += count;
+  // PAGEADDR and COLUMNADDR with two arguments each
+  panel->busBytes += 6 * I2C_COMMAND_BYTES + dataBusBytes(count);
+}
+
+/*--------------------------------------------------*/
+/*--                 benchInk()                   --*/
+/*--------------------------------------------------*/
+/*    One row: the whole trace drawn and flushed    */
+/*    point by point, rounds times.                 */
+/*--------------------------------------------------*/
+static bool benchInk(const char* name, const Trace& trace, const TraceTicks& ticks,
+                     const int* window, int khz, int rounds){
+  static uint8_t frame[BENCH_FRAME_BYTES];
+  static Panel panel;
+  InkMirror ink(frame, BENCH_WIDTH, BENCH_HEIGHT);
+  if(window){
+    ink.setPadWindow(window[0], window[1], window[2], window[3]);
+  }
+
+  double ns = 0;
+  uint32_t worstBus = 0;
+  for(int r = 0; r < rounds; r++){
+    ink.clear();
+    memset(&panel, 0, sizeof(panel));
+    worstBus = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < trace.size(); i++){
+      uint32_t before = panel.busBytes;
+      ink.addPoint(trace[i][0], trace[i][1], strokeStartAt(trace, i));
+      ink.flush(sendRun, &panel);
+      if(panel.busBytes - before > worstBus){
+        worstBus = panel.busBytes - before;
+      }
+    }
+    ns += elapsedNs(start);
+    sink = panel.pages;
+  }
+
+  bool exact = memcmp(panel.frame, frame, sizeof(frame)) == 0;
+
+  uint64_t totalTicks = 0;
+  for(uint32_t t : ticks){
+    totalTicks += t;
+  }
+  double writingS = (double)totalTicks * POINT_TICK_US / 1e6;
+  double points = (double)trace.size();
+  double usPerByte = I2C_BITS_PER_BYTE * 1000.0 / khz;
+  uint32_t fullFrameBus = 6 * I2C_COMMAND_BYTES + dataBusBytes(BENCH_FRAME_BYTES);
+  int lit = 0;
+  for(uint8_t b : frame){
+    lit += __builtin_popcount(b);
+  }
+
+  printf("%-16s %6zu %6d %6.2f %6.1f %8.1f %9.0f %8.1f %7.3f %7.3f %7.2f %s\n",
+         name, trace.size(), lit, panel.pages / points, (double)panel.bytes / points,
+         ns / rounds / points, panel.pages * rounds / (ns / 1e9),
+         writingS > 0 ? panel.pages / writingS : 0,
+         panel.busBytes / points * usPerByte / 1000, worstBus * usPerByte / 1000,
+         fullFrameBus * usPerByte / 1000, exact ? "ok" : "MISMATCH");
+  return exact;
+}
+
+int main(int argc, char** argv){
+  std::vector<int> steps = {0, 4};
+  std::vector<int> window;
+  bool fit = false;
+  const char* tracePath = NULL;
+  int points = 20000;
+  int khz = 400;
+  int rounds = 50;
+  uint32_t seed = 1;
+
+  bool parsed = parseArgs(argc, argv, &seed, &tracePath, [&](const char* arg, const char* value) {
+    if(!strcmp(arg, "--resample")){ steps = parseList(value); return 2; }
+    if(!strcmp(arg, "--window")){
+      if(!strcmp(value, "fit")){
+        fit = true;
+      }
+      else{
+        window = parseList(value);
+      }
+      return 2;
+    }
+    if(!strcmp(arg, "--i2c-khz")){ khz = atoi(value); return 2; }
+    if(!strcmp(arg, "--points")){ points = atoi(value); return 2; }
+    if(!strcmp(arg, "--rounds")){ rounds = atoi(value); return 2; }
+    return 0;
+  });
+  if(!parsed){
+    return 1;
+  }
+  if(!window.empty() && window.size() != 4){
+    fprintf(stderr, "--window takes X0,Y0,X1,Y1\n");
+    return 1;
+  }
+  if(khz <= 0 || rounds <= 0){
+    fprintf(stderr, "--i2c-khz and --rounds must be positive\n");
+    return 1;
+  }
+
+  Trace trace;
+  if(tracePath){
+    if(!loadTrace(tracePath, trace)){
+      fprintf(stderr, "could not read trace %s\n", tracePath);
+      return 1;
+    }
+  }
+  else{
+    trace = syntheticTrace(seed, points);
+  }
+  TraceTicks ticks = traceTicks(trace, seed);
+
+  if(fit){
+    window = {trace[0][0], trace[0][1], trace[0][0], trace[0][1]};
+    for(const TracePoint& p : trace){
+      window[0] = p[0] < window[0] ? p[0] : window[0];
+      window[1] = p[1] < window[1] ? p[1] : window[1];
+      window[2] = p[0] > window[2] ? p[0] : window[2];
+      window[3] = p[1] > window[3] ? p[1] : window[3];
+    }
+  }
+
+  if(window.empty()){
+    printf("window %d,%d - %d,%d (INK_PAD_*), I2C %d kHz\n",
+           INK_PAD_X_MIN, INK_PAD_Y_MIN, INK_PAD_X_MAX, INK_PAD_Y_MAX, khz);
+  }
+  else{
+    printf("window %d,%d - %d,%d, I2C %d kHz\n", window[0], window[1], window[2], window[3], khz);
+  }
+  printf("%-16s %6s %6s %6s %6s %8s %9s %8s %7s %7s %7s %s\n",
+         "trace", "points", "pixels", "pg/pt", "B/pt", "ns/pt", "host_pg/s", "pen_pg/s",
+         "i2c_ms", "worst", "full", "check");
+
+  int failed = 0;
+  for(int step : steps){
+    Trace spaced = trace;
+    TraceTicks spacedTicks = ticks;
+    if(step > 0){
+      resampleTrace(trace, ticks, step, spaced, spacedTicks);
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), step > 0 ? "%s/step%d" : "%s", tracePath ? "recorded" : "synthetic", step);
+    failed += !benchInk(name, spaced, spacedTicks, window.empty() ? NULL : window.data(), khz, rounds);
+  }
+
+  return failed ? 1 : 0;
+}
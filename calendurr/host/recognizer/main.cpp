@@ -0,0 +1,555 @@
+/*--------------------------------------------------*/
+/*--        TIME RECOGNIZER BENCHMARK (host)      --*/
+/*--------------------------------------------------*/
+/*  Runs the firmware's TimeRecognizer on written   */
+/*  glyphs and times and prints how often it gets   */
+/*  them right and how long recognize() takes.      */
+/*  Synthetic ink comes from the templates with     */
+/*  random distortion; recordings can be added      */
+/*  with --samples. With --preview the same ink is  */
+/*  also read from only the points a progressive    */
+/*  send puts in its preview (Progressive.h), to    */
+/*  see what reading the first pass costs.          */
+/*                                                  */
+/*  --gestures benchmarks GestureRecognizer         */
+/*  instead: a written word, then a scribble or a   */
+/*  line over it, a check mark beside it, or ink    */
+/*  that must stay ink (a line under the word, big  */
+/*  digits); per kind how often strokeDone() got    */
+/*  it right and how long it took.                  */
+/*                                                  */
+/*  Every run first checks undo (checkUndo()) and   */
+/*  exits 1 if the time field did not follow it.    */
+/*                                                  */
+/*  pio run -e native_recognizer                    */
+/*  .pio/build/native_recognizer/program \          */
+/*      --distortion 10,20,30                       */
+/*                                                  */
+/*  Options (lists are comma separated):            */
+/*    --distortion P,... synthetic distortion (%)   */
+/*    --trials N         renderings per glyph/time  */
+/*    --samples FILE     lines of "9:30 trace.txt", */
+/*                       traces in coordz format    */
+/*    --split N          pen-up step in recordings  */
+/*    --preview STRIDE   also read the preview      */
+/*    --gestures         the gesture benchmark      */
+/*    --seed N           generator seed             */
+/*--------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Args.h"
+#include "InkSynth.h"
+#include "PointStore.h"
+#include "Progressive.h"
+#include "Recognizer.h"
+#include "Strokes.h"
+#include "Trace.h"
+
+// Size of one written character in pad units
+#define BENCH_GLYPH_W 140
+#define BENCH_GLYPH_H 200
+#define BENCH_GLYPH_GAP 40
+
+struct Result {
+  unsigned long tried = 0;
+  unsigned long right = 0;
+  unsigned long rejected = 0;
+  double totalUs = 0;
+  double worstUs = 0;
+
+  void time(double us){
+    totalUs += us;
+    if(us > worstUs){
+      worstUs = us;
+    }
+  }
+};
+
+static double elapsedUs(std::chrono::steady_clock::time_point start){
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static const int8_t* shapeFor(char label, TraceRandom& rng){
+  std::vector<const int8_t*> paths;
+  for(uint8_t i = 0; i < timeGlyphCount; i++){
+    if(timeGlyphs[i].label == label){
+      paths.push_back(timeGlyphs[i].path);
+    }
+  }
+  return paths[rng.range(0, paths.size() - 1)];
+}
+
+/*--------------------------------------------------*/
+/*--                benchGlyphs()                 --*/
+/*--------------------------------------------------*/
+/*    One glyph at a time straight through the      */
+/*    classifier; prints the labels it confuses.    */
+/*--------------------------------------------------*/
+static Result benchGlyphs(int distortion, int trials, TraceRandom& rng){
+  Result result;
+  std::string confusions;
+
+  for(uint8_t g = 0; g < timeGlyphCount; g++){
+    for(int t = 0; t < trials; t++){
+      std::vector<Trace> written = synthGlyph(timeGlyphs[g].path, TIME_FIELD_X_MIN + 100, TIME_FIELD_Y_MIN + 100,
+                                              BENCH_GLYPH_W, BENCH_GLYPH_H, distortion, rng);
+      std::vector<InkPoint> ink;
+      std::vector<InkStroke> strokes;
+      for(const Trace& stroke : written){
+        strokes.push_back({(uint16_t)ink.size(), (uint16_t)stroke.size()});
+        for(const TracePoint& p : stroke){
+          ink.push_back({(int16_t)p[0], (int16_t)p[1]});
+        }
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      GlyphCloud cloud;
+      makeCloud(ink.data(), strokes.data(), strokes.size(), cloud);
+      char label = timeGlyphSet.classify(cloud, TIME_REJECT);
+      result.time(elapsedUs(start));
+
+      result.tried++;
+      if(label == timeGlyphs[g].label){
+        result.right++;
+      }
+      else if(label == 0){
+        result.rejected++;
+      }
+      else if(confusions.size() < 60){
+        confusions += std::string(1, timeGlyphs[g].label) + "->" + label + " ";
+      }
+    }
+  }
+
+  if(!confusions.empty()){
+    printf("    confused: %s\n", confusions.c_str());
+  }
+  return result;
+}
+
+/*--------------------------------------------------*/
+/*--                  feedInk()                   --*/
+/*--------------------------------------------------*/
+/*    Hands the strokes to the recognizer; with a   */
+/*    stride only the points previewPoint() keeps.  */
+/*--------------------------------------------------*/
+static void feedInk(TimeRecognizer& recognizer, const std::vector<Trace>& strokes, int stride){
+  recognizer.reset();
+  for(const Trace& stroke : strokes){
+    for(size_t i = 0; i < stroke.size(); i++){
+      if(stride <= 1 || previewPoint(i, i + 1 == stroke.size(), stride)){
+        recognizer.addPoint(stroke[i][0], stroke[i][1], i == 0);
+      }
+    }
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                 writeTime()                  --*/
+/*--------------------------------------------------*/
+/*    Picks a random time and one of the ways it    */
+/*    could be written ("930", "9:30", "9:30pm",    */
+/*    "9pm") and writes it into strokes.            */
+/*--------------------------------------------------*/
+static std::string writeTime(std::vector<Trace>& strokes, int distortion, TraceRandom& rng, int* hour, int* minute){
+  int h24 = rng.range(0, 23);
+  int m = rng.range(0, 11) * 5;
+  int style = rng.range(0, 3);
+  char text[12];
+
+  if(style == 3){
+    m = 0;
+  }
+  int h12 = h24 % 12 == 0 ? 12 : h24 % 12;
+  switch(style){
+    case 0: snprintf(text, sizeof(text), "%d%02d", h24, m); break;
+    case 1: snprintf(text, sizeof(text), "%d:%02d", h24, m); break;
+    case 2: snprintf(text, sizeof(text), "%d:%02d%s", h12, m, h24 < 12 ? "am" : "pm"); break;
+    default: snprintf(text, sizeof(text), "%d%s", h12, h24 < 12 ? "am" : "pm"); break;
+  }
+  *hour = h24;
+  *minute = m;
+
+  strokes.clear();
+  int x = TIME_FIELD_X_MIN + 40;
+  int y = TIME_FIELD_Y_MIN + 200;
+  for(const char* c = text; *c; c++){
+    if(*c == ':'){
+      strokes.push_back(synthDot(x, y + BENCH_GLYPH_H / 3, rng));
+      strokes.push_back(synthDot(x, y + BENCH_GLYPH_H * 2 / 3, rng));
+      x += BENCH_GLYPH_GAP;
+    }
+    else{
+      std::vector<Trace> glyph = synthGlyph(shapeFor(*c, rng), x, y + rng.range(-20, 20), BENCH_GLYPH_W,
+                                            BENCH_GLYPH_H, distortion, rng);
+      strokes.insert(strokes.end(), glyph.begin(), glyph.end());
+      x += BENCH_GLYPH_W + BENCH_GLYPH_GAP;
+    }
+  }
+
+  return text;
+}
+
+// stride 0 reads all of the ink, otherwise its preview
+static Result benchTimes(int distortion, int trials, int stride, TraceRandom& rng){
+  static TimeRecognizer recognizer;
+  Result result;
+  std::string misses;
+
+  for(int t = 0; t < trials; t++){
+    int hour, minute;
+    std::vector<Trace> strokes;
+    std::string written = writeTime(strokes, distortion, rng, &hour, &minute);
+    feedInk(recognizer, strokes, stride);
+
+    int h = -1, m = -1;
+    char seen[TIME_MAX_GLYPHS + 1];
+    auto start = std::chrono::steady_clock::now();
+    bool ok = recognizer.recognize(&h, &m, seen, sizeof(seen));
+    result.time(elapsedUs(start));
+
+    result.tried++;
+    if(!ok){
+      result.rejected++;
+    }
+    else if(h == hour && m == minute){
+      result.right++;
+      continue;
+    }
+    if(misses.size() < 60){
+      misses += written + "->" + seen + " ";
+    }
+  }
+
+  if(!misses.empty()){
+    printf("    missed: %s\n", misses.c_str());
+  }
+  return result;
+}
+
+/*--------------------------------------------------*/
+/*--               benchSamples()                 --*/
+/*--------------------------------------------------*/
+/*    Recorded time fields. Each line names the     */
+/*    time that was written and a trace of it.      */
+/*--------------------------------------------------*/
+static bool benchSamples(const char* path, int split, int stride, const char* label){
+  FILE* f = fopen(path, "r");
+  if(!f){
+    fprintf(stderr, "cannot read %s\n", path);
+    return false;
+  }
+
+  static TimeRecognizer recognizer;
+  Result result;
+  char expected[32], file[256];
+
+  while(fscanf(f, "%31s %255s", expected, file) == 2){
+    int hour, minute;
+    Trace trace;
+    if(!parseTimeText(expected, &hour, &minute) || !loadTrace(file, trace)){
+      fprintf(stderr, "skipping %s %s\n", expected, file);
+      continue;
+    }
+
+    feedInk(recognizer, splitStrokes(trace, split), stride);
+
+    int h = -1, m = -1;
+    char seen[TIME_MAX_GLYPHS + 1];
+    auto start = std::chrono::steady_clock::now();
+    bool ok = recognizer.recognize(&h, &m, seen, sizeof(seen));
+    result.time(elapsedUs(start));
+
+    result.tried++;
+    if(ok && h == hour && m == minute){
+      result.right++;
+    }
+    else{
+      if(!ok){
+        result.rejected++;
+      }
+      printf("    %s read as \"%s\"\n", expected, seen);
+    }
+  }
+  fclose(f);
+
+  printf("%-8s %6lu %6lu %6lu %7.1f%% %8.1f %8.1f\n", label, result.tried, result.right, result.rejected,
+         result.tried ? 100.0 * result.right / result.tried : 0.0,
+         result.tried ? result.totalUs / result.tried : 0.0, result.worstUs);
+  return true;
+}
+
+/*--------------------------------------------------*/
+/*--               benchGestures()                --*/
+/*--------------------------------------------------*/
+/*    Every trial writes a word of 3-5 digits       */
+/*    (each lifted like the pen would), then one    */
+/*    stroke of the kind tested. The scribbles get  */
+/*    a random number of passes and the lines a     */
+/*    random slant and direction, so they are not   */
+/*    the templates. A gesture counts as right only */
+/*    if it also erases exactly the word (or, for   */
+/*    the check mark, nothing).                     */
+/*--------------------------------------------------*/
+enum GestureKind { KIND_ERASE, KIND_STRIKE, KIND_SEND, KIND_UNDERLINE, KIND_BIG_DIGIT, KIND_COUNT };
+
+static const char* gestureKindNames[KIND_COUNT] = {"erase", "strike", "send", "under", "bigdig"};
+static const char gestureExpected[KIND_COUNT] = {GESTURE_ERASE, GESTURE_STRIKE, GESTURE_SEND, 0, 0};
+
+static void benchGestures(int distortion, int trials, TraceRandom& rng){
+  static GestureRecognizer recognizer;
+
+  for(int kind = 0; kind < KIND_COUNT; kind++){
+    Result result;
+    unsigned long wrong = 0;
+    std::string misses;
+
+    for(int t = 0; t < trials; t++){
+      recognizer.reset();
+      uint16_t index = 0;
+
+      // the word, away from the time field
+      int x0 = 300 + rng.range(0, 400), y0 = 1400 + rng.range(0, 800);
+      int letters = rng.range(3, 5);    // two digits are narrower than GESTURE_MIN_SIZE
+      int x = x0;
+      for(int l = 0; l < letters; l++){
+        const int8_t* path = shapeFor('0' + rng.range(0, 9), rng);
+        for(const Trace& stroke : synthGlyph(path, x, y0 + rng.range(-20, 20), BENCH_GLYPH_W, BENCH_GLYPH_H,
+                                             distortion, rng)){
+          for(size_t i = 0; i < stroke.size(); i++){
+            recognizer.addPoint(stroke[i][0], stroke[i][1], i == 0, index++);
+          }
+          uint16_t keep;
+          recognizer.strokeDone(&keep);
+        }
+        x += BENCH_GLYPH_W + BENCH_GLYPH_GAP;
+      }
+      int wordW = x - x0 - BENCH_GLYPH_GAP;
+
+      // the stroke under test, as a path in its box
+      int8_t path[40];
+      int n = 0;
+      int bx = x0 - 30, by = y0 - 30, bw = wordW + 60, bh = BENCH_GLYPH_H + 60;
+      bool reverse = rng.range(0, 1);
+      switch(kind){
+        case KIND_ERASE: {
+          bool down = rng.range(0, 2) == 0;    // mostly back and forth across
+          int passes = rng.range(down ? 4 : 3, 8);
+          for(int i = 0; i <= passes; i++){
+            int along = i * 100 / passes;
+            int side = (i % 2) ? 100 : 0;
+            path[n++] = down ? along : side;
+            path[n++] = down ? side : along;
+          }
+          break;
+        }
+        case KIND_STRIKE:
+        case KIND_UNDERLINE: {
+          int a = rng.range(30, 70), b = rng.range(30, 70);
+          path[n++] = 0; path[n++] = a;
+          path[n++] = 100; path[n++] = b;
+          by = kind == KIND_STRIKE ? y0 + BENCH_GLYPH_H / 2 - 40 : y0 + BENCH_GLYPH_H + 20;
+          bh = 80;
+          break;
+        }
+        case KIND_SEND: {
+          path[n++] = 0; path[n++] = rng.range(40, 75);
+          path[n++] = rng.range(20, 40); path[n++] = 100;
+          path[n++] = 100; path[n++] = rng.range(0, 10);
+          bw = bh = rng.range(GESTURE_MIN_SIZE + 20, 700);
+          bx = x0 + wordW + 200;
+          reverse = false;
+          break;
+        }
+        default: {
+          // a digit written big enough to pass the size test
+          const int8_t* digit = shapeFor('0' + rng.range(0, 9), rng);
+          while(digit[n] != GLYPH_END && n < 38){
+            path[n] = digit[n];
+            n++;
+          }
+          bw = rng.range(300, 500);
+          bh = bw * 3 / 2;
+          bx = x0 + wordW + 200;
+          reverse = false;
+          break;
+        }
+      }
+      if(reverse){
+        for(int i = 0; i < n / 2; i += 2){
+          int8_t px = path[i], py = path[i + 1];
+          path[i] = path[n - 2 - i];
+          path[i + 1] = path[n - 1 - i];
+          path[n - 2 - i] = px;
+          path[n - 1 - i] = py;
+        }
+      }
+      path[n] = GLYPH_END;
+
+      char got = 0;
+      uint16_t wordPoints = index, keep = UINT16_MAX;
+      double us = 0;
+      for(const Trace& stroke : synthGlyph(path, bx, by, bw, bh, distortion, rng)){
+        for(size_t i = 0; i < stroke.size(); i++){
+          recognizer.addPoint(stroke[i][0], stroke[i][1], i == 0, index++);
+        }
+        auto start = std::chrono::steady_clock::now();
+        char gesture = recognizer.strokeDone(&keep);
+        us += elapsedUs(start);
+        got = gesture ? gesture : got;
+      }
+      result.time(us);
+
+      uint16_t wantKeep = kind == KIND_SEND ? wordPoints : 0;
+      result.tried++;
+      if(got == gestureExpected[kind] && (got == 0 || keep == wantKeep)){
+        result.right++;
+      }
+      else{
+        if(got == 0){
+          result.rejected++;
+        }
+        else{
+          wrong++;
+        }
+        if(misses.size() < 60){
+          misses += std::string(got ? 1 : 0, got) + (got ? "" : "ink") + " ";
+        }
+      }
+    }
+
+    if(!misses.empty()){
+      printf("    %s missed as: %s\n", gestureKindNames[kind], misses.c_str());
+    }
+    printf("%-6s %3d%% %6lu %6lu %6lu %6lu %7.1f%% %8.1f %8.1f\n", gestureKindNames[kind], distortion, result.tried,
+           result.right, result.rejected, wrong, 100.0 * result.right / result.tried, result.totalUs / result.tried,
+           result.worstUs);
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                 checkUndo()                  --*/
+/*--------------------------------------------------*/
+/*    "1130" written in the time field, stored the  */
+/*    way storePoint() does. Its last stroke (the   */
+/*    0) is undone the way undoStroke() does: the   */
+/*    stroke table cuts coordz, the recognizer is   */
+/*    rewound and reads what is left. It must then  */
+/*    read 1:13.                                    */
+/*--------------------------------------------------*/
+static bool readStore(TimeRecognizer& recognizer, const PointStore& store, int* hour, int* minute){
+  recognizer.rewind();
+  for(uint16_t i = 0; i < store.count(); i++){
+    StoredPoint point = store.at(i);
+    recognizer.addPoint(point.x, point.y, point.strokeStart || i == 0);
+  }
+  return recognizer.recognize(hour, minute);
+}
+
+static bool checkUndo(){
+  TraceRandom rng(1);   // its own, so the benchmark's numbers do not move
+  static TimeRecognizer recognizer;
+  static StrokeTable table;
+  std::vector<uint8_t> bytes(8192);
+  PointStore store(bytes.data(), bytes.size(), false);
+
+  recognizer.reset();
+  int x = TIME_FIELD_X_MIN + 40;
+  int y = TIME_FIELD_Y_MIN + 200;
+  for(const char* c = "1130"; *c; c++){
+    for(const Trace& stroke : synthGlyph(shapeFor(*c, rng), x, y, BENCH_GLYPH_W, BENCH_GLYPH_H, 0, rng)){
+      for(size_t i = 0; i < stroke.size(); i++){
+        table.add(store.count(), stroke[i][0], stroke[i][1], i == 0);
+        store.append(stroke[i][0], stroke[i][1], i == 0);
+        recognizer.addPoint(stroke[i][0], stroke[i][1], i == 0);
+      }
+      table.lift();
+    }
+    x += BENCH_GLYPH_W + BENCH_GLYPH_GAP;
+  }
+
+  int hour = -1, minute = -1;
+  bool before = recognizer.recognize(&hour, &minute) && hour == 11 && minute == 30;
+  int hourBefore = hour, minuteBefore = minute;
+
+  hour = minute = -1;
+  bool after = table.undo(store) && readStore(recognizer, store, &hour, &minute) && hour == 1 && minute == 13;
+
+  printf("undo: 1130 read as %d:%02d, after undo %d:%02d %s\n", hourBefore, minuteBefore, hour, minute,
+         before && after ? "ok" : "MISMATCH");
+  return before && after;
+}
+
+static void printRow(const char* what, int distortion, const Result& result){
+  printf("%-6s %3d%% %6lu %6lu %6lu %7.1f%% %8.1f %8.1f\n", what, distortion, result.tried, result.right,
+         result.rejected, 100.0 * result.right / result.tried, result.totalUs / result.tried, result.worstUs);
+}
+
+int main(int argc, char** argv){
+  std::vector<int> distortions = {10, 20, 30};
+  int trials = 200;
+  const char* samples = NULL;
+  int split = 60;
+  int stride = 0;
+  uint32_t seed = 1;
+  bool gestures = false;
+
+  bool parsed = parseArgs(argc, argv, &seed, NULL, [&](const char* arg, const char* value) {
+    if(!strcmp(arg, "--distortion")){ distortions = parseList(value); return 2; }
+    if(!strcmp(arg, "--trials")){ trials = atoi(value); return 2; }
+    if(!strcmp(arg, "--samples")){ samples = value; return 2; }
+    if(!strcmp(arg, "--split")){ split = atoi(value); return 2; }
+    if(!strcmp(arg, "--preview")){ stride = atoi(value); return 2; }
+    if(!strcmp(arg, "--gestures")){ gestures = true; return 1; }
+    return 0;
+  });
+  if(!parsed){
+    return 2;
+  }
+
+  timeGlyphSet.begin();
+  TraceRandom rng(seed);
+
+  if(!checkUndo()){
+    return 1;
+  }
+
+  if(gestures){
+    gestureGlyphSet.begin();
+    printf("%-6s %4s %6s %6s %6s %6s %8s %8s %8s\n", "kind", "dist", "tried", "right", "ink", "wrong", "acc",
+           "mean_us", "worst_us");
+    for(int distortion : distortions){
+      benchGestures(distortion, trials, rng);
+    }
+    return 0;
+  }
+
+  // "prev8": the preview of the same times, for --preview 8
+  char previewLabel[16];
+  snprintf(previewLabel, sizeof(previewLabel), "prev%d", stride);
+
+  printf("%-6s %4s %6s %6s %6s %8s %8s %8s\n", "kind", "dist", "tried", "right", "reject", "acc", "mean_us", "worst_us");
+  for(int distortion : distortions){
+    printRow("glyph", distortion, benchGlyphs(distortion, trials, rng));
+    TraceRandom same = rng;
+    printRow("time", distortion, benchTimes(distortion, trials, 0, rng));
+    if(stride > 0){
+      printRow(previewLabel, distortion, benchTimes(distortion, trials, stride, same));
+    }
+  }
+
+  if(samples && !benchSamples(samples, split, 0, "samples")){
+    return 1;
+  }
+  if(samples && stride > 0 && !benchSamples(samples, split, stride, previewLabel)){
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,786 @@
+#include "Receiver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "Channels.h"
+#include "Protocol.h"
+#include "Reliable.h"
+#include "SimLink.h"
+#include "Strokes.h"
+
+NoteReceiver::NoteReceiver(const std::vector<Trace>& expected, const std::vector<TraceTicks>& expectedTicks,
+                           int month, int day)
+  : expected(expected), expectedTicks(expectedTicks), month(month), day(day), state(IDLE),
+    haveCounter(false), lastCounter(0), noteStarted(false), noteQueuedUs(0),
+    refining(false), previewUs(0), stopUs(0),
+    tracing(false), hostOffsetUs(0), syncDueUs(0),
+    note(0), cumulative(0), total(-1), framesSinceAck(0),
+    strokesClosed(false), haveFromSet(false), haveFrom(0) {}
+
+void NoteReceiver::traceLatency(int64_t hostOffsetUs){
+  tracing = true;
+  this->hostOffsetUs = hostOffsetUs;
+}
+
+void NoteReceiver::run(int fd){
+  uint8_t datagram[sizeof(SimHeader) + NOTE_MAX_PAYLOAD];
+
+  for(;;){
+    ssize_t n = recv(fd, datagram, sizeof(datagram), 0);
+    if(n <= 0){
+      break;
+    }
+    if((size_t)n < sizeof(SimHeader)){
+      error("short datagram");
+      send(fd, datagram, 0, 0);
+      continue;
+    }
+
+    SimHeader header;
+    uint8_t reply[NOTE_MAX_PAYLOAD];
+    memcpy(&header, datagram, sizeof(header));
+    uint16_t replyLen = receive(datagram + sizeof(header), n - sizeof(header),
+                                header.queuedUs, header.deliveredUs, reply);
+    send(fd, reply, replyLen, 0);
+  }
+}
+
+void NoteReceiver::error(const std::string& what){
+  // keep the first few for the printout, count the rest
+  if(report.errors.size() < 8){
+    report.errors.push_back(what);
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                  receive()                   --*/
+/*--------------------------------------------------*/
+uint16_t NoteReceiver::receive(const uint8_t* data, uint16_t len, uint64_t queuedUs, uint64_t deliveredUs,
+                               uint8_t* reply){
+  std::chrono::steady_clock::time_point began = std::chrono::steady_clock::now();
+  uint64_t hostUs = deliveredUs + hostOffsetUs;
+
+  if(report.packets == 0){
+    report.firstQueuedUs = queuedUs;
+  }
+  report.packets++;
+  report.bytes += len;
+  report.lastDeliveredUs = deliveredUs;
+  report.packetLatencyUs.push_back(deliveredUs - queuedUs);
+
+  if(len > 0 && (data[0] == RELIABLE_DATA_TAG || data[0] == RELIABLE_TIMED_TAG ||
+                 data[0] == RELIABLE_CLOSE_TAG || data[0] == RELIABLE_HELLO_TAG)){
+    return receiveReliable(data, len, queuedUs, deliveredUs, reply);
+  }
+  if(len > 0 && (data[0] == STROKE_DATA_TAG || data[0] == STROKE_TIMED_TAG || data[0] == STROKE_DROP_TAG ||
+                 data[0] == STROKE_CLOSE_TAG || data[0] == STROKE_HELLO_TAG)){
+    return receiveStrokes(data, len, queuedUs, deliveredUs, reply);
+  }
+  if(len > 0 && (data[0] == STATUS_TAG || data[0] == STREAM_DATA_TAG || data[0] == STREAM_TIMED_TAG)){
+    receiveChannels(data, len, queuedUs, deliveredUs);
+    return 0;
+  }
+
+  unsigned long counter = 0;
+  MessageType type = parseControl(data, len, &counter);
+
+  if(type != MSG_POINTS && type != MSG_UNKNOWN && type != MSG_SYNC){
+    if(haveCounter && counter != lastCounter + 1){
+      report.counterErrors++;
+      error("counter " + std::to_string(counter) + " after " + std::to_string(lastCounter));
+    }
+    haveCounter = true;
+    lastCounter = counter;
+  }
+
+  if(state != IDLE && !noteStarted && type != MSG_SYNC){
+    noteStarted = true;
+    noteQueuedUs = queuedUs;
+  }
+
+  switch(type){
+    case MSG_START:
+      state = COLLECTING;
+      noteStarted = false;
+      points.clear();
+      ticks.clear();
+      traced.clear();
+      decoder.start();
+      placed.clear();
+      refining = false;
+      previewUs = 0;
+      break;
+
+    case MSG_POINTS: {
+      if(state != COLLECTING){
+        report.stateErrors++;
+        error("points outside a note");
+        break;
+      }
+      if(data[0] == PROGRESSIVE_TAG){
+        placeProgressive(data, len, deliveredUs);
+        break;
+      }
+      TimedPoint decoded[NOTE_MAX_PAYLOAD / 4];
+      int n = decoder.decode(data, len, decoded, NOTE_MAX_PAYLOAD / 4);
+      for(int i = 0; i < n; i++){
+        points.push_back({decoded[i].x, decoded[i].y});
+        ticks.push_back(decoded[i].ticks);
+      }
+
+      // the first point's capture is in the header, the others follow from their ticks
+      PacketTrace trace;
+      if(tracing && parseTrace(data, len, &trace)){
+        uint64_t handledUs = hostUs + std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - began).count();
+        uint32_t captureUs = trace.captureUs;
+        for(int i = 0; i < n; i++){
+          if(i > 0){
+            captureUs += decoded[i].ticks * POINT_TICK_US;
+          }
+          traced.push_back({captureUs, captureUs + (trace.storedUs - trace.captureUs), trace.notifyUs,
+                            hostUs, handledUs});
+        }
+      }
+      break;
+    }
+
+    case MSG_SYNC:
+      if(!tracing || !clock.answer(data, len, hostUs)){
+        report.stateErrors++;
+        error("SYNC answer nobody asked for");
+        break;
+      }
+      report.syncs++;
+      report.clockOffsetUs = clock.offsetUs();
+      report.syncRoundTripUs = clock.roundTripUs();
+      break;
+
+    case MSG_STOP:
+      if(state != COLLECTING){
+        report.stateErrors++;
+        error("STOP without START");
+      }
+      stopUs = deliveredUs;
+      report.stopUs.push_back(deliveredUs);
+      state = WAITING_FOR_DATE;
+      break;
+
+    case MSG_DATE: {
+      int m = 0, d = 0;
+      if(state != WAITING_FOR_DATE){
+        report.stateErrors++;
+        error("DATE before STOP");
+      }
+      else if(!parseDate(data, len, &m, &d) || m != month || d != day){
+        report.stateErrors++;
+        error("bad DATE payload");
+      }
+      report.dateUs.push_back(deliveredUs);
+      state = HAS_DATE;
+      break;
+    }
+
+    case MSG_TIME: {
+      int h = 0, m = 0;
+      if(state != HAS_DATE){
+        report.stateErrors++;
+        error("TIME before DATE");
+      }
+      else if(!parseDate(data, len, &h, &m) || h > 23 || m > 59){
+        report.stateErrors++;
+        error("bad TIME payload");
+      }
+      break;
+    }
+
+    case MSG_END:
+      if(state != HAS_DATE){
+        report.stateErrors++;
+        error("END before DATE");
+      }
+      finishNote(deliveredUs);
+      state = IDLE;
+      break;
+
+    default:
+      report.stateErrors++;
+      error("unknown packet");
+      break;
+  }
+
+  return tracing ? syncRequest(hostUs, reply) : 0;
+}
+
+/*--------------------------------------------------*/
+/*--             receiveChannels()                --*/
+/*--------------------------------------------------*/
+/*    Markers come in ahead of the points they      */
+/*    close, so every session collects on its own   */
+/*    and finishes when both are there.             */
+/*--------------------------------------------------*/
+void NoteReceiver::receiveChannels(const uint8_t* data, uint16_t len, uint64_t queuedUs, uint64_t deliveredUs){
+  StatusMessage status;
+  uint8_t id;
+  bool isStatus = parseStatus(data, len, &status);
+
+  if(isStatus){
+    id = status.session;
+  }
+  else if(len >= STREAM_HEADER){
+    id = data[1];
+  }
+  else{
+    report.stateErrors++;
+    error("short STREAM frame");
+    return;
+  }
+
+  // like the other framings, a note counts from its first packet after START
+  Session& session = sessions[id];
+  if(session.queuedUs == 0 && !(isStatus && status.type == STATUS_START)){
+    session.queuedUs = queuedUs;
+  }
+
+  if(isStatus){
+    switch(status.type){
+      case STATUS_START:
+        break;
+      case STATUS_STOP:
+        session.total = status.a;
+        report.stopUs.push_back(deliveredUs);
+        break;
+      case STATUS_DATE:
+        if(session.total < 0 || status.a != month || status.b != day){
+          report.stateErrors++;
+          error("bad or early DATE");
+        }
+        report.dateUs.push_back(deliveredUs);
+        break;
+      case STATUS_TIME:
+        if(status.a > 23 || status.b > 59){
+          report.stateErrors++;
+          error("bad TIME payload");
+        }
+        break;
+      case STATUS_END:
+        if(session.total < 0){
+          report.stateErrors++;
+          error("END before STOP");
+        }
+        session.ended = true;
+        break;
+    }
+  }
+  else{
+    int decoded[NOTE_MAX_PAYLOAD / 4][2];
+    uint32_t decodedTicks[NOTE_MAX_PAYLOAD / 4];
+    uint16_t offset = 0;
+    int n = parseStream(data, len, &id, &offset, decoded, NOTE_MAX_PAYLOAD / 4, decodedTicks);
+    for(int i = 0; i < n; i++){
+      size_t at = offset + i;
+      if(session.have.size() < at + 1){
+        session.have.resize(at + 1, false);
+        session.points.resize(at + 1);
+        session.ticks.resize(at + 1);
+      }
+      if(session.have[at]){
+        report.duplicates++;
+        continue;
+      }
+      session.have[at] = true;
+      session.points[at] = {decoded[i][0], decoded[i][1]};
+      session.ticks[at] = decodedTicks[i];
+      session.received++;
+    }
+  }
+
+  if(session.ended && session.total >= 0 && session.received >= (unsigned long)session.total){
+    points = session.points;
+    ticks = session.ticks;
+    noteQueuedUs = session.queuedUs;
+    previewUs = 0;
+    stopUs = 0;
+    finishNote(deliveredUs);
+    sessions.erase(id);
+  }
+}
+
+/*--------------------------------------------------*/
+/*--              receiveStrokes()                --*/
+/*--------------------------------------------------*/
+/*    A frame whose total differs from what is      */
+/*    kept for its id starts that stroke over, as   */
+/*    the device sends a shortened stroke again.    */
+/*--------------------------------------------------*/
+uint16_t NoteReceiver::receiveStrokes(const uint8_t* data, uint16_t len, uint64_t queuedUs, uint64_t deliveredUs,
+                                      uint8_t* reply){
+  if(len < 4){
+    report.stateErrors++;
+    error("short stroke frame");
+    return 0;
+  }
+
+  uint8_t frameNote = data[1];
+  uint16_t id = data[2] | (data[3] << 8);
+
+  // a new note starts once the previous one is written down
+  if(frameNote != note){
+    if(strokesClosed && frameNote == (uint8_t)(note + 1)){
+      note = frameNote;
+      strokes.clear();
+      strokesClosed = false;
+      haveFromSet = false;
+      noteStarted = false;
+    }
+    else{
+      uint8_t stale[5] = {STROKE_HAVE_TAG, frameNote, 1, 0, 0};
+      memcpy(reply, stale, sizeof(stale));
+      report.acks++;
+      return sizeof(stale);
+    }
+  }
+  if(strokesClosed){
+    return buildHave(reply);   // the HAVE with closed = 1 was lost
+  }
+
+  if(!noteStarted){
+    noteStarted = true;
+    noteQueuedUs = queuedUs;
+  }
+
+  bool ackNow = false;
+  if(data[0] != STROKE_CLOSE_TAG && (!haveFromSet || id < haveFrom)){
+    haveFromSet = true;
+    haveFrom = id;
+  }
+
+  if(data[0] == STROKE_HELLO_TAG){
+    haveFrom = id;
+    ackNow = true;
+  }
+  else if(data[0] == STROKE_DROP_TAG){
+    strokes.erase(id);
+    ackNow = true;
+  }
+  else if(data[0] == STROKE_CLOSE_TAG){
+    if(len < 6){
+      report.stateErrors++;
+      error("short CLOSE");
+      return 0;
+    }
+    if(data[4] != month || data[5] != day){
+      report.stateErrors++;
+      error("bad CLOSE date");
+    }
+
+    uint16_t complete = 0;
+    for(const auto& held : strokes){
+      complete += held.second.received == held.second.have.size();
+    }
+    if(complete != id || complete != strokes.size()){
+      report.stateErrors++;
+      error("CLOSE for " + std::to_string(id) + " strokes, " + std::to_string(complete) + " of " +
+            std::to_string(strokes.size()) + " complete");
+    }
+    else{
+      points.clear();
+      ticks.clear();
+      for(const auto& held : strokes){
+        points.insert(points.end(), held.second.points.begin(), held.second.points.end());
+        ticks.insert(ticks.end(), held.second.ticks.begin(), held.second.ticks.end());
+      }
+      previewUs = 0;
+      stopUs = 0;
+      finishNote(deliveredUs);
+      strokesClosed = true;
+    }
+    ackNow = true;
+  }
+  else{
+    if(len < STROKE_HEADER){
+      report.stateErrors++;
+      error("short stroke frame");
+      return 0;
+    }
+    bool timed = data[0] == STROKE_TIMED_TAG;
+    uint16_t first = data[4] | (data[5] << 8);
+    uint16_t count = data[6] | (data[7] << 8);
+
+    Stroke& stroke = strokes[id];
+    if(stroke.have.size() != count){
+      stroke.points.assign(count, {0, 0});
+      stroke.ticks.assign(count, 0);
+      stroke.have.assign(count, false);
+      stroke.received = 0;
+    }
+    bool wasComplete = stroke.received == count;
+
+    uint16_t i = STROKE_HEADER;
+    for(uint16_t at = first; i + 4 <= len && at < count; at++){
+      const uint8_t* p = data + i;
+      uint32_t t = 0;
+      i += 4;
+      if(timed){
+        uint8_t n = getVarint(data + i, len - i, &t);
+        if(n == 0){
+          report.stateErrors++;
+          error("cut off ticks");
+          break;
+        }
+        i += n;
+      }
+
+      if(stroke.have[at]){
+        report.duplicates++;
+        ackNow = true;
+        continue;
+      }
+      stroke.have[at] = true;
+      stroke.points[at] = {(int16_t)(p[0] | (p[1] << 8)), (int16_t)(p[2] | (p[3] << 8))};
+      stroke.ticks[at] = t;
+      stroke.received++;
+    }
+
+    if(!wasComplete && stroke.received == count){
+      ackNow = true;
+    }
+  }
+
+  if(++framesSinceAck >= RECEIVER_ACK_EVERY){
+    ackNow = true;
+  }
+
+  return ackNow ? buildHave(reply) : 0;
+}
+
+/*--------------------------------------------------*/
+/*--                 buildHave()                  --*/
+/*--------------------------------------------------*/
+uint16_t NoteReceiver::buildHave(uint8_t* reply){
+  uint16_t from = haveFromSet ? haveFrom : (strokes.empty() ? 0 : strokes.begin()->first);
+
+  reply[0] = STROKE_HAVE_TAG;
+  reply[1] = note;
+  reply[2] = strokesClosed;
+  reply[3] = from & 0xFF;
+  reply[4] = from >> 8;
+  memset(reply + 5, 0, STROKE_HAVE_BYTES);
+  for(const auto& held : strokes){
+    uint16_t bit = held.first - from;
+    if(bit < STROKE_HAVE_BYTES * 8 && held.second.received == held.second.have.size()){
+      reply[5 + bit / 8] |= 1 << (bit % 8);
+    }
+  }
+
+  haveFromSet = false;
+  framesSinceAck = 0;
+  report.acks++;
+  return STROKE_HAVE_MAX_LEN;
+}
+
+/*--------------------------------------------------*/
+/*--             placeProgressive()               --*/
+/*--------------------------------------------------*/
+/*    Puts the points of one PROGRESSIVE frame at   */
+/*    their index. The preview is in when the       */
+/*    refinement starts (or, if it never does, at   */
+/*    the last preview frame).                      */
+/*--------------------------------------------------*/
+void NoteReceiver::placeProgressive(const uint8_t* data, uint16_t len, uint64_t deliveredUs){
+  ProgressivePoint decoded[NOTE_MAX_PAYLOAD / 5];
+  bool refine = false;
+  int n = parseProgressive(data, len, decoded, NOTE_MAX_PAYLOAD / 5, &refine);
+  if(n == 0){
+    report.stateErrors++;
+    error("empty PROGRESSIVE frame");
+    return;
+  }
+
+  if(refine){
+    refining = true;
+  }
+  else{
+    report.previewPoints += n;
+    if(!refining){
+      previewUs = deliveredUs;
+    }
+  }
+
+  for(int i = 0; i < n; i++){
+    uint16_t at = decoded[i].index;
+    if(placed.size() < (size_t)at + 1){
+      placed.resize(at + 1, false);
+      points.resize(at + 1);
+      ticks.resize(at + 1);
+    }
+    if(placed[at]){
+      report.duplicates++;
+    }
+    placed[at] = true;
+    points[at] = {decoded[i].x, decoded[i].y};
+    ticks[at] = decoded[i].ticks;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--               syncRequest()                  --*/
+/*--------------------------------------------------*/
+/*    A SYNC on the answer to the first packet and  */
+/*    then every LATENCY_SYNC_EVERY_MS.             */
+/*--------------------------------------------------*/
+uint16_t NoteReceiver::syncRequest(uint64_t hostUs, uint8_t* reply){
+  if(hostUs < syncDueUs){
+    return 0;
+  }
+  syncDueUs = hostUs + (uint64_t)LATENCY_SYNC_EVERY_MS * 1000;
+  return clock.request(reply, hostUs);
+}
+
+/*--------------------------------------------------*/
+/*--             receiveReliable()                --*/
+/*--------------------------------------------------*/
+uint16_t NoteReceiver::receiveReliable(const uint8_t* data, uint16_t len, uint64_t queuedUs, uint64_t deliveredUs,
+                                       uint8_t* reply){
+  if(len < 4){
+    report.stateErrors++;
+    error("short reliable frame");
+    return 0;
+  }
+
+  uint8_t frameNote = data[1];
+  uint16_t offset = data[2] | (data[3] << 8);
+
+  // a new note starts once the previous one is complete
+  if(frameNote != note){
+    if(total >= 0 && cumulative == total + 1 && frameNote == (uint8_t)(note + 1)){
+      note = frameNote;
+      have.clear();
+      points.clear();
+      ticks.clear();
+      cumulative = 0;
+      total = -1;
+      noteStarted = false;
+    }
+    else{
+      // a HELLO or stale frame for a note we already finished: just ack it
+      uint8_t stale[5] = {RELIABLE_ACK_TAG, frameNote, 0, 0, 0};
+      memcpy(reply, stale, sizeof(stale));
+      if(total >= 0 && frameNote == note){
+        reply[2] = (total + 1) & 0xFF;
+        reply[3] = (total + 1) >> 8;
+      }
+      report.acks++;
+      return sizeof(stale);
+    }
+  }
+
+  if(!noteStarted){
+    noteStarted = true;
+    noteQueuedUs = queuedUs;
+  }
+
+  bool ackNow = false;
+
+  if(data[0] == RELIABLE_HELLO_TAG){
+    ackNow = true;
+  }
+  else if(data[0] == RELIABLE_CLOSE_TAG){
+    if(len < 6){
+      report.stateErrors++;
+      error("short CLOSE");
+      return 0;
+    }
+    if(data[4] != month || data[5] != day){
+      report.stateErrors++;
+      error("bad CLOSE date");
+    }
+    if(total < 0){
+      total = offset;
+      if(have.size() < (size_t)total + 1){
+        have.resize(total + 1, false);
+        points.resize(total);
+        ticks.resize(total);
+      }
+    }
+    have[total] = true;
+    ackNow = true;
+  }
+  else{
+    bool timed = data[0] == RELIABLE_TIMED_TAG;
+    if(offset != cumulative){
+      ackNow = true;
+    }
+
+    uint16_t i = 4;
+    for(uint16_t at = offset; i + 4 <= len; at++){
+      const uint8_t* p = data + i;
+      uint32_t t = 0;
+      i += 4;
+      if(timed){
+        uint8_t n = getVarint(data + i, len - i, &t);
+        if(n == 0){
+          report.stateErrors++;
+          error("cut off ticks");
+          break;
+        }
+        i += n;
+      }
+
+      if(have.size() < (size_t)at + 1){
+        have.resize(at + 1, false);
+        points.resize(at + 1);
+        ticks.resize(at + 1);
+      }
+      if(have[at]){
+        report.duplicates++;
+        ackNow = true;
+      }
+      have[at] = true;
+      points[at] = {(int16_t)(p[0] | (p[1] << 8)), (int16_t)(p[2] | (p[3] << 8))};
+      ticks[at] = t;
+    }
+  }
+
+  bool wasComplete = total >= 0 && cumulative == total + 1;
+  while(cumulative < have.size() && have[cumulative]){
+    cumulative++;
+  }
+
+  if(!wasComplete && total >= 0 && cumulative == total + 1){
+    finishNote(deliveredUs);
+    ackNow = true;
+  }
+
+  if(++framesSinceAck >= RECEIVER_ACK_EVERY){
+    ackNow = true;
+  }
+
+  return ackNow ? buildAck(reply) : 0;
+}
+
+/*--------------------------------------------------*/
+/*--                 buildAck()                   --*/
+/*--------------------------------------------------*/
+/*    Cumulative offset plus the first SACK ranges  */
+/*    of points received past the first gap.        */
+/*--------------------------------------------------*/
+uint16_t NoteReceiver::buildAck(uint8_t* reply){
+  uint16_t len = 0;
+  reply[len++] = RELIABLE_ACK_TAG;
+  reply[len++] = note;
+  reply[len++] = cumulative & 0xFF;
+  reply[len++] = cumulative >> 8;
+  uint8_t* ranges = reply + len++;
+  *ranges = 0;
+
+  size_t i = cumulative;
+  while(i < have.size() && *ranges < RELIABLE_MAX_SACK){
+    while(i < have.size() && !have[i]){
+      i++;
+    }
+    if(i >= have.size()){
+      break;
+    }
+    size_t start = i;
+    while(i < have.size() && have[i]){
+      i++;
+    }
+    reply[len++] = start & 0xFF;
+    reply[len++] = start >> 8;
+    reply[len++] = i & 0xFF;
+    reply[len++] = i >> 8;
+    (*ranges)++;
+  }
+
+  framesSinceAck = 0;
+  report.acks++;
+  return len;
+}
+
+/*--------------------------------------------------*/
+/*--                finishNote()                  --*/
+/*--------------------------------------------------*/
+/*    Compares the collected points with the note   */
+/*    that was sent: same count, same values, same  */
+/*    order.                                        */
+/*--------------------------------------------------*/
+void NoteReceiver::finishNote(uint64_t deliveredUs){
+  size_t index = report.notes++;
+  report.noteLatencyUs.push_back(deliveredUs - noteQueuedUs);
+  // reliable notes have no STOP: drawable when complete
+  uint64_t drawableUs = previewUs ? previewUs : (stopUs > noteQueuedUs ? stopUs : deliveredUs);
+  report.previewLatencyUs.push_back(drawableUs - noteQueuedUs);
+  if(tracing){
+    finishLatency();
+  }
+
+  if(index >= expected.size()){
+    error("unexpected extra note");
+    return;
+  }
+
+  const Trace& sent = expected[index];
+  const TraceTicks* sentTicks = index < expectedTicks.size() ? &expectedTicks[index] : NULL;
+  size_t match = 0;
+  while(match < sent.size() && match < points.size() && sent[match] == points[match] &&
+        (!sentTicks || (*sentTicks)[match] == ticks[match])){
+    match++;
+  }
+
+  if(match == sent.size() && points.size() == sent.size()){
+    report.intact++;
+  }
+  else{
+    if(points.size() < sent.size()){
+      report.missingPoints += sent.size() - points.size();
+    }
+    error("note " + std::to_string(index) + ": " + std::to_string(points.size()) + "/" +
+          std::to_string(sent.size()) + " points, first mismatch at " + std::to_string(match));
+  }
+}
+
+/*--------------------------------------------------*/
+/*--               finishLatency()                --*/
+/*--------------------------------------------------*/
+/*    Puts the note's device times on the host      */
+/*    clock with the best offset known now, which   */
+/*    has had the whole note to settle.             */
+/*--------------------------------------------------*/
+void NoteReceiver::finishLatency(){
+  NoteLatency latency;
+
+  if(!clock.synced()){
+    report.untraced += traced.size();
+    traced.clear();
+    report.latency.push_back(latency);
+    return;
+  }
+
+  // a stage the offset error pushes below zero counts as 0
+  auto span = [](uint64_t from, uint64_t to) { return to > from ? to - from : 0; };
+  for(const TracedPoint& p : traced){
+    uint64_t captureUs = clock.toHost(p.captureUs, p.receivedUs);
+    uint64_t storedUs = clock.toHost(p.storedUs, p.receivedUs);
+    uint64_t notifyUs = clock.toHost(p.notifyUs, p.receivedUs);
+    latency.total.push_back(span(captureUs, p.handledUs));
+    latency.store.push_back(span(captureUs, storedUs));
+    latency.queue.push_back(span(storedUs, notifyUs));
+    latency.radio.push_back(span(notifyUs, p.receivedUs));
+    latency.host.push_back(span(p.receivedUs, p.handledUs));
+  }
+  traced.clear();
+  report.latency.push_back(latency);
+}
+
+uint64_t percentile(std::vector<uint64_t> samples, double p){
+  if(samples.empty()){
+    return 0;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t i = (size_t)(p / 100.0 * (samples.size() - 1) + 0.5);
+  return samples[std::min(i, samples.size() - 1)];
+}
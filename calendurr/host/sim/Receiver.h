@@ -0,0 +1,239 @@
+#ifndef CALENDURR_SIM_RECEIVER_H
+#define CALENDURR_SIM_RECEIVER_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Protocol.h"
+#include "Trace.h"
+
+/*--------------------------------------------------*/
+/*--          SIMULATED CENTRAL (receiver)        --*/
+/*--------------------------------------------------*/
+/*  Reads the datagrams SimLink delivers and runs   */
+/*  them through the same state machine as          */
+/*  BluetoothPage.js (START -> points -> STOP ->    */
+/*  DATE -> TIME (optional) -> END). Every note is  */
+/*  compared with the note that was sent, so        */
+/*  ordering and completeness problems are counted  */
+/*  instead of silently producing a broken drawing. */
+/*  Timed notes must also bring back every point's  */
+/*  ticks.                                          */
+/*                                                  */
+/*  Reliable frames (Reliable.h) are reassembled by */
+/*  offset and acked like the phone would: at once  */
+/*  on a gap, a duplicate, CLOSE or HELLO, and      */
+/*  otherwise every RECEIVER_ACK_EVERY frames.      */
+/*                                                  */
+/*  Stroke frames (Strokes.h) are kept by stroke    */
+/*  id; a DROP forgets one and CLOSE joins the      */
+/*  rest in id order. A HAVE goes back when a       */
+/*  stroke completes, on a DROP, a duplicate,       */
+/*  CLOSE or HELLO, and otherwise every             */
+/*  RECEIVER_ACK_EVERY frames.                      */
+/*                                                  */
+/*  PROGRESSIVE frames (Progressive.h) are placed   */
+/*  by their index; the preview counts as in once   */
+/*  the first refinement frame follows it.          */
+/*                                                  */
+/*  STATUS and STREAM frames (Channels.h) are kept  */
+/*  per session; a note is done when its END is in  */
+/*  and it has the points its STOP promised.        */
+/*                                                  */
+/*  With traceLatency() it asks for a SYNC every    */
+/*  LATENCY_SYNC_EVERY_MS on its answers and splits */
+/*  the latency of every point of a TRACED packet   */
+/*  into its stages (Latency.h). Its clock runs     */
+/*  ahead of the link's by an offset it is not      */
+/*  told, so the sync has something to find.        */
+/*--------------------------------------------------*/
+
+#define RECEIVER_ACK_EVERY 4
+
+/*------------------------------------------*/
+/*  notes - notes that ended with END       */
+/*  intact - notes identical to what was    */
+/*            sent, in the same order       */
+/*  missingPoints - expected but not seen   */
+/*  counterErrors - control messages that   */
+/*            skipped or repeated a counter */
+/*  stateErrors - messages that arrived in  */
+/*            the wrong place               */
+/*  duplicates - reliable points that were  */
+/*            received more than once       */
+/*  acks - acks written back to the device  */
+/*  packetLatencyUs - queued -> delivered   */
+/*  noteLatencyUs - first packet of a note  */
+/*            queued -> its END delivered   */
+/*  previewLatencyUs - first packet queued  */
+/*            -> the note can be drawn: the */
+/*            preview pass delivered, or    */
+/*            STOP without one (a reliable  */
+/*            note: once it is complete)    */
+/*  previewPoints - points in preview       */
+/*            frames                        */
+/*  stopUs/dateUs - when each note's STOP   */
+/*            and DATE were delivered       */
+/*  latency - per traced note, see below    */
+/*  untraced - traced points that came      */
+/*            before the first SYNC answer  */
+/*  syncs - SYNC answers                    */
+/*  clockOffsetUs - host - device clock, as */
+/*            estimated at the end          */
+/*  syncRoundTripUs - round trip of the     */
+/*            answer that estimate is from  */
+/*------------------------------------------*/
+
+/*------------------------------------------*/
+/*  NoteLatency - every point of one note,  */
+/*  in us:                                  */
+/*  total - capture -> handled here         */
+/*  store - capture -> coordz (the longest  */
+/*            in its send, see Latency.h)   */
+/*  queue - coordz -> notify()              */
+/*  radio - notify() -> received here       */
+/*  host - received -> handled              */
+/*------------------------------------------*/
+struct NoteLatency {
+  std::vector<uint64_t> total;
+  std::vector<uint64_t> store;
+  std::vector<uint64_t> queue;
+  std::vector<uint64_t> radio;
+  std::vector<uint64_t> host;
+};
+
+struct ReceiverReport {
+  unsigned long packets = 0;
+  unsigned long bytes = 0;
+  unsigned long notes = 0;
+  unsigned long intact = 0;
+  unsigned long missingPoints = 0;
+  unsigned long counterErrors = 0;
+  unsigned long stateErrors = 0;
+  unsigned long duplicates = 0;
+  unsigned long acks = 0;
+  uint64_t firstQueuedUs = 0;
+  uint64_t lastDeliveredUs = 0;
+  std::vector<uint64_t> packetLatencyUs;
+  std::vector<uint64_t> noteLatencyUs;
+  std::vector<uint64_t> previewLatencyUs;
+  unsigned long previewPoints = 0;
+  std::vector<uint64_t> stopUs;
+  std::vector<uint64_t> dateUs;
+  std::vector<NoteLatency> latency;
+  unsigned long untraced = 0;
+  unsigned long syncs = 0;
+  int64_t clockOffsetUs = 0;
+  uint32_t syncRoundTripUs = 0;
+  std::vector<std::string> errors;
+};
+
+class NoteReceiver {
+  public:
+    // expectedTicks empty: the notes are sent without timestamps
+    NoteReceiver(const std::vector<Trace>& expected, const std::vector<TraceTicks>& expectedTicks,
+                 int month, int day);
+
+    // Reads datagrams until the other end shuts the socket down
+    void run(int fd);
+
+    // Syncs with the device and keeps the times of TRACED packets; the
+    // host clock reads the link's time plus hostOffsetUs
+    void traceLatency(int64_t hostOffsetUs);
+
+    // Handles one notification (also usable without a socket). Writes
+    // the control characteristic answer to reply and returns its length
+    uint16_t receive(const uint8_t* data, uint16_t len, uint64_t queuedUs, uint64_t deliveredUs,
+                     uint8_t* reply);
+
+    ReceiverReport report;
+
+  private:
+    enum State { IDLE, COLLECTING, WAITING_FOR_DATE, HAS_DATE };
+
+    void finishNote(uint64_t deliveredUs);
+    void error(const std::string& what);
+    uint16_t receiveReliable(const uint8_t* data, uint16_t len, uint64_t queuedUs, uint64_t deliveredUs,
+                             uint8_t* reply);
+    uint16_t buildAck(uint8_t* reply);
+    uint16_t receiveStrokes(const uint8_t* data, uint16_t len, uint64_t queuedUs, uint64_t deliveredUs,
+                            uint8_t* reply);
+    uint16_t buildHave(uint8_t* reply);
+    void receiveChannels(const uint8_t* data, uint16_t len, uint64_t queuedUs, uint64_t deliveredUs);
+    void placeProgressive(const uint8_t* data, uint16_t len, uint64_t deliveredUs);
+    uint16_t syncRequest(uint64_t hostUs, uint8_t* reply);
+    void finishLatency();
+
+    const std::vector<Trace>& expected;
+    const std::vector<TraceTicks>& expectedTicks;
+    int month;
+    int day;
+    State state;
+    bool haveCounter;
+    unsigned long lastCounter;
+    bool noteStarted;
+    uint64_t noteQueuedUs;
+    Trace points;
+    TraceTicks ticks;
+    PointDecoder decoder;
+
+    // progressive note: points placed so far, when the preview and STOP
+    // were delivered
+    std::vector<bool> placed;
+    bool refining;
+    uint64_t previewUs;
+    uint64_t stopUs;
+
+    // latency tracing, times of every traced point of the note
+    struct TracedPoint {
+      uint32_t captureUs;   // device clock
+      uint32_t storedUs;
+      uint32_t notifyUs;
+      uint64_t receivedUs;  // host clock
+      uint64_t handledUs;
+    };
+    bool tracing;
+    int64_t hostOffsetUs;
+    ClockSync clock;
+    uint64_t syncDueUs;
+    std::vector<TracedPoint> traced;
+
+    // notes of the status/stream channels by session
+    struct Session {
+      Trace points;
+      TraceTicks ticks;
+      std::vector<bool> have;
+      unsigned long received = 0;
+      int total = -1;         // until STOP
+      bool ended = false;
+      uint64_t queuedUs = 0;
+    };
+    std::map<uint8_t, Session> sessions;
+
+    // reliable note being reassembled
+    uint8_t note;
+    std::vector<bool> have;
+    uint16_t cumulative;
+    int total;            // -1 until CLOSE arrives
+    int framesSinceAck;
+
+    // stroke note: its strokes by id, and the lowest id framed since the
+    // last HAVE (or the HELLO's)
+    struct Stroke {
+      Trace points;
+      TraceTicks ticks;
+      std::vector<bool> have;
+      uint16_t received = 0;
+    };
+    std::map<uint16_t, Stroke> strokes;
+    bool strokesClosed;
+    bool haveFromSet;
+    uint16_t haveFrom;
+};
+
+// p-th percentile (0-100) of samples, 0 if empty
+uint64_t percentile(std::vector<uint64_t> samples, double p);
+
+#endif
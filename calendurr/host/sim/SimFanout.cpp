@@ -0,0 +1,126 @@
+#include "SimFanout.h"
+
+#include <string.h>
+#include <sys/socket.h>
+
+SimFanout::SimFanout(const SimLinkConfig& config, const std::vector<uint16_t>& mtus, const std::vector<int>& fds)
+  : delivered(0), refused(0), lost(0), config(config), rng(config.seed), nowUs(0){
+  for(size_t i = 0; i < fds.size(); i++){
+    Central central;
+    central.mtu = mtus[i];
+    central.fd = fds[i];
+    central.nextEventUs = config.connIntervalUs + config.connIntervalUs * i / fds.size();
+    centrals.push_back(central);
+  }
+}
+
+bool SimFanout::sendTo(uint16_t conn, const uint8_t* data, uint16_t len){
+  advanceTo(nowUs + config.notifyCostUs);
+
+  Central& central = centrals[conn];
+  if(len > central.mtu - 3 || central.queue.size() >= config.queueDepth){
+    refused++;
+    return false;
+  }
+
+  central.queue.push_back({nowUs, std::vector<uint8_t>(data, data + len)});
+  return true;
+}
+
+void SimFanout::pause(uint32_t ms){
+  advanceTo(nowUs + (uint64_t)ms * 1000);
+}
+
+void SimFanout::flush(){
+  for(;;){
+    pump();
+
+    bool queued = false;
+    uint64_t next = UINT64_MAX;
+    for(const Central& central : centrals){
+      queued = queued || !central.queue.empty();
+      next = central.nextEventUs < next ? central.nextEventUs : next;
+    }
+    if(!queued && idle()){
+      return;
+    }
+    advanceTo(next);
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                advanceTo()                   --*/
+/*--------------------------------------------------*/
+/*    Runs the connection events of all the links   */
+/*    up to us, in time order.                      */
+/*--------------------------------------------------*/
+void SimFanout::advanceTo(uint64_t us){
+  if(us < nowUs){
+    return;
+  }
+
+  for(;;){
+    uint16_t conn = 0;
+    for(uint16_t i = 1; i < centrals.size(); i++){
+      if(centrals[i].nextEventUs < centrals[conn].nextEventUs){
+        conn = i;
+      }
+    }
+    if(centrals.empty() || centrals[conn].nextEventUs > us){
+      break;
+    }
+
+    nowUs = centrals[conn].nextEventUs;
+    connectionEvent(conn);
+    centrals[conn].nextEventUs += config.connIntervalUs;
+  }
+  nowUs = us;
+}
+
+/*--------------------------------------------------*/
+/*--             connectionEvent()                --*/
+/*--------------------------------------------------*/
+/*    Like SimLink's, but the event ends at this    */
+/*    link's share of the interval.                 */
+/*--------------------------------------------------*/
+void SimFanout::connectionEvent(uint16_t conn){
+  Central& central = centrals[conn];
+  uint64_t endUs = nowUs + config.connIntervalUs / centrals.size();
+  uint64_t at = nowUs;
+  uint8_t sent = 0;
+
+  for(uint16_t i = 0; i < config.packetsPerEvent && !central.queue.empty(); i++){
+    const Packet& packet = central.queue.front();
+    uint64_t airUs = (uint64_t)(packet.data.size() + 3 + 4 + 10) * 8 + 150 + 80 + 150;
+    if(i > 0 && at + airUs > endUs){
+      break;
+    }
+    at += airUs;
+
+    if(config.lossPerMille && rng.range(0, 999) < config.lossPerMille){
+      lost++;
+    }
+    else{
+      deliver(central, packet, at);
+    }
+    central.queue.pop_front();
+    sent++;
+  }
+
+  if(sent){
+    credit(conn, sent);
+  }
+}
+
+void SimFanout::deliver(Central& central, const Packet& packet, uint64_t at){
+  uint8_t datagram[sizeof(SimHeader) + NOTE_MAX_PAYLOAD];
+  SimHeader header = {packet.queuedUs, at};
+  memcpy(datagram, &header, sizeof(header));
+  memcpy(datagram + sizeof(header), packet.data.data(), packet.data.size());
+  send(central.fd, datagram, sizeof(header) + packet.data.size(), 0);
+  delivered++;
+
+  // lockstep with the receiver; its control writes are dropped
+  uint8_t reply[NOTE_MAX_PAYLOAD];
+  recv(central.fd, reply, sizeof(reply), 0);
+}
@@ -0,0 +1,75 @@
+#ifndef CALENDURR_SIM_FANOUT_H
+#define CALENDURR_SIM_FANOUT_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include "Fanout.h"
+#include "SimLink.h"
+
+/*--------------------------------------------------*/
+/*--        SIMULATED RADIO, SEVERAL CENTRALS     --*/
+/*--------------------------------------------------*/
+/*  NoteFanout over one radio shared by several     */
+/*  connections, each with its own MTU, HVN queue   */
+/*  and socket to its own NoteReceiver. The         */
+/*  connections run at the same interval with       */
+/*  their anchors spread evenly over it, and each   */
+/*  event may only use its share of the interval    */
+/*  (the SoftDevice's event length split between    */
+/*  the links), at least one packet.                */
+/*                                                  */
+/*  Every sendTo() costs notifyCostUs, so a note    */
+/*  costs the CPU one notify per packet per         */
+/*  connection; the encoding is done once.          */
+/*  Packets leaving a queue give the link its       */
+/*  credit back (HVN TX complete). Control writes   */
+/*  from the centrals are not modelled.             */
+/*--------------------------------------------------*/
+
+class SimFanout : public NoteFanout {
+  public:
+    // One connection per fd, MTU from mtus; the connection handle is the index
+    SimFanout(const SimLinkConfig& config, const std::vector<uint16_t>& mtus, const std::vector<int>& fds);
+
+    void pause(uint32_t ms) override;
+    uint32_t now() override { return nowUs / 1000; }
+    uint32_t clockUs() override { return (uint32_t)(nowUs + config.clockBaseUs); }
+
+    // Runs connection events until every link has sent everything
+    void flush();
+
+    uint64_t nowMicros() const { return nowUs; }
+
+    unsigned long delivered;
+    unsigned long refused;
+    unsigned long lost;
+
+  protected:
+    bool sendTo(uint16_t conn, const uint8_t* data, uint16_t len) override;
+
+  private:
+    struct Packet {
+      uint64_t queuedUs;
+      std::vector<uint8_t> data;
+    };
+
+    struct Central {
+      uint16_t mtu;
+      int fd;
+      std::deque<Packet> queue;
+      uint64_t nextEventUs;
+    };
+
+    void advanceTo(uint64_t us);
+    void connectionEvent(uint16_t conn);
+    void deliver(Central& central, const Packet& packet, uint64_t at);
+
+    SimLinkConfig config;
+    TraceRandom rng;
+    std::vector<Central> centrals;
+    uint64_t nowUs;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "SimLink.h"
+
+#include <string.h>
+#include <sys/socket.h>
+
+SimLink::SimLink(const SimLinkConfig& config, int fd)
+  : delivered(0), refused(0), lost(0), events(0), writes(0), disconnects(0),
+    config(config), fd(fd), rng(config.seed), isConnected(true), reconnectUs(0),
+    nowUs(0), nextEventUs(config.connIntervalUs) {}
+
+uint16_t SimLink::payloadSize(){
+  return config.mtu - 3;
+}
+
+/*--------------------------------------------------*/
+/*--                  notify()                    --*/
+/*--------------------------------------------------*/
+/*    A full queue either blocks the caller until   */
+/*    the next connection event frees a slot, or    */
+/*    refuses the packet (dropWhenFull).            */
+/*--------------------------------------------------*/
+bool SimLink::notify(const uint8_t* data, uint16_t len){
+  advanceTo(nowUs + config.notifyCostUs);
+
+  if(!isConnected || len > payloadSize()){
+    refused++;
+    return false;
+  }
+
+  while(queue.size() >= config.queueDepth){
+    if(config.dropWhenFull || !isConnected){
+      refused++;
+      return false;
+    }
+    advanceTo(nextEventUs);
+  }
+
+  queue.push_back({nowUs, std::vector<uint8_t>(data, data + len)});
+  return true;
+}
+
+void SimLink::pause(uint32_t ms){
+  advanceTo(nowUs + (uint64_t)ms * 1000);
+}
+
+void SimLink::flush(){
+  while(!queue.empty() || !incoming.empty()){
+    advanceTo(nextEventUs);
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                advanceTo()                   --*/
+/*--------------------------------------------------*/
+/*    Runs every connection event up to us, and     */
+/*    the scripted disconnect / reconnect.          */
+/*--------------------------------------------------*/
+void SimLink::advanceTo(uint64_t us){
+  if(us < nowUs){
+    return;
+  }
+
+  for(;;){
+    uint64_t dropUs = (isConnected && config.disconnectAtMs && !disconnects)
+      ? (uint64_t)config.disconnectAtMs * 1000 : UINT64_MAX;
+    uint64_t wakeUs = isConnected ? nextEventUs : reconnectUs;
+    uint64_t at = dropUs < wakeUs ? dropUs : wakeUs;
+
+    if(at > us){
+      break;
+    }
+
+    nowUs = at;
+    if(at == dropUs){
+      disconnect();
+    }
+    else if(!isConnected){
+      isConnected = true;
+      nextEventUs = nowUs + config.connIntervalUs;
+      if(onConnect){
+        onConnect();
+      }
+    }
+    else{
+      connectionEvent();
+      nextEventUs += config.connIntervalUs;
+    }
+  }
+  nowUs = us;
+}
+
+void SimLink::disconnect(){
+  disconnects++;
+  isConnected = false;
+  reconnectUs = nowUs + (uint64_t)config.reconnectAfterMs * 1000;
+  lost += queue.size();
+  queue.clear();
+  incoming.clear();
+}
+
+/*--------------------------------------------------*/
+/*--             connectionEvent()                --*/
+/*--------------------------------------------------*/
+/*    The central's packet opens the event, so      */
+/*    pending control writes land first. Then up to */
+/*    packetsPerEvent queued notifications go out,  */
+/*    spaced by the air time of a 1M PHY packet     */
+/*    plus T_IFS and the empty ack from the         */
+/*    central.                                      */
+/*--------------------------------------------------*/
+void SimLink::connectionEvent(){
+  events++;
+
+  while(!incoming.empty() && incoming.front().queuedUs <= nowUs){
+    Packet write = incoming.front();
+    incoming.pop_front();
+    writes++;
+    if(onWrite){
+      onWrite(write.data.data(), write.data.size());
+    }
+  }
+
+  uint64_t at = nowUs;
+  for(uint16_t i = 0; i < config.packetsPerEvent && !queue.empty(); i++){
+    Packet packet = queue.front();
+    queue.pop_front();
+
+    // 8 us per byte: ATT (3) + L2CAP (4) + preamble, access address, header, CRC (10)
+    at += (uint64_t)(packet.data.size() + 3 + 4 + 10) * 8 + 150 + 80 + 150;
+
+    if(config.lossPerMille && rng.range(0, 999) < config.lossPerMille){
+      lost++;
+    }
+    else{
+      deliver(packet, at);
+    }
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                 deliver()                    --*/
+/*--------------------------------------------------*/
+/*    Hands one notification to the receiver and    */
+/*    waits for its answer (lockstep keeps the run  */
+/*    deterministic).                               */
+/*--------------------------------------------------*/
+void SimLink::deliver(const Packet& packet, uint64_t at){
+  uint8_t datagram[sizeof(SimHeader) + NOTE_MAX_PAYLOAD];
+  SimHeader header = {packet.queuedUs, at};
+  memcpy(datagram, &header, sizeof(header));
+  memcpy(datagram + sizeof(header), packet.data.data(), packet.data.size());
+  send(fd, datagram, sizeof(header) + packet.data.size(), 0);
+  delivered++;
+
+  uint8_t reply[NOTE_MAX_PAYLOAD];
+  ssize_t n = recv(fd, reply, sizeof(reply), 0);
+  if(n > 0){
+    incoming.push_back({at + config.hostDelayUs, std::vector<uint8_t>(reply, reply + n)});
+  }
+}
@@ -0,0 +1,130 @@
+#ifndef CALENDURR_SIM_LINK_H
+#define CALENDURR_SIM_LINK_H
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "Protocol.h"
+#include "Trace.h"
+
+/*--------------------------------------------------*/
+/*--         SIMULATED BLE PERIPHERAL LINK        --*/
+/*--------------------------------------------------*/
+/*  Stands in for dataCharacteristic.notify() when  */
+/*  the protocol code runs on the host. Packets go  */
+/*  into a TX queue (the SoftDevice HVN queue) and  */
+/*  leave it at connection events, at most          */
+/*  packetsPerEvent per event. Delivered packets    */
+/*  are written to a SOCK_SEQPACKET socket, one     */
+/*  datagram per notification, for the receiver.    */
+/*                                                  */
+/*  The receiver answers every datagram with one    */
+/*  datagram (empty if it has nothing to say); a    */
+/*  non-empty answer is a write without response to */
+/*  the control characteristic and reaches the      */
+/*  device at the first connection event after      */
+/*  hostDelayUs.                                    */
+/*                                                  */
+/*  Time is virtual (us) so every run with the same */
+/*  config and seed gives the same numbers.         */
+/*--------------------------------------------------*/
+
+/*------------------------------------------*/
+/*  mtu - negotiated ATT MTU                */
+/*  connIntervalUs - connection interval    */
+/*  packetsPerEvent - notifications the     */
+/*            radio gets out per event      */
+/*  queueDepth - HVN TX queue slots         */
+/*  dropWhenFull - refuse the notify when   */
+/*            the queue is full instead of  */
+/*            blocking until the next event */
+/*  lossPerMille - packets lost after they  */
+/*            leave the queue (host stack)  */
+/*  notifyCostUs - CPU time of one notify   */
+/*  hostDelayUs - central's turnaround for  */
+/*            a control write               */
+/*  disconnectAtMs - drop the link at this  */
+/*            time (0 = never)              */
+/*  reconnectAfterMs - down time before the */
+/*            central reconnects            */
+/*  clockBaseUs - the device's micros() at  */
+/*            time 0                        */
+/*------------------------------------------*/
+struct SimLinkConfig {
+  uint16_t mtu = 247;
+  uint32_t connIntervalUs = 15000;
+  uint16_t packetsPerEvent = 6;
+  uint16_t queueDepth = 8;
+  bool dropWhenFull = false;
+  uint16_t lossPerMille = 0;
+  uint32_t notifyCostUs = 20;
+  uint32_t hostDelayUs = 5000;
+  uint32_t disconnectAtMs = 0;
+  uint32_t reconnectAfterMs = 1000;
+  uint32_t clockBaseUs = 0;
+  uint32_t seed = 1;
+};
+
+// Prepended to every datagram written to the socket
+struct SimHeader {
+  uint64_t queuedUs;
+  uint64_t deliveredUs;
+};
+
+class SimLink : public NoteLink {
+  public:
+    SimLink(const SimLinkConfig& config, int fd);
+
+    uint16_t payloadSize() override;
+    bool notify(const uint8_t* data, uint16_t len) override;
+    void pause(uint32_t ms) override;
+    uint32_t now() override { return nowUs / 1000; }
+    uint32_t clockUs() override { return (uint32_t)(nowUs + config.clockBaseUs); }
+    bool connected() override { return isConnected; }
+
+    // Runs connection events until the TX queue is empty
+    void flush();
+
+    // Runs connection events until time us (what the loop does between
+    // pen readings)
+    void waitUntil(uint64_t us){ advanceTo(us); }
+
+    uint64_t nowMicros() const { return nowUs; }
+
+    // Control characteristic writes and connect_callback()
+    std::function<void(const uint8_t*, uint16_t)> onWrite;
+    std::function<void()> onConnect;
+
+    unsigned long delivered;
+    unsigned long refused;
+    unsigned long lost;
+    unsigned long events;
+    unsigned long writes;
+    unsigned long disconnects;
+
+  private:
+    struct Packet {
+      uint64_t queuedUs;
+      std::vector<uint8_t> data;
+    };
+
+    void deliver(const Packet& packet, uint64_t at);
+    void disconnect();
+
+    void advanceTo(uint64_t us);
+    void connectionEvent();
+
+    SimLinkConfig config;
+    int fd;
+    TraceRandom rng;
+    std::deque<Packet> queue;
+    std::deque<Packet> incoming;    // queuedUs = when it may reach the device
+    bool isConnected;
+    uint64_t reconnectUs;
+    uint64_t nowUs;
+    uint64_t nextEventUs;
+};
+
+#endif
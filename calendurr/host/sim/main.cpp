@@ -0,0 +1,882 @@
+/*--------------------------------------------------*/
+/*--          NOTE TRANSFER SIMULATOR (host)      --*/
+/*--------------------------------------------------*/
+/*  Runs the firmware's NoteSender against SimLink  */
+/*  and checks the result with NoteReceiver on the  */
+/*  other end of a local socket. Every combination  */
+/*  of the swept parameters is one scenario; each   */
+/*  prints one row of throughput and latency.       */
+/*                                                  */
+/*  With --latency the notes are written in real    */
+/*  (simulated) time instead of being sent at once: */
+/*  each point is stored when it is captured, sent  */
+/*  on a pen lift once 100 are waiting, like        */
+/*  readSensor() does, and the rest after the SEND  */
+/*  press. Every point's capture -> host latency is */
+/*  split into its stages per note (Latency.h), on  */
+/*  a host clock the receiver has to find by SYNC.  */
+/*                                                  */
+/*  With --progressive the binary points go out as  */
+/*  a preview and its refinement (Progressive.h);   */
+/*  prev_p50/p99 is how long after the first packet */
+/*  was queued the note could be drawn, the whole   */
+/*  note (STOP) for the other framings.             */
+/*                                                  */
+/*  With --channels the markers go on their own     */
+/*  characteristic ahead of the points (Channels.h, */
+/*  NoteStream pumped like the loop() does). In     */
+/*  every plain run stop_p50/p99 and date_p99 are   */
+/*  SEND press -> STOP / DATE delivered, with the   */
+/*  whole note still to send at the press.          */
+/*                                                  */
+/*  With --centrals the notes go to that many       */
+/*  receivers at once through one NoteFanout        */
+/*  (Fanout.h) on a shared radio (SimFanout); each  */
+/*  row is the aggregate rate, the slowest and      */
+/*  fastest link's rate and Jain's fairness index   */
+/*  over the links (1 = all equal).                 */
+/*                                                  */
+/*  With --strokes the note goes out stroke by      */
+/*  stroke while it is written (Strokes.h), one     */
+/*  stroke per pen lift; --undo K then takes back   */
+/*  the last K strokes and writes them again, and   */
+/*  the row is followed by what that correction     */
+/*  cost against the whole note.                    */
+/*                                                  */
+/*  pio run -e native_sim                           */
+/*  .pio/build/native_sim/program --mtu 23,247 \    */
+/*      --interval 7.5,30 --points 100,950          */
+/*                                                  */
+/*  Options (lists are comma separated):            */
+/*    --mtu N,...        ATT MTU                    */
+/*    --interval MS,...  connection interval        */
+/*    --points N,...     points per note            */
+/*    --framing F,...    text, packed, binary       */
+/*    --notes N          notes per scenario         */
+/*    --per-event N      packets per conn. event    */
+/*    --queue N          HVN TX queue depth         */
+/*    --drop             refuse when queue is full  */
+/*    --loss N           per-mille loss after queue */
+/*    --reliable         sequence numbers + acks    */
+/*    --progressive      preview pass first         */
+/*    --channels         status + stream channels   */
+/*    --strokes          stroke table, delta sends  */
+/*    --undo K           strokes redone per note    */
+/*    --centrals N,...   connections, fanned out    */
+/*    --slow-mtu N       MTU of the last central    */
+/*    --untimed          no per-point timestamps    */
+/*    --latency          trace every point's        */
+/*                       latency (binary framing)   */
+/*    --resample STEP    ArcResampler every note    */
+/*    --disconnect-at MS drop the link once         */
+/*    --reconnect-after MS  down time               */
+/*    --host-delay US    central's ack turnaround   */
+/*    --trace FILE       use a recorded coordz.txt  */
+/*    --seed N           generator / loss seed      */
+/*    --csv              machine readable output    */
+/*--------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Channels.h"
+#include "Protocol.h"
+#include "Receiver.h"
+#include "Reliable.h"
+#include "SimFanout.h"
+#include "SimLink.h"
+#include "Strokes.h"
+#include "Trace.h"
+
+#define SIM_MONTH 4
+#define SIM_DAY 27
+#define SIM_HOUR 9
+#define SIM_MINUTE 30
+
+#define SIM_SEND_PRESS_MS 300             // last point -> SEND_BUTTON
+#define SIM_LIFT_TICKS (100000 / POINT_TICK_US)
+#define SIM_SEND_AFTER 100                // readSensor() sends on a lift past this
+#define SIM_CLOCK_BASE_US 0xFFF00000u     // device micros() wraps ~1 s into the run
+#define SIM_HOST_OFFSET_US 1700000000000000LL
+#define SIM_STREAM_PASSES 8               // loop() passes streaming a note before SEND
+#define SIM_UNTIMED_POINT_US 2500         // --strokes --untimed: time between readings
+#define SIM_LOOP_US 2000                  // --strokes: loop() pass while the pen is up
+
+struct Scenario {
+  SimLinkConfig link;
+  uint8_t framing;
+  bool reliable;
+  bool progressive;
+  bool channels;
+  bool strokes;
+  int undo;
+  bool timed;
+  bool latency;
+  int points;
+};
+
+struct SenderStats {
+  unsigned long refused;
+  unsigned long lost;
+  unsigned long resent;
+  unsigned long tickBytes;    // of pointBytes, the ticks
+  unsigned long pointBytes;   // PointStore storage for all notes
+  unsigned long strokeBytes;  // --strokes: all frames, and those after the first undo,
+  unsigned long fixBytes;     // summed over every note
+  unsigned long undone;
+  unsigned long drops;
+  std::vector<uint64_t> pressUs;  // SEND of every note
+};
+
+static const char* framingName(const Scenario& scenario){
+  if(scenario.reliable){
+    return "reliable";
+  }
+  if(scenario.progressive){
+    return "preview";
+  }
+  if(scenario.channels){
+    return "channels";
+  }
+  if(scenario.strokes){
+    return "strokes";
+  }
+  switch(scenario.framing){
+    case FRAMING_TEXT_PACKED: return "packed";
+    case FRAMING_BINARY: return "binary";
+    default: return "text";
+  }
+}
+
+static std::vector<double> parseList(const char* arg){
+  std::vector<double> values;
+  std::string list(arg);
+  size_t start = 0;
+  while(start <= list.size()){
+    size_t comma = list.find(',', start);
+    if(comma == std::string::npos){
+      comma = list.size();
+    }
+    values.push_back(atof(list.substr(start, comma - start).c_str()));
+    start = comma + 1;
+  }
+  return values;
+}
+
+static std::vector<uint8_t> parseFramings(const char* arg){
+  std::vector<uint8_t> framings;
+  std::string list(arg);
+  size_t start = 0;
+  while(start <= list.size()){
+    size_t comma = list.find(',', start);
+    if(comma == std::string::npos){
+      comma = list.size();
+    }
+    std::string name = list.substr(start, comma - start);
+    framings.push_back(name == "binary" ? FRAMING_BINARY : (name == "packed" ? FRAMING_TEXT_PACKED : FRAMING_TEXT));
+    start = comma + 1;
+  }
+  return framings;
+}
+
+// SEND press -> seen, per note; empty unless every note has both
+static std::vector<uint64_t> sincePress(const std::vector<uint64_t>& pressUs, const std::vector<uint64_t>& seenUs){
+  std::vector<uint64_t> spans;
+  for(size_t n = 0; pressUs.size() == seenUs.size() && n < seenUs.size(); n++){
+    spans.push_back(seenUs[n] - pressUs[n]);
+  }
+  return spans;
+}
+
+/*--------------------------------------------------*/
+/*--                writeNote()                   --*/
+/*--------------------------------------------------*/
+/*    --latency: one note as the pen writes it.     */
+/*    The loop answers SYNC between readings; a     */
+/*    point whose capture time passed while a send  */
+/*    blocked is stored late, as on the board.      */
+/*--------------------------------------------------*/
+static void writeNote(SimLink& link, NoteSender& sender, LatencyTracer& tracer, const Trace& note,
+                      const TraceTicks& ticks){
+  std::vector<uint8_t> bytes(note.size() * POINT_RECORD_MAX);
+  PointStore coordz(bytes.data(), bytes.size(), true);
+  uint64_t captureUs = link.nowMicros();
+
+  for(size_t i = 0; i < note.size(); i++){
+    captureUs += (uint64_t)ticks[i] * POINT_TICK_US;
+    link.waitUntil(captureUs);
+    tracer.service(sender, link.clockUs());
+
+    bool lift = i == 0 || ticks[i] >= SIM_LIFT_TICKS;
+    coordz.append(note[i][0], note[i][1], lift, ticks[i]);
+    tracer.stored(ticks[i], (uint32_t)(captureUs + SIM_CLOCK_BASE_US), link.clockUs());
+
+    if(i + 1 < note.size() && ticks[i + 1] >= SIM_LIFT_TICKS && coordz.count() > SIM_SEND_AFTER){
+      sender.sendPoints(coordz);
+      coordz.clear();
+    }
+  }
+
+  link.waitUntil(link.nowMicros() + (uint64_t)SIM_SEND_PRESS_MS * 1000);
+  tracer.service(sender, link.clockUs());
+  sender.sendPoints(coordz);
+}
+
+/*--------------------------------------------------*/
+/*--               writeStrokes()                 --*/
+/*--------------------------------------------------*/
+/*    --strokes: strokes [from, to) of one note as  */
+/*    the pen writes them, each point at its ticks, */
+/*    with a loop() pass between readings. A full   */
+/*    table is flushed like sendCoordinates() does. */
+/*--------------------------------------------------*/
+static void writeStrokes(SimLink& link, StrokeTable& table, StrokeSender& sender, PointStore& coordz,
+                         const Trace& note, const TraceTicks& ticks, const std::vector<size_t>& starts,
+                         size_t from, size_t to){
+  for(size_t s = from; s < to; s++){
+    if(!table.room()){
+      while(!sender.transmit(STROKE_STALL_MS)){
+        while(!link.connected()){
+          link.pause(10);
+        }
+      }
+      table.forget();
+      coordz.clear();
+    }
+
+    for(size_t i = starts[s]; i < starts[s + 1]; i++){
+      uint32_t tick = i < ticks.size() ? ticks[i] : 0;
+      uint64_t captureUs = link.nowMicros() + (ticks.empty() ? SIM_UNTIMED_POINT_US : (uint64_t)tick * POINT_TICK_US);
+      while(link.nowMicros() < captureUs){
+        link.waitUntil(std::min(captureUs, link.nowMicros() + SIM_LOOP_US));
+        sender.service();
+      }
+      table.add(coordz.count(), note[i][0], note[i][1], i == starts[s]);
+      coordz.append(note[i][0], note[i][1], i == starts[s], tick);
+    }
+    table.lift();
+    sender.service();
+  }
+}
+
+/*--------------------------------------------------*/
+/*--               runScenario()                  --*/
+/*--------------------------------------------------*/
+/*    Sends the notes exactly like sendData() does  */
+/*    (points, STOP, DATE, END, START, or with      */
+/*    NOTE_RELIABLE points + CLOSE until acked) and */
+/*    returns what the receiver saw.                */
+/*--------------------------------------------------*/
+static ReceiverReport runScenario(const Scenario& scenario, const std::vector<Trace>& notes,
+                                  const std::vector<TraceTicks>& ticks, SenderStats* stats){
+  int fds[2];
+  if(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) != 0){
+    perror("socketpair");
+    exit(1);
+  }
+
+  NoteReceiver receiver(notes, ticks, SIM_MONTH, SIM_DAY);
+  if(scenario.latency){
+    receiver.traceLatency(SIM_HOST_OFFSET_US);
+  }
+  std::thread central([&]() { receiver.run(fds[1]); });
+
+  SimLink link(scenario.link, fds[0]);
+  NoteSender sender(link, scenario.framing);
+  sender.progressive = scenario.progressive;
+  ReliableSender reliable(link);
+  stats->resent = 0;
+  stats->tickBytes = 0;
+  stats->pointBytes = 0;
+  stats->strokeBytes = 0;
+  stats->fixBytes = 0;
+  stats->undone = 0;
+  stats->drops = 0;
+
+  // what readSensor() stores in coordz
+  std::vector<std::vector<uint8_t>> pointBuffers;
+  std::vector<PointStore> stores;
+  for(size_t n = 0; n < notes.size(); n++){
+    pointBuffers.emplace_back(notes[n].size() * POINT_RECORD_MAX);
+  }
+  for(size_t n = 0; n < notes.size(); n++){
+    stores.emplace_back(pointBuffers[n].data(), pointBuffers[n].size(), scenario.timed);
+    storeTrace(notes[n], scenario.timed ? ticks[n] : TraceTicks(), stores.back());
+    stats->pointBytes += stores.back().bytes();
+    if(scenario.timed){
+      // the ticks are whatever the same points cost without them
+      std::vector<uint8_t> plain(pointBuffers[n].size());
+      PointStore untimed(plain.data(), plain.size(), false);
+      storeTrace(notes[n], TraceTicks(), untimed);
+      stats->tickBytes += stores.back().bytes() - untimed.bytes();
+    }
+  }
+
+  if(scenario.reliable){
+    link.onWrite = [&](const uint8_t* data, uint16_t len) { reliable.post(data, len); };
+    link.onConnect = [&]() { reliable.resume(); };
+
+    for(size_t n = 0; n < notes.size(); n++){
+      reliable.setPoints(stores[n], 0);
+      reliable.close(SIM_MONTH, SIM_DAY, SIM_HOUR, SIM_MINUTE);
+
+      // like the loop(): retry after a stall, wait out a disconnect
+      for(int attempt = 0; attempt < 50 && !reliable.transmit(RELIABLE_STALL_MS); attempt++){
+        while(!link.connected()){
+          link.pause(10);
+        }
+      }
+      reliable.nextNote();
+    }
+    stats->resent = reliable.resent;
+  }
+  else if(scenario.strokes){
+    StrokeTable table;
+    StrokeSender strokes(link, table);
+    link.onWrite = [&](const uint8_t* data, uint16_t len) { strokes.post(data, len); };
+    link.onConnect = [&]() { strokes.resume(); };
+
+    for(size_t n = 0; n < notes.size(); n++){
+      std::vector<uint8_t> bytes(notes[n].size() * POINT_RECORD_MAX);
+      PointStore coordz(bytes.data(), bytes.size(), scenario.timed);
+      strokes.setPoints(coordz);
+      const TraceTicks& noteTicks = scenario.timed ? ticks[n] : TraceTicks();
+
+      std::vector<size_t> starts;
+      for(size_t i = 0; i < notes[n].size(); i++){
+        if(strokeStartAt(notes[n], i)){
+          starts.push_back(i);
+        }
+      }
+      size_t count = starts.size();
+      starts.push_back(notes[n].size());
+
+      stats->pressUs.push_back(link.nowMicros());
+      unsigned long noteBytes = strokes.bytes;
+      writeStrokes(link, table, strokes, coordz, notes[n], noteTicks, starts, 0, count);
+
+      // take back the last strokes and write them again once the phone has the note
+      size_t undone = 0;
+      unsigned long fixFrom = strokes.bytes;
+      if(scenario.undo > 0){
+        for(int attempt = 0; attempt < 50 && !strokes.transmit(STROKE_STALL_MS); attempt++){
+          while(!link.connected()){
+            link.pause(10);
+          }
+        }
+        fixFrom = strokes.bytes;
+        while(undone < (size_t)scenario.undo && table.undo(coordz)){
+          undone++;
+        }
+        writeStrokes(link, table, strokes, coordz, notes[n], noteTicks, starts, count - undone, count);
+      }
+
+      strokes.close(SIM_MONTH, SIM_DAY, SIM_HOUR, SIM_MINUTE);
+      for(int attempt = 0; attempt < 50 && !strokes.transmit(STROKE_STALL_MS); attempt++){
+        while(!link.connected()){
+          link.pause(10);
+        }
+      }
+      stats->strokeBytes += strokes.bytes - noteBytes;
+      stats->fixBytes += undone ? strokes.bytes - fixFrom : 0;
+      stats->undone += undone;
+      strokes.nextNote();
+    }
+    stats->resent = strokes.resent;
+    stats->drops = strokes.drops;
+  }
+  else if(scenario.latency){
+    LatencyTracer tracer;
+    sender.tracer = &tracer;
+    link.onWrite = [&](const uint8_t* data, uint16_t len) { tracer.post(data, len, link.clockUs()); };
+
+    sender.sendStart();
+    tracer.start(link.clockUs());
+
+    for(size_t n = 0; n < notes.size(); n++){
+      writeNote(link, sender, tracer, notes[n], ticks[n]);
+      sender.sendStop();
+      sender.sendDate(SIM_MONTH, SIM_DAY);
+      sender.sendTime(SIM_HOUR, SIM_MINUTE);
+      sender.sendEnd();
+      sender.sendStart();
+      tracer.start(link.clockUs());
+    }
+  }
+  else if(scenario.channels){
+    // connect_callback(), then per note a few loop() passes before SEND
+    NoteStream stream(link);
+    stream.start();
+
+    for(size_t n = 0; n < notes.size(); n++){
+      for(int pass = 0; pass < SIM_STREAM_PASSES; pass++){
+        stream.service(stores[n]);
+      }
+      stats->pressUs.push_back(link.nowMicros());
+      stream.close(stores[n], SIM_MONTH, SIM_DAY, SIM_HOUR, SIM_MINUTE);
+      stream.start();
+      stream.drain(stores[n]);
+      stream.cleared();
+    }
+  }
+  else{
+    // connect_callback()
+    sender.sendStart();
+
+    for(size_t n = 0; n < notes.size(); n++){
+      stats->pressUs.push_back(link.nowMicros());
+      sender.sendPoints(stores[n]);
+      sender.sendStop();
+      sender.sendDate(SIM_MONTH, SIM_DAY);
+      sender.sendTime(SIM_HOUR, SIM_MINUTE);
+      sender.sendEnd();
+      sender.sendStart();
+    }
+  }
+  link.flush();
+
+  shutdown(fds[0], SHUT_WR);
+  central.join();
+  close(fds[0]);
+  close(fds[1]);
+
+  stats->refused = link.refused;
+  stats->lost = link.lost;
+  return receiver.report;
+}
+
+/*--------------------------------------------------*/
+/*--                runFanout()                   --*/
+/*--------------------------------------------------*/
+/*    The plain transfer of runScenario() to        */
+/*    mtus.size() centrals through one SimFanout;   */
+/*    one report per central.                       */
+/*--------------------------------------------------*/
+static std::vector<ReceiverReport> runFanout(const Scenario& scenario, const std::vector<uint16_t>& mtus,
+                                             const std::vector<Trace>& notes, const std::vector<TraceTicks>& ticks,
+                                             SenderStats* stats, unsigned long* waits){
+  size_t count = mtus.size();
+  std::vector<int> deviceFds, centralFds;
+  for(size_t c = 0; c < count; c++){
+    int fds[2];
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) != 0){
+      perror("socketpair");
+      exit(1);
+    }
+    deviceFds.push_back(fds[0]);
+    centralFds.push_back(fds[1]);
+  }
+
+  std::vector<NoteReceiver> receivers;
+  receivers.reserve(count);
+  for(size_t c = 0; c < count; c++){
+    receivers.emplace_back(notes, ticks, SIM_MONTH, SIM_DAY);
+  }
+  std::vector<std::thread> threads;
+  for(size_t c = 0; c < count; c++){
+    threads.emplace_back([&receivers, &centralFds, c]() { receivers[c].run(centralFds[c]); });
+  }
+
+  SimFanout fanout(scenario.link, mtus, deviceFds);
+  for(size_t c = 0; c < count; c++){
+    fanout.attach(c, mtus[c] - 3, scenario.link.queueDepth);
+  }
+  NoteSender sender(fanout, scenario.framing);
+  sender.progressive = scenario.progressive;
+
+  std::vector<std::vector<uint8_t>> pointBuffers;
+  std::vector<PointStore> stores;
+  for(size_t n = 0; n < notes.size(); n++){
+    pointBuffers.emplace_back(notes[n].size() * POINT_RECORD_MAX);
+  }
+  for(size_t n = 0; n < notes.size(); n++){
+    stores.emplace_back(pointBuffers[n].data(), pointBuffers[n].size(), scenario.timed);
+    storeTrace(notes[n], scenario.timed ? ticks[n] : TraceTicks(), stores.back());
+  }
+
+  // connect_callback() of the first central; the others attach before any note
+  sender.sendStart();
+  for(size_t n = 0; n < notes.size(); n++){
+    stats->pressUs.push_back(fanout.nowMicros());
+    sender.sendPoints(stores[n]);
+    sender.sendStop();
+    sender.sendDate(SIM_MONTH, SIM_DAY);
+    sender.sendTime(SIM_HOUR, SIM_MINUTE);
+    sender.sendEnd();
+    sender.sendStart();
+  }
+  fanout.flush();
+
+  for(size_t c = 0; c < count; c++){
+    shutdown(deviceFds[c], SHUT_WR);
+  }
+  for(std::thread& thread : threads){
+    thread.join();
+  }
+  for(size_t c = 0; c < count; c++){
+    close(deviceFds[c]);
+    close(centralFds[c]);
+  }
+
+  stats->refused = fanout.refused;
+  stats->lost = fanout.lost;
+  *waits = fanout.waits;
+
+  std::vector<ReceiverReport> reports;
+  for(const NoteReceiver& receiver : receivers){
+    reports.push_back(receiver.report);
+  }
+  return reports;
+}
+
+/*--------------------------------------------------*/
+/*--               printLatency()                 --*/
+/*--------------------------------------------------*/
+/*    Stage percentiles per note and over the whole */
+/*    run (with --csv, the end of the scenario's    */
+/*    row). false if the clock estimate is off by   */
+/*    more than the half round trip that bounds it. */
+/*--------------------------------------------------*/
+static bool printLatency(const ReceiverReport& report, bool csv){
+  // host - device as the receiver's clock really is (SIM_CLOCK_BASE_US is the device's micros() at 0)
+  int64_t trueOffsetUs = SIM_HOST_OFFSET_US - (int64_t)SIM_CLOCK_BASE_US;
+  int32_t errorUs = (int32_t)(uint32_t)(report.clockOffsetUs - trueOffsetUs);
+  bool bounded = report.syncs > 0 && (uint32_t)abs(errorUs) <= report.syncRoundTripUs / 2 + 1;
+
+  NoteLatency all;
+  const struct { const char* name; std::vector<uint64_t> NoteLatency::* stage; } stages[] = {
+    {"capture->host", &NoteLatency::total},
+    {"  capture->coordz", &NoteLatency::store},
+    {"  coordz->notify", &NoteLatency::queue},
+    {"  notify->received", &NoteLatency::radio},
+    {"  host handling", &NoteLatency::host},
+  };
+
+  for(size_t n = 0; n < report.latency.size(); n++){
+    const NoteLatency& note = report.latency[n];
+    for(const auto& stage : stages){
+      (all.*stage.stage).insert((all.*stage.stage).end(), (note.*stage.stage).begin(), (note.*stage.stage).end());
+    }
+    if(!csv){
+      printf("  note %-3zu %5zu pts  ms p50/p99: total %7.1f %7.1f  queue %7.1f %7.1f  radio %6.1f %6.1f"
+             "  host %5.3f %5.3f\n", n, note.total.size(),
+             percentile(note.total, 50) / 1000.0, percentile(note.total, 99) / 1000.0,
+             percentile(note.queue, 50) / 1000.0, percentile(note.queue, 99) / 1000.0,
+             percentile(note.radio, 50) / 1000.0, percentile(note.radio, 99) / 1000.0,
+             percentile(note.host, 50) / 1000.0, percentile(note.host, 99) / 1000.0);
+    }
+  }
+
+  if(csv){
+    // the rest of the scenario's row
+    printf(",%.2f,%.2f,%.3f,%.2f,%.2f,%.2f,%.2f,%.3f,%lu,%d,%u\n",
+           percentile(all.total, 50) / 1000.0, percentile(all.total, 99) / 1000.0,
+           percentile(all.store, 99) / 1000.0, percentile(all.queue, 50) / 1000.0,
+           percentile(all.queue, 99) / 1000.0, percentile(all.radio, 50) / 1000.0,
+           percentile(all.radio, 99) / 1000.0, percentile(all.host, 99) / 1000.0,
+           report.syncs, errorUs, report.syncRoundTripUs);
+  }
+  else{
+    printf("  %-20s %8s %8s %8s %8s\n", "all points, ms", "p50", "p90", "p99", "max");
+    for(const auto& stage : stages){
+      const std::vector<uint64_t>& samples = all.*stage.stage;
+      printf("  %-20s %8.3f %8.3f %8.3f %8.3f\n", stage.name, percentile(samples, 50) / 1000.0,
+             percentile(samples, 90) / 1000.0, percentile(samples, 99) / 1000.0, percentile(samples, 100) / 1000.0);
+    }
+    printf("  clock: %lu syncs, offset error %d us (round trip %u us), %lu points before the first\n",
+           report.syncs, errorUs, report.syncRoundTripUs, report.untraced);
+  }
+
+  if(!bounded){
+    fprintf(stderr, "  clock offset off by %d us, more than half the %u us round trip\n", errorUs,
+            report.syncRoundTripUs);
+  }
+  return bounded;
+}
+
+int main(int argc, char** argv){
+  std::vector<double> mtus = {23, 185, 247};
+  std::vector<double> intervals = {7.5, 15, 30};
+  std::vector<double> pointCounts = {100, 500, 950};
+  std::vector<uint8_t> framings = {FRAMING_TEXT, FRAMING_TEXT_PACKED, FRAMING_BINARY};
+  SimLinkConfig base;
+  bool reliableMode = false;
+  bool progressiveMode = false;
+  bool channelsMode = false;
+  bool strokesMode = false;
+  int undoStrokes = 0;
+  std::vector<double> centralCounts;   // empty: one central on SimLink
+  uint16_t slowMtu = 0;
+  bool latencyMode = false;
+  bool timed = NOTE_TIMESTAMPS;
+  int resampleStep = 0;
+  int noteCount = 5;
+  const char* tracePath = NULL;
+  bool csv = false;
+
+  for(int i = 1; i < argc; i++){
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : "";
+
+    if(!strcmp(arg, "--mtu")){ mtus = parseList(value); i++; }
+    else if(!strcmp(arg, "--interval")){ intervals = parseList(value); i++; }
+    else if(!strcmp(arg, "--points")){ pointCounts = parseList(value); i++; }
+    else if(!strcmp(arg, "--framing")){ framings = parseFramings(value); i++; }
+    else if(!strcmp(arg, "--notes")){ noteCount = atoi(value); i++; }
+    else if(!strcmp(arg, "--per-event")){ base.packetsPerEvent = atoi(value); i++; }
+    else if(!strcmp(arg, "--queue")){ base.queueDepth = atoi(value); i++; }
+    else if(!strcmp(arg, "--loss")){ base.lossPerMille = atoi(value); i++; }
+    else if(!strcmp(arg, "--seed")){ base.seed = strtoul(value, NULL, 10); i++; }
+    else if(!strcmp(arg, "--trace")){ tracePath = value; i++; }
+    else if(!strcmp(arg, "--disconnect-at")){ base.disconnectAtMs = atoi(value); i++; }
+    else if(!strcmp(arg, "--reconnect-after")){ base.reconnectAfterMs = atoi(value); i++; }
+    else if(!strcmp(arg, "--host-delay")){ base.hostDelayUs = atoi(value); i++; }
+    else if(!strcmp(arg, "--drop")){ base.dropWhenFull = true; }
+    else if(!strcmp(arg, "--reliable")){ reliableMode = true; }
+    else if(!strcmp(arg, "--progressive")){ progressiveMode = true; }
+    else if(!strcmp(arg, "--channels")){ channelsMode = true; }
+    else if(!strcmp(arg, "--strokes")){ strokesMode = true; }
+    else if(!strcmp(arg, "--undo")){ undoStrokes = atoi(value); i++; }
+    else if(!strcmp(arg, "--centrals")){ centralCounts = parseList(value); i++; }
+    else if(!strcmp(arg, "--slow-mtu")){ slowMtu = atoi(value); i++; }
+    else if(!strcmp(arg, "--untimed")){ timed = false; }
+    else if(!strcmp(arg, "--latency")){ latencyMode = true; }
+    else if(!strcmp(arg, "--resample")){ resampleStep = atoi(value); i++; }
+    else if(!strcmp(arg, "--csv")){ csv = true; }
+    else{
+      fprintf(stderr, "unknown option %s\n", arg);
+      return 2;
+    }
+  }
+
+  if(latencyMode && (reliableMode || !timed)){
+    fprintf(stderr, "--latency needs timestamps and the plain (not --reliable) transfer\n");
+    return 2;
+  }
+  if((progressiveMode || channelsMode) && (reliableMode || latencyMode || (progressiveMode && channelsMode))){
+    fprintf(stderr, "--progressive and --channels are plain transfers, one at a time, without --reliable or --latency\n");
+    return 2;
+  }
+  if(!centralCounts.empty() && (reliableMode || latencyMode || channelsMode)){
+    fprintf(stderr, "--centrals fans out the plain transfer, without --reliable, --latency or --channels\n");
+    return 2;
+  }
+  if(strokesMode && (reliableMode || latencyMode || progressiveMode || channelsMode || !centralCounts.empty())){
+    fprintf(stderr, "--strokes is a transfer of its own, without --reliable, --latency, --progressive, --channels or --centrals\n");
+    return 2;
+  }
+  if(undoStrokes && !strokesMode){
+    fprintf(stderr, "--undo needs --strokes\n");
+    return 2;
+  }
+  for(double centrals : centralCounts){
+    if(centrals < 1 || centrals > FANOUT_MAX_LINKS){
+      fprintf(stderr, "--centrals takes 1 to %d\n", FANOUT_MAX_LINKS);
+      return 2;
+    }
+  }
+  if(latencyMode){
+    framings = {FRAMING_BINARY};
+    base.clockBaseUs = SIM_CLOCK_BASE_US;
+  }
+  if(progressiveMode || channelsMode){
+    framings = {FRAMING_BINARY};
+  }
+
+  Trace recorded;
+  if(tracePath && !loadTrace(tracePath, recorded)){
+    fprintf(stderr, "could not read trace %s\n", tracePath);
+    return 1;
+  }
+
+  if(!centralCounts.empty()){
+    printf(csv ? "framing,mtu,interval_ms,points,centrals,slowest_mtu,payload,bytes_per_s,link_min_bytes_per_s,"
+                 "link_max_bytes_per_s,fairness,note_p99_ms,stop_p99_ms,waits,notes,intact\n"
+               : "%-8s %4s %6s %6s %4s %5s %7s %9s %9s %9s %6s %9s %8s %6s %s\n",
+           "framing", "mtu", "ci_ms", "points", "cen", "slow", "payload", "agg_B/s", "link_min", "link_max", "fair",
+           "note_p99", "stop_p99", "waits", "intact");
+  }
+  else if(csv){
+    printf("framing,mtu,interval_ms,points,packets,bytes,refused,lost,resent,duration_ms,bytes_per_s,points_per_s,"
+           "pkt_p50_ms,pkt_p99_ms,note_p50_ms,note_p99_ms,prev_p50_ms,prev_p99_ms,stop_p50_ms,stop_p99_ms,date_p99_ms,tick_bytes_per_point,point_bytes_per_point,notes,intact%s\n",
+           latencyMode ? ",total_p50_ms,total_p99_ms,store_p99_ms,queue_p50_ms,queue_p99_ms,radio_p50_ms,radio_p99_ms,"
+                         "host_p99_ms,syncs,offset_error_us,sync_round_trip_us" : "");
+  }
+  else{
+    printf("%-8s %4s %6s %6s %7s %8s %6s %5s %6s %9s %9s %8s %8s %8s %9s %9s %9s %9s %8s %8s %8s %6s %6s %s\n",
+           "framing", "mtu", "ci_ms", "points", "packets", "bytes", "refuse", "lost", "resent", "time_ms",
+           "bytes/s", "pts/s", "p50_ms", "p99_ms", "note_p50", "note_p99", "prev_p50", "prev_p99", "stop_p50", "stop_p99", "date_p99", "t_B/pt", "p_B/pt", "intact");
+  }
+
+  int failed = 0;
+  if(reliableMode || strokesMode){
+    framings = {FRAMING_BINARY};
+  }
+
+  for(uint8_t framing : framings){
+    for(double mtu : mtus){
+      for(double interval : intervals){
+        for(double points : pointCounts){
+          Scenario scenario;
+          scenario.link = base;
+          scenario.link.mtu = (uint16_t)mtu;
+          scenario.link.connIntervalUs = (uint32_t)(interval * 1000);
+          scenario.framing = framing;
+          scenario.reliable = reliableMode;
+          scenario.progressive = progressiveMode;
+          scenario.channels = channelsMode;
+          scenario.strokes = strokesMode;
+          scenario.undo = undoStrokes;
+          scenario.timed = timed;
+          scenario.latency = latencyMode;
+          scenario.points = (int)points;
+
+          // the same notes for every scenario with this length
+          std::vector<Trace> notes;
+          for(int n = 0; n < noteCount; n++){
+            if(!recorded.empty()){
+              size_t start = ((size_t)n * scenario.points) % recorded.size();
+              Trace note;
+              for(int p = 0; p < scenario.points; p++){
+                note.push_back(recorded[(start + p) % recorded.size()]);
+              }
+              notes.push_back(note);
+            }
+            else{
+              notes.push_back(syntheticTrace(base.seed + n, scenario.points));
+            }
+          }
+          std::vector<TraceTicks> ticks;
+          for(int n = 0; n < noteCount; n++){
+            ticks.push_back(traceTicks(notes[n], base.seed + n));
+            if(resampleStep > 0){
+              Trace spaced;
+              TraceTicks spacedTicks;
+              resampleTrace(notes[n], ticks[n], resampleStep, spaced, spacedTicks);
+              notes[n] = spaced;
+              ticks[n] = spacedTicks;
+            }
+          }
+          if(!timed){
+            ticks.clear();
+          }
+
+          for(double centrals : centralCounts){
+            std::vector<uint16_t> linkMtus((size_t)centrals, scenario.link.mtu);
+            if(centrals > 1 && slowMtu){
+              linkMtus.back() = slowMtu;
+            }
+
+            SenderStats stats;
+            unsigned long waits = 0;
+            std::vector<ReceiverReport> reports = runFanout(scenario, linkMtus, notes, ticks, &stats, &waits);
+
+            // per link rate over its own first queued -> last delivered
+            uint64_t firstUs = UINT64_MAX, lastUs = 0;
+            unsigned long bytes = 0, intact = 0;
+            double rateSum = 0, rateSquares = 0, rateMin = 0, rateMax = 0;
+            std::vector<uint64_t> noteUs, stopUs;
+            for(size_t c = 0; c < reports.size(); c++){
+              const ReceiverReport& report = reports[c];
+              double seconds = (report.lastDeliveredUs - report.firstQueuedUs) / 1e6;
+              double rate = seconds > 0 ? report.bytes / seconds : 0;
+              rateSum += rate;
+              rateSquares += rate * rate;
+              rateMin = c == 0 || rate < rateMin ? rate : rateMin;
+              rateMax = rate > rateMax ? rate : rateMax;
+              firstUs = report.firstQueuedUs < firstUs ? report.firstQueuedUs : firstUs;
+              lastUs = report.lastDeliveredUs > lastUs ? report.lastDeliveredUs : lastUs;
+              bytes += report.bytes;
+              intact += report.intact;
+              noteUs.insert(noteUs.end(), report.noteLatencyUs.begin(), report.noteLatencyUs.end());
+              std::vector<uint64_t> spans = sincePress(stats.pressUs, report.stopUs);
+              stopUs.insert(stopUs.end(), spans.begin(), spans.end());
+
+              if(report.intact != notes.size() || report.counterErrors || report.stateErrors){
+                failed++;
+                fflush(stdout);
+                for(const std::string& e : report.errors){
+                  fprintf(stderr, "  central %zu: %s\n", c, e.c_str());
+                }
+              }
+            }
+            double seconds = lastUs > firstUs ? (lastUs - firstUs) / 1e6 : 0;
+            double fairness = rateSquares > 0 ? rateSum * rateSum / (reports.size() * rateSquares) : 0;
+            uint16_t slowest = linkMtus.back() < linkMtus.front() ? linkMtus.back() : linkMtus.front();
+
+            printf(csv ? "%s,%u,%.2f,%d,%d,%u,%u,%.0f,%.0f,%.0f,%.3f,%.1f,%.1f,%lu,%lu,%lu\n"
+                       : "%-8s %4u %6.2f %6d %4d %5u %7u %9.0f %9.0f %9.0f %6.3f %9.1f %8.1f %6lu %lu/%lu\n",
+                   framingName(scenario), scenario.link.mtu, interval, scenario.points, (int)centrals, slowest,
+                   slowest - 3, seconds > 0 ? bytes / seconds : 0, rateMin, rateMax, fairness,
+                   percentile(noteUs, 99) / 1000.0, percentile(stopUs, 99) / 1000.0, waits, intact,
+                   (unsigned long)(notes.size() * reports.size()));
+          }
+          if(!centralCounts.empty()){
+            continue;
+          }
+
+          SenderStats stats;
+          ReceiverReport report = runScenario(scenario, notes, ticks, &stats);
+
+          double seconds = (report.lastDeliveredUs - report.firstQueuedUs) / 1e6;
+          unsigned long totalPoints = 0;
+          for(const Trace& note : notes){
+            totalPoints += note.size();
+          }
+          double bytesPerSec = seconds > 0 ? report.bytes / seconds : 0;
+          double pointsPerSec = seconds > 0 ? totalPoints / seconds : 0;
+          double tickBytesPerPoint = totalPoints ? (double)stats.tickBytes / totalPoints : 0;
+          double pointBytesPerPoint = totalPoints ? (double)stats.pointBytes / totalPoints : 0;
+
+          std::vector<uint64_t> stopSpans = sincePress(stats.pressUs, report.stopUs);
+          std::vector<uint64_t> dateSpans = sincePress(stats.pressUs, report.dateUs);
+
+          const char* format = csv
+            ? (latencyMode ? "%s,%u,%.2f,%d,%lu,%lu,%lu,%lu,%lu,%.1f,%.0f,%.0f,%.2f,%.2f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f,%lu,%lu"
+                           : "%s,%u,%.2f,%d,%lu,%lu,%lu,%lu,%lu,%.1f,%.0f,%.0f,%.2f,%.2f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f,%lu,%lu\n")
+            : "%-8s %4u %6.2f %6d %7lu %8lu %6lu %5lu %6lu %9.1f %9.0f %8.0f %8.2f %8.2f %9.1f %9.1f %9.1f %9.1f %8.1f %8.1f %8.1f %6.2f %6.2f %lu/%lu\n";
+          printf(format, framingName(scenario), scenario.link.mtu, interval, scenario.points,
+                 report.packets, report.bytes, stats.refused, stats.lost, stats.resent,
+                 seconds * 1000, bytesPerSec, pointsPerSec,
+                 percentile(report.packetLatencyUs, 50) / 1000.0, percentile(report.packetLatencyUs, 99) / 1000.0,
+                 percentile(report.noteLatencyUs, 50) / 1000.0, percentile(report.noteLatencyUs, 99) / 1000.0,
+                 percentile(report.previewLatencyUs, 50) / 1000.0, percentile(report.previewLatencyUs, 99) / 1000.0,
+                 percentile(stopSpans, 50) / 1000.0, percentile(stopSpans, 99) / 1000.0,
+                 percentile(dateSpans, 99) / 1000.0,
+                 tickBytesPerPoint, pointBytesPerPoint, report.intact, (unsigned long)notes.size());
+
+          if(strokesMode && !csv){
+            // totals over the run: what the fixes cost against everything sent before them
+            printf("  strokes: %lu B per note, %lu DROPs; %lu undone and written again: %lu B in all, "
+                   "%.1f B per undone stroke, %.1f%% on top of the run's other stroke bytes\n",
+                   report.bytes / notes.size(), stats.drops, stats.undone, stats.fixBytes,
+                   stats.undone ? (double)stats.fixBytes / stats.undone : 0,
+                   stats.strokeBytes > stats.fixBytes ? 100.0 * stats.fixBytes / (stats.strokeBytes - stats.fixBytes) : 0);
+          }
+
+          if(latencyMode && !printLatency(report, csv)){
+            failed++;
+          }
+
+          if(report.intact != notes.size() || report.counterErrors || report.stateErrors){
+            failed++;
+            fflush(stdout);
+            for(const std::string& e : report.errors){
+              fprintf(stderr, "  %s\n", e.c_str());
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return failed ? 3 : 0;
+}
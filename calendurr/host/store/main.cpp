@@ -0,0 +1,286 @@
+/*--------------------------------------------------*/
+/*--          POINT STORE BENCHMARK (host)        --*/
+/*--------------------------------------------------*/
+/*  Fills the firmware's PointStore and the old     */
+/*  unsigned int coordz[1000][2] array with the     */
+/*  same traces and prints how many points each     */
+/*  holds in the RAM they take, what append and     */
+/*  reading back cost, and whether every point      */
+/*  came back unchanged. A short note that crosses  */
+/*  zero is also sent in every framing and parsed   */
+/*  back, so signed points are checked end to end.  */
+/*                                                  */
+/*  pio run -e native_store                         */
+/*  .pio/build/native_store/program --resample 0,4  */
+/*                                                  */
+/*  Options (lists are comma separated):            */
+/*    --bytes N          store size (firmware:      */
+/*                       COORD_BYTES)               */
+/*    --resample S,...   ArcResampler step, 0 = off */
+/*    --trace FILE       recorded coordz.txt        */
+/*    --rounds N         timing repetitions         */
+/*    --seed N           generator seed             */
+/*--------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "Args.h"
+#include "PointStore.h"
+#include "Protocol.h"
+#include "Trace.h"
+
+// What coordz took before the store (it had no ticks)
+#define ARRAY_POINTS 1000
+#define ARRAY_BYTES (ARRAY_POINTS * 2 * sizeof(unsigned int))
+
+static unsigned int arrayPoints[ARRAY_POINTS][2];
+
+// Keeps the optimizer from dropping the loops being timed
+static volatile unsigned long sink;
+
+static double elapsedNs(std::chrono::steady_clock::time_point start){
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*--------------------------------------------------*/
+/*--                benchStore()                  --*/
+/*--------------------------------------------------*/
+/*    One row: a timed or untimed store of size     */
+/*    bytes filled from trace until it is full,     */
+/*    read back, cut in half and filled again.      */
+/*--------------------------------------------------*/
+static bool benchStore(const char* name, const Trace& trace, const TraceTicks& ticks,
+                       uint16_t size, bool timed, int rounds){
+  std::vector<uint8_t> buffer(size);
+  PointStore store(buffer.data(), size, timed);
+  storeTrace(trace, timed ? ticks : TraceTicks(), store);
+  uint16_t count = store.count();
+
+  // everything stored comes back, by iterator and by index
+  bool exact = true;
+  uint16_t i = 0;
+  for(const StoredPoint& point : store){
+    if(point.x != trace[i][0] || point.y != trace[i][1] ||
+       point.strokeStart != strokeStartAt(trace, i) || (timed && point.ticks != ticks[i])){
+      exact = false;
+    }
+    i++;
+  }
+  for(uint16_t k = 0; k < count; k += 7){
+    StoredPoint point = store.at(count - 1 - k);
+    if(point.x != trace[count - 1 - k][0] || point.y != trace[count - 1 - k][1]){
+      exact = false;
+    }
+  }
+  exact = exact && i == count;
+
+  // cut back to half (undo) and filled again, it ends up the same
+  uint16_t bytes = store.bytes();
+  store.truncate(count / 2);
+  for(uint16_t p = count / 2; p < count; p++){
+    store.append(trace[p][0], trace[p][1], strokeStartAt(trace, p), timed ? ticks[p] : 0);
+  }
+  exact = exact && store.bytes() == bytes && store.count() == count;
+  for(uint16_t k = 0; k < count; k += 5){
+    StoredPoint point = store.at(k);
+    if(point.x != trace[k][0] || point.y != trace[k][1] || (timed && point.ticks != ticks[k])){
+      exact = false;
+    }
+  }
+
+  double appendNs = 0, iterateNs = 0, atNs = 0;
+  double arrayAppendNs = 0, arrayIterateNs = 0;
+  uint16_t arrayCount = count < ARRAY_POINTS ? count : ARRAY_POINTS;
+
+  for(int r = 0; r < rounds; r++){
+    auto start = std::chrono::steady_clock::now();
+    store.clear();
+    for(uint16_t p = 0; p < count; p++){
+      store.append(trace[p][0], trace[p][1], strokeStartAt(trace, p), timed ? ticks[p] : 0);
+    }
+    appendNs += elapsedNs(start);
+
+    start = std::chrono::steady_clock::now();
+    unsigned long sum = 0;
+    for(const StoredPoint& point : store){
+      sum += point.x + point.y + point.ticks;
+    }
+    iterateNs += elapsedNs(start);
+
+    start = std::chrono::steady_clock::now();
+    for(uint16_t p = 0; p < count; p++){
+      sum += store.at(p).x;
+    }
+    atNs += elapsedNs(start);
+
+    start = std::chrono::steady_clock::now();
+    for(uint16_t p = 0; p < arrayCount; p++){
+      arrayPoints[p][0] = trace[p][0];
+      arrayPoints[p][1] = trace[p][1];
+    }
+    arrayAppendNs += elapsedNs(start);
+
+    start = std::chrono::steady_clock::now();
+    for(uint16_t p = 0; p < arrayCount; p++){
+      sum += arrayPoints[p][0] + arrayPoints[p][1];
+    }
+    arrayIterateNs += elapsedNs(start);
+    sink = sum;
+  }
+
+  double perStore = (double)rounds * count;
+  double perArray = (double)rounds * arrayCount;
+  printf("%-14s %5s %6u %6u %6.2f %5.1fx %8.2f %8.2f %8.2f %8.2f %8.2f %s\n",
+         name, timed ? "yes" : "no", size, count, count ? (double)store.bytes() / count : 0,
+         (double)count / ARRAY_POINTS * ARRAY_BYTES / size,
+         appendNs / perStore, iterateNs / perStore, atNs / perStore,
+         arrayAppendNs / perArray, arrayIterateNs / perArray, exact ? "ok" : "MISMATCH");
+  return exact;
+}
+
+/*------------------------------------------*/
+/*  CaptureLink - keeps every notify for    */
+/*  checkSigned(); size is its ATT payload  */
+/*------------------------------------------*/
+class CaptureLink : public NoteLink {
+  public:
+    explicit CaptureLink(uint16_t size) : size(size) {}
+
+    uint16_t payloadSize() override { return size; }
+    bool notify(const uint8_t* data, uint16_t len) override {
+      packets.push_back(std::vector<uint8_t>(data, data + len));
+      return true;
+    }
+    void pause(uint32_t) override {}
+    uint32_t now() override { return 0; }
+    bool connected() override { return true; }
+
+    uint16_t size;
+    std::vector<std::vector<uint8_t>> packets;
+};
+
+/*--------------------------------------------------*/
+/*--                checkSigned()                 --*/
+/*--------------------------------------------------*/
+/*    Points past the calibrated edge are negative: */
+/*    every record kind has to keep the sign, and   */
+/*    every framing has to give the same numbers    */
+/*    back, in the 20 bytes of a default MTU too.   */
+/*    There a text frame may cut the ticks of the   */
+/*    longest gap to what fits, but no further.     */
+/*--------------------------------------------------*/
+static bool checkSigned(){
+  static const int16_t note[][2] = {
+    {-300, -5}, {-298, -3}, {-180, 40}, {3, -2}, {-4, 6},      // absolute, short, long, across 0
+    {-32768, 32767}, {4000, -1}, {-1, 0}                       // int16 limits, long jumps
+  };
+  const uint16_t count = sizeof(note) / sizeof(note[0]);
+  uint32_t ticks[count];
+  for(uint16_t i = 0; i < count; i++){
+    ticks[i] = i == 5 ? POINT_TICKS_MAX : i * 3;   // the widest text point gets the longest gap
+  }
+
+  uint8_t buffer[128];
+  PointStore store(buffer, sizeof(buffer), true);
+  bool exact = true;
+  for(uint16_t i = 0; i < count; i++){
+    store.append(note[i][0], note[i][1], i == 0 || i == 5, ticks[i]);
+  }
+  for(uint16_t i = 0; i < count; i++){
+    StoredPoint point = store.at(i);
+    if(point.x != note[i][0] || point.y != note[i][1] || point.ticks != ticks[i]){
+      exact = false;
+    }
+  }
+
+  static const uint8_t framings[] = {FRAMING_TEXT, FRAMING_TEXT_PACKED, FRAMING_BINARY};
+  static const uint16_t sizes[] = {NOTE_MAX_PAYLOAD, 20};
+  for(uint8_t framing : framings){
+    for(uint16_t size : sizes){
+      CaptureLink link(size);
+      NoteSender sender(link, framing);
+      sender.sendPoints(store);
+
+      uint16_t at = 0;
+      for(const std::vector<uint8_t>& packet : link.packets){
+        int points[NOTE_MAX_PAYLOAD / 4][2];
+        uint32_t got[NOTE_MAX_PAYLOAD / 4];
+        int n = parsePoints(packet.data(), packet.size(), points, NOTE_MAX_PAYLOAD / 4, got);
+        for(int i = 0; i < n; i++, at++){
+          bool cut = framing != FRAMING_BINARY && packet.size() == size && got[i] < ticks[at];
+          if(at >= count || points[i][0] != note[at][0] || points[i][1] != note[at][1] ||
+             (got[i] != ticks[at] && !cut) || packet.size() > size){
+            exact = false;
+          }
+        }
+      }
+      exact = exact && at == count;
+    }
+  }
+
+  printf("signed points: store and text/packed/binary framings (20 and %d byte notifies) %s\n", NOTE_MAX_PAYLOAD,
+         exact ? "ok" : "MISMATCH");
+  return exact;
+}
+
+int main(int argc, char** argv){
+  uint16_t size = 8192;
+  std::vector<int> steps = {0, 4};
+  const char* tracePath = NULL;
+  int rounds = 200;
+  uint32_t seed = 1;
+
+  bool parsed = parseArgs(argc, argv, &seed, &tracePath, [&](const char* arg, const char* value) {
+    if(!strcmp(arg, "--bytes")){ size = atoi(value); return 2; }
+    if(!strcmp(arg, "--resample")){ steps = parseList(value); return 2; }
+    if(!strcmp(arg, "--rounds")){ rounds = atoi(value); return 2; }
+    return 0;
+  });
+  if(!parsed){
+    return 1;
+  }
+
+  Trace source;
+  if(tracePath && !loadTrace(tracePath, source)){
+    fprintf(stderr, "could not read trace %s\n", tracePath);
+    return 1;
+  }
+
+  // more than any store can hold, so every row fills up
+  Trace trace;
+  if(source.empty()){
+    trace = syntheticTrace(seed, 2 * size);
+  }
+  else{
+    while(trace.size() < 2u * size){
+      trace.insert(trace.end(), source.begin(), source.end());
+    }
+  }
+  TraceTicks ticks = traceTicks(trace, seed);
+
+  int failed = !checkSigned();
+  printf("array: %d points in %d bytes (coordz)\n", ARRAY_POINTS, (int)ARRAY_BYTES);
+  printf("%-14s %5s %6s %6s %6s %6s %8s %8s %8s %8s %8s %s\n",
+         "trace", "timed", "bytes", "points", "B/pt", "vs_arr",
+         "app_ns", "iter_ns", "at_ns", "arr_app", "arr_iter", "check");
+
+  for(int step : steps){
+    Trace spaced = trace;
+    TraceTicks spacedTicks = ticks;
+    if(step > 0){
+      resampleTrace(trace, ticks, step, spaced, spacedTicks);
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), step > 0 ? "%s/step%d" : "%s", source.empty() ? "synthetic" : "recorded", step);
+    failed += !benchStore(name, spaced, spacedTicks, size, true, rounds);
+    failed += !benchStore(name, spaced, spacedTicks, size, false, rounds);
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+/*--------------------------------------------------*/
+/*--          DEVICE TRAITS CHECK (host)          --*/
+/*--------------------------------------------------*/
+/*  Builds calendurrShared/DeviceTraits for both    */
+/*  firmware variants in the firmware's C++         */
+/*  dialect (gnu++11), checks at compile time that  */
+/*  what they share really is shared and that their */
+/*  dials behave as each variant says, then walks   */
+/*  every day of the year through turnDay(),        */
+/*  turnMonth() and fitDay() against a plain        */
+/*  reference and prints what each variant         */
+/*  resolves to.                                    */
+/*                                                  */
+/*  pio run -e native_traits                        */
+/*  .pio/build/native_traits/program                */
+/*--------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <type_traits>
+
+#include "DeviceTraits.h"
+
+typedef DeviceTraits<VARIANT_CALENDAR> Calendar;
+typedef DeviceTraits<VARIANT_BLE_TEST> BleTest;
+
+// Same board and sensor, same GATT layout
+static_assert(Calendar::Pins::sense == BleTest::Pins::sense &&
+              Calendar::Pins::sendButton == BleTest::Pins::sendButton, "one board");
+static_assert(Calendar::Pad::xMax == BleTest::Pad::xMax && Calendar::Pad::yMin == BleTest::Pad::yMin, "one pad");
+static_assert(std::is_base_of<Calendar::Ble, BleTest::Ble>::value, "one service");
+
+// What differs, decided here and nowhere else
+static_assert(Calendar::Ble::txPower == 8 && BleTest::Ble::txPower == 4, "tx power");
+static_assert(Calendar::Dates::turnDay(31, 1, 1) == 1 && Calendar::Dates::turnDay(1, 3, -1) == 31, "calendar wraps");
+static_assert(BleTest::Dates::turnDay(31, 1, 1) == 31 && BleTest::Dates::turnDay(1, 3, -1) == 1, "test sketch stops");
+
+// Evaluated by the compiler, so free at run time
+static_assert(Calendar::Dates::turnMonth(12, 1) == 1 && Calendar::Dates::fitDay(31, 4) == 30, "month dial");
+static_assert(Calendar::Battery::millivolts(16383) == 4799, "VBAT scale");
+
+static const int referenceDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+template<class Traits>
+static int checkDates(bool wraps){
+  typedef typename Traits::Dates Dates;
+  int failed = 0;
+  int total = 0;
+
+  for(int month = 1; month <= 12; month++){
+    int last = referenceDays[month - 1];
+    total += Dates::lastDay(month);
+    failed += Dates::lastDay(month) != last;
+
+    for(int day = 1; day <= last; day++){
+      int up = day == last ? (wraps ? 1 : last) : day + 1;
+      int down = day == 1 ? (wraps ? last : 1) : day - 1;
+      failed += Dates::turnDay(day, month, 1) != up;
+      failed += Dates::turnDay(day, month, -1) != down;
+
+      for(int next = 1; next <= 12; next++){
+        int fitted = day > referenceDays[next - 1] ? referenceDays[next - 1] : day;
+        failed += Dates::fitDay(day, next) != fitted;
+      }
+    }
+
+    failed += Dates::turnMonth(month, 1) != (month == 12 ? 1 : month + 1);
+    failed += Dates::turnMonth(month, -1) != (month == 1 ? 12 : month - 1);
+    failed += strlen(Dates::monthNames[month - 1]) > 9;   // whatsTheDate() pads to 9
+  }
+
+  failed += total != 365;
+  return failed;
+}
+
+template<class Traits>
+static int report(const char* name, bool wraps){
+  int failed = checkDates<Traits>(wraps);
+  printf("%-10s sense %2u  vbat %2u/AIN%u  oled 0x%02X  tx %+d dBm  adv %u/%u  day dial %-5s  %s\n",
+         name, Traits::Pins::sense, Traits::Pins::vbat, Traits::Pins::vbatAin, Traits::Pins::oledAddress,
+         Traits::Ble::txPower, Traits::Ble::advFastInterval, Traits::Ble::advSlowInterval,
+         Traits::Dates::wraps ? "wraps" : "stops", failed ? "MISMATCH" : "ok");
+  return failed;
+}
+
+int main(){
+  int failed = 0;
+  failed += report<Calendar>("calendar", true);
+  failed += report<BleTest>("ble_test", false);
+  printf("Device = %s\n", DEVICE_VARIANT == VARIANT_CALENDAR ? "calendar" : "ble_test");
+  return failed ? 1 : 0;
+}
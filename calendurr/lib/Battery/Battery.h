@@ -0,0 +1,84 @@
+#ifndef CALENDURR_BATTERY_H
+#define CALENDURR_BATTERY_H
+
+#include <stdint.h>
+
+/*--------------------------------------------------*/
+/*--              BATTERY GAUGE                   --*/
+/*--------------------------------------------------*/
+/*  VBAT (A6, halved by the Feather's divider) is   */
+/*  read without blocking and turned into a charge  */
+/*  percent in integer math:                        */
+/*                                                  */
+/*    batteryAdc.start()       end of a loop() pass */
+/*    batteryAdc.collect(&mv)  before the next      */
+/*                             SENSE reads          */
+/*    gauge.addSample(mv)                           */
+/*    if(gauge.changed()) show gauge.percent()      */
+/*                                                  */
+/*  The SAADC is only ever busy with VBAT between   */
+/*  readSensor() calls, so it never meets the touch */
+/*  conversions.                                    */
+/*--------------------------------------------------*/
+
+#ifndef BATTERY_PERIOD_MS
+#define BATTERY_PERIOD_MS 5000  // between VBAT samples
+#endif
+
+#define BATTERY_SMOOTH_SHIFT 3  // exponential average over ~8 samples
+#define BATTERY_HYSTERESIS 1    // percent the reading must move past before it is shown
+
+// Resting LiPo voltage (mV) to percent, piecewise linear in between
+uint8_t lipoPercent(uint16_t mv);
+
+/*------------------------------------------*/
+/*  BatteryGauge - smooths the samples and  */
+/*  decides when the shown percent changes. */
+/*  filtered - mV << BATTERY_SMOOTH_SHIFT   */
+/*  shown - last percent handed out         */
+/*------------------------------------------*/
+class BatteryGauge {
+  public:
+    BatteryGauge() : filtered(0), shown(0), seeded(false), dirty(false) {}
+
+    void addSample(uint16_t mv);
+
+    // A new percent to show / send since the last call
+    bool changed();
+
+    uint8_t percent() const { return shown; }
+    uint16_t millivolts() const { return filtered >> BATTERY_SMOOTH_SHIFT; }
+
+  private:
+    uint32_t filtered;
+    uint8_t shown;
+    bool seeded;
+    bool dirty;
+};
+
+/*------------------------------------------*/
+/*  BatteryAdc - one VBAT conversion on the */
+/*  nRF52 SAADC, split so the acquisition   */
+/*  runs while loop() does other work.      */
+/*  Leaves the SAADC the way analogRead()   */
+/*  expects it (stopped, disabled).         */
+/*------------------------------------------*/
+class BatteryAdc {
+  public:
+    BatteryAdc() : pending(false), result(0) {}
+
+    // Starts a conversion; false if one is already pending
+    bool start();
+
+    // Waits for the pending conversion (it is usually done) and hands
+    // back VBAT in mV; false if none was started
+    bool collect(uint16_t* mv);
+
+    bool busy() const { return pending; }
+
+  private:
+    bool pending;
+    volatile int16_t result;  // EasyDMA target
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include "Battery.h"
+
+/*------------------------------------------*/
+/*  Typical single cell LiPo at rest; the   */
+/*  flat middle is where a linear map of    */
+/*  voltage was furthest off.               */
+/*------------------------------------------*/
+struct CurvePoint {
+  uint16_t mv;
+  uint8_t percent;
+};
+
+static constexpr CurvePoint lipoCurve[] = {
+  {3270, 0}, {3610, 5}, {3690, 10}, {3710, 15}, {3730, 20}, {3750, 25},
+  {3770, 30}, {3790, 35}, {3800, 40}, {3820, 45}, {3840, 50}, {3850, 55},
+  {3870, 60}, {3910, 65}, {3950, 70}, {3980, 75}, {4020, 80}, {4080, 85},
+  {4110, 90}, {4150, 95}, {4200, 100}
+};
+
+static constexpr uint8_t lipoPoints = sizeof(lipoCurve) / sizeof(lipoCurve[0]);
+
+uint8_t lipoPercent(uint16_t mv){
+  if(mv <= lipoCurve[0].mv){
+    return 0;
+  }
+  if(mv >= lipoCurve[lipoPoints - 1].mv){
+    return 100;
+  }
+
+  uint8_t i = 1;
+  while(mv > lipoCurve[i].mv){
+    i++;
+  }
+
+  const CurvePoint& lo = lipoCurve[i - 1];
+  const CurvePoint& hi = lipoCurve[i];
+  return lo.percent + (uint32_t)(mv - lo.mv) * (hi.percent - lo.percent) / (hi.mv - lo.mv);
+}
+
+/*--------------------------------------------------*/
+/*--                 addSample()                  --*/
+/*--------------------------------------------------*/
+/*    The first sample is taken as is; after that   */
+/*    each one moves the average 1/8 of the way.    */
+/*    The shown percent only follows once the       */
+/*    average has moved more than                   */
+/*    BATTERY_HYSTERESIS away from it.              */
+/*--------------------------------------------------*/
+void BatteryGauge::addSample(uint16_t mv){
+  if(!seeded){
+    seeded = true;
+    filtered = (uint32_t)mv << BATTERY_SMOOTH_SHIFT;
+    shown = lipoPercent(mv);
+    dirty = true;
+    return;
+  }
+
+  filtered = filtered - (filtered >> BATTERY_SMOOTH_SHIFT) + mv;
+
+  uint8_t now = lipoPercent(millivolts());
+  int diff = (int)now - (int)shown;
+  if(diff > BATTERY_HYSTERESIS || diff < -BATTERY_HYSTERESIS){
+    shown = now;
+    dirty = true;
+  }
+}
+
+bool BatteryGauge::changed(){
+  bool was = dirty;
+  dirty = false;
+  return was;
+}
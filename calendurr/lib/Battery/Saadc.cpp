@@ -0,0 +1,81 @@
+#include "Battery.h"
+
+#if defined(ARDUINO_ARCH_NRF52)
+
+#include <Arduino.h>
+
+#include "DeviceTraits.h"
+
+// PSELP counts analog inputs from 1 (0 is not connected)
+#define VBAT_AIN (SAADC_CH_PSELP_PSELP_AnalogInput0 + Device::Pins::vbatAin)
+
+// 14 bit, gain 1/4 of the 0.6 V reference (2.4 V full scale, the same as
+// analogReference(AR_INTERNAL_2_4)); the divider halves VBAT
+static_assert(Device::Battery::bits == 14 && Device::Battery::referenceMv == 2400,
+              "start() configures 14 bit against 0.6 V / 4");
+
+/*--------------------------------------------------*/
+/*--                   start()                    --*/
+/*--------------------------------------------------*/
+/*    Configures channel 0 for VBAT and triggers    */
+/*    the sample. The 40 us acquisition (the        */
+/*    divider is high impedance) and the conversion */
+/*    run on their own; collect() picks them up.    */
+/*--------------------------------------------------*/
+bool BatteryAdc::start(){
+  if(pending){
+    return false;
+  }
+
+  NRF_SAADC->RESOLUTION = SAADC_RESOLUTION_VAL_14bit;
+  NRF_SAADC->OVERSAMPLE = SAADC_OVERSAMPLE_OVERSAMPLE_Bypass;
+  NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Enabled << SAADC_ENABLE_ENABLE_Pos;
+
+  NRF_SAADC->CH[0].CONFIG = (SAADC_CH_CONFIG_RESP_Bypass << SAADC_CH_CONFIG_RESP_Pos) |
+                            (SAADC_CH_CONFIG_RESN_Bypass << SAADC_CH_CONFIG_RESN_Pos) |
+                            (SAADC_CH_CONFIG_GAIN_Gain1_4 << SAADC_CH_CONFIG_GAIN_Pos) |
+                            (SAADC_CH_CONFIG_REFSEL_Internal << SAADC_CH_CONFIG_REFSEL_Pos) |
+                            (SAADC_CH_CONFIG_TACQ_40us << SAADC_CH_CONFIG_TACQ_Pos) |
+                            (SAADC_CH_CONFIG_MODE_SE << SAADC_CH_CONFIG_MODE_Pos) |
+                            (SAADC_CH_CONFIG_BURST_Disabled << SAADC_CH_CONFIG_BURST_Pos);
+  NRF_SAADC->CH[0].PSELN = SAADC_CH_PSELN_PSELN_NC;
+  NRF_SAADC->CH[0].PSELP = VBAT_AIN;
+
+  NRF_SAADC->RESULT.PTR = (uint32_t)&result;
+  NRF_SAADC->RESULT.MAXCNT = 1;
+
+  NRF_SAADC->EVENTS_STARTED = 0;
+  NRF_SAADC->EVENTS_END = 0;
+  NRF_SAADC->EVENTS_STOPPED = 0;
+
+  NRF_SAADC->TASKS_START = 1;
+  while(!NRF_SAADC->EVENTS_STARTED);   // buffer armed, a few cycles
+  NRF_SAADC->EVENTS_STARTED = 0;
+  NRF_SAADC->TASKS_SAMPLE = 1;
+
+  pending = true;
+  return true;
+}
+
+bool BatteryAdc::collect(uint16_t* mv){
+  if(!pending){
+    return false;
+  }
+
+  while(!NRF_SAADC->EVENTS_END);
+  NRF_SAADC->EVENTS_END = 0;
+
+  NRF_SAADC->TASKS_STOP = 1;
+  while(!NRF_SAADC->EVENTS_STOPPED);
+  NRF_SAADC->EVENTS_STOPPED = 0;
+
+  NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Disabled << SAADC_ENABLE_ENABLE_Pos;
+  NRF_SAADC->CH[0].PSELP = SAADC_CH_PSELP_PSELP_NC;
+  pending = false;
+
+  int32_t raw = result < 0 ? 0 : result;   // single ended can read slightly below 0
+  *mv = Device::Battery::millivolts(raw);
+  return true;
+}
+
+#endif
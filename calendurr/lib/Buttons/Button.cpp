@@ -0,0 +1,76 @@
+#include "Button.h"
+
+Button::Button(uint16_t longMs, uint16_t doubleMs)
+  : longMs(longMs), doubleMs(doubleMs), rawPressed(false), edgeMs(0), down(false), longSent(false),
+    clicked(false), doubled(false), pressMs(0), releaseMs(0), eventHead(0), eventTail(0) {}
+
+void Button::begin(bool pressed, uint32_t ms){
+  rawPressed = pressed;
+  edgeMs = ms;
+  down = pressed;
+  longSent = pressed;      // held through reset: no long press for it
+  clicked = false;
+  doubled = false;
+  pressMs = releaseMs = ms;
+  eventHead = eventTail = 0;
+}
+
+void Button::edge(bool pressed, uint32_t ms){
+  rawPressed = pressed;
+  edgeMs = ms;
+}
+
+void Button::emit(ButtonEvent event){
+  uint8_t following = (eventHead + 1) % BUTTON_EVENTS;
+  if(following != eventTail){
+    events[eventHead] = event;
+    eventHead = following;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                   poll()                     --*/
+/*--------------------------------------------------*/
+/*    Takes the level the interrupt left once it    */
+/*    has settled, steps the state machine and      */
+/*    hands out one event per call.                 */
+/*--------------------------------------------------*/
+ButtonEvent Button::poll(uint32_t ms){
+  // the handler may run in between: take both together
+  bool pressed;
+  uint32_t changedMs;
+  do{
+    changedMs = edgeMs;
+    pressed = rawPressed;
+  } while(changedMs != edgeMs);
+
+  if(pressed != down && ms - changedMs >= BUTTON_DEBOUNCE_MS){
+    down = pressed;
+    if(down){
+      bool second = clicked && ms - releaseMs <= doubleMs;
+      emit(second ? BUTTON_DOUBLE_PRESS : BUTTON_PRESS);
+      clicked = false;
+      doubled = second;
+      longSent = false;
+      pressMs = ms;
+    }
+    else{
+      emit(BUTTON_RELEASE);
+      // the release that ends a long or double press does not start a new click
+      clicked = !longSent && !doubled;
+      releaseMs = ms;
+    }
+  }
+
+  if(down && !longSent && ms - pressMs >= longMs){
+    longSent = true;
+    emit(BUTTON_LONG_PRESS);
+  }
+
+  if(eventTail == eventHead){
+    return BUTTON_NONE;
+  }
+  ButtonEvent event = events[eventTail];
+  eventTail = (eventTail + 1) % BUTTON_EVENTS;
+  return event;
+}
@@ -0,0 +1,79 @@
+#ifndef CALENDURR_BUTTON_H
+#define CALENDURR_BUTTON_H
+
+#include <stdint.h>
+
+/*--------------------------------------------------*/
+/*--          BUTTONS (interrupt driven)          --*/
+/*--------------------------------------------------*/
+/*  SEND_BUTTON and BLE_BUTTON interrupt on every   */
+/*  edge (attachInterrupt(..., CHANGE), a GPIOTE    */
+/*  channel on the nRF52); the handler only notes   */
+/*  the level and when it changed:                  */
+/*                                                  */
+/*    ISR    button.edge(pressed, millis())         */
+/*    loop() while((e = button.poll(millis())))     */
+/*             handle e                             */
+/*                                                  */
+/*  A level counts once it has not changed for      */
+/*  BUTTON_DEBOUNCE_MS, so contact bounce never     */
+/*  reaches the state machine and nothing waits:    */
+/*                                                  */
+/*    up --press--> down --release--> up            */
+/*         BUTTON_PRESS        BUTTON_RELEASE       */
+/*    down for longMs: BUTTON_LONG_PRESS (once)     */
+/*    a press within doubleMs of the last release   */
+/*    is BUTTON_DOUBLE_PRESS instead of a press     */
+/*--------------------------------------------------*/
+
+#define BUTTON_DEBOUNCE_MS 20
+#define BUTTON_LONG_MS 2000
+#define BUTTON_DOUBLE_MS 300
+#define BUTTON_EVENTS 4         // events poll() has not handed out yet
+
+enum ButtonEvent {
+  BUTTON_NONE,
+  BUTTON_PRESS,
+  BUTTON_RELEASE,
+  BUTTON_LONG_PRESS,
+  BUTTON_DOUBLE_PRESS
+};
+
+class Button {
+  public:
+    Button(uint16_t longMs = BUTTON_LONG_MS, uint16_t doubleMs = BUTTON_DOUBLE_MS);
+
+    // The level at startup, before any edge
+    void begin(bool pressed, uint32_t ms);
+
+    // Interrupt handler: the pin changed, pressed is its level now
+    void edge(bool pressed, uint32_t ms);
+
+    // The next event, BUTTON_NONE once there is none; call from the loop
+    ButtonEvent poll(uint32_t ms);
+
+    // Debounced level
+    bool held() const { return down; }
+
+  private:
+    void emit(ButtonEvent event);
+
+    uint16_t longMs;
+    uint16_t doubleMs;
+
+    volatile bool rawPressed;
+    volatile uint32_t edgeMs;
+
+    bool down;
+    bool longSent;
+    bool clicked;            // released once, a second press is a double
+    bool doubled;            // this press was the second
+    uint32_t pressMs;
+    uint32_t releaseMs;
+
+    ButtonEvent events[BUTTON_EVENTS];
+    uint8_t eventHead;
+    uint8_t eventTail;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "InkMirror.h"
+
+#include <string.h>
+
+InkMirror::InkMirror(uint8_t* frame, uint8_t width, uint8_t height)
+  : frame(frame), width(width), height(height), lastX(0), lastY(0), started(false), erasing(false), touched(0) {
+  setPadWindow(INK_PAD_X_MIN, INK_PAD_Y_MIN, INK_PAD_X_MAX, INK_PAD_Y_MAX);
+}
+
+/*--------------------------------------------------*/
+/*--               setPadWindow()                 --*/
+/*--------------------------------------------------*/
+/*    One scale for both axes, the smaller of the   */
+/*    two that would fit, and the leftover space    */
+/*    split evenly on either side.                  */
+/*--------------------------------------------------*/
+void InkMirror::setPadWindow(int xMin, int yMin, int xMax, int yMax){
+  padX = xMin;
+  padY = yMin;
+  padXMax = xMax > xMin ? xMax : xMin + 1;
+  padYMax = yMax > yMin ? yMax : yMin + 1;
+
+  uint32_t scaleX = ((uint32_t)(width - 1) << INK_SCALE_SHIFT) / (uint32_t)(padXMax - padX);
+  uint32_t scaleY = ((uint32_t)(height - 1) << INK_SCALE_SHIFT) / (uint32_t)(padYMax - padY);
+  scale = scaleX < scaleY ? scaleX : scaleY;
+
+  offsetX = ((width - 1) - (int)(((uint32_t)(padXMax - padX) * scale) >> INK_SCALE_SHIFT)) / 2;
+  offsetY = ((height - 1) - (int)(((uint32_t)(padYMax - padY) * scale) >> INK_SCALE_SHIFT)) / 2;
+}
+
+void InkMirror::toScreen(int x, int y, int* px, int* py) const {
+  x = x < padX ? padX : (x > padXMax ? padXMax : x);
+  y = y < padY ? padY : (y > padYMax ? padYMax : y);
+  *px = offsetX + (int)(((uint32_t)(x - padX) * scale) >> INK_SCALE_SHIFT);
+  *py = offsetY + (int)(((uint32_t)(y - padY) * scale) >> INK_SCALE_SHIFT);
+}
+
+void InkMirror::addPoint(int x, int y, bool strokeStart){
+  if(!frame){
+    return;
+  }
+
+  int px, py;
+  toScreen(x, y, &px, &py);
+
+  if(strokeStart || !started){
+    plot(px, py);
+  }
+  else if(px != lastX || py != lastY){
+    line(lastX, lastY, px, py);
+  }
+
+  lastX = px;
+  lastY = py;
+  started = true;
+}
+
+/*--------------------------------------------------*/
+/*--                   line()                     --*/
+/*--------------------------------------------------*/
+/*    Bresenham, all steps in integers. The start   */
+/*    pixel was drawn with the point before.        */
+/*--------------------------------------------------*/
+void InkMirror::line(int x0, int y0, int x1, int y1){
+  int dx = x1 > x0 ? x1 - x0 : x0 - x1;
+  int dy = y1 > y0 ? y0 - y1 : y1 - y0;   // negative
+  int sx = x0 < x1 ? 1 : -1;
+  int sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+
+  while(x0 != x1 || y0 != y1){
+    int e2 = 2 * err;
+    if(e2 >= dy){
+      err += dy;
+      x0 += sx;
+    }
+    if(e2 <= dx){
+      err += dx;
+      y0 += sy;
+    }
+    plot(x0, y0);
+  }
+}
+
+void InkMirror::plot(int px, int py){
+  uint8_t page = py >> 3;
+  if(erasing){
+    frame[px + page * width] &= ~(1 << (py & 7));
+  }
+  else{
+    frame[px + page * width] |= 1 << (py & 7);
+  }
+
+  uint8_t bit = 1 << page;
+  if(!(touched & bit)){
+    touched |= bit;
+    firstColumn[page] = px;
+    lastColumn[page] = px;
+  }
+  else if(px < firstColumn[page]){
+    firstColumn[page] = px;
+  }
+  else if(px > lastColumn[page]){
+    lastColumn[page] = px;
+  }
+}
+
+void InkMirror::clear(){
+  if(frame){
+    memset(frame, 0, (uint16_t)width * ((height + 7) / 8));
+  }
+  started = false;
+  touched = 0;
+}
+
+uint8_t InkMirror::flush(InkFlush send, void* context){
+  uint8_t pages = 0;
+  for(uint8_t page = 0; touched; page++){
+    uint8_t bit = 1 << page;
+    if(touched & bit){
+      touched &= ~bit;
+      send(page, firstColumn[page], lastColumn[page], frame + page * width + firstColumn[page], context);
+      pages++;
+    }
+  }
+  return pages;
+}
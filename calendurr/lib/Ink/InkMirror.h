@@ -0,0 +1,97 @@
+#ifndef CALENDURR_INK_MIRROR_H
+#define CALENDURR_INK_MIRROR_H
+
+#include <stdint.h>
+
+/*--------------------------------------------------*/
+/*--            INK MIRROR (OLED preview)         --*/
+/*--------------------------------------------------*/
+/*  Draws the strokes being written onto the OLED   */
+/*  as they are stored, so there is something to    */
+/*  look at besides the date. Each new point is     */
+/*  joined to the one before with an integer        */
+/*  (Bresenham) line straight into the SSD1306      */
+/*  framebuffer, and only the columns of the pages  */
+/*  a line touched are sent to the panel:           */
+/*                                                  */
+/*    ink.addPoint(x, y, strokeStart);              */
+/*    ink.flush(sendPage, context);                 */
+/*                                                  */
+/*  The framebuffer is in the SSD1306 layout: page  */
+/*  p (rows 8p..8p+7) of column x is byte           */
+/*  x + p * width, the top row in bit 0. The pad    */
+/*  window is scaled by the same factor on both     */
+/*  axes and centered, so the ink keeps its shape.  */
+/*  Nothing is drawn until there is a frame.        */
+/*--------------------------------------------------*/
+
+#ifndef INK_MIRROR
+#define INK_MIRROR 0
+#endif
+
+// Pad area shown on the OLED (pad units)
+#ifndef INK_PAD_X_MIN
+#define INK_PAD_X_MIN 0
+#endif
+#ifndef INK_PAD_X_MAX
+#define INK_PAD_X_MAX 4400
+#endif
+#ifndef INK_PAD_Y_MIN
+#define INK_PAD_Y_MIN 0
+#endif
+#ifndef INK_PAD_Y_MAX
+#define INK_PAD_Y_MAX 5000
+#endif
+
+#define INK_MAX_PAGES 8   // 64 rows
+#define INK_SCALE_SHIFT 16
+
+// Receives one touched run of a page: columns first..last, bytes[0] is
+// column first
+typedef void (*InkFlush)(uint8_t page, uint8_t first, uint8_t last, const uint8_t* bytes, void* context);
+
+class InkMirror {
+  public:
+    InkMirror(uint8_t* frame, uint8_t width, uint8_t height);
+
+    // For a display that only has its buffer after begin()
+    void setFrame(uint8_t* buffer){ frame = buffer; }
+
+    // Pad area that fills the screen; the default is INK_PAD_*
+    void setPadWindow(int xMin, int yMin, int xMax, int yMax);
+
+    // Draws the segment from the previous point (a dot for a stroke start)
+    void addPoint(int x, int y, bool strokeStart);
+
+    // While on, addPoint() clears the pixels it would light (undo)
+    void setErase(bool on){ erasing = on; }
+
+    // Blanks the framebuffer; the caller sends the whole frame once
+    void clear();
+
+    // Hands every touched run to send; returns how many pages went out
+    uint8_t flush(InkFlush send, void* context);
+
+    bool dirty() const { return touched != 0; }
+
+  private:
+    void toScreen(int x, int y, int* px, int* py) const;
+    void line(int x0, int y0, int x1, int y1);
+    void plot(int px, int py);
+
+    uint8_t* frame;
+    uint8_t width;
+    uint8_t height;
+    int padX, padY;
+    int padXMax, padYMax;
+    uint32_t scale;          // pixels per pad unit << INK_SCALE_SHIFT
+    int offsetX, offsetY;
+    int lastX, lastY;        // previous point, screen pixels
+    bool started;
+    bool erasing;
+    uint8_t touched;         // one bit per page
+    uint8_t firstColumn[INK_MAX_PAGES];
+    uint8_t lastColumn[INK_MAX_PAGES];
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "OledDma.h"
+
+#if defined(ARDUINO_ARCH_NRF52)
+
+#include <Arduino.h>
+#include <string.h>
+
+#define OLED_PAGEADDR 0x22
+#define OLED_COLUMNADDR 0x21
+#define OLED_TWIM_IRQ SPIM1_SPIS1_TWIM1_TWIS1_SPI1_TWI1_IRQn
+
+static OledDma* twimOwner = NULL;
+
+extern "C" void SPIM1_SPIS1_TWIM1_TWIS1_SPI1_TWI1_IRQHandler(void){
+  if(twimOwner){
+    twimOwner->irq();
+  }
+}
+
+OledDma::OledDma(uint8_t address)
+  : address(address), runs(0), next(0), sending(false), done(NULL), context(NULL) {
+  runStart[0] = 0;
+}
+
+/*--------------------------------------------------*/
+/*--                   begin()                    --*/
+/*--------------------------------------------------*/
+/*    The pins keep the open-drain, pulled-up setup */
+/*    Wire gave them; only the TWIM changes.        */
+/*--------------------------------------------------*/
+void OledDma::begin(){
+  twimOwner = this;
+
+  NRF_TWIM1->ENABLE = TWIM_ENABLE_ENABLE_Disabled << TWIM_ENABLE_ENABLE_Pos;
+  NRF_TWIM1->PSEL.SCL = g_ADigitalPinMap[PIN_WIRE_SCL];
+  NRF_TWIM1->PSEL.SDA = g_ADigitalPinMap[PIN_WIRE_SDA];
+  NRF_TWIM1->FREQUENCY = TWIM_FREQUENCY_FREQUENCY_K400;
+  NRF_TWIM1->ADDRESS = address;
+  NRF_TWIM1->SHORTS = TWIM_SHORTS_LASTTX_STOP_Msk;
+  NRF_TWIM1->INTENSET = TWIM_INTENSET_STOPPED_Msk | TWIM_INTENSET_ERROR_Msk;
+  NRF_TWIM1->ENABLE = TWIM_ENABLE_ENABLE_Enabled << TWIM_ENABLE_ENABLE_Pos;
+
+  NVIC_ClearPendingIRQ(OLED_TWIM_IRQ);
+  NVIC_SetPriority(OLED_TWIM_IRQ, 3);
+  NVIC_EnableIRQ(OLED_TWIM_IRQ);
+}
+
+bool OledDma::queue(uint8_t pageFirst, uint8_t pageLast, uint8_t first, uint8_t last, const uint8_t* bytes){
+  if(sending || runs == OLED_DMA_RUNS){
+    return false;
+  }
+
+  uint16_t count = (pageLast - pageFirst + 1) * (last - first + 1);
+  uint16_t used = runStart[runs];
+  if(used + OLED_DMA_PREFIX + count > OLED_DMA_BYTES){
+    return false;
+  }
+
+  const uint8_t prefix[OLED_DMA_PREFIX] = {
+    0x80, OLED_PAGEADDR, 0x80, pageFirst, 0x80, pageLast,
+    0x80, OLED_COLUMNADDR, 0x80, first, 0x80, last,
+    0x40   // data follows
+  };
+  memcpy(buffer + used, prefix, OLED_DMA_PREFIX);
+  memcpy(buffer + used + OLED_DMA_PREFIX, bytes, count);
+  runStart[++runs] = used + OLED_DMA_PREFIX + count;
+  return true;
+}
+
+bool OledDma::start(OledDone done, void* context){
+  if(sending || runs == 0){
+    return false;
+  }
+
+  this->done = done;
+  this->context = context;
+  next = 0;
+  sending = true;
+  startRun();
+  return true;
+}
+
+void OledDma::startRun(){
+  uint8_t i = next++;
+  NRF_TWIM1->TXD.PTR = (uint32_t)(buffer + runStart[i]);
+  NRF_TWIM1->TXD.MAXCNT = runStart[i + 1] - runStart[i];
+  NRF_TWIM1->EVENTS_STOPPED = 0;
+  NRF_TWIM1->EVENTS_ERROR = 0;
+  NRF_TWIM1->TASKS_STARTTX = 1;
+}
+
+/*--------------------------------------------------*/
+/*--                    irq()                     --*/
+/*--------------------------------------------------*/
+/*    A NACK ends the run with a STOP like any      */
+/*    other; the panel just misses it until the     */
+/*    next frame.                                   */
+/*--------------------------------------------------*/
+void OledDma::irq(){
+  if(NRF_TWIM1->EVENTS_ERROR){
+    NRF_TWIM1->EVENTS_ERROR = 0;
+    NRF_TWIM1->ERRORSRC = NRF_TWIM1->ERRORSRC;   // write 1 to clear
+    NRF_TWIM1->TASKS_STOP = 1;
+  }
+  if(!NRF_TWIM1->EVENTS_STOPPED){
+    return;
+  }
+  NRF_TWIM1->EVENTS_STOPPED = 0;
+
+  if(next < runs){
+    startRun();
+    return;
+  }
+
+  runs = 0;
+  sending = false;
+  if(done){
+    done(context);
+  }
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef CALENDURR_OLED_DMA_H
+#define CALENDURR_OLED_DMA_H
+
+#include <stdint.h>
+
+/*--------------------------------------------------*/
+/*--          OLED FRAMES BY TWIM EASYDMA         --*/
+/*--------------------------------------------------*/
+/*  Adafruit_SSD1306::display() sends the frame     */
+/*  through Wire, which spins until the last of     */
+/*  1 KB is clocked out at 400 kHz (~25 ms).        */
+/*  OledDma copies the frame (or the ink mirror's   */
+/*  runs) into a buffer of its own and TWIM1 sends  */
+/*  it by EasyDMA, so the loop goes straight back   */
+/*  to the pad and the radio:                       */
+/*                                                  */
+/*    display.begin(...); Wire.end();               */
+/*    oled.begin();                                 */
+/*    oled.queue(0, 7, 0, 127, display.getBuffer());*/
+/*    oled.start(done, context);                    */
+/*                                                  */
+/*  Every queued run is one I2C write: PAGEADDR and */
+/*  COLUMNADDR as single commands (control byte     */
+/*  0x80 each), then 0x40 and the run's bytes as    */
+/*  data. The TWIM interrupt starts the next run at */
+/*  each STOP and calls done after the last one, in */
+/*  the interrupt. Nothing can be queued while a    */
+/*  send runs (busy()).                             */
+/*                                                  */
+/*  Only I2C panels: the board has no SPI one, so   */
+/*  there is no SPIM transport.                     */
+/*--------------------------------------------------*/
+
+#ifndef OLED_DMA
+#define OLED_DMA 0
+#endif
+
+#define OLED_DMA_PAGES 8          // 64 rows
+#define OLED_DMA_WIDTH 128
+#define OLED_DMA_PREFIX 13        // 6 commands with their control bytes, then 0x40
+#define OLED_DMA_RUNS OLED_DMA_PAGES
+#define OLED_DMA_BYTES (OLED_DMA_PAGES * (OLED_DMA_PREFIX + OLED_DMA_WIDTH))  // every page on its own
+
+// Called from the TWIM interrupt once everything queued is out
+typedef void (*OledDone)(void* context);
+
+class OledDma {
+  public:
+    OledDma(uint8_t address);
+
+    // TWIM1 on Wire's pins at 400 kHz; Wire has to be ended first
+    void begin();
+
+    // Adds pages pageFirst..pageLast, columns first..last; bytes is that
+    // rectangle page by page. false while a send runs or if it is full
+    bool queue(uint8_t pageFirst, uint8_t pageLast, uint8_t first, uint8_t last, const uint8_t* bytes);
+
+    // Sends what was queued; false if nothing was or a send runs
+    bool start(OledDone done = 0, void* context = 0);
+
+    bool busy() const { return sending; }
+
+    // The TWIM1 interrupt
+    void irq();
+
+  private:
+    void startRun();
+
+    uint8_t address;
+    uint8_t buffer[OLED_DMA_BYTES];   // EasyDMA source
+    uint16_t runStart[OLED_DMA_RUNS + 1];
+    uint8_t runs;
+    volatile uint8_t next;
+    volatile bool sending;
+    OledDone done;
+    void* context;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "PenFilter.h"
+
+#include "PenMath.h"
+
+AverageFilter::AverageFilter(float coeff) : coeff(coeff) {
+  reset();
+}
+
+/*--------------------------------------------------*/
+/*--            AverageFilter::add()              --*/
+/*--------------------------------------------------*/
+/*    Filters the coordinates (if there are no      */
+/*    previous filtered values, just takes them),   */
+/*    then averages the result with up to 5 of the  */
+/*    most recent averages.                         */
+/*--------------------------------------------------*/
+bool AverageFilter::add(int x, int y, uint32_t us){
+  (void)us;
+
+  if(filteredX != 0 && filteredY != 0){
+    filteredX = (coeff * x) + (1 - coeff) * filteredX;
+    filteredY = (coeff * y) + (1 - coeff) * filteredY;
+  }
+  else{
+    filteredX = x;
+    filteredY = y;
+  }
+
+  // the averages were reset since the last point: the pen was lifted
+  bool strokeStart = (avgX[0] == 0 || avgY[0] == 0);
+
+  if(!strokeStart){
+    // average over as many earlier averages as this stroke has so far
+    int depth = 4;
+    while(depth > 0 && (avgX[depth] == 0 || avgY[depth] == 0)){
+      depth--;
+    }
+
+    int sumX = filteredX;
+    int sumY = filteredY;
+    for(int i = 0; i <= depth; i++){
+      sumX += avgX[i];
+      sumY += avgY[i];
+    }
+
+    for(int i = 4; i > 0; i--){
+      avgX[i] = avgX[i - 1];
+      avgY[i] = avgY[i - 1];
+    }
+    avgX[0] = sumX / (depth + 2);
+    avgY[0] = sumY / (depth + 2);
+  }
+  else{
+    avgX[0] = filteredX;
+    avgY[0] = filteredY;
+  }
+
+  return strokeStart;
+}
+
+void AverageFilter::reset(){
+  filteredX = 0;
+  filteredY = 0;
+  for(int i = 0; i < 5; i++){
+    avgX[i] = 0;
+    avgY[i] = 0;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                   alpha()                    --*/
+/*--------------------------------------------------*/
+/*    Smoothing factor of a first order low-pass at */
+/*    cutoff (mHz) for a step of dt us, in 1/65536: */
+/*    a = r / (r + 1) with r = 2 pi cutoff dt.      */
+/*    cutoff * dt stays below 2^32 by the limits in */
+/*    PenFilter.h.                                  */
+/*--------------------------------------------------*/
+static uint32_t alpha(uint32_t cutoff, uint32_t dt){
+  uint32_t r = cutoff * dt / 2429;   // 1e9 / (2 pi 65536)
+
+  return 65536 - 0xFFFFFFFFUL / (r + 65536);
+}
+
+static int32_t blend(int32_t from, int32_t to, uint32_t a){
+  return from + (int32_t)(((int64_t)(to - from) * a) >> 16);
+}
+
+static int32_t clampSpeed(int32_t speed){
+  return speed > 32767 ? 32767 : speed < -32767 ? -32767 : speed;
+}
+
+OneEuroFilter::OneEuroFilter(uint32_t minCutoff, uint32_t beta, uint32_t speedCutoff)
+  : minCutoff(minCutoff), beta(beta), speedCutoff(speedCutoff), started(false),
+    posX(0), posY(0), velX(0), velY(0), lastUs(0) {}
+
+/*--------------------------------------------------*/
+/*--            OneEuroFilter::add()              --*/
+/*--------------------------------------------------*/
+/*    The first reading of a stroke is taken as it  */
+/*    is, so a stroke starts where the pen touched  */
+/*    down with no ramp. After that the velocity    */
+/*    toward the new reading is smoothed, and its   */
+/*    size sets how far the position may follow.    */
+/*--------------------------------------------------*/
+bool OneEuroFilter::add(int x, int y, uint32_t us){
+  int32_t inX = x * ONE_EURO_FRACTION;
+  int32_t inY = y * ONE_EURO_FRACTION;
+
+  if(!started){
+    started = true;
+    posX = inX;
+    posY = inY;
+    velX = 0;
+    velY = 0;
+    lastUs = us;
+    return true;
+  }
+
+  uint32_t dt = us - lastUs;
+  lastUs = us;
+  if(dt == 0){
+    dt = 1;
+  }
+  else if(dt > ONE_EURO_MAX_GAP_US){
+    dt = ONE_EURO_MAX_GAP_US;
+  }
+
+  // pad units/s: 1/16 units * 1e6 / 16 / dt, clamped so it never overflows
+  int32_t stepX = clampSpeed((inX - posX) / 16);
+  int32_t stepY = clampSpeed((inY - posY) / 16);
+  uint32_t a = alpha(speedCutoff, dt);
+  velX = blend(velX, clampSpeed(stepX * 62500 / (int32_t)dt), a);
+  velY = blend(velY, clampSpeed(stepY * 62500 / (int32_t)dt), a);
+
+  uint32_t speed = isqrt32((uint32_t)(velX * velX + velY * velY));
+  uint32_t cutoff = ONE_EURO_MAX_CUTOFF;
+  if(minCutoff < ONE_EURO_MAX_CUTOFF && (beta == 0 || speed < (ONE_EURO_MAX_CUTOFF - minCutoff) / beta)){
+    cutoff = minCutoff + beta * speed;
+  }
+
+  a = alpha(cutoff, dt);
+  posX = blend(posX, inX, a);
+  posY = blend(posY, inY, a);
+
+  return false;
+}
+
+void OneEuroFilter::reset(){
+  started = false;
+}
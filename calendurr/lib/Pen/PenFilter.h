@@ -0,0 +1,104 @@
+#ifndef CALENDURR_PEN_FILTER_H
+#define CALENDURR_PEN_FILTER_H
+
+#include <stdint.h>
+
+/*--------------------------------------------------*/
+/*--          COORDINATE FILTERS (pen path)       --*/
+/*--------------------------------------------------*/
+/*  Sit between the pad readings and the resampler. */
+/*  Both take the scaled position of every new      */
+/*  reading and hand back the smoothed one; reset() */
+/*  is called when the pen lifts or jumps, and the  */
+/*  next add() starts a stroke.                     */
+/*                                                  */
+/*  FILTER_AVERAGE   the original one: an EMA       */
+/*                   (coeff 0.1) then the mean of   */
+/*                   up to 6 of its results. Steady */
+/*                   but many samples behind a fast */
+/*                   stroke.                        */
+/*  FILTER_ONE_EURO  One Euro filter: a low-pass    */
+/*                   whose cutoff rises with pen    */
+/*                   speed, so jitter is smoothed   */
+/*                   hard while the pen is slow and */
+/*                   fast strokes are followed      */
+/*                   closely. Fixed point only.     */
+/*                                                  */
+/*  host/filter compares them on replayed traces.   */
+/*--------------------------------------------------*/
+
+#define FILTER_AVERAGE 0
+#define FILTER_ONE_EURO 1
+
+#ifndef PEN_FILTER
+#define PEN_FILTER FILTER_AVERAGE
+#endif
+
+// One Euro tuning, all in integers:
+// cutoff = ONE_EURO_MIN_CUTOFF + ONE_EURO_BETA * speed, where speed is
+// the smoothed pen speed in pad units per second
+#ifndef ONE_EURO_MIN_CUTOFF
+#define ONE_EURO_MIN_CUTOFF 1000     // mHz, cutoff with the pen still
+#endif
+
+#ifndef ONE_EURO_BETA
+#define ONE_EURO_BETA 20             // mHz per pad unit/s
+#endif
+
+#ifndef ONE_EURO_SPEED_CUTOFF
+#define ONE_EURO_SPEED_CUTOFF 1000   // mHz, smoothing of the speed itself
+#endif
+
+#define ONE_EURO_MAX_CUTOFF 200000   // mHz; keeps alpha() in 32 bits
+#define ONE_EURO_MAX_GAP_US 20000    // longer gaps count as this long
+#define ONE_EURO_FRACTION 256        // positions are kept in 1/256 pad units
+
+/*------------------------------------------*/
+/*  AverageFilter - the original filter,    */
+/*  moved out of readSensor() unchanged     */
+/*  (zero still means "no value yet")       */
+/*------------------------------------------*/
+class AverageFilter {
+  public:
+    AverageFilter(float coeff);
+
+    // Filters one reading; true if it starts a stroke
+    bool add(int x, int y, uint32_t us);
+    void reset();
+
+    int x(){ return avgX[0]; }
+    int y(){ return avgY[0]; }
+
+  private:
+    float coeff;
+    int filteredX, filteredY;
+    int avgX[5], avgY[5];     // newest average first
+};
+
+/*------------------------------------------*/
+/*  OneEuroFilter - speed-dependent         */
+/*  low-pass; the speed is taken from both  */
+/*  axes so a stroke is smoothed the same   */
+/*  way along x and y                       */
+/*------------------------------------------*/
+class OneEuroFilter {
+  public:
+    OneEuroFilter(uint32_t minCutoff = ONE_EURO_MIN_CUTOFF, uint32_t beta = ONE_EURO_BETA,
+                  uint32_t speedCutoff = ONE_EURO_SPEED_CUTOFF);
+
+    // Filters one reading; true if it starts a stroke
+    bool add(int x, int y, uint32_t us);
+    void reset();
+
+    int x(){ return (posX + ONE_EURO_FRACTION / 2) / ONE_EURO_FRACTION; }
+    int y(){ return (posY + ONE_EURO_FRACTION / 2) / ONE_EURO_FRACTION; }
+
+  private:
+    uint32_t minCutoff, beta, speedCutoff;
+    bool started;
+    int32_t posX, posY;       // 1/256 units
+    int32_t velX, velY;       // smoothed, pad units/s
+    uint32_t lastUs;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#include "PenMath.h"
+
+uint32_t isqrt32(uint32_t value){
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+
+  while(bit > value){
+    bit >>= 2;
+  }
+  while(bit){
+    if(value >= root + bit){
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else{
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  return root;
+}
@@ -0,0 +1,9 @@
+#ifndef CALENDURR_PEN_MATH_H
+#define CALENDURR_PEN_MATH_H
+
+#include <stdint.h>
+
+// Integer square root (floor); no FPU work on the pen path
+uint32_t isqrt32(uint32_t value);
+
+#endif
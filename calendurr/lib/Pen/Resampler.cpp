@@ -0,0 +1,82 @@
+#include "Resampler.h"
+
+#include "PenMath.h"
+
+ArcResampler::ArcResampler(uint16_t step)
+  : step((uint32_t)step * RESAMPLE_FRACTION), down(false), first(false),
+    posX(0), posY(0), posUs(0), targetX(0), targetY(0), targetUs(0), carried(0) {}
+
+void ArcResampler::add(int x, int y, uint32_t us){
+  targetX = x * RESAMPLE_FRACTION;
+  targetY = y * RESAMPLE_FRACTION;
+  targetUs = us;
+
+  if(!down){
+    down = true;
+    first = true;
+    posX = targetX;
+    posY = targetY;
+    posUs = us;
+    carried = 0;
+  }
+}
+
+void ArcResampler::emit(PenPoint* point, bool strokeStart){
+  point->x = (posX + RESAMPLE_FRACTION / 2) / RESAMPLE_FRACTION;
+  point->y = (posY + RESAMPLE_FRACTION / 2) / RESAMPLE_FRACTION;
+  point->us = posUs;
+  point->strokeStart = strokeStart;
+}
+
+/*--------------------------------------------------*/
+/*--                   next()                     --*/
+/*--------------------------------------------------*/
+/*    Walks from the last point toward the newest   */
+/*    input. If the ink left to the next spacing    */
+/*    mark lies on this segment, the mark is cut    */
+/*    out of it; otherwise the segment is used up   */
+/*    and its length carried to the next one.       */
+/*--------------------------------------------------*/
+bool ArcResampler::next(PenPoint* point){
+  if(!down){
+    return false;
+  }
+  if(first){
+    first = false;
+    emit(point, true);
+    return true;
+  }
+
+  int32_t dx = targetX - posX;
+  int32_t dy = targetY - posY;
+  uint32_t length = isqrt32((uint32_t)(dx * dx + dy * dy));
+  uint32_t need = step - carried;
+
+  if(length == 0 || length < need){
+    carried += length;
+    posX = targetX;
+    posY = targetY;
+    posUs = targetUs;
+    return false;
+  }
+
+  posX += (int32_t)((int64_t)dx * need / length);
+  posY += (int32_t)((int64_t)dy * need / length);
+  posUs += (uint32_t)((uint64_t)(targetUs - posUs) * need / length);
+  carried = 0;
+  emit(point, false);
+  return true;
+}
+
+bool ArcResampler::finish(PenPoint* point){
+  // a lone point that was never taken out still counts as a stroke
+  bool moved = down && (first || carried > 0);
+
+  if(moved){
+    emit(point, first);
+  }
+  down = false;
+  first = false;
+  carried = 0;
+  return moved;
+}
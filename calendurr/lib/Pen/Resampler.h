@@ -0,0 +1,75 @@
+#ifndef CALENDURR_RESAMPLER_H
+#define CALENDURR_RESAMPLER_H
+
+#include <stdint.h>
+
+/*--------------------------------------------------*/
+/*--          ARC-LENGTH RESAMPLER (pen path)     --*/
+/*--------------------------------------------------*/
+/*  Sits between the coordinate filter and coordz.  */
+/*  Whatever the pen speed, a stroke comes out as   */
+/*  points RESAMPLE_STEP pad units apart along the  */
+/*  ink: slow writing no longer piles up near-      */
+/*  duplicate points and fast writing is filled in. */
+/*  The first point of a stroke and its end are     */
+/*  always kept. Times are interpolated with the    */
+/*  positions, so per-point ticks stay true.        */
+/*                                                  */
+/*  Use:                                            */
+/*    resampler.add(x, y, micros());                */
+/*    while(resampler.next(&p)) store(p);           */
+/*    ...pen lifted:                                */
+/*    if(resampler.finish(&p)) store(p);            */
+/*--------------------------------------------------*/
+
+#ifndef PEN_RESAMPLE
+#define PEN_RESAMPLE 1
+#endif
+
+#ifndef RESAMPLE_STEP
+#define RESAMPLE_STEP 4       // pad units between points
+#endif
+
+#define RESAMPLE_FRACTION 16  // positions are kept in 1/16 pad units
+
+/*------------------------------------------*/
+/*  PenPoint - one resampled point          */
+/*  strokeStart - first point of a stroke   */
+/*------------------------------------------*/
+struct PenPoint {
+  int x;
+  int y;
+  uint32_t us;
+  bool strokeStart;
+};
+
+class ArcResampler {
+  public:
+    ArcResampler(uint16_t step = RESAMPLE_STEP);
+
+    // Next filtered pen position; the first one after finish() starts a stroke
+    void add(int x, int y, uint32_t us);
+
+    // Yields the points due so far, one per call; false when there are none
+    bool next(PenPoint* point);
+
+    // Ends the stroke; true (and the end point) if the pen moved since
+    // the last point that came out
+    bool finish(PenPoint* point);
+
+    bool penDown(){ return down; }
+
+  private:
+    void emit(PenPoint* point, bool strokeStart);
+
+    uint32_t step;
+    bool down;
+    bool first;
+    int32_t posX, posY;       // last point passed, 1/16 units
+    uint32_t posUs;
+    int32_t targetX, targetY; // newest input
+    uint32_t targetUs;
+    uint32_t carried;         // ink since the last point out, 1/16 units
+};
+
+#endif
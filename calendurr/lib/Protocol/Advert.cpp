@@ -0,0 +1,21 @@
+#include "Advert.h"
+
+uint8_t buildAdvert(const AdvertStatus& status, uint8_t* data){
+  data[0] = ADVERT_COMPANY_ID & 0xFF;
+  data[1] = ADVERT_COMPANY_ID >> 8;
+  data[2] = status.pending;
+  data[3] = status.fill;
+  data[4] = status.battery;
+  return ADVERT_DATA_LEN;
+}
+
+bool parseAdvert(const uint8_t* data, uint8_t len, AdvertStatus* status){
+  if(len < ADVERT_DATA_LEN || (data[0] | (data[1] << 8)) != ADVERT_COMPANY_ID){
+    return false;
+  }
+
+  status->pending = data[2];
+  status->fill = data[3];
+  status->battery = data[4];
+  return true;
+}
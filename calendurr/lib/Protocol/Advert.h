@@ -0,0 +1,59 @@
+#ifndef CALENDURR_ADVERT_H
+#define CALENDURR_ADVERT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*--------------------------------------------------*/
+/*--        NOTE STATUS IN THE ADVERTISING        --*/
+/*--------------------------------------------------*/
+/*  The undirected advertising packet carries a     */
+/*  manufacturer specific AD structure, so a        */
+/*  gateway scanning passively sees whether the     */
+/*  device has anything to send without connecting  */
+/*  and discovering the service:                    */
+/*                                                  */
+/*    0xFF company16 pending fill battery           */
+/*      company - ADVERT_COMPANY_ID                 */
+/*      pending - notes waiting to be sent          */
+/*      fill - percent of coordz in use             */
+/*      battery - percent, ADVERT_UNKNOWN until     */
+/*             the first VBAT reading               */
+/*                                                  */
+/*  With the flags, the TX power and the 128-bit    */
+/*  service UUID that is all 31 bytes, which is why */
+/*  there is no version byte: a new layout takes a  */
+/*  new company value. The scan response is left    */
+/*  alone; a passive scan never asks for it.        */
+/*--------------------------------------------------*/
+
+#define ADVERT_COMPANY_ID 0xFFFF    // the SIG's value for tests and prototypes, no company
+#define ADVERT_DATA_LEN 5
+#define ADVERT_UNKNOWN 0xFF
+
+#ifndef ADVERT_UPDATE_MS
+#define ADVERT_UPDATE_MS 5000       // advertising restarts at most this often for a change
+#endif
+
+/*------------------------------------------*/
+/*  AdvertStatus - what the block says      */
+/*------------------------------------------*/
+struct AdvertStatus {
+  uint8_t pending;
+  uint8_t fill;
+  uint8_t battery;
+};
+
+inline bool sameAdvert(const AdvertStatus& a, const AdvertStatus& b){
+  return a.pending == b.pending && a.fill == b.fill && a.battery == b.battery;
+}
+
+// Writes the manufacturer data (company first, without the AD length and
+// type) to data; returns ADVERT_DATA_LEN
+uint8_t buildAdvert(const AdvertStatus& status, uint8_t* data);
+
+// Reads manufacturer data written by buildAdvert(); false if it is some
+// other company's or cut off
+bool parseAdvert(const uint8_t* data, uint8_t len, AdvertStatus* status);
+
+#endif
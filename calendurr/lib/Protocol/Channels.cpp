@@ -0,0 +1,230 @@
+#include "Channels.h"
+
+NoteStream::NoteStream(NoteLink& link)
+  : session(0), packets(0), bytes(0), failures(0), link(link), sent(0), offset(0), closing(false),
+    closeAt(0), closedSession(0) {}
+
+uint16_t NoteStream::payload(){
+  uint16_t size = link.payloadSize();
+
+  if(size > NOTE_MAX_PAYLOAD){
+    size = NOTE_MAX_PAYLOAD;
+  }
+  else if(size < NOTE_MIN_PAYLOAD){
+    size = NOTE_MIN_PAYLOAD;
+  }
+
+  return size;
+}
+
+bool NoteStream::sendPacket(const uint8_t* data, uint16_t len, bool status){
+  if(status ? link.notifyStatus(data, len) : link.notify(data, len)){
+    packets++;
+    bytes += len;
+    return true;
+  }
+
+  failures++;
+  return false;
+}
+
+bool NoteStream::sendStatus(uint8_t type, uint8_t a, uint8_t b, uint8_t len){
+  uint8_t frame[STATUS_MAX_LEN] = {STATUS_TAG, type, session, a, b};
+
+  // a marker is never skipped: wait for room rather than lose the note
+  while(!sendPacket(frame, 3 + len, true)){
+    if(!link.connected()){
+      return false;
+    }
+    link.pause(1);
+  }
+  return true;
+}
+
+void NoteStream::start(){
+  session++;
+  // points stored but not sent yet belong to the new note
+  if(!closing){
+    offset = 0;
+  }
+  sendStatus(STATUS_START);
+}
+
+/*--------------------------------------------------*/
+/*--                   close()                    --*/
+/*--------------------------------------------------*/
+/*    Marks where the note ends in the store and    */
+/*    sends its markers ahead of its points. Only   */
+/*    one closed note can wait for its points; a    */
+/*    second SEND first drains the one before.      */
+/*--------------------------------------------------*/
+void NoteStream::close(const PointStore& points, int month, int day, int hour, int minute){
+  if(closing){
+    drain(points);
+  }
+
+  uint16_t total = offset + (points.count() - sent);
+  closing = true;
+  closeAt = points.count();
+  closedSession = session;
+
+  sendStatus(STATUS_STOP, total & 0xFF, total >> 8, 2);
+  sendStatus(STATUS_DATE, month, day, 2);
+  if(hour >= 0){
+    sendStatus(STATUS_TIME, hour, minute, 2);
+  }
+  sendStatus(STATUS_END);
+}
+
+/*--------------------------------------------------*/
+/*--                  service()                   --*/
+/*--------------------------------------------------*/
+/*    A closed note's points go first, all of them  */
+/*    (its last packet may be short); the open      */
+/*    note only sends packets it can fill.          */
+/*--------------------------------------------------*/
+void NoteStream::service(const PointStore& points, uint8_t burst, bool partial){
+  uint8_t buffer[NOTE_MAX_PAYLOAD];
+  uint16_t size = payload();
+  bool timed = points.timed();
+
+  while(burst > 0){
+    uint16_t limit = closing ? closeAt : points.count();
+    if(sent >= limit){
+      if(!closing){
+        return;
+      }
+      closing = false;
+      offset = 0;
+      continue;
+    }
+
+    uint16_t len = 0;
+    uint16_t i = sent;
+    buffer[len++] = timed ? STREAM_TIMED_TAG : STREAM_DATA_TAG;
+    buffer[len++] = closing ? closedSession : session;
+    buffer[len++] = offset & 0xFF;
+    buffer[len++] = offset >> 8;
+
+    bool full = false;
+    while(i < limit){
+      StoredPoint point = points.at(i);
+      if(len + 4 + (timed ? varintLength(point.ticks) : 0) > size){
+        full = true;
+        break;
+      }
+      buffer[len++] = point.x & 0xFF;
+      buffer[len++] = point.x >> 8;
+      buffer[len++] = point.y & 0xFF;
+      buffer[len++] = point.y >> 8;
+      if(timed){
+        len += putVarint(buffer + len, point.ticks);
+      }
+      i++;
+    }
+
+    if(!full && !closing && !partial){
+      return;   // wait for more points
+    }
+    if(!sendPacket(buffer, len, false)){
+      return;   // the queue is full, try again next pass
+    }
+    offset += i - sent;
+    sent = i;
+    burst--;
+  }
+}
+
+bool NoteStream::drain(const PointStore& points){
+  while(!idle(points)){
+    if(!link.connected()){
+      return false;
+    }
+    unsigned long before = packets;
+    service(points, 1, true);
+    if(packets == before){
+      link.pause(1);
+    }
+  }
+  return true;
+}
+
+void NoteStream::cleared(){
+  if(closing){
+    closing = false;
+    offset = 0;
+  }
+  sent = 0;
+}
+
+/*--------------------------------------------------*/
+/*--               parseStatus()                  --*/
+/*--------------------------------------------------*/
+bool parseStatus(const uint8_t* data, uint16_t len, StatusMessage* message){
+  if(len < 3 || data[0] != STATUS_TAG){
+    return false;
+  }
+
+  message->type = data[1];
+  message->session = data[2];
+  message->a = 0;
+  message->b = 0;
+
+  switch(message->type){
+    case STATUS_STOP:
+      if(len < 5){
+        return false;
+      }
+      message->a = data[3] | (data[4] << 8);
+      return true;
+    case STATUS_DATE:
+    case STATUS_TIME:
+      if(len < 5){
+        return false;
+      }
+      message->a = data[3];
+      message->b = data[4];
+      return true;
+    case STATUS_START:
+    case STATUS_END:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                parseStream()                 --*/
+/*--------------------------------------------------*/
+int parseStream(const uint8_t* data, uint16_t len, uint8_t* session, uint16_t* offset, int (*points)[2],
+                int maxPoints, uint32_t* ticks){
+  if(len < STREAM_HEADER || (data[0] != STREAM_DATA_TAG && data[0] != STREAM_TIMED_TAG)){
+    return 0;
+  }
+
+  bool timed = data[0] == STREAM_TIMED_TAG;
+  *session = data[1];
+  *offset = data[2] | (data[3] << 8);
+
+  int count = 0;
+  uint16_t i = STREAM_HEADER;
+  while(i + 4 <= len && count < maxPoints){
+    uint32_t t = 0;
+    points[count][0] = (int16_t)(data[i] | (data[i + 1] << 8));
+    points[count][1] = (int16_t)(data[i + 2] | (data[i + 3] << 8));
+    i += 4;
+    if(timed){
+      uint8_t n = getVarint(data + i, len - i, &t);
+      if(n == 0){
+        return count;
+      }
+      i += n;
+    }
+    if(ticks){
+      ticks[count] = t;
+    }
+    count++;
+  }
+
+  return count;
+}
@@ -0,0 +1,133 @@
+#ifndef CALENDURR_CHANNELS_H
+#define CALENDURR_CHANNELS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Protocol.h"
+
+/*--------------------------------------------------*/
+/*--   STATUS/STREAM CHANNELS (NOTE_CHANNELS)   --*/
+/*--------------------------------------------------*/
+/*  The note markers get their own notify           */
+/*  characteristic (status), the points keep the    */
+/*  data characteristic (stream). Both carry the    */
+/*  session (note) number, so the phone never has   */
+/*  to tell a marker from a point by its text.      */
+/*                                                  */
+/*  Points are not sent in one blocking burst any   */
+/*  more: service() hands at most STREAM_BURST      */
+/*  packets to notify() per loop() pass. A SEND     */
+/*  press therefore gets its STOP, DATE, TIME and   */
+/*  END out at once, behind only what already sits  */
+/*  in the SoftDevice queue; the rest of the note   */
+/*  follows, and STOP says how many points to wait  */
+/*  for.                                            */
+/*                                                  */
+/*  Frames (little-endian):                         */
+/*    STATUS 0x18 type session [args]               */
+/*      START  1                                    */
+/*      STOP   2 total16                            */
+/*      DATE   3 month day                          */
+/*      TIME   4 hour minute                        */
+/*      END    5                                    */
+/*    STREAM 0x19 session offset16 (x16 y16)*       */
+/*    STREAM 0x1A session offset16 (x16 y16 ticks)* */
+/*                                                  */
+/*  A note is complete once its END is in and it    */
+/*  has total points. BluetoothPage.js reads        */
+/*  neither characteristic's new frames yet.        */
+/*--------------------------------------------------*/
+
+#ifndef NOTE_CHANNELS
+#define NOTE_CHANNELS 0
+#endif
+
+#define STATUS_TAG 0x18
+#define STREAM_DATA_TAG 0x19
+#define STREAM_TIMED_TAG 0x1A
+
+#define STATUS_START 1
+#define STATUS_STOP 2
+#define STATUS_DATE 3
+#define STATUS_TIME 4
+#define STATUS_END 5
+
+#define STATUS_MAX_LEN 5
+#define STREAM_HEADER 4
+#define STREAM_BURST 2          // stream packets per service()
+
+/*------------------------------------------*/
+/*  NoteStream - device side.               */
+/*  Reads the points to send straight from  */
+/*  coordz, which must only be cleared once */
+/*  idle() (cleared() then starts over).    */
+/*  session - number of the open note       */
+/*------------------------------------------*/
+class NoteStream {
+  public:
+    NoteStream(NoteLink& link);
+
+    // START of the next session, on the status channel
+    void start();
+
+    // SEND: the stored points so far are the note. STOP, DATE, TIME
+    // (hour < 0 leaves it out) and END go out now, the points after them
+    void close(const PointStore& points, int month, int day, int hour = -1, int minute = -1);
+
+    // Hands up to burst stream packets to the link; only full ones while
+    // the note is open unless partial. Call from the loop
+    void service(const PointStore& points, uint8_t burst = STREAM_BURST, bool partial = false);
+
+    // Sends everything stored; false if the link dropped first
+    bool drain(const PointStore& points);
+
+    // Everything stored has been sent
+    bool idle(const PointStore& points) const { return !closing && sent == points.count(); }
+
+    // coordz was cleared; a closed note not sent by then is dropped
+    void cleared();
+
+    uint8_t session;
+    unsigned long packets;
+    unsigned long bytes;
+    unsigned long failures;
+
+  private:
+    bool sendStatus(uint8_t type, uint8_t a = 0, uint8_t b = 0, uint8_t len = 0);
+    bool sendPacket(const uint8_t* data, uint16_t len, bool status);
+    uint16_t payload();
+
+    NoteLink& link;
+    uint16_t sent;          // points of the store already sent
+    uint16_t offset;        // note offset of the point at sent
+    bool closing;           // the points up to closeAt are a closed note
+    uint16_t closeAt;
+    uint8_t closedSession;
+};
+
+/*------------------------------------------*/
+/*  Host side helpers.                      */
+/*------------------------------------------*/
+
+/*------------------------------------------*/
+/*  StatusMessage - a STATUS frame          */
+/*  a, b - total (in a), month and day or   */
+/*            hour and minute               */
+/*------------------------------------------*/
+struct StatusMessage {
+  uint8_t type;
+  uint8_t session;
+  uint16_t a;
+  uint8_t b;
+};
+
+// Reads a STATUS frame; false if it is not one or is cut off
+bool parseStatus(const uint8_t* data, uint16_t len, StatusMessage* message);
+
+// Decodes a STREAM frame like parsePoints(); returns how many points, 0 if
+// it is not one
+int parseStream(const uint8_t* data, uint16_t len, uint8_t* session, uint16_t* offset, int (*points)[2],
+                int maxPoints, uint32_t* ticks = NULL);
+
+#endif
@@ -0,0 +1,167 @@
+#include "Fanout.h"
+
+NoteFanout::NoteFanout() : head(0), waits(0){
+  for(uint8_t i = 0; i < FANOUT_MAX_LINKS; i++){
+    links[i].active = false;
+  }
+}
+
+FanoutLink* NoteFanout::find(uint16_t conn){
+  for(uint8_t i = 0; i < FANOUT_MAX_LINKS; i++){
+    if(links[i].active && links[i].conn == conn){
+      return &links[i];
+    }
+  }
+  return NULL;
+}
+
+uint8_t NoteFanout::linkCount() const {
+  uint8_t count = 0;
+  for(uint8_t i = 0; i < FANOUT_MAX_LINKS; i++){
+    if(links[i].active){
+      count++;
+    }
+  }
+  return count;
+}
+
+// Where the slowest connection is (head without connections)
+uint32_t NoteFanout::tail() const {
+  uint32_t behind = 0;
+  for(uint8_t i = 0; i < FANOUT_MAX_LINKS; i++){
+    if(links[i].active && head - links[i].offset > behind){
+      behind = head - links[i].offset;
+    }
+  }
+  return head - behind;
+}
+
+bool NoteFanout::idle() const {
+  return tail() == head;
+}
+
+uint16_t NoteFanout::packetAt(uint32_t offset, uint8_t* data) const {
+  uint16_t len = ring[offset % FANOUT_BUFFER];
+  for(uint16_t i = 0; i < len; i++){
+    data[i] = ring[(offset + 1 + i) % FANOUT_BUFFER];
+  }
+  return len;
+}
+
+uint16_t NoteFanout::payloadSize(){
+  uint16_t size = NOTE_MAX_PAYLOAD;
+  for(uint8_t i = 0; i < FANOUT_MAX_LINKS; i++){
+    if(links[i].active && links[i].payload < size){
+      size = links[i].payload;
+    }
+  }
+  return size;
+}
+
+/*--------------------------------------------------*/
+/*--                  notify()                    --*/
+/*--------------------------------------------------*/
+/*    Writes the packet into the ring once, for     */
+/*    every connection. A full ring waits for the   */
+/*    slowest connection, the way a full HVN queue  */
+/*    blocks a single link.                         */
+/*--------------------------------------------------*/
+bool NoteFanout::notify(const uint8_t* data, uint16_t len){
+  if(!connected() || len == 0 || len > payloadSize()){
+    return false;
+  }
+
+  bool waited = false;
+  while(head + len + 1 - tail() > FANOUT_BUFFER){
+    pump();
+    if(head + len + 1 - tail() <= FANOUT_BUFFER){
+      break;
+    }
+    if(!connected()){
+      return false;
+    }
+    if(!waited){
+      waits++;
+      waited = true;
+    }
+    pause(1);
+  }
+
+  ring[head % FANOUT_BUFFER] = len;
+  for(uint16_t i = 0; i < len; i++){
+    ring[(head + 1 + i) % FANOUT_BUFFER] = data[i];
+  }
+  head += len + 1;
+
+  pump();
+  return true;
+}
+
+/*--------------------------------------------------*/
+/*--                   pump()                     --*/
+/*--------------------------------------------------*/
+/*    Round robin, one packet per connection per    */
+/*    round, until no connection can take more.     */
+/*    A refused packet stays for the next pump().   */
+/*--------------------------------------------------*/
+void NoteFanout::pump(){
+  uint8_t packet[NOTE_MAX_PAYLOAD];
+  bool progress = true;
+
+  while(progress){
+    progress = false;
+    for(uint8_t i = 0; i < FANOUT_MAX_LINKS; i++){
+      FanoutLink& link = links[i];
+      if(!link.active || link.credits == 0 || link.offset == head){
+        continue;
+      }
+
+      uint16_t len = packetAt(link.offset, packet);
+      if(!sendTo(link.conn, packet, len)){
+        continue;
+      }
+      link.credits--;
+      link.offset += len + 1;
+      link.packets++;
+      link.bytes += len;
+      progress = true;
+    }
+  }
+}
+
+bool NoteFanout::attach(uint16_t conn, uint16_t payload, uint8_t credits){
+  for(uint8_t i = 0; i < FANOUT_MAX_LINKS; i++){
+    if(!links[i].active){
+      links[i].conn = conn;
+      links[i].payload = payload < NOTE_MIN_PAYLOAD ? NOTE_MIN_PAYLOAD : payload;
+      links[i].credits = credits;
+      links[i].offset = head;
+      links[i].packets = 0;
+      links[i].bytes = 0;
+      links[i].active = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+void NoteFanout::detach(uint16_t conn){
+  FanoutLink* link = find(conn);
+  if(link){
+    link->active = false;
+  }
+}
+
+void NoteFanout::setPayload(uint16_t conn, uint16_t payload){
+  FanoutLink* link = find(conn);
+  if(link && payload >= NOTE_MIN_PAYLOAD){
+    link->payload = payload;
+  }
+}
+
+void NoteFanout::credit(uint16_t conn, uint8_t count){
+  FanoutLink* link = find(conn);
+  if(link){
+    link->credits += count;
+  }
+}
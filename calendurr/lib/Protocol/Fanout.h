@@ -0,0 +1,118 @@
+#ifndef CALENDURR_FANOUT_H
+#define CALENDURR_FANOUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Protocol.h"
+
+/*--------------------------------------------------*/
+/*--      SEVERAL CENTRALS (NOTE_CENTRALS > 1)    --*/
+/*--------------------------------------------------*/
+/*  Up to NOTE_CENTRALS phones/laptops connect at   */
+/*  once and all get the same notes. NoteSender     */
+/*  encodes every packet once, into one ring        */
+/*  shared by all the connections; each connection  */
+/*  only keeps its place in it and what its own     */
+/*  SoftDevice queue can take:                      */
+/*                                                  */
+/*    ring:  ...[len packet][len packet][len ...    */
+/*                ^ slowest          ^ head         */
+/*                   offset                         */
+/*                                                  */
+/*  pump() hands the packets out one per            */
+/*  connection per round, so a link with a short    */
+/*  queue or a long interval does not starve the    */
+/*  others of notify() calls. A packet's bytes are  */
+/*  reused once every connection has taken it, so   */
+/*  the slowest link sets the pace of the sender    */
+/*  once it is FANOUT_BUFFER behind.                */
+/*                                                  */
+/*  Packets are cut for the smallest ATT payload of */
+/*  the connections at the time they are encoded.   */
+/*  A central that connects mid-note gets the note  */
+/*  from the next packet on; the next START is its  */
+/*  first whole note.                               */
+/*--------------------------------------------------*/
+
+#ifndef NOTE_CENTRALS
+#define NOTE_CENTRALS 1
+#endif
+
+#ifndef FANOUT_BUFFER
+#define FANOUT_BUFFER 2048      // bytes of encoded packets held for the slowest link
+#endif
+
+#define FANOUT_MAX_LINKS 4
+
+/*------------------------------------------*/
+/*  FanoutLink - one connection             */
+/*  conn - connection handle                */
+/*  payload - its ATT MTU - 3               */
+/*  credits - free slots of its HVN queue   */
+/*  offset - ring bytes it has taken (the   */
+/*            SoftDevice accepted them)     */
+/*  packets/bytes - handed to it so far     */
+/*------------------------------------------*/
+struct FanoutLink {
+  bool active;
+  uint16_t conn;
+  uint16_t payload;
+  uint8_t credits;
+  uint32_t offset;
+  unsigned long packets;
+  unsigned long bytes;
+};
+
+/*------------------------------------------*/
+/*  NoteFanout - the NoteLink NoteSender    */
+/*  writes to; sendTo() is the real notify  */
+/*  of one connection.                      */
+/*  head - ring bytes written so far        */
+/*  waits - notify() calls that had to wait */
+/*            for the slowest link          */
+/*------------------------------------------*/
+class NoteFanout : public NoteLink {
+  public:
+    NoteFanout();
+
+    uint16_t payloadSize();
+    bool notify(const uint8_t* data, uint16_t len);
+    bool connected(){ return linkCount() > 0; }
+
+    // A connection came up with credits free HVN slots; false if all
+    // FANOUT_MAX_LINKS are taken
+    bool attach(uint16_t conn, uint16_t payload, uint8_t credits);
+    void detach(uint16_t conn);
+
+    // After an MTU exchange
+    void setPayload(uint16_t conn, uint16_t payload);
+
+    // count packets of conn left its HVN queue (TX complete)
+    void credit(uint16_t conn, uint8_t count);
+
+    // Hands every connection what it has credits for
+    void pump();
+
+    // Every connection has taken everything written
+    bool idle() const;
+
+    uint8_t linkCount() const;
+    const FanoutLink& link(uint8_t i) const { return links[i]; }
+
+    uint32_t head;
+    unsigned long waits;
+
+  protected:
+    virtual bool sendTo(uint16_t conn, const uint8_t* data, uint16_t len) = 0;
+
+  private:
+    FanoutLink* find(uint16_t conn);
+    uint32_t tail() const;
+    uint16_t packetAt(uint32_t offset, uint8_t* data) const;
+
+    FanoutLink links[FANOUT_MAX_LINKS];
+    uint8_t ring[FANOUT_BUFFER];
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "Latency.h"
+
+#include <string.h>
+
+#include "Protocol.h"
+
+static void put32(uint8_t* out, uint32_t value){
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+  out[2] = (value >> 16) & 0xFF;
+  out[3] = value >> 24;
+}
+
+static uint32_t get32(const uint8_t* in){
+  return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+LatencyTracer::LatencyTracer()
+  : syncs(0), sentUs(0), storeLagUs(0), batchLagUs(0), anchorHead(0), anchorTail(0),
+    syncHead(0), syncTail(0) {}
+
+void LatencyTracer::start(uint32_t nowUs){
+  sentUs = nowUs;
+  storeLagUs = 0;
+  anchorHead = anchorTail = 0;
+}
+
+void LatencyTracer::stored(uint32_t ticks, uint32_t captureUs, uint32_t nowUs){
+  if(nowUs - captureUs > storeLagUs){
+    storeLagUs = nowUs - captureUs;
+  }
+
+  uint8_t following = (anchorHead + 1) % LATENCY_ANCHORS;
+  if(ticks >= POINT_TICKS_MAX && following != anchorTail){
+    anchorUs[anchorHead] = captureUs;
+    anchorHead = following;
+  }
+}
+
+void LatencyTracer::batch(){
+  batchLagUs = storeLagUs;
+  storeLagUs = 0;
+}
+
+/*--------------------------------------------------*/
+/*--                 captureOf()                  --*/
+/*--------------------------------------------------*/
+/*    Capture time of the next point to send, the   */
+/*    way pointClock counted it: the ticks after    */
+/*    the one before, or (clamped) where it was     */
+/*    anchored when it was stored.                  */
+/*--------------------------------------------------*/
+uint32_t LatencyTracer::captureOf(uint32_t ticks){
+  if(ticks >= POINT_TICKS_MAX && anchorTail != anchorHead){
+    return anchorUs[anchorTail];
+  }
+  return sentUs + ticks * POINT_TICK_US;
+}
+
+uint8_t LatencyTracer::header(uint8_t* out, uint32_t firstTicks, uint32_t nowUs){
+  uint32_t captureUs = captureOf(firstTicks);
+  uint8_t len = 0;
+
+  out[len++] = TRACED_FRAME_TAG;
+  put32(out + len, captureUs);
+  len += 4;
+  len += putVarint(out + len, batchLagUs);
+  len += putVarint(out + len, nowUs - captureUs);
+  return len;
+}
+
+void LatencyTracer::sent(uint32_t ticks){
+  sentUs = captureOf(ticks);
+  if(ticks >= POINT_TICKS_MAX && anchorTail != anchorHead){
+    anchorTail = (anchorTail + 1) % LATENCY_ANCHORS;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                    post()                    --*/
+/*--------------------------------------------------*/
+/*    Notes when the SYNC request arrived (in the   */
+/*    BLE task, as close to the radio as the app    */
+/*    gets); service() answers it from the loop.    */
+/*--------------------------------------------------*/
+void LatencyTracer::post(const uint8_t* data, uint16_t len, uint32_t nowUs){
+  uint8_t head = syncHead;
+  uint8_t following = (head + 1) % SYNC_SLOTS;
+
+  if(len < SYNC_REQUEST_LEN || data[0] != SYNC_TAG || following == syncTail){
+    return;  // the phone asks again
+  }
+
+  syncSeq[head] = data[1];
+  syncRxUs[head] = nowUs;
+  syncHead = following;
+}
+
+void LatencyTracer::service(NoteSender& sender, uint32_t nowUs){
+  while(syncTail != syncHead){
+    uint8_t tail = syncTail;
+    uint8_t reply[SYNC_REPLY_LEN];
+
+    reply[0] = SYNC_TAG;
+    reply[1] = syncSeq[tail];
+    put32(reply + 2, syncRxUs[tail]);
+    put32(reply + 6, nowUs);
+    sender.sendPacket(reply, sizeof(reply));
+    syncs++;
+    syncTail = (tail + 1) % SYNC_SLOTS;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                parseTrace()                  --*/
+/*--------------------------------------------------*/
+uint16_t parseTrace(const uint8_t* data, uint16_t len, PacketTrace* trace){
+  uint32_t stored = 0, notify = 0;
+
+  if(len < 7 || data[0] != TRACED_FRAME_TAG){
+    return 0;
+  }
+
+  uint16_t i = 5;
+  uint8_t n = getVarint(data + i, len - i, &stored);
+  if(n == 0){
+    return 0;
+  }
+  i += n;
+  n = getVarint(data + i, len - i, &notify);
+  if(n == 0){
+    return 0;
+  }
+  i += n;
+
+  trace->captureUs = get32(data + 1);
+  trace->storedUs = trace->captureUs + stored;
+  trace->notifyUs = trace->captureUs + notify;
+  return i;
+}
+
+ClockSync::ClockSync() : samples(0), lastRequestUs(0), nextSeq(0) {
+  memset(pendingUsed, 0, sizeof(pendingUsed));
+}
+
+uint16_t ClockSync::request(uint8_t* out, uint64_t hostUs){
+  // the oldest request gives way; its answer is most likely lost
+  uint8_t slot = nextSeq % SYNC_PENDING;
+  pendingSeq[slot] = nextSeq;
+  pendingUs[slot] = hostUs;
+  pendingUsed[slot] = true;
+  lastRequestUs = hostUs;
+
+  out[0] = SYNC_TAG;
+  out[1] = nextSeq++;
+  return SYNC_REQUEST_LEN;
+}
+
+/*--------------------------------------------------*/
+/*--                   answer()                   --*/
+/*--------------------------------------------------*/
+/*    t1 request written, t2 device got it, t3      */
+/*    device answered, t4 answer here:              */
+/*      offset = ((t1 - t2) + (t4 - t3)) / 2        */
+/*      round trip = (t4 - t1) - (t3 - t2)          */
+/*    The first answer fixes which 2^32 us span of  */
+/*    the device clock offset counts from.          */
+/*--------------------------------------------------*/
+bool ClockSync::answer(const uint8_t* data, uint16_t len, uint64_t hostUs){
+  if(len < SYNC_REPLY_LEN || data[0] != SYNC_TAG){
+    return false;
+  }
+
+  uint8_t slot = data[1] % SYNC_PENDING;
+  if(!pendingUsed[slot] || pendingSeq[slot] != data[1]){
+    return false;
+  }
+  pendingUsed[slot] = false;
+
+  uint64_t t1 = pendingUs[slot];
+  uint32_t rx = get32(data + 2);
+  uint32_t tx = get32(data + 6);
+  uint32_t held = tx - rx;
+  if(hostUs - t1 < held){
+    return false;
+  }
+
+  int64_t t2 = synced() ? (int64_t)toHost(rx, t1) - offsetUs() : (int64_t)rx;
+  int64_t t3 = t2 + held;
+
+  Sample sample;
+  sample.offsetUs = (((int64_t)t1 - t2) + ((int64_t)hostUs - t3)) / 2;
+  sample.roundTripUs = (uint32_t)(hostUs - t1 - held);
+  window[samples % SYNC_SAMPLES] = sample;
+  samples++;
+  return true;
+}
+
+const ClockSync::Sample& ClockSync::best(){
+  static const Sample none = {0, 0};
+  unsigned long filled = samples < SYNC_SAMPLES ? samples : SYNC_SAMPLES;
+  const Sample* found = &none;
+
+  for(unsigned long i = 0; i < filled; i++){
+    if(found == &none || window[i].roundTripUs < found->roundTripUs){
+      found = &window[i];
+    }
+  }
+  return *found;
+}
+
+uint64_t ClockSync::toHost(uint32_t deviceUs, uint64_t hostNearUs){
+  int64_t predicted = (int64_t)hostNearUs - offsetUs();
+  int32_t diff = (int32_t)(deviceUs - (uint32_t)predicted);
+  return (uint64_t)(predicted + diff + offsetUs());
+}
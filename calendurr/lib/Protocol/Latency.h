@@ -0,0 +1,177 @@
+#ifndef CALENDURR_LATENCY_H
+#define CALENDURR_LATENCY_H
+
+#include <stdint.h>
+
+/*--------------------------------------------------*/
+/*--        LATENCY TRACING (NOTE_LATENCY)        --*/
+/*--------------------------------------------------*/
+/*  Follows every point from the pad to the phone:  */
+/*    capture  micros() of the reading (point.us)   */
+/*    enqueue  stored in coordz, ready to send      */
+/*    notify   handed to dataCharacteristic.notify  */
+/*    receive  the phone got the notification       */
+/*                                                  */
+/*  The device side needs no per-point memory: a    */
+/*  point's capture time is the note start plus     */
+/*  the ticks of every point before it (PointClock  */
+/*  counts them without drifting), so each packet   */
+/*  only carries the capture time of its first      */
+/*  point, how long points waited to be stored and  */
+/*  when the packet was handed to notify():         */
+/*                                                  */
+/*    TRACED 'L' capture32 stored notify            */
+/*           (x16 y16 ticks)*                       */
+/*      stored - longest capture -> coordz of the   */
+/*               points in this send, us (varint)   */
+/*      notify - us after capture32 (varint)        */
+/*                                                  */
+/*  The two clocks are lined up NTP style: the      */
+/*  phone writes SYNC seq to the control            */
+/*  characteristic, the device answers on the data  */
+/*  characteristic with when it got it and when it  */
+/*  answered:                                       */
+/*                                                  */
+/*    SYNC 0x15 seq            (phone -> device)    */
+/*    SYNC 0x15 seq rx32 tx32  (device -> phone)    */
+/*                                                  */
+/*  The answer with the shortest round trip out of  */
+/*  the last SYNC_SAMPLES gives the offset; its     */
+/*  error is at most half that round trip. Drift    */
+/*  between syncs is not modelled (tens of ppm,     */
+/*  the phone syncs every LATENCY_SYNC_EVERY_MS).   */
+/*                                                  */
+/*  Needs the binary framing with timestamps and    */
+/*  not NOTE_RELIABLE; BluetoothPage.js does not    */
+/*  read TRACED packets, so it is a bench build.    */
+/*--------------------------------------------------*/
+
+#ifndef NOTE_LATENCY
+#define NOTE_LATENCY 0
+#endif
+
+#define TRACED_FRAME_TAG 'L'
+#define SYNC_TAG 0x15
+
+#define TRACED_HEADER_MAX 15    // tag + capture32 + two 5 byte varints
+#define SYNC_REQUEST_LEN 2
+#define SYNC_REPLY_LEN 10
+#define LATENCY_ANCHORS 4       // clamped gaps stored but not yet sent
+#define SYNC_SLOTS 4            // requests buffered between callback and loop
+#define SYNC_SAMPLES 8
+#define SYNC_PENDING 8          // requests the phone waits on at once
+#define LATENCY_SYNC_EVERY_MS 1000
+
+class NoteSender;
+
+/*------------------------------------------*/
+/*  LatencyTracer - device side. Follows    */
+/*  pointClock through the stored and the   */
+/*  sent points and answers SYNC requests.  */
+/*------------------------------------------*/
+class LatencyTracer {
+  public:
+    LatencyTracer();
+
+    // A note starts: with pointClock.start(), same time
+    void start(uint32_t nowUs);
+
+    // A point captured at captureUs, with these ticks, was stored at
+    // nowUs
+    void stored(uint32_t ticks, uint32_t captureUs, uint32_t nowUs);
+
+    // NoteSender::sendPoints(): a send starts, then per packet its
+    // header (the first point's ticks) and every point that went out
+    void batch();
+    uint8_t header(uint8_t* out, uint32_t firstTicks, uint32_t nowUs);
+    void sent(uint32_t ticks);
+
+    // Control characteristic write callback; safe from the BLE task
+    void post(const uint8_t* data, uint16_t len, uint32_t nowUs);
+
+    // Answers the SYNC requests posted so far; call from the loop
+    void service(NoteSender& sender, uint32_t nowUs);
+
+    unsigned long syncs;
+
+  private:
+    uint32_t captureOf(uint32_t ticks);
+
+    uint32_t sentUs;         // capture time of the last sent point
+    uint32_t storeLagUs;     // longest capture -> coordz since batch()
+    uint32_t batchLagUs;
+
+    // gaps clamped at POINT_TICKS_MAX start over at the capture time
+    uint32_t anchorUs[LATENCY_ANCHORS];
+    uint8_t anchorHead;
+    uint8_t anchorTail;
+
+    uint8_t syncSeq[SYNC_SLOTS];
+    uint32_t syncRxUs[SYNC_SLOTS];
+    volatile uint8_t syncHead;
+    volatile uint8_t syncTail;
+};
+
+/*------------------------------------------*/
+/*  Host side helpers.                      */
+/*------------------------------------------*/
+
+/*------------------------------------------*/
+/*  PacketTrace - header of a TRACED packet */
+/*  in device micros(), for its first point */
+/*------------------------------------------*/
+struct PacketTrace {
+  uint32_t captureUs;
+  uint32_t storedUs;       // capture + longest wait for coordz
+  uint32_t notifyUs;
+};
+
+// Reads the header of a TRACED packet; returns where its points start, 0
+// if it is not one
+uint16_t parseTrace(const uint8_t* data, uint16_t len, PacketTrace* trace);
+
+/*------------------------------------------*/
+/*  ClockSync - the phone's end of SYNC.    */
+/*  Device times are 32 bit micros() that   */
+/*  wrap every 71 minutes; toHost() unwraps */
+/*  them around the time they were seen.    */
+/*------------------------------------------*/
+class ClockSync {
+  public:
+    ClockSync();
+
+    // Builds the next SYNC write (SYNC_REQUEST_LEN bytes) sent at hostUs
+    uint16_t request(uint8_t* out, uint64_t hostUs);
+
+    // A SYNC answer received at hostUs; false if it answers nothing
+    // pending
+    bool answer(const uint8_t* data, uint16_t len, uint64_t hostUs);
+
+    bool synced(){ return samples > 0; }
+
+    // host - device of the best sample, and its round trip
+    int64_t offsetUs(){ return best().offsetUs; }
+    uint32_t roundTripUs(){ return best().roundTripUs; }
+
+    // Device micros() seen around hostNearUs, on the host clock
+    uint64_t toHost(uint32_t deviceUs, uint64_t hostNearUs);
+
+    unsigned long samples;
+    uint64_t lastRequestUs;
+
+  private:
+    struct Sample {
+      int64_t offsetUs;
+      uint32_t roundTripUs;
+    };
+
+    const Sample& best();
+
+    uint8_t nextSeq;
+    uint8_t pendingSeq[SYNC_PENDING];
+    uint64_t pendingUs[SYNC_PENDING];
+    bool pendingUsed[SYNC_PENDING];
+    Sample window[SYNC_SAMPLES];
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "PointStore.h"
+
+static void put16(uint8_t* out, uint16_t value){
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+}
+
+static uint16_t get16(const uint8_t* in){
+  return in[0] | (in[1] << 8);
+}
+
+// Ticks after a delta record are stored as the change from the ticks
+// before (zigzag, so small changes either way stay one byte); absolute
+// coordinates are zigzag coded too, an int16 fits the 16 bits
+static uint32_t zigzag(int32_t value){
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value){
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Sign extends a 4 bit nibble
+static int nibble(uint8_t value){
+  return (value & 0x08) ? (int)value - 16 : (int)value;
+}
+
+PointStore::PointStore(uint8_t* buffer, uint16_t size, bool timed)
+  : buffer(buffer), size(size), withTicks(timed), used(0), nibbles(0), points(0), lastX(0), lastY(0),
+    lastTicks(0), cursorIndex(0), cursorByte(0), cursorNibble(0), cursorPoint{0, 0, 0, false} {}
+
+// Nibbles a value takes at 3 bits each
+static uint8_t nibbleLength(uint32_t value){
+  uint8_t len = 1;
+  while(value >= 8){
+    value >>= 3;
+    len++;
+  }
+  return len;
+}
+
+uint8_t PointStore::getNibble(uint16_t at) const {
+  uint8_t pair = buffer[size - 1 - at / 2];
+  return (at & 1) ? pair >> 4 : pair & 0x0F;
+}
+
+void PointStore::putNibble(uint16_t at, uint8_t value){
+  uint8_t& pair = buffer[size - 1 - at / 2];
+  pair = (at & 1) ? (pair & 0x0F) | (value << 4) : (pair & 0xF0) | value;
+}
+
+/*--------------------------------------------------*/
+/*--                  append()                    --*/
+/*--------------------------------------------------*/
+/*    Picks the shortest record that holds the      */
+/*    step from the previous point. The records and */
+/*    the nibbles grow toward each other; the point */
+/*    fits if they do not meet.                     */
+/*--------------------------------------------------*/
+bool PointStore::append(int16_t x, int16_t y, bool strokeStart, uint32_t ticks){
+  int dx = (int)x - (int)lastX;
+  int dy = (int)y - (int)lastY;
+  bool absolute = points == 0 || strokeStart ||
+                  dx < -127 || dx > 127 || dy < -127 || dy > 127;
+  bool small = !absolute && dx >= -7 && dx <= 7 && dy >= -8 && dy <= 7;
+  uint8_t recordLen = absolute ? 5 : (small ? 1 : 3);
+
+  uint32_t tickValue = absolute ? ticks : zigzag((int32_t)(ticks - lastTicks));
+  uint8_t tickLen = withTicks && absolute ? varintLength(tickValue) : 0;
+  uint8_t tickNibbles = withTicks && !absolute ? nibbleLength(tickValue) : 0;
+
+  if(used + recordLen + tickLen + (nibbles + tickNibbles + 1) / 2 > size){
+    return false;
+  }
+
+  uint8_t* out = buffer + used;
+  if(absolute){
+    out[0] = strokeStart ? POINT_RECORD_STROKE : POINT_RECORD_ABSOLUTE;
+    put16(out + 1, zigzag(x));
+    put16(out + 3, zigzag(y));
+  }
+  else if(small){
+    out[0] = ((dx & 0x0F) << 4) | (dy & 0x0F);
+  }
+  else{
+    out[0] = POINT_RECORD_DELTA;
+    out[1] = (uint8_t)(int8_t)dx;
+    out[2] = (uint8_t)(int8_t)dy;
+  }
+  used += recordLen;
+
+  if(tickLen){
+    used += putVarint(buffer + used, tickValue);
+  }
+  for(uint8_t i = 0; i < tickNibbles; i++){
+    putNibble(nibbles++, (tickValue & 0x07) | (i + 1 < tickNibbles ? 0x08 : 0));
+    tickValue >>= 3;
+  }
+
+  lastX = x;
+  lastY = y;
+  lastTicks = ticks;
+  points++;
+  return true;
+}
+
+uint8_t PointStore::decode(uint16_t byte, uint16_t* nibbleAt, StoredPoint& point) const {
+  const uint8_t* in = buffer + byte;
+  bool absolute = in[0] == POINT_RECORD_ABSOLUTE || in[0] == POINT_RECORD_STROKE;
+  uint8_t len;
+
+  switch(in[0]){
+    case POINT_RECORD_DELTA:
+      point.x += (int8_t)in[1];
+      point.y += (int8_t)in[2];
+      point.strokeStart = false;
+      len = 3;
+      break;
+
+    case POINT_RECORD_ABSOLUTE:
+    case POINT_RECORD_STROKE:
+      point.x = unzigzag(get16(in + 1));
+      point.y = unzigzag(get16(in + 3));
+      point.strokeStart = in[0] == POINT_RECORD_STROKE;
+      len = 5;
+      break;
+
+    default:
+      point.x += nibble(in[0] >> 4);
+      point.y += nibble(in[0] & 0x0F);
+      point.strokeStart = false;
+      len = 1;
+      break;
+  }
+
+  if(withTicks && absolute){
+    uint32_t value = 0;
+    len += getVarint(in + len, used - byte - len, &value);
+    point.ticks = value;
+  }
+  else if(withTicks){
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    uint8_t part;
+    do{
+      part = getNibble((*nibbleAt)++);
+      value |= (uint32_t)(part & 0x07) << shift;
+      shift += 3;
+    } while((part & 0x08) && shift < 32);
+    point.ticks += unzigzag(value);
+  }
+  else{
+    point.ticks = 0;
+  }
+  return len;
+}
+
+/*--------------------------------------------------*/
+/*--                    at()                      --*/
+/*--------------------------------------------------*/
+/*    cursorPoint is point cursorIndex - 1,         */
+/*    cursorByte the record after it and            */
+/*    cursorNibble the tick nibble after it. Going  */
+/*    back means decoding from the start again.     */
+/*--------------------------------------------------*/
+StoredPoint PointStore::at(uint16_t index) const {
+  if(index >= points){
+    return StoredPoint{0, 0, 0, false};
+  }
+  if(index + 1 < cursorIndex){
+    cursorIndex = 0;
+    cursorByte = 0;
+    cursorNibble = 0;
+  }
+
+  while(cursorIndex <= index){
+    cursorByte += decode(cursorByte, &cursorNibble, cursorPoint);
+    cursorIndex++;
+  }
+  return cursorPoint;
+}
+
+void PointStore::clear(){
+  used = 0;
+  nibbles = 0;
+  points = 0;
+  lastX = 0;
+  lastY = 0;
+  lastTicks = 0;
+  cursorIndex = 0;
+  cursorByte = 0;
+  cursorNibble = 0;
+}
+
+/*--------------------------------------------------*/
+/*--                 truncate()                   --*/
+/*--------------------------------------------------*/
+/*    at() leaves cursorByte and cursorNibble right */
+/*    after the new last point, which is where      */
+/*    append() goes on.                             */
+/*--------------------------------------------------*/
+void PointStore::truncate(uint16_t count){
+  if(count >= points){
+    return;
+  }
+  if(count == 0){
+    clear();
+    return;
+  }
+
+  StoredPoint last = at(count - 1);
+  used = cursorByte;
+  nibbles = cursorNibble;
+  points = count;
+  lastX = last.x;
+  lastY = last.y;
+  lastTicks = last.ticks;
+}
+
+PointStore::Iterator::Iterator(const PointStore* store, uint16_t index)
+  : store(store), index(index), byte(0), nibble(0), point{0, 0, 0, false} {
+  if(index == 0 && store->points > 0){
+    byte = store->decode(0, &nibble, point);
+  }
+}
+
+PointStore::Iterator& PointStore::Iterator::operator++(){
+  index++;
+  if(index < store->points){
+    byte += store->decode(byte, &nibble, point);
+  }
+  return *this;
+}
@@ -0,0 +1,132 @@
+#ifndef CALENDURR_POINT_STORE_H
+#define CALENDURR_POINT_STORE_H
+
+#include <stdint.h>
+
+#include "PointTimes.h"
+
+/*--------------------------------------------------*/
+/*--          PACKED POINT STORE (coordz)         --*/
+/*--------------------------------------------------*/
+/*  The points of a note as deltas from the point   */
+/*  before, in a caller supplied byte buffer.       */
+/*  Consecutive pen samples (or resampled points)   */
+/*  are a few pad units apart, so nearly every      */
+/*  point is one byte (under two with its ticks)    */
+/*  instead of the 8 of an unsigned int pair.       */
+/*                                                  */
+/*  Records:                                        */
+/*    dx:4 dy:4        short delta, dx -7..7,       */
+/*                     dy -8..7 (dx -8 is never     */
+/*                     used, it marks the others)   */
+/*    0x80 dx8 dy8     delta up to +-127            */
+/*    0x81 x16 y16     absolute point               */
+/*    0x82 x16 y16     absolute, starts a stroke    */
+/*  Points are signed (the pad reads past its       */
+/*  calibrated edge); absolute x and y are zigzag   */
+/*  coded, so -1 is 1 and 1 is 2.                   */
+/*  The first point after clear() and every stroke  */
+/*  start are absolute, so a stroke can be decoded  */
+/*  on its own.                                     */
+/*                                                  */
+/*  In a timed store an absolute record is followed */
+/*  by its ticks as a varint. A delta record's      */
+/*  ticks are the (zigzag) change from the ticks    */
+/*  before, which stays small while the pen moves   */
+/*  steadily, as a varint of nibbles: 3 bits each,  */
+/*  low first, bit 3 set if another follows. The    */
+/*  nibbles fill the buffer from the end down (the  */
+/*  n-th in byte size-1-n/2, the low half for even  */
+/*  n), so a change of -4..3 costs half a byte and  */
+/*  -32..31 one.                                    */
+/*--------------------------------------------------*/
+
+#define POINT_RECORD_DELTA 0x80
+#define POINT_RECORD_ABSOLUTE 0x81
+#define POINT_RECORD_STROKE 0x82
+#define POINT_RECORD_MAX (5 + VARINT_MAX_LEN)   // a delta and 11 nibbles is less
+
+/*------------------------------------------*/
+/*  StoredPoint - one point read back       */
+/*  ticks - since the point before (0 in an */
+/*            untimed store)                */
+/*  strokeStart - first point of a stroke   */
+/*------------------------------------------*/
+struct StoredPoint {
+  int16_t x;
+  int16_t y;
+  uint32_t ticks;
+  bool strokeStart;
+};
+
+class PointStore {
+  public:
+    PointStore(uint8_t* buffer, uint16_t size, bool timed = NOTE_TIMESTAMPS);
+
+    // false (nothing stored) if the buffer is full
+    bool append(int16_t x, int16_t y, bool strokeStart = false, uint32_t ticks = 0);
+
+    // Random access; it remembers where it stopped, so reading forward
+    // is as cheap as iterating
+    StoredPoint at(uint16_t index) const;
+    void clear();
+
+    // Drops the points from index count on, as if they were never appended
+    void truncate(uint16_t count);
+
+    // Any point fits in what is left
+    bool room() const { return used + (nibbles + 1) / 2 + POINT_RECORD_MAX <= size; }
+
+    uint16_t count() const { return points; }
+    uint16_t bytes() const { return used + (nibbles + 1) / 2; }
+    uint16_t capacity() const { return size; }
+    bool timed() const { return withTicks; }
+
+    /*------------------------------------------*/
+    /*  Iterator - forward walk over the store  */
+    /*    for(StoredPoint p : store) ...        */
+    /*------------------------------------------*/
+    class Iterator {
+      public:
+        Iterator(const PointStore* store, uint16_t index);
+
+        const StoredPoint& operator*() const { return point; }
+        const StoredPoint* operator->() const { return &point; }
+        Iterator& operator++();
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+
+      private:
+        const PointStore* store;
+        uint16_t index;
+        uint16_t byte;
+        uint16_t nibble;
+        StoredPoint point;
+    };
+
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, points); }
+
+  private:
+    // Reads the record at byte into point (which holds the point before)
+    // and its tick nibbles from *nibbleAt on; returns the record's length
+    // and moves *nibbleAt past them
+    uint8_t decode(uint16_t byte, uint16_t* nibbleAt, StoredPoint& point) const;
+
+    uint8_t getNibble(uint16_t at) const;
+    void putNibble(uint16_t at, uint8_t value);
+
+    uint8_t* buffer;
+    uint16_t size;
+    bool withTicks;
+    uint16_t used;
+    uint16_t nibbles;        // tick nibbles at the end of the buffer
+    uint16_t points;
+    int16_t lastX, lastY;
+    uint32_t lastTicks;
+    mutable uint16_t cursorIndex;
+    mutable uint16_t cursorByte;
+    mutable uint16_t cursorNibble;
+    mutable StoredPoint cursorPoint;
+};
+
+#endif
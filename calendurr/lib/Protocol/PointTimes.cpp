@@ -0,0 +1,32 @@
+#include "PointTimes.h"
+
+uint8_t putVarint(uint8_t* out, uint32_t value){
+  uint8_t len = 0;
+  while(value >= 0x80){
+    out[len++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[len++] = value;
+  return len;
+}
+
+uint8_t getVarint(const uint8_t* in, uint16_t len, uint32_t* value){
+  uint32_t result = 0;
+  for(uint8_t i = 0; i < len && i < VARINT_MAX_LEN; i++){
+    result |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+    if(!(in[i] & 0x80)){
+      *value = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+uint8_t varintLength(uint32_t value){
+  uint8_t len = 1;
+  while(value >= 0x80){
+    value >>= 7;
+    len++;
+  }
+  return len;
+}
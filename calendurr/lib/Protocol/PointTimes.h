@@ -0,0 +1,73 @@
+#ifndef CALENDURR_POINT_TIMES_H
+#define CALENDURR_POINT_TIMES_H
+
+#include <stdint.h>
+
+/*--------------------------------------------------*/
+/*--          PER-POINT TIMESTAMPS                --*/
+/*--------------------------------------------------*/
+/*  Every stored point gets the time since the      */
+/*  previous one (or since the note started, for    */
+/*  the first) in ticks of POINT_TICK_US. A sample  */
+/*  every 2-3 ms is 8-12 ticks. The PointStore      */
+/*  keeps the change from one point to the next in  */
+/*  a varint of 3 bit nibbles, so the ticks cost    */
+/*  under a byte a point even where the resampler   */
+/*  spaces the points by distance, not time.        */
+/*                                                  */
+/*  On the wire (NOTE_TIMESTAMPS), as they are:     */
+/*    text   "C:x,y,ticks" (";" between points in   */
+/*           the packed framing)                    */
+/*    binary 'b' then x16 y16 varint per point      */
+/*--------------------------------------------------*/
+
+#ifndef NOTE_TIMESTAMPS
+#define NOTE_TIMESTAMPS 1
+#endif
+
+#ifndef POINT_TICK_US
+#define POINT_TICK_US 256
+#endif
+
+// Longer gaps (about 9 minutes at 256 us) are stored as this; it keeps a
+// varint at 3 bytes. A text frame whose ticks do not fit the notify
+// sends the largest number that does (textPoint() in Protocol.cpp)
+#define POINT_TICKS_MAX 0x1FFFFF
+
+#define VARINT_MAX_LEN 5
+
+// Writes value as a LEB128 varint; returns its length
+uint8_t putVarint(uint8_t* out, uint32_t value);
+
+// Reads a varint from at most len bytes; returns its length, 0 if cut off
+uint8_t getVarint(const uint8_t* in, uint16_t len, uint32_t* value);
+
+uint8_t varintLength(uint32_t value);
+
+/*------------------------------------------*/
+/*  PointClock - turns micros() into ticks  */
+/*  without drifting: the remainder of each */
+/*  interval counts toward the next one.    */
+/*------------------------------------------*/
+class PointClock {
+  public:
+    PointClock() : lastUs(0) {}
+
+    // Starts the note; the first point counts from here
+    void start(uint32_t nowUs){ lastUs = nowUs; }
+
+    uint32_t ticks(uint32_t nowUs){
+      uint32_t elapsed = (nowUs - lastUs) / POINT_TICK_US;
+      if(elapsed > POINT_TICKS_MAX){
+        lastUs = nowUs;
+        return POINT_TICKS_MAX;
+      }
+      lastUs += elapsed * POINT_TICK_US;
+      return elapsed;
+    }
+
+  private:
+    uint32_t lastUs;
+};
+
+#endif
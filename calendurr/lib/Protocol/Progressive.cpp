@@ -0,0 +1,111 @@
+#include "Progressive.h"
+
+#include "Protocol.h"
+
+/*--------------------------------------------------*/
+/*--             sendProgressive()                --*/
+/*--------------------------------------------------*/
+/*    The preview pass, then the refinement pass,   */
+/*    each packed into frames up to the ATT         */
+/*    payload. Both walk the store forward with     */
+/*    one point of lookahead (a stroke ends where   */
+/*    the next one starts), so at() stays cheap.    */
+/*--------------------------------------------------*/
+void NoteSender::sendProgressive(const PointStore& points){
+  uint8_t buffer[NOTE_MAX_PAYLOAD];
+  uint16_t size = payload();
+  bool timed = points.timed();
+  uint16_t count = points.count();
+
+  for(uint8_t pass = 0; pass < 2; pass++){
+    bool refine = pass == 1;
+    uint16_t len = 0;
+    uint16_t previous = 0;
+    uint16_t inStroke = 0;
+    StoredPoint point = points.at(0);
+
+    for(uint16_t i = 0; i < count; i++){
+      StoredPoint next = points.at(i + 1);
+      if(point.strokeStart){
+        inStroke = 0;
+      }
+      bool preview = previewPoint(inStroke++, i + 1 == count || next.strokeStart);
+
+      if(preview != refine){
+        uint16_t index = noteOffset + i;
+        uint32_t step = ((uint32_t)(uint16_t)(index - previous) << 1) | (point.strokeStart ? 1 : 0);
+        if(len > 0 && len + varintLength(step) + 4 + (timed ? varintLength(point.ticks) : 0) > size){
+          sendPacket(buffer, len);
+          len = 0;
+        }
+        if(len == 0){
+          buffer[len++] = PROGRESSIVE_TAG;
+          buffer[len++] = (timed ? PROGRESSIVE_TIMED : 0) | (refine ? PROGRESSIVE_REFINE : 0);
+          buffer[len++] = index & 0xFF;
+          buffer[len++] = index >> 8;
+          step &= 1;
+        }
+
+        len += putVarint(buffer + len, step);
+        buffer[len++] = point.x & 0xFF;
+        buffer[len++] = point.x >> 8;
+        buffer[len++] = point.y & 0xFF;
+        buffer[len++] = point.y >> 8;
+        if(timed){
+          len += putVarint(buffer + len, point.ticks);
+        }
+        previous = index;
+      }
+
+      point = next;
+    }
+
+    if(len > 0){
+      sendPacket(buffer, len);
+    }
+  }
+}
+
+/*--------------------------------------------------*/
+/*--             parseProgressive()               --*/
+/*--------------------------------------------------*/
+int parseProgressive(const uint8_t* data, uint16_t len, ProgressivePoint* out, int maxPoints, bool* refine){
+  if(len < PROGRESSIVE_HEADER || data[0] != PROGRESSIVE_TAG){
+    return 0;
+  }
+
+  bool timed = data[1] & PROGRESSIVE_TIMED;
+  if(refine){
+    *refine = data[1] & PROGRESSIVE_REFINE;
+  }
+
+  uint16_t index = data[2] | (data[3] << 8);
+  uint16_t i = PROGRESSIVE_HEADER;
+  int count = 0;
+  while(i < len && count < maxPoints){
+    uint32_t step = 0, t = 0;
+    uint8_t n = getVarint(data + i, len - i, &step);
+    if(n == 0 || i + n + 4 > len){
+      return count;
+    }
+    i += n;
+
+    index += step >> 1;
+    out[count].index = index;
+    out[count].strokeStart = step & 1;
+    out[count].x = (int16_t)(data[i] | (data[i + 1] << 8));
+    out[count].y = (int16_t)(data[i + 2] | (data[i + 3] << 8));
+    i += 4;
+    if(timed){
+      n = getVarint(data + i, len - i, &t);
+      if(n == 0){
+        return count;
+      }
+      i += n;
+    }
+    out[count].ticks = t;
+    count++;
+  }
+
+  return count;
+}
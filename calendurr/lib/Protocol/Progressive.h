@@ -0,0 +1,86 @@
+#ifndef CALENDURR_PROGRESSIVE_H
+#define CALENDURR_PROGRESSIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "PointTimes.h"
+
+/*--------------------------------------------------*/
+/*--     PROGRESSIVE NOTES (NOTE_PROGRESSIVE)     --*/
+/*--------------------------------------------------*/
+/*  A send goes out in two passes over coordz: the  */
+/*  PREVIEW of every stroke first (its first and    */
+/*  last point and every PROGRESSIVE_STRIDE-th one  */
+/*  in between), then the points it left out. The   */
+/*  phone can draw the note, and start reading it,  */
+/*  once the first pass is in, about 1/STRIDE of    */
+/*  the bytes; the second only adds detail.         */
+/*                                                  */
+/*  Every point carries its place in the note, so   */
+/*  the two passes merge back in order:             */
+/*                                                  */
+/*    PROGRESSIVE 0x16 flags base16                 */
+/*                (step x16 y16 [ticks])*           */
+/*      flags - bit 0 timed, bit 1 refinement pass  */
+/*      step - varint, (index - index of the point  */
+/*             before, base for the first) << 1,    */
+/*             bit 0 set on a stroke start          */
+/*      ticks - as stored: since the point before   */
+/*             it in the note, not in the frame     */
+/*                                                  */
+/*  Indexes count points from START over all the    */
+/*  sends of the note. Stroke starts are always in  */
+/*  the preview, so a pen lift never has to be      */
+/*  guessed from the gap between decimated points.  */
+/*                                                  */
+/*  The firmware holds the points until SEND (or a  */
+/*  full coordz), so the preview covers the note.   */
+/*  Needs the binary framing; BluetoothPage.js does */
+/*  not read PROGRESSIVE frames yet.                */
+/*--------------------------------------------------*/
+
+#ifndef NOTE_PROGRESSIVE
+#define NOTE_PROGRESSIVE 0
+#endif
+
+#ifndef PROGRESSIVE_STRIDE
+#define PROGRESSIVE_STRIDE 8
+#endif
+
+#define PROGRESSIVE_TAG 0x16
+#define PROGRESSIVE_TIMED 0x01
+#define PROGRESSIVE_REFINE 0x02
+
+#define PROGRESSIVE_HEADER 4
+#define PROGRESSIVE_RECORD_MAX (3 + 4 + VARINT_MAX_LEN)
+
+// Whether a point belongs to the preview: inStroke points after its stroke
+// started, last if it ends the stroke (or the send)
+inline bool previewPoint(uint16_t inStroke, bool last, uint16_t stride = PROGRESSIVE_STRIDE){
+  return inStroke == 0 || last || inStroke % stride == 0;
+}
+
+/*------------------------------------------*/
+/*  Host side helpers.                      */
+/*------------------------------------------*/
+
+/*------------------------------------------*/
+/*  ProgressivePoint - one point of a       */
+/*  PROGRESSIVE frame                       */
+/*  index - place in the note               */
+/*------------------------------------------*/
+struct ProgressivePoint {
+  uint16_t index;
+  int x;
+  int y;
+  uint32_t ticks;
+  bool strokeStart;
+};
+
+// Decodes a PROGRESSIVE frame; returns how many points were written, 0 if
+// it is not one. refine (optional) tells which pass it belongs to
+int parseProgressive(const uint8_t* data, uint16_t len, ProgressivePoint* out, int maxPoints,
+                     bool* refine = NULL);
+
+#endif
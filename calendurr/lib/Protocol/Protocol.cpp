@@ -0,0 +1,376 @@
+#include "Protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+NoteSender::NoteSender(NoteLink& link, uint8_t framing)
+  : framing(framing), counter(0), packets(0), bytes(0), failures(0), tracer(NULL),
+    progressive(NOTE_PROGRESSIVE), noteOffset(0), link(link) {}
+
+/*--------------------------------------------------*/
+/*--                  payload()                   --*/
+/*--------------------------------------------------*/
+/*    Usable bytes per notify, clamped to what the  */
+/*    characteristic was configured for.            */
+/*--------------------------------------------------*/
+uint16_t NoteSender::payload(){
+  uint16_t size = link.payloadSize();
+
+  if(size > NOTE_MAX_PAYLOAD){
+    size = NOTE_MAX_PAYLOAD;
+  }
+  else if(size < NOTE_MIN_PAYLOAD){
+    size = NOTE_MIN_PAYLOAD;
+  }
+
+  return size;
+}
+
+/*--------------------------------------------------*/
+/*--                sendPacket()                  --*/
+/*--------------------------------------------------*/
+bool NoteSender::sendPacket(const uint8_t* data, uint16_t len){
+  if(link.notify(data, len)){
+    packets++;
+    bytes += len;
+    return true;
+  }
+
+  failures++;
+  return false;
+}
+
+bool NoteSender::sendMessage(const char* msg){
+  return sendPacket((const uint8_t*)msg, strlen(msg));
+}
+
+/*--------------------------------------------------*/
+/*--          Control messages (START, ...)       --*/
+/*--------------------------------------------------*/
+/*    Each one carries the running counter so the   */
+/*    host never sees two identical values in a row */
+/*--------------------------------------------------*/
+void NoteSender::sendControl(const char* tag){
+  char msg[20];
+  snprintf(msg, sizeof(msg), "%s-%lu", tag, counter++);
+  sendMessage(msg);
+}
+
+void NoteSender::sendStart(){
+  noteOffset = 0;
+  sendControl("START");
+}
+
+void NoteSender::sendStop(){
+  sendControl("STOP");
+  link.pause(CONTROL_GAP_MS);
+}
+
+void NoteSender::sendDate(int month, int day){
+  char msg[24];
+  snprintf(msg, sizeof(msg), "DATE-%lu:%d,%d", counter++, month, day);
+  sendMessage(msg);
+  link.pause(CONTROL_GAP_MS);
+}
+
+void NoteSender::sendTime(int hour, int minute){
+  char msg[24];
+  snprintf(msg, sizeof(msg), "TIME-%lu:%d,%d", counter++, hour, minute);
+  sendMessage(msg);
+  link.pause(CONTROL_GAP_MS);
+}
+
+void NoteSender::sendEnd(){
+  sendControl("END");
+  link.pause(CONTROL_GAP_MS);
+}
+
+/*--------------------------------------------------*/
+/*--                 textPoint()                  --*/
+/*--------------------------------------------------*/
+/*    One point in a text framing, ",ticks" after   */
+/*    it if timed, in at most room bytes. Ticks     */
+/*    with more digits than fit are cut to the      */
+/*    largest number that does (a long gap, as      */
+/*    POINT_TICKS_MAX is in the store); with no     */
+/*    room for a digit they are left out.           */
+/*--------------------------------------------------*/
+static int textPoint(char* out, int room, const char* format, const StoredPoint& point, bool timed){
+  char text[32];
+  int n = snprintf(text, sizeof(text), format, point.x, point.y);
+  int digits = room - n - 1;
+
+  if(timed && digits > 0){
+    unsigned long most = 9;
+    for(int d = 1; d < digits && most < point.ticks; d++){
+      most = most * 10 + 9;
+    }
+    n += snprintf(text + n, sizeof(text) - n, ",%lu", point.ticks < most ? (unsigned long)point.ticks : most);
+  }
+
+  memcpy(out, text, n);
+  return n;
+}
+
+/*--------------------------------------------------*/
+/*--                sendPoints()                  --*/
+/*--------------------------------------------------*/
+/*    Sends every stored point using the selected   */
+/*    framing. Packed modes fill each notify up to  */
+/*    the current ATT payload. A timed store sends  */
+/*    every point with its ticks (PointTimes.h),    */
+/*    behind a trace header if a tracer is set.     */
+/*    Progressive sends have their own frames       */
+/*    (Progressive.cpp).                            */
+/*--------------------------------------------------*/
+void NoteSender::sendPoints(const PointStore& points){
+  uint8_t buffer[NOTE_MAX_PAYLOAD];
+  uint16_t size = payload();
+  bool timed = points.timed();
+  int count = points.count();
+  int i = 0;
+  bool traced = tracer && timed;
+
+  if(progressive && framing == FRAMING_BINARY){
+    sendProgressive(points);
+    noteOffset += count;
+    return;
+  }
+
+  if(traced){
+    tracer->batch();
+  }
+
+  while(i < count){
+    uint16_t len = 0;
+
+    if(framing == FRAMING_BINARY){
+      if(traced){
+        len = tracer->header(buffer, points.at(i).ticks, link.clockUs());
+      }
+      else{
+        buffer[len++] = timed ? BINARY_TIMED_TAG : BINARY_FRAME_TAG;
+      }
+      while(i < count){
+        StoredPoint point = points.at(i);
+        if(len + 4 + (timed ? varintLength(point.ticks) : 0) > size){
+          break;
+        }
+        if(traced){
+          tracer->sent(point.ticks);
+        }
+        buffer[len++] = point.x & 0xFF;
+        buffer[len++] = point.x >> 8;
+        buffer[len++] = point.y & 0xFF;
+        buffer[len++] = point.y >> 8;
+        if(timed){
+          len += putVarint(buffer + len, point.ticks);
+        }
+        i++;
+      }
+    }
+    else if(framing == FRAMING_TEXT_PACKED){
+      buffer[len++] = 'C';
+      buffer[len++] = ':';
+      while(i < count){
+        char coord[28];
+        StoredPoint point = points.at(i);
+        const char* format = (len > 2) ? ";%d,%d" : "%d,%d";
+        int n = textPoint(coord, sizeof(coord), format, point, timed);
+        if(len + n > size && len == 2){
+          n = textPoint(coord, size - len, format, point, timed);   // alone it has to fit
+        }
+        if(len + n > size){
+          break;
+        }
+        memcpy(buffer + len, coord, n);
+        len += n;
+        i++;
+      }
+    }
+    else{
+      len = textPoint((char*)buffer, size, "C:%d,%d", points.at(i), timed);
+      i++;
+    }
+
+    sendPacket(buffer, len);
+  }
+  noteOffset += count;
+}
+
+/*--------------------------------------------------*/
+/*--              parseControl()                  --*/
+/*--------------------------------------------------*/
+/*    Mirrors the checks BluetoothPage.js makes on  */
+/*    every received value.                         */
+/*--------------------------------------------------*/
+MessageType parseControl(const uint8_t* data, uint16_t len, unsigned long* counter){
+  static const struct { const char* tag; MessageType type; } tags[] = {
+    {"START-", MSG_START}, {"STOP-", MSG_STOP}, {"DATE-", MSG_DATE}, {"END-", MSG_END},
+    {"TIME-", MSG_TIME}
+  };
+
+  if(len == 0){
+    return MSG_UNKNOWN;
+  }
+  if(data[0] == BINARY_FRAME_TAG || data[0] == BINARY_TIMED_TAG || data[0] == TRACED_FRAME_TAG ||
+     data[0] == PROGRESSIVE_TAG || (len > 2 && data[0] == 'C' && data[1] == ':')){
+    return MSG_POINTS;
+  }
+  if(data[0] == SYNC_TAG){
+    return MSG_SYNC;
+  }
+
+  char text[NOTE_MAX_PAYLOAD + 1];
+  if(len > NOTE_MAX_PAYLOAD){
+    len = NOTE_MAX_PAYLOAD;
+  }
+  memcpy(text, data, len);
+  text[len] = 0;
+
+  for(unsigned int t = 0; t < sizeof(tags) / sizeof(tags[0]); t++){
+    size_t tagLen = strlen(tags[t].tag);
+    if(strncmp(text, tags[t].tag, tagLen) == 0){
+      if(counter){
+        *counter = strtoul(text + tagLen, NULL, 10);
+      }
+      return tags[t].type;
+    }
+  }
+
+  return MSG_UNKNOWN;
+}
+
+/*--------------------------------------------------*/
+/*--               parsePoints()                  --*/
+/*--------------------------------------------------*/
+int parsePoints(const uint8_t* data, uint16_t len, int (*points)[2], int maxPoints, uint32_t* ticks){
+  int count = 0;
+
+  // out of order: parseProgressive() places them
+  if(len > 0 && data[0] == PROGRESSIVE_TAG){
+    return 0;
+  }
+
+  if(len > 0 && (data[0] == BINARY_FRAME_TAG || data[0] == BINARY_TIMED_TAG || data[0] == TRACED_FRAME_TAG)){
+    bool timed = data[0] != BINARY_FRAME_TAG;
+    uint16_t i = 1;
+    if(data[0] == TRACED_FRAME_TAG){
+      PacketTrace trace;
+      i = parseTrace(data, len, &trace);
+      if(i == 0){
+        return 0;
+      }
+    }
+    while(i + 4 <= len && count < maxPoints){
+      uint32_t t = 0;
+      points[count][0] = (int16_t)(data[i] | (data[i + 1] << 8));
+      points[count][1] = (int16_t)(data[i + 2] | (data[i + 3] << 8));
+      i += 4;
+      if(timed){
+        uint8_t n = getVarint(data + i, len - i, &t);
+        if(n == 0){
+          return count;
+        }
+        i += n;
+      }
+      if(ticks){
+        ticks[count] = t;
+      }
+      count++;
+    }
+    return count;
+  }
+
+  // text framings: "C:x,y" or "C:x,y;x,y;..."; a point past the
+  // calibrated edge is negative
+  uint16_t i = 2;
+  while(i < len && count < maxPoints){
+    int value[2] = {0, 0};
+    for(int axis = 0; axis < 2; axis++){
+      bool digits = false;
+      bool negative = i < len && data[i] == '-';
+      if(negative){
+        i++;
+      }
+      while(i < len && data[i] >= '0' && data[i] <= '9'){
+        value[axis] = value[axis] * 10 + (data[i] - '0');
+        digits = true;
+        i++;
+      }
+      if(!digits){
+        return count;
+      }
+      if(negative){
+        value[axis] = -value[axis];
+      }
+      if(axis == 0){
+        if(i >= len || data[i] != ','){
+          return count;
+        }
+        i++;
+      }
+    }
+
+    points[count][0] = value[0];
+    points[count][1] = value[1];
+
+    // optional ",ticks", then skip anything else up to the next ';'
+    uint32_t t = 0;
+    if(i < len && data[i] == ','){
+      for(i++; i < len && data[i] >= '0' && data[i] <= '9'; i++){
+        t = t * 10 + (data[i] - '0');
+      }
+    }
+    if(ticks){
+      ticks[count] = t;
+    }
+    count++;
+
+    while(i < len && data[i] != ';'){
+      i++;
+    }
+    i++;
+  }
+
+  return count;
+}
+
+/*--------------------------------------------------*/
+/*--          PointDecoder::decode()              --*/
+/*--------------------------------------------------*/
+int PointDecoder::decode(const uint8_t* data, uint16_t len, TimedPoint* out, int maxPoints){
+  int points[NOTE_MAX_PAYLOAD / 4][2];
+  uint32_t ticks[NOTE_MAX_PAYLOAD / 4];
+
+  if(maxPoints > NOTE_MAX_PAYLOAD / 4){
+    maxPoints = NOTE_MAX_PAYLOAD / 4;
+  }
+  int count = parsePoints(data, len, points, maxPoints, ticks);
+
+  for(int i = 0; i < count; i++){
+    us += (uint64_t)ticks[i] * POINT_TICK_US;
+    out[i].x = points[i][0];
+    out[i].y = points[i][1];
+    out[i].ticks = ticks[i];
+    out[i].us = us;
+  }
+
+  return count;
+}
+
+/*--------------------------------------------------*/
+/*--                parseDate()                   --*/
+/*--------------------------------------------------*/
+bool parseDate(const uint8_t* data, uint16_t len, int* month, int* day){
+  char text[NOTE_MAX_PAYLOAD + 1];
+  if(len > NOTE_MAX_PAYLOAD){
+    len = NOTE_MAX_PAYLOAD;
+  }
+  memcpy(text, data, len);
+  text[len] = 0;
+
+  const char* colon = strchr(text, ':');
+  return colon && sscanf(colon + 1, "%d,%d", month, day) == 2;
+}
@@ -0,0 +1,183 @@
+#ifndef CALENDURR_PROTOCOL_H
+#define CALENDURR_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Latency.h"
+#include "PointStore.h"
+#include "Progressive.h"
+#include "PointTimes.h"
+
+/*--------------------------------------------------*/
+/*--          NOTE PROTOCOL (wire format)         --*/
+/*--------------------------------------------------*/
+/*  Everything that goes out over the calendar      */
+/*  data characteristic is built here, so the same  */
+/*  code runs on the board and in the native (host) */
+/*  simulator.                                      */
+/*                                                  */
+/*  A note on the wire looks like:                  */
+/*    START-n                                       */
+/*    <coordinate packets>                          */
+/*    STOP-n                                        */
+/*    DATE-n:month,day                              */
+/*    TIME-n:hour,minute  (only if one was read)    */
+/*    END-n                                         */
+/*    START-n   (opens the next note)               */
+/*--------------------------------------------------*/
+
+/*------------------------------------------*/
+/*  Framing modes for coordinate packets:   */
+/*  FRAMING_TEXT - one "C:x,y" per notify,  */
+/*            what BluetoothPage.js parses  */
+/*  FRAMING_TEXT_PACKED - "C:x,y;x,y;..."   */
+/*            filled up to the ATT payload  */
+/*  FRAMING_BINARY - 'B' followed by        */
+/*            little-endian int16 x,y pairs */
+/*            ('b' with a ticks varint      */
+/*            after each pair; TRACED 'L'   */
+/*            with NOTE_LATENCY, Latency.h) */
+/*            or PROGRESSIVE 0x16 frames    */
+/*            (Progressive.h)               */
+/*------------------------------------------*/
+#define FRAMING_TEXT 0
+#define FRAMING_TEXT_PACKED 1
+#define FRAMING_BINARY 2
+
+#ifndef NOTE_FRAMING
+#define NOTE_FRAMING FRAMING_TEXT
+#endif
+
+#define BINARY_FRAME_TAG 'B'
+#define BINARY_TIMED_TAG 'b'
+
+// Largest notify payload we ever build (MTU 247 - 3 byte ATT header)
+#define NOTE_MAX_PAYLOAD 244
+// Payload available before the MTU exchange (default MTU 23 - 3)
+#define NOTE_MIN_PAYLOAD 20
+
+// Gap left between control messages so they are not coalesced by the host
+#define CONTROL_GAP_MS 5
+
+/*------------------------------------------*/
+/*  NoteLink - whatever carries notifies.   */
+/*  payloadSize - usable bytes per notify   */
+/*  notify - queue one packet, false if it  */
+/*            was not accepted              */
+/*  pause - wait (delay() on the board)     */
+/*  now - milliseconds (millis())           */
+/*  clockUs - microseconds (micros()), for  */
+/*            latency tracing               */
+/*  notifyStatus - a note marker on the     */
+/*            status characteristic         */
+/*            (NOTE_CHANNELS, Channels.h)   */
+/*  connected - a central is connected      */
+/*------------------------------------------*/
+class NoteLink {
+  public:
+    virtual uint16_t payloadSize() = 0;
+    virtual bool notify(const uint8_t* data, uint16_t len) = 0;
+    virtual void pause(uint32_t ms) = 0;
+    virtual uint32_t now() = 0;
+    virtual uint32_t clockUs(){ return now() * 1000; }
+    virtual bool notifyStatus(const uint8_t* data, uint16_t len){ return notify(data, len); }
+    virtual bool connected() = 0;
+};
+
+/*------------------------------------------*/
+/*  NoteSender - builds and sends the note  */
+/*  messages over a NoteLink.               */
+/*  counter - makes every control message   */
+/*            unique (was messageCounter)   */
+/*  packets/bytes - totals that were sent   */
+/*  failures - notifies the link refused    */
+/*  tracer - set: binary timed points go    */
+/*            out as TRACED packets         */
+/*  progressive - binary points go out as a */
+/*            preview and its refinement    */
+/*  noteOffset - points of the note sent    */
+/*            since START                   */
+/*------------------------------------------*/
+class NoteSender {
+  public:
+    NoteSender(NoteLink& link, uint8_t framing = NOTE_FRAMING);
+
+    void sendStart();
+    void sendStop();
+    void sendDate(int month, int day);
+    void sendTime(int hour, int minute);
+    void sendEnd();
+    void sendPoints(const PointStore& points);
+
+    bool sendMessage(const char* msg);
+    bool sendPacket(const uint8_t* data, uint16_t len);
+
+    uint8_t framing;
+    unsigned long counter;
+    unsigned long packets;
+    unsigned long bytes;
+    unsigned long failures;
+    LatencyTracer* tracer;
+    bool progressive;
+    uint16_t noteOffset;
+
+  private:
+    void sendControl(const char* tag);
+    void sendProgressive(const PointStore& points);
+    uint16_t payload();
+
+    NoteLink& link;
+};
+
+/*------------------------------------------*/
+/*  Packet parsing helpers (host side).     */
+/*------------------------------------------*/
+enum MessageType {
+  MSG_UNKNOWN,
+  MSG_START,
+  MSG_STOP,
+  MSG_DATE,
+  MSG_END,
+  MSG_POINTS,
+  MSG_TIME,
+  MSG_SYNC
+};
+
+// Returns the message type and, for control messages, its counter
+MessageType parseControl(const uint8_t* data, uint16_t len, unsigned long* counter);
+
+// Decodes up to maxPoints coordinates from a point packet; returns how many.
+// ticks (optional) gets each point's ticks, 0 where the packet has none.
+// PROGRESSIVE frames give 0: their points go where parseProgressive() says
+int parsePoints(const uint8_t* data, uint16_t len, int (*points)[2], int maxPoints, uint32_t* ticks = NULL);
+
+/*------------------------------------------*/
+/*  PointDecoder - point packets of one     */
+/*  note into (x, y, t) with t in µs since  */
+/*  the note started. start() at START.     */
+/*------------------------------------------*/
+struct TimedPoint {
+  int x;
+  int y;
+  uint32_t ticks;     // since the previous point
+  uint64_t us;        // since the note started
+};
+
+class PointDecoder {
+  public:
+    PointDecoder() : us(0) {}
+
+    void start(){ us = 0; }
+
+    // Decodes one point packet; returns how many points were written
+    int decode(const uint8_t* data, uint16_t len, TimedPoint* out, int maxPoints);
+
+  private:
+    uint64_t us;
+};
+
+// Pulls "month,day" out of a DATE message (or "hour,minute" out of TIME)
+bool parseDate(const uint8_t* data, uint16_t len, int* month, int* day);
+
+#endif
@@ -0,0 +1,330 @@
+#include "Reliable.h"
+
+#include <string.h>
+
+static void put16(uint8_t* out, uint16_t value){
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+}
+
+static uint16_t get16(const uint8_t* in){
+  return in[0] | (in[1] << 8);
+}
+
+ReliableSender::ReliableSender(NoteLink& link)
+  : note(0), acked(0), sent(0), resent(0), acks(0), link(link),
+    points(NULL), count(0), base(0), next(0), closing(false), closeSent(false),
+    month(0), day(0), hour(-1), minute(-1), helloPending(false), helloMs(0), progressMs(0),
+    inFlight(0), transmissions(0), ackHead(0), ackTail(0) {}
+
+void ReliableSender::setPoints(const PointStore& points, uint16_t base){
+  this->points = &points;
+  this->count = points.count();
+  this->base = base;
+  if(next < base){
+    next = base;
+  }
+}
+
+void ReliableSender::close(int month, int day, int hour, int minute){
+  closing = true;
+  closeSent = false;
+  this->month = month;
+  this->day = day;
+  this->hour = hour;
+  this->minute = minute;
+}
+
+/*--------------------------------------------------*/
+/*--                  resume()                    --*/
+/*--------------------------------------------------*/
+/*    Called from connect_callback(). Whatever was  */
+/*    in flight when the link dropped is in an      */
+/*    unknown state until the phone answers HELLO.  */
+/*--------------------------------------------------*/
+void ReliableSender::resume(){
+  if(next > acked || closing){
+    helloPending = true;
+    helloMs = link.now() - RELIABLE_RTO_MS - 1;
+  }
+}
+
+void ReliableSender::nextNote(){
+  note++;
+  acked = 0;
+  points = NULL;
+  count = 0;
+  base = 0;
+  next = 0;
+  closing = false;
+  closeSent = false;
+  helloPending = false;
+  inFlight = 0;
+}
+
+uint16_t ReliableSender::end(){
+  return base + count;
+}
+
+bool ReliableSender::complete(){
+  return acked >= end() + (closing ? 1 : 0);
+}
+
+/*--------------------------------------------------*/
+/*--             pointsPerPacket()                --*/
+/*--------------------------------------------------*/
+/*    How many of the left points from offset fit   */
+/*    in one frame; timed points vary in size.      */
+/*--------------------------------------------------*/
+uint8_t ReliableSender::pointsPerPacket(uint16_t offset, uint16_t left){
+  uint16_t size = link.payloadSize();
+  if(size > NOTE_MAX_PAYLOAD){
+    size = NOTE_MAX_PAYLOAD;
+  }
+
+  if(!points->timed()){
+    uint16_t n = (size - 4) / 4;
+    return left < n ? left : n;
+  }
+
+  uint16_t len = 4;
+  uint8_t n = 0;
+  while(n < left){
+    uint16_t pointLen = 4 + varintLength(points->at(offset - base + n).ticks);
+    if(len + pointLen > size){
+      break;
+    }
+    len += pointLen;
+    n++;
+  }
+  return n;
+}
+
+/*--------------------------------------------------*/
+/*--                    post()                    --*/
+/*--------------------------------------------------*/
+/*    Copies an ack written by the phone into a     */
+/*    small ring; service() handles it in the loop  */
+/*    so the sender state is only touched there.    */
+/*--------------------------------------------------*/
+void ReliableSender::post(const uint8_t* data, uint16_t len){
+  uint8_t head = ackHead;
+  uint8_t following = (head + 1) % RELIABLE_ACK_SLOTS;
+
+  if(following == ackTail || len > RELIABLE_ACK_MAX_LEN){
+    return;  // a newer ack will follow, they are cumulative
+  }
+
+  memcpy(ackData[head], data, len);
+  ackLen[head] = len;
+  ackHead = following;
+}
+
+/*--------------------------------------------------*/
+/*--                handleAck()                   --*/
+/*--------------------------------------------------*/
+/*    Drops every packet covered by the cumulative  */
+/*    ack or a SACK range. The link keeps order, so */
+/*    a packet still missing that went out before   */
+/*    the newest one this ack covers was lost; only */
+/*    those are marked for retransmission. Packets  */
+/*    sent more than once are no evidence: the ack  */
+/*    may be for the first copy.                    */
+/*--------------------------------------------------*/
+void ReliableSender::handleAck(const uint8_t* data, uint16_t len){
+  if(len < 5 || data[0] != RELIABLE_ACK_TAG || data[1] != note){
+    return;
+  }
+
+  acks++;
+
+  uint16_t cumulative = get16(data + 2);
+  uint8_t ranges = data[4];
+  if(ranges > RELIABLE_MAX_SACK || len < 5 + 4 * ranges){
+    return;
+  }
+
+  if(cumulative > acked){
+    acked = cumulative;
+    progressMs = link.now();
+  }
+
+  uint32_t newest = 0;
+  bool arrived = false;
+  uint8_t kept = 0;
+  for(uint8_t f = 0; f < inFlight; f++){
+    Flight& flight = flights[f];
+    uint16_t flightEnd = flight.offset + (flight.count ? flight.count : 1);
+    bool covered = flightEnd <= acked;
+
+    for(uint8_t r = 0; r < ranges && !covered; r++){
+      uint16_t start = get16(data + 5 + 4 * r);
+      uint16_t stop = get16(data + 7 + 4 * r);
+      covered = flight.offset >= start && flightEnd <= stop;
+    }
+
+    if(!covered){
+      flights[kept++] = flight;
+    }
+    else if(flight.tries == 1 && (!arrived || (int32_t)(flight.order - newest) > 0)){
+      newest = flight.order;
+      arrived = true;
+    }
+  }
+  inFlight = kept;
+
+  for(uint8_t f = 0; f < inFlight; f++){
+    if(helloPending || (arrived && (int32_t)(flights[f].order - newest) < 0)){
+      flights[f].lost = true;
+    }
+  }
+
+  if(helloPending){
+    helloPending = false;
+    progressMs = link.now();
+  }
+}
+
+/*--------------------------------------------------*/
+/*--            Frame builders                    --*/
+/*--------------------------------------------------*/
+bool ReliableSender::sendData(uint16_t offset, uint8_t n){
+  uint8_t buffer[NOTE_MAX_PAYLOAD];
+  uint16_t len = 0;
+
+  buffer[len++] = points->timed() ? RELIABLE_TIMED_TAG : RELIABLE_DATA_TAG;
+  buffer[len++] = note;
+  put16(buffer + len, offset);
+  len += 2;
+
+  for(uint8_t i = 0; i < n; i++){
+    StoredPoint point = points->at(offset - base + i);
+    put16(buffer + len, point.x);
+    put16(buffer + len + 2, point.y);
+    len += 4;
+    if(points->timed()){
+      len += putVarint(buffer + len, point.ticks);
+    }
+  }
+
+  return link.notify(buffer, len);
+}
+
+bool ReliableSender::sendClose(){
+  uint8_t buffer[8] = {RELIABLE_CLOSE_TAG, note, 0, 0, month, day, (uint8_t)hour, (uint8_t)minute};
+  put16(buffer + 2, end());
+  return link.notify(buffer, hour < 0 ? 6 : 8);
+}
+
+bool ReliableSender::sendHello(){
+  uint8_t buffer[4] = {RELIABLE_HELLO_TAG, note, 0, 0};
+  put16(buffer + 2, next);
+  return link.notify(buffer, sizeof(buffer));
+}
+
+bool ReliableSender::transmitFlight(Flight& flight){
+  flight.sentMs = link.now();
+  flight.lost = false;
+
+  bool ok = flight.count ? sendData(flight.offset, flight.count) : sendClose();
+  if(!ok){
+    flight.lost = true;   // refused by the link, try again next service()
+    return false;
+  }
+  flight.order = ++transmissions;
+  if(flight.tries < 255){
+    flight.tries++;
+  }
+  return true;
+}
+
+/*--------------------------------------------------*/
+/*--                  service()                   --*/
+/*--------------------------------------------------*/
+void ReliableSender::service(){
+  while(ackTail != ackHead){
+    uint8_t tail = ackTail;
+    handleAck(ackData[tail], ackLen[tail]);
+    ackTail = (tail + 1) % RELIABLE_ACK_SLOTS;
+  }
+
+  if(!link.connected()){
+    return;
+  }
+
+  uint32_t now = link.now();
+
+  // nothing else goes out until the phone has said what it has
+  if(helloPending){
+    if(now - helloMs > RELIABLE_RTO_MS && sendHello()){
+      helloMs = now;
+    }
+    return;
+  }
+
+  // gaps reported by the last ack
+  for(uint8_t f = 0; f < inFlight; f++){
+    if(flights[f].lost){
+      if(flights[f].count){
+        resent++;
+      }
+      if(!transmitFlight(flights[f])){
+        return;
+      }
+    }
+  }
+
+  // tail loss: nothing acked the oldest packet in time
+  if(inFlight > 0 && now - flights[0].sentMs > RELIABLE_RTO_MS){
+    if(flights[0].count){
+      resent++;
+    }
+    transmitFlight(flights[0]);
+  }
+
+  while(inFlight < RELIABLE_WINDOW && next < end()){
+    Flight& flight = flights[inFlight++];
+    flight.offset = next;
+    flight.count = pointsPerPacket(next, end() - next);
+    flight.tries = 0;
+    next += flight.count;
+    sent++;
+    if(!transmitFlight(flight)){
+      return;
+    }
+  }
+
+  if(closing && !closeSent && next == end() && inFlight < RELIABLE_WINDOW){
+    Flight& flight = flights[inFlight++];
+    flight.offset = end();
+    flight.count = 0;
+    flight.tries = 0;
+    closeSent = true;
+    transmitFlight(flight);
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                 transmit()                   --*/
+/*--------------------------------------------------*/
+bool ReliableSender::transmit(uint32_t timeoutMs){
+  progressMs = link.now();
+
+  while(!complete()){
+    if(!link.connected()){
+      return false;
+    }
+
+    service();
+    if(complete()){
+      break;
+    }
+
+    if(link.now() - progressMs > timeoutMs){
+      return false;
+    }
+    link.pause(1);
+  }
+
+  return true;
+}
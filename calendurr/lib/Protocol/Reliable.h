@@ -0,0 +1,136 @@
+#ifndef CALENDURR_RELIABLE_H
+#define CALENDURR_RELIABLE_H
+
+#include <stdint.h>
+
+#include "Protocol.h"
+
+/*--------------------------------------------------*/
+/*--     RELIABLE NOTE TRANSFER (NOTE_RELIABLE)    --*/
+/*--------------------------------------------------*/
+/*  Every coordinate packet carries the note number */
+/*  and the offset of its first point inside the    */
+/*  note. The phone answers on the control          */
+/*  characteristic (write without response) with a  */
+/*  cumulative ack plus up to 4 SACK ranges, so     */
+/*  only the packets that fell into a gap are sent  */
+/*  again. A note stays in the buffer until it is   */
+/*  fully acked; after a reconnect the device sends */
+/*  a HELLO and continues from what the phone says  */
+/*  it already has.                                 */
+/*                                                  */
+/*  Frames (little-endian):                         */
+/*    DATA  0x11 note offset16 (x16 y16)*           */
+/*    TIMED 0x14 note offset16 (x16 y16 ticks)*     */
+/*          (ticks: varint, see PointTimes.h)       */
+/*    CLOSE 0x12 note total16 month day [hour min]  */
+/*    HELLO 0x13 note available16                   */
+/*    ACK   0x06 note cumulative16 n                */
+/*          (start16 end16) * n                     */
+/*                                                  */
+/*  Offsets count points; CLOSE takes the one slot  */
+/*  after the last point, so a note is done when    */
+/*  the cumulative ack reaches total + 1.           */
+/*--------------------------------------------------*/
+
+#ifndef NOTE_RELIABLE
+#define NOTE_RELIABLE 0
+#endif
+
+#define RELIABLE_DATA_TAG 0x11
+#define RELIABLE_CLOSE_TAG 0x12
+#define RELIABLE_HELLO_TAG 0x13
+#define RELIABLE_TIMED_TAG 0x14
+#define RELIABLE_ACK_TAG 0x06
+
+#define RELIABLE_WINDOW 16     // packets in flight
+#define RELIABLE_RTO_MS 300    // resend the oldest unacked packet after this
+#define RELIABLE_STALL_MS 2000 // stop waiting (the note is kept) after this without progress
+#define RELIABLE_MAX_SACK 4    // SACK ranges per ack
+#define RELIABLE_ACK_SLOTS 4   // acks buffered between callback and loop
+#define RELIABLE_ACK_MAX_LEN (5 + 4 * RELIABLE_MAX_SACK)
+
+class ReliableSender {
+  public:
+    ReliableSender(NoteLink& link);
+
+    // Points of the current note: the first stored point is note offset
+    // base. A timed store is sent with its ticks
+    void setPoints(const PointStore& points, uint16_t base);
+
+    // Marks the note as finished after the points given so far; hour < 0
+    // leaves the time out of CLOSE
+    void close(int month, int day, int hour = -1, int minute = -1);
+
+    // After a reconnect: ask the phone what it already has
+    void resume();
+
+    // Sends new packets and retransmits gaps; call from the loop
+    void service();
+
+    // Blocks in service() until everything given is acked. false if the
+    // link dropped or nothing moved for timeoutMs (the note is kept)
+    bool transmit(uint32_t timeoutMs);
+
+    // Everything given so far (including CLOSE if set) is acked
+    bool complete();
+
+    // close() was called for the current note
+    bool closed(){ return closing; }
+
+    // Starts the next note once the current one is complete
+    void nextNote();
+
+    // Control characteristic write callback; safe from the BLE task
+    void post(const uint8_t* data, uint16_t len);
+
+    uint8_t note;
+    uint16_t acked;          // cumulative: every offset below is acked
+    unsigned long sent;      // data packets, first transmissions
+    unsigned long resent;    // data packets sent again
+    unsigned long acks;
+
+  private:
+    struct Flight {
+      uint16_t offset;
+      uint8_t count;         // points; 0 for CLOSE
+      bool lost;
+      uint8_t tries;         // transmissions so far
+      uint32_t order;        // transmission counter when it last went out
+      uint32_t sentMs;
+    };
+
+    void handleAck(const uint8_t* data, uint16_t len);
+    bool sendData(uint16_t offset, uint8_t count);
+    bool sendClose();
+    bool sendHello();
+    bool transmitFlight(Flight& flight);
+    uint8_t pointsPerPacket(uint16_t offset, uint16_t left);
+    uint16_t end();
+
+    NoteLink& link;
+    const PointStore* points;
+    int count;
+    uint16_t base;
+    uint16_t next;           // first offset never sent
+    bool closing;
+    bool closeSent;
+    uint8_t month;
+    uint8_t day;
+    int8_t hour;
+    int8_t minute;
+    bool helloPending;
+    uint32_t helloMs;
+    uint32_t progressMs;
+
+    Flight flights[RELIABLE_WINDOW];
+    uint8_t inFlight;
+    uint32_t transmissions;
+
+    uint8_t ackData[RELIABLE_ACK_SLOTS][RELIABLE_ACK_MAX_LEN];
+    uint8_t ackLen[RELIABLE_ACK_SLOTS];
+    volatile uint8_t ackHead;
+    volatile uint8_t ackTail;
+};
+
+#endif
@@ -0,0 +1,569 @@
+#include "Strokes.h"
+
+#include <string.h>
+
+static void put16(uint8_t* out, uint16_t value){
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+}
+
+static uint16_t get16(const uint8_t* in){
+  return in[0] | (in[1] << 8);
+}
+
+// a was sent before b (seq wraps)
+static bool sentBefore(uint16_t a, uint16_t b){
+  return (int16_t)(a - b) < 0;
+}
+
+static bool dropping(const StrokeEntry& stroke){
+  return stroke.state == STROKE_DROP || stroke.state == STROKE_DROP_SENT;
+}
+
+/*--------------------------------------------------*/
+/*--                StrokeTable                   --*/
+/*--------------------------------------------------*/
+/*  Live strokes are in coordz order; an undone one */
+/*  keeps its entry (count 0) until the phone has   */
+/*  let go of it.                                   */
+/*--------------------------------------------------*/
+StrokeTable::StrokeTable() : entries(0), nextId(0) {}
+
+void StrokeTable::clear(){
+  entries = 0;
+  nextId = 0;
+}
+
+void StrokeTable::forget(){
+  entries = 0;
+}
+
+int StrokeTable::last() const {
+  for(int i = entries - 1; i >= 0; i--){
+    if(!dropping(strokes[i])){
+      return i;
+    }
+  }
+  return -1;
+}
+
+StrokeEntry* StrokeTable::find(uint16_t id){
+  for(uint8_t i = 0; i < entries; i++){
+    if(strokes[i].id == id){
+      return &strokes[i];
+    }
+  }
+  return NULL;
+}
+
+void StrokeTable::remove(uint8_t i){
+  memmove(strokes + i, strokes + i + 1, (entries - i - 1) * sizeof(StrokeEntry));
+  entries--;
+}
+
+void StrokeTable::add(uint16_t index, int16_t x, int16_t y, bool strokeStart){
+  int l = last();
+  if(l >= 0 && strokes[l].state == STROKE_OPEN){
+    StrokeEntry& stroke = strokes[l];
+    if(!strokeStart){
+      stroke.count++;
+      if(x < stroke.minX) stroke.minX = x;
+      if(x > stroke.maxX) stroke.maxX = x;
+      if(y < stroke.minY) stroke.minY = y;
+      if(y > stroke.maxY) stroke.maxY = y;
+      return;
+    }
+    stroke.state = STROKE_NEW;   // no lift() was seen
+  }
+
+  if(entries >= STROKE_MAX){
+    return;   // room() was not asked
+  }
+
+  StrokeEntry& stroke = strokes[entries++];
+  stroke.first = index;
+  stroke.count = 1;
+  stroke.minX = stroke.maxX = x;
+  stroke.minY = stroke.maxY = y;
+  stroke.id = nextId++;
+  stroke.state = STROKE_OPEN;
+  stroke.seq = 0;
+  stroke.sentMs = 0;
+}
+
+void StrokeTable::lift(){
+  int l = last();
+  if(l >= 0 && strokes[l].state == STROKE_OPEN){
+    strokes[l].state = STROKE_NEW;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                  renew()                     --*/
+/*--------------------------------------------------*/
+/*    A stroke the phone may hold has changed: its  */
+/*    old id gets a DROP entry, the stroke a new id */
+/*    (a HAVE bit cannot say which version the      */
+/*    phone holds). With the table full it keeps    */
+/*    the id; the phone replaces a stroke whose     */
+/*    total changes.                                */
+/*--------------------------------------------------*/
+void StrokeTable::renew(StrokeEntry& stroke){
+  if(stroke.seq != 0 && entries < STROKE_MAX){
+    StrokeEntry& drop = strokes[entries++];
+    drop = stroke;
+    drop.count = 0;
+    drop.state = STROKE_DROP;
+    stroke.id = nextId++;
+    stroke.seq = 0;
+  }
+  stroke.state = STROKE_NEW;
+}
+
+bool StrokeTable::undo(PointStore& points){
+  int l = last();
+  if(l < 0){
+    return false;
+  }
+
+  points.truncate(strokes[l].first);
+  if(strokes[l].seq != 0){
+    strokes[l].count = 0;
+    strokes[l].state = STROKE_DROP;
+  }
+  else{
+    remove(l);   // never sent, the phone knows nothing of it
+  }
+  return true;
+}
+
+bool StrokeTable::undoFrom(uint16_t* first) const {
+  int l = last();
+  if(l < 0){
+    return false;
+  }
+  *first = strokes[l].first;
+  return true;
+}
+
+void StrokeTable::truncate(PointStore& points, uint16_t count){
+  int l;
+  while((l = last()) >= 0 && strokes[l].first >= count){
+    if(strokes[l].seq != 0){
+      strokes[l].count = 0;
+      strokes[l].state = STROKE_DROP;
+    }
+    else{
+      remove(l);
+    }
+  }
+
+  if(l >= 0 && strokes[l].first + strokes[l].count > count){
+    StrokeEntry& stroke = strokes[l];
+    stroke.count = count - stroke.first;
+    StoredPoint point = points.at(stroke.first);
+    stroke.minX = stroke.maxX = point.x;
+    stroke.minY = stroke.maxY = point.y;
+    for(uint16_t i = 1; i < stroke.count; i++){
+      point = points.at(stroke.first + i);
+      if(point.x < stroke.minX) stroke.minX = point.x;
+      if(point.x > stroke.maxX) stroke.maxX = point.x;
+      if(point.y < stroke.minY) stroke.minY = point.y;
+      if(point.y > stroke.maxY) stroke.maxY = point.y;
+    }
+    renew(stroke);
+  }
+
+  points.truncate(count);
+}
+
+/*--------------------------------------------------*/
+/*--                StrokeSender                  --*/
+/*--------------------------------------------------*/
+StrokeSender::StrokeSender(NoteLink& link, StrokeTable& table)
+  : note(0), sent(0), resent(0), drops(0), acks(0), bytes(0), link(link), table(table), points(NULL),
+    activeId(0), activeOffset(0), active(false), seq(0), closing(false), closeAcked(false), closeMs(0),
+    month(0), day(0), hour(-1), minute(-1), helloPending(false), helloMs(0), progressMs(0),
+    haveHead(0), haveTail(0) {}
+
+void StrokeSender::setPoints(const PointStore& points){
+  this->points = &points;
+}
+
+void StrokeSender::close(int month, int day, int hour, int minute){
+  closing = true;
+  closeAcked = false;
+  closeMs = 0;
+  this->month = month;
+  this->day = day;
+  this->hour = hour;
+  this->minute = minute;
+}
+
+void StrokeSender::nextNote(){
+  note++;
+  table.clear();
+  active = false;
+  closing = false;
+  closeAcked = false;
+  closeMs = 0;
+  helloPending = false;
+}
+
+/*--------------------------------------------------*/
+/*--                  resume()                    --*/
+/*--------------------------------------------------*/
+/*    Called from connect_callback(). A stroke cut  */
+/*    off by the drop starts over.                  */
+/*--------------------------------------------------*/
+void StrokeSender::resume(){
+  active = false;
+  if(!complete() || closing){
+    helloPending = true;
+    helloMs = link.now() - STROKE_RTO_MS - 1;
+  }
+}
+
+bool StrokeSender::complete(){
+  if(closing){
+    return closeAcked;
+  }
+  for(uint8_t i = 0; i < table.entries; i++){
+    if(table.strokes[i].state != STROKE_ACKED && table.strokes[i].state != STROKE_OPEN){
+      return false;
+    }
+  }
+  return true;
+}
+
+void StrokeSender::post(const uint8_t* data, uint16_t len){
+  uint8_t head = haveHead;
+  uint8_t following = (head + 1) % STROKE_ACK_SLOTS;
+
+  if(following == haveTail || len > STROKE_HAVE_MAX_LEN){
+    return;  // the next HAVE or the RTO makes up for it
+  }
+
+  memcpy(haveData[head], data, len);
+  haveLen[head] = len;
+  haveHead = following;
+}
+
+/*--------------------------------------------------*/
+/*--                handleHave()                  --*/
+/*--------------------------------------------------*/
+/*    The link keeps order, so a stroke (or DROP)   */
+/*    sent before the newest one the phone shows    */
+/*    and still not there was lost; after a HELLO   */
+/*    everything the HAVE does not show was.        */
+/*--------------------------------------------------*/
+void StrokeSender::handleHave(const uint8_t* data, uint16_t len){
+  if(len < 5 || data[0] != STROKE_HAVE_TAG || data[1] != note){
+    return;
+  }
+
+  acks++;
+  bool noteClosed = data[2];
+  uint16_t from = get16(data + 3);
+  uint16_t bits = (len - 5) * 8;
+  uint32_t now = link.now();
+
+  bool arrived = false;
+  uint16_t newest = 0;
+  for(uint8_t i = 0; i < table.entries; i++){
+    const StrokeEntry& stroke = table.strokes[i];
+    uint16_t bit = stroke.id - from;
+    if(bit >= bits || stroke.seq == 0){
+      continue;
+    }
+    bool held = data[5 + bit / 8] & (1 << (bit % 8));
+    bool there = dropping(stroke) ? !held : held;
+    if(there && (!arrived || sentBefore(newest, stroke.seq))){
+      arrived = true;
+      newest = stroke.seq;
+    }
+  }
+
+  for(int i = table.entries - 1; i >= 0; i--){
+    StrokeEntry& stroke = table.strokes[i];
+    uint16_t bit = stroke.id - from;
+    if(bit >= bits){
+      continue;
+    }
+    bool held = data[5 + bit / 8] & (1 << (bit % 8));
+    bool lost = helloPending || (arrived && sentBefore(stroke.seq, newest));
+
+    switch(stroke.state){
+      case STROKE_NEW:
+      case STROKE_SENT:
+        if(held){
+          stroke.state = STROKE_ACKED;
+          progressMs = now;
+        }
+        else if(stroke.state == STROKE_SENT && lost){
+          stroke.state = STROKE_NEW;
+        }
+        break;
+      case STROKE_ACKED:
+        if(!held){
+          stroke.state = STROKE_NEW;   // the phone forgot it
+        }
+        break;
+      case STROKE_DROP:
+      case STROKE_DROP_SENT:
+        if(!held){
+          table.remove(i);
+          progressMs = now;
+        }
+        else if(stroke.state == STROKE_DROP_SENT && lost){
+          stroke.state = STROKE_DROP;
+        }
+        break;
+    }
+  }
+
+  if(active){
+    StrokeEntry* stroke = table.find(activeId);
+    active = stroke && stroke->state == STROKE_NEW;
+  }
+
+  if(closing && closeMs && noteClosed && !closeAcked){
+    closeAcked = true;
+    progressMs = now;
+  }
+
+  if(helloPending){
+    helloPending = false;
+    progressMs = now;
+  }
+}
+
+/*--------------------------------------------------*/
+/*--            Frame builders                    --*/
+/*--------------------------------------------------*/
+bool StrokeSender::notify(const uint8_t* data, uint16_t len){
+  if(!link.notify(data, len)){
+    return false;
+  }
+  bytes += len;
+  return true;
+}
+
+/*--------------------------------------------------*/
+/*--                sendFrame()                   --*/
+/*--------------------------------------------------*/
+/*    The next frame of the active stroke: as many  */
+/*    of its points from activeOffset as fit.       */
+/*--------------------------------------------------*/
+bool StrokeSender::sendFrame(StrokeEntry& stroke){
+  uint8_t buffer[NOTE_MAX_PAYLOAD];
+  uint16_t size = link.payloadSize();
+  if(size > NOTE_MAX_PAYLOAD){
+    size = NOTE_MAX_PAYLOAD;
+  }
+  bool timed = points->timed();
+
+  buffer[0] = timed ? STROKE_TIMED_TAG : STROKE_DATA_TAG;
+  buffer[1] = note;
+  put16(buffer + 2, stroke.id);
+  put16(buffer + 4, activeOffset);
+  put16(buffer + 6, stroke.count);
+  uint16_t len = STROKE_HEADER;
+
+  uint16_t offset = activeOffset;
+  while(offset < stroke.count){
+    StoredPoint point = points->at(stroke.first + offset);
+    uint16_t pointLen = 4 + (timed ? varintLength(point.ticks) : 0);
+    if(len + pointLen > size){
+      break;
+    }
+    put16(buffer + len, point.x);
+    put16(buffer + len + 2, point.y);
+    len += 4;
+    if(timed){
+      len += putVarint(buffer + len, point.ticks);
+    }
+    offset++;
+  }
+
+  if(offset == activeOffset || !notify(buffer, len)){
+    return false;
+  }
+  activeOffset = offset;
+  return true;
+}
+
+bool StrokeSender::sendDrop(StrokeEntry& stroke){
+  uint8_t buffer[4] = {STROKE_DROP_TAG, note, 0, 0};
+  put16(buffer + 2, stroke.id);
+  if(!notify(buffer, sizeof(buffer))){
+    return false;
+  }
+  drops++;
+  return true;
+}
+
+bool StrokeSender::sendClose(){
+  uint16_t strokes = 0;
+  for(uint8_t i = 0; i < table.entries; i++){
+    if(!dropping(table.strokes[i])){
+      strokes++;
+    }
+  }
+
+  uint8_t buffer[8] = {STROKE_CLOSE_TAG, note, 0, 0, month, day, (uint8_t)hour, (uint8_t)minute};
+  put16(buffer + 2, strokes);
+  return notify(buffer, hour < 0 ? 6 : 8);
+}
+
+bool StrokeSender::sendHello(){
+  uint16_t from = 0;
+  bool any = false;
+  for(uint8_t i = 0; i < table.entries; i++){
+    const StrokeEntry& stroke = table.strokes[i];
+    if(stroke.state != STROKE_ACKED && stroke.state != STROKE_OPEN && (!any || stroke.id < from)){
+      from = stroke.id;
+      any = true;
+    }
+  }
+
+  uint8_t buffer[4] = {STROKE_HELLO_TAG, note, 0, 0};
+  put16(buffer + 2, from);
+  return notify(buffer, sizeof(buffer));
+}
+
+/*--------------------------------------------------*/
+/*--                 sendNext()                   --*/
+/*--------------------------------------------------*/
+/*    One frame: the rest of the active stroke, or  */
+/*    the first stroke or DROP in the table that    */
+/*    has to go. false once the link refuses or     */
+/*    nothing is left.                              */
+/*--------------------------------------------------*/
+bool StrokeSender::sendNext(uint32_t now){
+  StrokeEntry* stroke = active ? table.find(activeId) : NULL;
+
+  if(!stroke || stroke->state != STROKE_NEW){
+    active = false;
+    stroke = NULL;
+    for(uint8_t i = 0; i < table.entries && !stroke; i++){
+      if(table.strokes[i].state == STROKE_NEW || table.strokes[i].state == STROKE_DROP){
+        stroke = &table.strokes[i];
+      }
+    }
+  }
+  if(!stroke){
+    return false;
+  }
+
+  if(stroke->state == STROKE_DROP){
+    if(!sendDrop(*stroke)){
+      return false;
+    }
+    stroke->state = STROKE_DROP_SENT;
+    stroke->seq = ++seq ? seq : ++seq;
+    stroke->sentMs = now;
+    return true;
+  }
+
+  if(!active){
+    if(stroke->seq){
+      resent++;
+    }
+    else{
+      sent++;
+    }
+    active = true;
+    activeId = stroke->id;
+    activeOffset = 0;
+    stroke->seq = ++seq ? seq : ++seq;
+  }
+
+  if(!sendFrame(*stroke)){
+    return false;
+  }
+  if(activeOffset >= stroke->count){
+    stroke->state = STROKE_SENT;
+    stroke->sentMs = now;
+    active = false;
+  }
+  return true;
+}
+
+/*--------------------------------------------------*/
+/*--                  service()                   --*/
+/*--------------------------------------------------*/
+void StrokeSender::service(){
+  while(haveTail != haveHead){
+    uint8_t tail = haveTail;
+    handleHave(haveData[tail], haveLen[tail]);
+    haveTail = (tail + 1) % STROKE_ACK_SLOTS;
+  }
+
+  if(!link.connected() || !points){
+    return;
+  }
+
+  uint32_t now = link.now();
+
+  // nothing else goes out until the phone has said what it has
+  if(helloPending){
+    if(now - helloMs > STROKE_RTO_MS && sendHello()){
+      helloMs = now;
+    }
+    return;
+  }
+
+  // tail loss: nothing showed the oldest stroke (or DROP) in time
+  StrokeEntry* oldest = NULL;
+  for(uint8_t i = 0; i < table.entries; i++){
+    StrokeEntry& stroke = table.strokes[i];
+    if((stroke.state == STROKE_SENT || stroke.state == STROKE_DROP_SENT) &&
+       (!oldest || sentBefore(stroke.seq, oldest->seq))){
+      oldest = &stroke;
+    }
+  }
+  if(oldest && now - oldest->sentMs > STROKE_RTO_MS){
+    oldest->state = oldest->state == STROKE_SENT ? STROKE_NEW : STROKE_DROP;
+  }
+
+  while(sendNext(now)){
+  }
+
+  // CLOSE once the phone holds exactly the note's strokes
+  if(closing && !closeAcked && !active && (closeMs == 0 || now - closeMs > STROKE_RTO_MS)){
+    for(uint8_t i = 0; i < table.entries; i++){
+      if(table.strokes[i].state != STROKE_ACKED){
+        return;
+      }
+    }
+    if(sendClose()){
+      closeMs = now ? now : 1;
+    }
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                 transmit()                   --*/
+/*--------------------------------------------------*/
+bool StrokeSender::transmit(uint32_t timeoutMs){
+  progressMs = link.now();
+
+  while(!complete()){
+    if(!link.connected()){
+      return false;
+    }
+
+    service();
+    if(complete()){
+      break;
+    }
+
+    if(link.now() - progressMs > timeoutMs){
+      return false;
+    }
+    link.pause(1);
+  }
+
+  return true;
+}
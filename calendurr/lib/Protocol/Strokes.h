@@ -0,0 +1,230 @@
+#ifndef CALENDURR_STROKES_H
+#define CALENDURR_STROKES_H
+
+#include <stdint.h>
+
+#include "Protocol.h"
+
+/*--------------------------------------------------*/
+/*--        STROKE TABLE AND DELTA SENDS        --*/
+/*--------------------------------------------------*/
+/*  coordz is a flat list of points. StrokeTable    */
+/*  indexes it by stroke: where each one starts in  */
+/*  coordz, how many points it has, its bounding    */
+/*  box and whether the phone has it. Undo (or an   */
+/*  erase gesture) cuts coordz back to the start of */
+/*  a stroke.                                       */
+/*                                                  */
+/*  StrokeSender sends every stroke once the pen    */
+/*  lifts, under an id of its own, while the note   */
+/*  is still being written; the phone says which    */
+/*  ids it holds. Only what the phone does not have */
+/*  goes out: strokes it has not acked, and a DROP  */
+/*  for each stroke undone after it was sent. A     */
+/*  stroke that changes after it was sent is        */
+/*  dropped and sent again under a new id. Fixing   */
+/*  a word costs its new strokes and 4 bytes per    */
+/*  undone one instead of the whole note, and a     */
+/*  reconnect only sends what the phone missed.     */
+/*                                                  */
+/*  Frames (little-endian):                         */
+/*    STROKE 0x1B note id16 first16 total16         */
+/*           (x16 y16)*                             */
+/*    TIMED  0x1C as STROKE, (x16 y16 ticks)*       */
+/*    DROP   0x1D note id16                         */
+/*    CLOSE  0x1E note strokes16 month day          */
+/*           [hour min]                             */
+/*    HELLO  0x1F note from16                       */
+/*    HAVE   0x07 note closed from16 bits*          */
+/*                                                  */
+/*  HAVE is written to the control characteristic;  */
+/*  bit i (LSB first) is set if the phone holds all */
+/*  of stroke from + i. It covers the ids of the    */
+/*  frames since its last HAVE (after a HELLO, from */
+/*  HELLO's from on). A frame whose total differs   */
+/*  from what the phone has for that id replaces    */
+/*  it. The phone keeps a note's strokes in         */
+/*  id order; CLOSE goes once it holds exactly the  */
+/*  strokes the device has, and closed = 1 says it  */
+/*  has written the note down.                      */
+/*--------------------------------------------------*/
+
+#ifndef NOTE_STROKES
+#define NOTE_STROKES 0
+#endif
+
+#define STROKE_DATA_TAG 0x1B
+#define STROKE_TIMED_TAG 0x1C
+#define STROKE_DROP_TAG 0x1D
+#define STROKE_CLOSE_TAG 0x1E
+#define STROKE_HELLO_TAG 0x1F
+#define STROKE_HAVE_TAG 0x07
+
+#define STROKE_HEADER 8
+#define STROKE_MAX 128          // table entries, undone strokes the phone still holds included
+#define STROKE_HAVE_BYTES 16    // ids per HAVE / 8
+#define STROKE_HAVE_MAX_LEN (5 + STROKE_HAVE_BYTES)
+#define STROKE_ACK_SLOTS 4      // HAVEs buffered between callback and loop
+#define STROKE_RTO_MS 300       // send the oldest unacked stroke again after this
+#define STROKE_STALL_MS 2000
+
+/*------------------------------------------*/
+/*  StrokeState - where a stroke (or the    */
+/*  DROP of an undone one) is               */
+/*------------------------------------------*/
+enum StrokeState {
+  STROKE_OPEN,        // the pen is still on it
+  STROKE_NEW,         // to send (again)
+  STROKE_SENT,        // sent, not in a HAVE yet
+  STROKE_ACKED,
+  STROKE_DROP,        // undone, DROP to send (again)
+  STROKE_DROP_SENT
+};
+
+/*------------------------------------------*/
+/*  StrokeEntry - one stroke                */
+/*  first - coordz index of its first point */
+/*  count - its points (0 once undone)      */
+/*  seq - order it was last sent in         */
+/*------------------------------------------*/
+struct StrokeEntry {
+  uint16_t first;
+  uint16_t count;
+  int16_t minX, minY, maxX, maxY;
+  uint16_t id;
+  uint8_t state;
+  uint16_t seq;
+  uint32_t sentMs;
+};
+
+class StrokeTable {
+  public:
+    StrokeTable();
+
+    // Called for every point appended to coordz; index is its place there
+    void add(uint16_t index, int16_t x, int16_t y, bool strokeStart);
+
+    // The pen lifted: the last stroke is complete
+    void lift();
+
+    // Takes the last stroke out of points. false if there is none (or
+    // everything the note had was flushed)
+    bool undo(PointStore& points);
+
+    // Where in coordz the stroke undo() would take out starts; false if
+    // there is none
+    bool undoFrom(uint16_t* first) const;
+
+    // Cuts points back to count, as an erase gesture does; strokes from
+    // there on go, one cut in two is sent again
+    void truncate(PointStore& points, uint16_t count);
+
+    // Next note: no strokes, ids from 0
+    void clear();
+
+    // The phone holds every stroke: forget them so coordz can be cleared
+    // (undo stops there), the ids go on
+    void forget();
+
+    // Room for a stroke started by the next point
+    bool room() const { return entries + 1 < STROKE_MAX; }
+
+    uint8_t count() const { return entries; }
+    const StrokeEntry& operator[](uint8_t i) const { return strokes[i]; }
+
+  private:
+    friend class StrokeSender;
+
+    int last() const;
+    void renew(StrokeEntry& stroke);
+    void remove(uint8_t i);
+    StrokeEntry* find(uint16_t id);
+
+    StrokeEntry strokes[STROKE_MAX];
+    uint8_t entries;
+    uint16_t nextId;
+};
+
+/*------------------------------------------*/
+/*  StrokeSender - sends the table over a   */
+/*  NoteLink; the same shape as             */
+/*  ReliableSender                          */
+/*  sent/resent - stroke transmissions      */
+/*  drops - DROP frames                     */
+/*  bytes - every frame it built            */
+/*------------------------------------------*/
+class StrokeSender {
+  public:
+    StrokeSender(NoteLink& link, StrokeTable& table);
+
+    // The store the table indexes; a timed one is sent with its ticks
+    void setPoints(const PointStore& points);
+
+    // Ends the note once the phone holds everything; hour < 0 leaves the
+    // time out of CLOSE
+    void close(int month, int day, int hour = -1, int minute = -1);
+
+    // After a reconnect: ask the phone which strokes it has
+    void resume();
+
+    // Sends complete strokes and DROPs, and again what was lost; call
+    // from the loop
+    void service();
+
+    // Blocks in service() until complete(). false if the link dropped or
+    // nothing moved for timeoutMs (the strokes are kept)
+    bool transmit(uint32_t timeoutMs);
+
+    // The phone holds every complete stroke and none that was undone,
+    // and (after close()) has written the note down
+    bool complete();
+
+    bool closed(){ return closing; }
+
+    // Starts the next note once the current one is complete
+    void nextNote();
+
+    // Control characteristic write callback; safe from the BLE task
+    void post(const uint8_t* data, uint16_t len);
+
+    uint8_t note;
+    unsigned long sent;
+    unsigned long resent;
+    unsigned long drops;
+    unsigned long acks;
+    unsigned long bytes;
+
+  private:
+    void handleHave(const uint8_t* data, uint16_t len);
+    bool sendNext(uint32_t now);
+    bool sendFrame(StrokeEntry& stroke);
+    bool sendDrop(StrokeEntry& stroke);
+    bool sendClose();
+    bool sendHello();
+    bool notify(const uint8_t* data, uint16_t len);
+
+    NoteLink& link;
+    StrokeTable& table;
+    const PointStore* points;
+    uint16_t activeId;       // stroke whose frames are going out
+    uint16_t activeOffset;
+    bool active;
+    uint16_t seq;
+    bool closing;
+    bool closeAcked;
+    uint32_t closeMs;        // 0 until CLOSE went out
+    uint8_t month;
+    uint8_t day;
+    int8_t hour;
+    int8_t minute;
+    bool helloPending;
+    uint32_t helloMs;
+    uint32_t progressMs;
+
+    uint8_t haveData[STROKE_ACK_SLOTS][STROKE_HAVE_MAX_LEN];
+    uint8_t haveLen[STROKE_ACK_SLOTS];
+    volatile uint8_t haveHead;
+    volatile uint8_t haveTail;
+};
+
+#endif
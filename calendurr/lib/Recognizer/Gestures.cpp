@@ -0,0 +1,251 @@
+#include "Recognizer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------*/
+/*--              GESTURE TEMPLATES               --*/
+/*--------------------------------------------------*/
+/*  0..100 box, y growing down the pad. Matched     */
+/*  point for point, so only the three pass         */
+/*  scribble has a template; longer ones are found  */
+/*  by countTurns() before the matcher runs.        */
+/*--------------------------------------------------*/
+
+static const int8_t scribble3[] = {0,0, 100,33, 0,66, 100,100, GLYPH_END};
+static const int8_t scribble3Back[] = {100,0, 0,33, 100,66, 0,100, GLYPH_END};
+static const int8_t strike[] = {0,50, 100,50, GLYPH_END};
+static const int8_t check[] = {0,55, 30,100, 100,0, GLYPH_END};
+static const int8_t checkShort[] = {0,75, 20,100, 100,0, GLYPH_END};
+
+const GlyphShape gestureGlyphs[] = {
+  {GESTURE_ERASE, scribble3}, {GESTURE_ERASE, scribble3Back},
+  {GESTURE_STRIKE, strike},
+  {GESTURE_SEND, check}, {GESTURE_SEND, checkShort}
+};
+
+const uint8_t gestureGlyphCount = sizeof(gestureGlyphs) / sizeof(gestureGlyphs[0]);
+
+static GlyphCloud gestureClouds[sizeof(gestureGlyphs) / sizeof(gestureGlyphs[0])];
+
+GlyphSet gestureGlyphSet(gestureGlyphs, gestureGlyphCount, gestureClouds, pathDistance);
+
+/*--------------------------------------------------*/
+/*--             GestureRecognizer                --*/
+/*--------------------------------------------------*/
+GestureRecognizer::GestureRecognizer()
+  : inkCount(0), tooLong(false), open(false), start(0), recentCount(0) {}
+
+void GestureRecognizer::begin(){
+  gestureGlyphSet.begin();
+}
+
+void GestureRecognizer::reset(){
+  open = false;
+  inkCount = 0;
+  recentCount = 0;
+}
+
+void GestureRecognizer::truncate(uint16_t count){
+  if(open && start >= count){
+    open = false;
+    inkCount = 0;
+  }
+  while(recentCount > 0 && recent[recentCount - 1].start >= count){
+    recentCount--;
+  }
+}
+
+void GestureRecognizer::remember(){
+  if(recentCount == GESTURE_RECENT){
+    memmove(recent, recent + 1, sizeof(recent) - sizeof(recent[0]));
+    recentCount--;
+  }
+  recent[recentCount].start = start;
+  recent[recentCount].box = box;
+  recentCount++;
+}
+
+void GestureRecognizer::addPoint(int x, int y, bool strokeStart, uint16_t index){
+  if(strokeStart || !open){
+    if(open){
+      remember();   // no lift was seen, so it was never a gesture
+    }
+    open = true;
+    start = index;
+    inkCount = 0;
+    tooLong = false;
+    box.minX = box.maxX = x;
+    box.minY = box.maxY = y;
+  }
+  else{
+    if(x < box.minX) box.minX = x;
+    if(x > box.maxX) box.maxX = x;
+    if(y < box.minY) box.minY = y;
+    if(y > box.maxY) box.maxY = y;
+
+    const InkPoint& last = ink[inkCount - 1];
+    if(abs(x - last.x) < GESTURE_INK_STEP && abs(y - last.y) < GESTURE_INK_STEP){
+      return;
+    }
+  }
+
+  if(inkCount >= GESTURE_INK_POINTS){
+    tooLong = true;   // longer than any gesture
+    return;
+  }
+  ink[inkCount].x = x;
+  ink[inkCount].y = y;
+  inkCount++;
+}
+
+static bool inTimeField(const InkBox& b){
+  return b.maxX >= TIME_FIELD_X_MIN && b.minX <= TIME_FIELD_X_MAX &&
+         b.maxY >= TIME_FIELD_Y_MIN && b.minY <= TIME_FIELD_Y_MAX;
+}
+
+static bool overlaps(const InkBox& a, const InkBox& b){
+  return a.maxX >= b.minX && a.minX <= b.maxX && a.maxY >= b.minY && a.minY <= b.maxY;
+}
+
+/*--------------------------------------------------*/
+/*--                countTurns()                  --*/
+/*--------------------------------------------------*/
+/*    How often the ink goes back along one axis    */
+/*    by at least swing. A scribble turns many      */
+/*    times along one axis and hardly along the     */
+/*    other; a big 8 or S turns along both.         */
+/*--------------------------------------------------*/
+static uint8_t countTurns(const InkPoint* ink, uint16_t count, bool alongY, int16_t swing){
+  uint8_t turns = 0;
+  int8_t dir = 0;
+  int16_t extreme = alongY ? ink[0].y : ink[0].x;
+
+  for(uint16_t i = 1; i < count; i++){
+    int16_t v = alongY ? ink[i].y : ink[i].x;
+    if(dir == 0){
+      if(abs(v - extreme) >= swing){
+        dir = v > extreme ? 1 : -1;
+        extreme = v;
+      }
+    }
+    else if((v - extreme) * dir > 0){
+      extreme = v;
+    }
+    else if((extreme - v) * dir >= swing){
+      dir = -dir;
+      extreme = v;
+      turns++;
+    }
+  }
+  return turns;
+}
+
+static char scribbleTest(const InkPoint* ink, uint16_t count, const InkBox& box){
+  int16_t swingX = (box.maxX - box.minX) / 2;
+  int16_t swingY = (box.maxY - box.minY) / 2;
+  uint8_t turnsX = countTurns(ink, count, false, swingX > GESTURE_INK_STEP ? swingX : GESTURE_INK_STEP);
+  uint8_t turnsY = countTurns(ink, count, true, swingY > GESTURE_INK_STEP ? swingY : GESTURE_INK_STEP);
+  uint8_t most = turnsX > turnsY ? turnsX : turnsY;
+  uint8_t least = turnsX > turnsY ? turnsY : turnsX;
+  return most >= GESTURE_SCRIBBLE_TURNS && least * 3 <= most ? GESTURE_ERASE : 0;
+}
+
+/*--------------------------------------------------*/
+/*--                  covers()                    --*/
+/*--------------------------------------------------*/
+/*    A scribble covers the strokes whose middle    */
+/*    it went over, give or take half a character   */
+/*    (nobody scribbles to the exact edge). A line  */
+/*    takes the strokes up to a character above or  */
+/*    below it too (the bar of a 5, the tail of a   */
+/*    9); whether it went through them or under     */
+/*    them is checked on all of them together in    */
+/*    strokeDone().                                 */
+/*--------------------------------------------------*/
+static bool covers(char gesture, const InkBox& g, const InkBox& b){
+  if(inTimeField(b)){
+    return false;
+  }
+
+  const int16_t slack = GESTURE_MIN_SIZE / 4;
+  int16_t midX = b.minX + (b.maxX - b.minX) / 2;
+  int16_t midY = b.minY + (b.maxY - b.minY) / 2;
+  if(midX < g.minX - slack || midX > g.maxX + slack){
+    return false;
+  }
+  if(gesture == GESTURE_ERASE){
+    return midY >= g.minY - slack && midY <= g.maxY + slack;
+  }
+
+  int16_t lineY = g.minY + (g.maxY - g.minY) / 2;
+  return lineY >= b.minY - 2 * slack && lineY <= b.maxY + 2 * slack;
+}
+
+/*--------------------------------------------------*/
+/*--                strokeDone()                  --*/
+/*--------------------------------------------------*/
+/*    Cheap tests first: a stroke the size of a     */
+/*    character is never matched, and a scribble    */
+/*    needs no matching. A line has to go through   */
+/*    the middle half of what it covers, so one     */
+/*    under a word stays an underline.              */
+/*--------------------------------------------------*/
+char GestureRecognizer::strokeDone(uint16_t* keep, uint32_t* score){
+  if(score){
+    *score = UINT32_MAX;
+  }
+  if(!open){
+    return 0;
+  }
+  open = false;
+
+  int16_t width = box.maxX - box.minX;
+  int16_t height = box.maxY - box.minY;
+  if((width > height ? width : height) < GESTURE_MIN_SIZE || inkCount < 2 || inTimeField(box)){
+    remember();
+    return 0;
+  }
+
+  char gesture = scribbleTest(ink, inkCount, box);
+  if(!gesture && !tooLong){
+    GlyphCloud cloud;
+    InkStroke stroke = {0, inkCount};
+    makeCloud(ink, &stroke, 1, cloud);
+    gesture = gestureGlyphSet.classify(cloud, GESTURE_REJECT, score);
+  }
+
+  uint8_t covered = 0;
+  if(gesture == GESTURE_ERASE || gesture == GESTURE_STRIKE){
+    InkBox all = box;
+    while(covered < recentCount && covers(gesture, box, recent[recentCount - 1 - covered].box)){
+      const InkBox& b = recent[recentCount - 1 - covered].box;
+      all.minY = covered == 0 || b.minY < all.minY ? b.minY : all.minY;
+      all.maxY = covered == 0 || b.maxY > all.maxY ? b.maxY : all.maxY;
+      covered++;
+    }
+    int16_t lineY = box.minY + height / 2;
+    int16_t quarter = (all.maxY - all.minY) / 4;
+    if(covered == 0 ||
+       (gesture == GESTURE_STRIKE && (lineY < all.minY + quarter || lineY > all.maxY - quarter))){
+      covered = 0;
+      gesture = 0;
+    }
+  }
+  else if(gesture == GESTURE_SEND){
+    for(uint8_t i = 0; i < recentCount; i++){
+      if(overlaps(box, recent[i].box)){
+        gesture = 0;
+      }
+    }
+  }
+
+  if(!gesture){
+    remember();
+    return 0;
+  }
+
+  recentCount -= covered;
+  *keep = covered ? recent[recentCount].start : start;
+  return gesture;
+}
@@ -0,0 +1,39 @@
+#include "Recognizer.h"
+
+/*--------------------------------------------------*/
+/*--            TIME FIELD TEMPLATES              --*/
+/*--------------------------------------------------*/
+/*  One path per common way of writing the glyph,   */
+/*  drawn in a 0..100 box with y growing down the   */
+/*  pad. Order and direction do not matter to the   */
+/*  matcher, only the shape of the ink.             */
+/*--------------------------------------------------*/
+
+static const int8_t glyph0[] = {50,0, 20,10, 5,50, 20,90, 50,100, 80,90, 95,50, 80,10, 50,0, GLYPH_END};
+static const int8_t glyph1[] = {50,0, 50,100, GLYPH_END};
+static const int8_t glyph1Flag[] = {25,25, 50,0, 50,100, GLYPH_END};
+static const int8_t glyph2[] = {10,20, 30,3, 60,0, 85,15, 85,40, 10,100, 90,100, GLYPH_END};
+static const int8_t glyph3[] = {10,10, 50,0, 85,15, 80,40, 45,50, 85,60, 90,85, 50,100, 10,90, GLYPH_END};
+static const int8_t glyph4[] = {60,0, 5,65, 90,65, GLYPH_PEN_UP, 65,30, 65,100, GLYPH_END};
+static const int8_t glyph4Open[] = {15,0, 10,55, 85,55, GLYPH_PEN_UP, 70,0, 70,100, GLYPH_END};
+static const int8_t glyph5[] = {85,0, 20,0, 15,45, 55,38, 85,55, 85,85, 55,100, 10,90, GLYPH_END};
+static const int8_t glyph5Bar[] = {20,0, 15,45, 55,38, 85,55, 85,85, 55,100, 10,90, GLYPH_PEN_UP, 20,0, 85,0, GLYPH_END};
+static const int8_t glyph6[] = {80,5, 50,0, 20,20, 8,60, 20,95, 55,100, 85,80, 80,55, 50,45, 15,60, GLYPH_END};
+static const int8_t glyph7[] = {5,0, 95,0, 40,100, GLYPH_END};
+static const int8_t glyph8[] = {85,15, 50,0, 15,15, 20,40, 50,50, 80,62, 85,88, 50,100, 15,88, 20,62, 50,50, 80,40, 85,15, GLYPH_END};
+static const int8_t glyph9[] = {85,20, 55,0, 20,10, 15,35, 40,50, 75,40, 85,20, 80,100, GLYPH_END};
+static const int8_t glyphA[] = {80,30, 55,5, 20,15, 5,60, 25,95, 60,90, 80,50, 80,5, 85,100, GLYPH_END};
+static const int8_t glyphP[] = {10,100, 10,0, 50,0, 85,20, 85,50, 50,65, 10,60, GLYPH_END};
+static const int8_t glyphM[] = {5,100, 5,0, 5,20, 25,0, 45,15, 50,100, 50,20, 70,0, 90,15, 95,100, GLYPH_END};
+
+const GlyphShape timeGlyphs[] = {
+  {'0', glyph0}, {'1', glyph1}, {'1', glyph1Flag}, {'2', glyph2}, {'3', glyph3},
+  {'4', glyph4}, {'4', glyph4Open}, {'5', glyph5}, {'5', glyph5Bar}, {'6', glyph6},
+  {'7', glyph7}, {'8', glyph8}, {'9', glyph9}, {'a', glyphA}, {'p', glyphP}, {'m', glyphM}
+};
+
+const uint8_t timeGlyphCount = sizeof(timeGlyphs) / sizeof(timeGlyphs[0]);
+
+static GlyphCloud timeClouds[sizeof(timeGlyphs) / sizeof(timeGlyphs[0])];
+
+GlyphSet timeGlyphSet(timeGlyphs, timeGlyphCount, timeClouds);
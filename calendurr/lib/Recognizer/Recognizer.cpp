@@ -0,0 +1,308 @@
+#include "Recognizer.h"
+
+#include <string.h>
+
+static uint32_t span(int32_t ax, int32_t ay, int32_t bx, int32_t by){
+  int32_t dx = bx - ax;
+  int32_t dy = by - ay;
+  return isqrt32((uint32_t)(dx * dx + dy * dy));
+}
+
+/*--------------------------------------------------*/
+/*--              Cloud building                  --*/
+/*--------------------------------------------------*/
+/*  The path is walked through a point source so    */
+/*  the same resampling serves stored ink and the   */
+/*  templates. Coordinates are scaled by 4 while    */
+/*  resampling to keep sub-unit steps.              */
+/*--------------------------------------------------*/
+struct PathSource {
+  virtual uint8_t strokeCount() = 0;
+  virtual uint16_t pointCount(uint8_t stroke) = 0;
+  virtual void point(uint8_t stroke, uint16_t i, int32_t* x, int32_t* y) = 0;
+};
+
+struct InkSource : PathSource {
+  const InkPoint* ink;
+  const InkStroke* strokes;
+  uint8_t count;
+
+  uint8_t strokeCount(){ return count; }
+  uint16_t pointCount(uint8_t stroke){ return strokes[stroke].count; }
+  void point(uint8_t stroke, uint16_t i, int32_t* x, int32_t* y){
+    const InkPoint& p = ink[strokes[stroke].start + i];
+    *x = p.x * 4;
+    *y = p.y * 4;
+  }
+};
+
+struct ShapeSource : PathSource {
+  const int8_t* starts[TIME_MAX_STROKES];
+  uint16_t counts[TIME_MAX_STROKES];
+  uint8_t count;
+
+  ShapeSource(const int8_t* path) : count(0){
+    const int8_t* p = path;
+    while(p[0] != GLYPH_END && count < TIME_MAX_STROKES){
+      starts[count] = p;
+      counts[count] = 0;
+      while(p[0] != GLYPH_END && p[0] != GLYPH_PEN_UP){
+        counts[count]++;
+        p += 2;
+      }
+      count++;
+      if(p[0] == GLYPH_PEN_UP){
+        p++;
+      }
+    }
+  }
+
+  uint8_t strokeCount(){ return count; }
+  uint16_t pointCount(uint8_t stroke){ return counts[stroke]; }
+  void point(uint8_t stroke, uint16_t i, int32_t* x, int32_t* y){
+    // templates are 0..100, stretch them to roughly handwriting size
+    *x = starts[stroke][2 * i] * 40;
+    *y = starts[stroke][2 * i + 1] * 40;
+  }
+};
+
+static bool buildCloud(PathSource& source, GlyphCloud& cloud){
+  uint32_t total = 0;
+  uint16_t points = 0;
+
+  for(uint8_t s = 0; s < source.strokeCount(); s++){
+    int32_t px, py, qx, qy;
+    for(uint16_t i = 0; i < source.pointCount(s); i++){
+      source.point(s, i, &qx, &qy);
+      if(i > 0){
+        total += span(px, py, qx, qy);
+      }
+      px = qx;
+      py = qy;
+      points++;
+    }
+  }
+
+  if(points == 0){
+    return false;
+  }
+
+  uint32_t interval = total / (GLYPH_POINTS - 1);
+  if(interval == 0){
+    interval = 1;
+  }
+
+  int32_t out[GLYPH_POINTS][2];
+  uint8_t n = 0;
+  uint32_t carried = 0;
+
+  for(uint8_t s = 0; s < source.strokeCount() && n < GLYPH_POINTS; s++){
+    int32_t px, py;
+    source.point(s, 0, &px, &py);
+    if(n == 0){
+      out[n][0] = px;
+      out[n][1] = py;
+      n++;
+    }
+
+    for(uint16_t i = 1; i < source.pointCount(s) && n < GLYPH_POINTS; i++){
+      int32_t qx, qy;
+      source.point(s, i, &qx, &qy);
+      uint32_t d = span(px, py, qx, qy);
+
+      while(d > 0 && carried + d >= interval && n < GLYPH_POINTS){
+        uint32_t t = interval - carried;
+        px += (int32_t)((int64_t)(qx - px) * t / d);
+        py += (int32_t)((int64_t)(qy - py) * t / d);
+        out[n][0] = px;
+        out[n][1] = py;
+        n++;
+        d -= t;
+        carried = 0;
+      }
+
+      carried += d;
+      px = qx;
+      py = qy;
+    }
+  }
+
+  // rounding can leave the last slot(s) empty
+  while(n < GLYPH_POINTS){
+    int32_t x, y;
+    uint8_t last = source.strokeCount() - 1;
+    source.point(last, source.pointCount(last) - 1, &x, &y);
+    out[n][0] = x;
+    out[n][1] = y;
+    n++;
+  }
+
+  // scale into GLYPH_SCALE, then centre. Each axis is stretched on its
+  // own (templates are drawn square, digits are written tall) unless the
+  // glyph is thin, like a "1", where that would blow up the wobble
+  int32_t minX = out[0][0], maxX = out[0][0], minY = out[0][1], maxY = out[0][1];
+  for(uint8_t i = 1; i < GLYPH_POINTS; i++){
+    if(out[i][0] < minX) minX = out[i][0];
+    if(out[i][0] > maxX) maxX = out[i][0];
+    if(out[i][1] < minY) minY = out[i][1];
+    if(out[i][1] > maxY) maxY = out[i][1];
+  }
+  int32_t width = maxX - minX;
+  int32_t height = maxY - minY;
+  if(width * GLYPH_THIN < height || height * GLYPH_THIN < width){
+    width = height = (width > height) ? width : height;
+  }
+  if(width == 0) width = 1;
+  if(height == 0) height = 1;
+
+  int32_t sumX = 0, sumY = 0;
+  for(uint8_t i = 0; i < GLYPH_POINTS; i++){
+    out[i][0] = (out[i][0] - minX) * GLYPH_SCALE / width;
+    out[i][1] = (out[i][1] - minY) * GLYPH_SCALE / height;
+    sumX += out[i][0];
+    sumY += out[i][1];
+  }
+  for(uint8_t i = 0; i < GLYPH_POINTS; i++){
+    cloud.p[i][0] = out[i][0] - sumX / GLYPH_POINTS;
+    cloud.p[i][1] = out[i][1] - sumY / GLYPH_POINTS;
+  }
+
+  return true;
+}
+
+bool makeCloud(const InkPoint* ink, const InkStroke* strokes, uint8_t strokeCount, GlyphCloud& cloud){
+  InkSource source;
+  source.ink = ink;
+  source.strokes = strokes;
+  source.count = strokeCount;
+  return strokeCount > 0 && buildCloud(source, cloud);
+}
+
+void makeShapeCloud(const GlyphShape& shape, GlyphCloud& cloud){
+  ShapeSource source(shape.path);
+  buildCloud(source, cloud);
+}
+
+/*--------------------------------------------------*/
+/*--              cloudDistance()                 --*/
+/*--------------------------------------------------*/
+/*  Greedy matching from GLYPH_STARTS start points  */
+/*  in each direction, about sqrt(n) runs in all as */
+/*  in $P. The nearest unmatched point is searched  */
+/*  on squared distances, and the chosen pair adds  */
+/*  an octagonal length (within 3% of the root, no  */
+/*  isqrt32()), so the match is integer adds and    */
+/*  shifts. Early pairs weigh more.                 */
+/*--------------------------------------------------*/
+static uint32_t octagon(int32_t dx, int32_t dy){
+  uint32_t ax = dx < 0 ? -dx : dx;
+  uint32_t ay = dy < 0 ? -dy : dy;
+  uint32_t hi = ax > ay ? ax : ay;
+  uint32_t lo = ax > ay ? ay : ax;
+  uint32_t d = hi - (hi >> 3) + (lo >> 1);
+  return d > hi ? d : hi;
+}
+
+static uint32_t greedy(const GlyphCloud& a, const GlyphCloud& b, uint8_t start, uint32_t best){
+  bool matched[GLYPH_POINTS];
+  memset(matched, 0, sizeof(matched));
+
+  uint32_t sum = 0;
+  for(uint8_t k = 0; k < GLYPH_POINTS; k++){
+    uint8_t i = (start + k) % GLYPH_POINTS;
+    uint32_t nearest = UINT32_MAX;
+    uint8_t index = 0;
+    int32_t nearX = 0, nearY = 0;
+
+    for(uint8_t j = 0; j < GLYPH_POINTS; j++){
+      if(matched[j]){
+        continue;
+      }
+      int32_t dx = a.p[i][0] - b.p[j][0];
+      int32_t dy = a.p[i][1] - b.p[j][1];
+      uint32_t d = (uint32_t)(dx * dx + dy * dy);
+      if(d < nearest){
+        nearest = d;
+        index = j;
+        nearX = dx;
+        nearY = dy;
+      }
+    }
+
+    matched[index] = true;
+    sum += (GLYPH_POINTS - k) * octagon(nearX, nearY);
+    if(sum >= best){
+      break;   // already worse than the best start
+    }
+  }
+
+  return sum;
+}
+
+uint32_t cloudDistance(const GlyphCloud& a, const GlyphCloud& b){
+  uint32_t best = UINT32_MAX;
+
+  for(uint8_t s = 0; s < GLYPH_STARTS; s++){
+    uint8_t start = s * GLYPH_POINTS / GLYPH_STARTS;
+    uint32_t d = greedy(a, b, start, best);
+    if(d < best) best = d;
+    d = greedy(b, a, start, best);
+    if(d < best) best = d;
+  }
+
+  // per point and weight, so the reject threshold does not depend on GLYPH_POINTS
+  return best * 2 / (GLYPH_POINTS + 1) * 100 / GLYPH_POINTS;
+}
+
+/*--------------------------------------------------*/
+/*--               pathDistance()                 --*/
+/*--------------------------------------------------*/
+/*  Both clouds are in path order (buildCloud()     */
+/*  walks the ink), so a stroke is compared point   */
+/*  for point, forwards and backwards.              */
+/*--------------------------------------------------*/
+uint32_t pathDistance(const GlyphCloud& a, const GlyphCloud& b){
+  uint32_t forward = 0, backward = 0;
+
+  for(uint8_t i = 0; i < GLYPH_POINTS; i++){
+    const int16_t* q = b.p[GLYPH_POINTS - 1 - i];
+    int32_t dx = a.p[i][0] - b.p[i][0];
+    int32_t dy = a.p[i][1] - b.p[i][1];
+    forward += isqrt32((uint32_t)(dx * dx + dy * dy));
+    dx = a.p[i][0] - q[0];
+    dy = a.p[i][1] - q[1];
+    backward += isqrt32((uint32_t)(dx * dx + dy * dy));
+  }
+
+  return (forward < backward ? forward : backward) / GLYPH_POINTS;
+}
+
+/*--------------------------------------------------*/
+/*--                  GlyphSet                    --*/
+/*--------------------------------------------------*/
+GlyphSet::GlyphSet(const GlyphShape* shapes, uint8_t count, GlyphCloud* clouds, CloudDistance distance)
+  : shapes(shapes), count(count), clouds(clouds), distance(distance) {}
+
+void GlyphSet::begin(){
+  for(uint8_t i = 0; i < count; i++){
+    makeShapeCloud(shapes[i], clouds[i]);
+  }
+}
+
+char GlyphSet::classify(const GlyphCloud& cloud, uint32_t rejectAbove, uint32_t* score){
+  uint32_t best = UINT32_MAX;
+  char label = 0;
+
+  for(uint8_t i = 0; i < count; i++){
+    uint32_t d = distance(cloud, clouds[i]);
+    if(d < best){
+      best = d;
+      label = shapes[i].label;
+    }
+  }
+
+  if(score){
+    *score = best;
+  }
+  return best <= rejectAbove ? label : 0;
+}
@@ -0,0 +1,284 @@
+#ifndef CALENDURR_RECOGNIZER_H
+#define CALENDURR_RECOGNIZER_H
+
+#include <stdint.h>
+
+#include "PenMath.h"
+
+/*--------------------------------------------------*/
+/*--       STROKE RECOGNIZER (point clouds)       --*/
+/*--------------------------------------------------*/
+/*  A $P style matcher in integer math: the strokes */
+/*  of a glyph are resampled to GLYPH_POINTS points */
+/*  along the ink, stretched to a GLYPH_SCALE box   */
+/*  and centred, then compared against every        */
+/*  template cloud with the greedy weighted point   */
+/*  matching of $P. Stroke order and direction do   */
+/*  not matter, so "4" written in one or two        */
+/*  strokes matches the same template.              */
+/*--------------------------------------------------*/
+
+#define GLYPH_POINTS 32
+#define GLYPH_SCALE 1000
+#define GLYPH_STARTS 3        // greedy start points per direction, 6 runs ~ sqrt(GLYPH_POINTS)
+#define GLYPH_THIN 4          // sides more than 4:1 keep their aspect ratio
+
+// Templates are drawn in a 0..100 box, pairs of (x, y) with
+// GLYPH_PEN_UP between strokes and GLYPH_END after the last point
+#define GLYPH_PEN_UP -1
+#define GLYPH_END -2
+
+/*------------------------------------------*/
+/*  InkPoint - one stored pen sample        */
+/*  InkStroke - points [start, start+count) */
+/*  GlyphCloud - a normalized point cloud   */
+/*  GlyphShape - a template in flash        */
+/*------------------------------------------*/
+struct InkPoint {
+  int16_t x;
+  int16_t y;
+};
+
+struct InkStroke {
+  uint16_t start;
+  uint16_t count;
+};
+
+struct GlyphCloud {
+  int16_t p[GLYPH_POINTS][2];
+};
+
+struct GlyphShape {
+  char label;
+  const int8_t* path;
+};
+
+// Builds the normalized cloud for a set of strokes; false if there is no ink
+bool makeCloud(const InkPoint* ink, const InkStroke* strokes, uint8_t strokeCount, GlyphCloud& cloud);
+
+// Builds the cloud of a template shape
+void makeShapeCloud(const GlyphShape& shape, GlyphCloud& cloud);
+
+// $P greedy cloud distance; smaller is closer
+uint32_t cloudDistance(const GlyphCloud& a, const GlyphCloud& b);
+
+// $1 style distance of the clouds as paths, point i to point i (or to
+// the other end first): mean GLYPH_SCALE units apart. For single strokes
+// whose direction of travel is part of the shape; GLYPH_POINTS steps
+// instead of the greedy search's GLYPH_POINTS squared
+uint32_t pathDistance(const GlyphCloud& a, const GlyphCloud& b);
+
+typedef uint32_t (*CloudDistance)(const GlyphCloud& a, const GlyphCloud& b);
+
+/*------------------------------------------*/
+/*  GlyphSet - templates turned into clouds */
+/*  once (begin), then matched against.     */
+/*  clouds - RAM for one cloud per shape    */
+/*  distance - cloudDistance, or            */
+/*            pathDistance for gestures     */
+/*------------------------------------------*/
+class GlyphSet {
+  public:
+    GlyphSet(const GlyphShape* shapes, uint8_t count, GlyphCloud* clouds, CloudDistance distance = cloudDistance);
+
+    void begin();
+
+    // Best matching label, or 0 if nothing is closer than rejectAbove
+    char classify(const GlyphCloud& cloud, uint32_t rejectAbove, uint32_t* score = 0);
+
+  private:
+    const GlyphShape* shapes;
+    uint8_t count;
+    GlyphCloud* clouds;
+    CloudDistance distance;
+};
+
+/*--------------------------------------------------*/
+/*--              TIME FIELD RECOGNIZER           --*/
+/*--------------------------------------------------*/
+/*  Points written inside the time field are kept   */
+/*  (stroke by stroke) while the note is captured.  */
+/*  At send, strokes are grouped into characters by */
+/*  their horizontal overlap, tiny marks become the */
+/*  ":" and the rest are matched against 0-9, a, p  */
+/*  and m. "930", "9:30", "9:30pm" and "7pm" all    */
+/*  give hour/minute in 24 hour time.               */
+/*  Off until its micros() record (main.cpp) has    */
+/*  been read on the board; -DTIME_RECOGNIZER=1.    */
+/*--------------------------------------------------*/
+
+#ifndef TIME_RECOGNIZER
+#define TIME_RECOGNIZER 0
+#endif
+
+/*------------------------------------------*/
+/*  Time field box in pad coordinates       */
+/*  (x_pos/y_pos units). Defaults to the    */
+/*  upper right of the pad; override with   */
+/*  build flags to match the overlay.       */
+/*------------------------------------------*/
+#ifndef TIME_FIELD_X_MIN
+#define TIME_FIELD_X_MIN 2400
+#endif
+#ifndef TIME_FIELD_X_MAX
+#define TIME_FIELD_X_MAX 3600
+#endif
+#ifndef TIME_FIELD_Y_MIN
+#define TIME_FIELD_Y_MIN 0
+#endif
+#ifndef TIME_FIELD_Y_MAX
+#define TIME_FIELD_Y_MAX 900
+#endif
+
+#define TIME_INK_POINTS 512
+#define TIME_INK_STEP 8       // pad units between kept points (the pen samples every 1-3)
+#define TIME_MAX_STROKES 24
+#define TIME_MAX_GLYPHS 8
+#define TIME_REJECT 15000     // cloud distance above which a glyph is unknown
+
+class TimeRecognizer {
+  public:
+    TimeRecognizer();
+
+    // Turns the templates into clouds (once, from setup())
+    void begin();
+
+    // Forget the ink of the previous note
+    void reset();
+
+    // coordz was flushed mid-note: the ink read so far stays, rewind()
+    // goes back no further than this
+    void keep();
+
+    // Back to the last keep() (or reset()); the caller feeds in again
+    // what is left in coordz, as undo does
+    void rewind();
+
+    // Called for every stored point; keeps the ones inside the field
+    void addPoint(int x, int y, bool strokeStart);
+
+    // Reads the field; text (optional) gets the characters seen
+    bool recognize(int* hour, int* minute, char* text = 0, uint8_t textLen = 0);
+
+    uint16_t points(){ return inkCount; }
+
+  private:
+    InkPoint ink[TIME_INK_POINTS];
+    uint16_t inkCount;
+    InkStroke strokes[TIME_MAX_STROKES];
+    uint8_t strokeCount;
+    bool penDown;
+    uint16_t inkFloor;       // ink and strokes from before the last keep()
+    uint8_t strokeFloor;
+};
+
+// Turns recognized characters ("930pm", "9:30") into 24 hour time
+bool parseTimeText(const char* text, int* hour, int* minute);
+
+extern const GlyphShape timeGlyphs[];
+extern const uint8_t timeGlyphCount;
+extern GlyphSet timeGlyphSet;
+
+/*--------------------------------------------------*/
+/*--              STROKE GESTURES                 --*/
+/*--------------------------------------------------*/
+/*  A single stroke bigger than any character is    */
+/*  read as a command when the pen lifts:           */
+/*                                                  */
+/*    scribble (GESTURE_ERASE)   over ink           */
+/*    line (GESTURE_STRIKE)      through ink        */
+/*    check mark (GESTURE_SEND)  on blank pad       */
+/*                                                  */
+/*  The erasing two remove the strokes they cover,  */
+/*  back from the newest, up to the first one they  */
+/*  do not; the check mark is the SEND button. A    */
+/*  gesture that does not meet its condition (a     */
+/*  line under the ink, a check mark over it) is    */
+/*  ink like any other stroke. Only the strokes     */
+/*  still in coordz can go, and strokes touching    */
+/*  the time field are left to TimeRecognizer.      */
+/*                                                  */
+/*  The stroke is matched with pathDistance(), so   */
+/*  the matcher does GLYPH_POINTS steps per         */
+/*  template instead of the $P search. Scribbles of */
+/*  any length are counted by their turns instead;  */
+/*  32 points cannot tell 5 passes from 7.          */
+/*--------------------------------------------------*/
+
+#ifndef PEN_GESTURES
+#define PEN_GESTURES 0
+#endif
+
+#define GESTURE_ERASE 'x'
+#define GESTURE_STRIKE '-'
+#define GESTURE_SEND 'v'
+
+#define GESTURE_INK_POINTS 192
+#define GESTURE_INK_STEP 32     // pad units between kept points
+#define GESTURE_RECENT 16       // newest strokes a gesture can erase
+#ifndef GESTURE_MIN_SIZE
+#define GESTURE_MIN_SIZE 400    // pad units, the longer side; a character is ~200
+#endif
+#define GESTURE_REJECT 150      // pathDistance above which it is ink
+#define GESTURE_SCRIBBLE_TURNS 3  // a scribble of four passes or more
+
+/*------------------------------------------*/
+/*  InkBox - bounding box of a stroke       */
+/*------------------------------------------*/
+struct InkBox {
+  int16_t minX, maxX, minY, maxY;
+};
+
+/*------------------------------------------*/
+/*  GestureRecognizer - sees every stored   */
+/*  point, keeps the stroke being written   */
+/*  (thinned) and the boxes of the strokes  */
+/*  before it.                              */
+/*  recent - newest last; start is the      */
+/*            coordz index of the stroke    */
+/*------------------------------------------*/
+class GestureRecognizer {
+  public:
+    GestureRecognizer();
+
+    // Turns the templates into clouds (once, from setup())
+    void begin();
+
+    // coordz was cleared: nothing in it can be erased any more
+    void reset();
+
+    // coordz was cut back to count (undo): the strokes from there on
+    // are gone
+    void truncate(uint16_t count);
+
+    // Called for every stored point; index is its place in coordz
+    void addPoint(int x, int y, bool strokeStart, uint16_t index);
+
+    // The pen was lifted. Returns the gesture the last stroke was, 0 for
+    // ink; keep gets how many coordz points stay (the gesture and what it
+    // erased go). score (optional) is the match distance
+    char strokeDone(uint16_t* keep, uint32_t* score = 0);
+
+  private:
+    struct RecentStroke {
+      uint16_t start;
+      InkBox box;
+    };
+
+    void remember();
+
+    InkPoint ink[GESTURE_INK_POINTS];
+    uint16_t inkCount;
+    bool tooLong;
+    bool open;            // a stroke strokeDone() has not read
+    uint16_t start;
+    InkBox box;
+    RecentStroke recent[GESTURE_RECENT];
+    uint8_t recentCount;
+};
+
+extern const GlyphShape gestureGlyphs[];
+extern const uint8_t gestureGlyphCount;
+extern GlyphSet gestureGlyphSet;
+
+#endif
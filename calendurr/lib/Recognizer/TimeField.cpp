@@ -0,0 +1,253 @@
+#include "Recognizer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+TimeRecognizer::TimeRecognizer() : inkCount(0), strokeCount(0), penDown(false), inkFloor(0), strokeFloor(0) {}
+
+void TimeRecognizer::begin(){
+  timeGlyphSet.begin();
+}
+
+void TimeRecognizer::reset(){
+  inkCount = 0;
+  strokeCount = 0;
+  penDown = false;
+  inkFloor = 0;
+  strokeFloor = 0;
+}
+
+void TimeRecognizer::keep(){
+  inkFloor = inkCount;
+  strokeFloor = strokeCount;
+}
+
+void TimeRecognizer::rewind(){
+  inkCount = inkFloor;
+  strokeCount = strokeFloor;
+  penDown = false;
+}
+
+/*--------------------------------------------------*/
+/*--                 addPoint()                   --*/
+/*--------------------------------------------------*/
+/*    Leaving the field ends the stroke, so ink     */
+/*    that wanders out and back in is split rather  */
+/*    than joined by a straight line. Within a      */
+/*    stroke only every TIME_INK_STEP units are     */
+/*    kept. Strokes past TIME_MAX_STROKES are left  */
+/*    out whole rather than run into the last one.  */
+/*--------------------------------------------------*/
+void TimeRecognizer::addPoint(int x, int y, bool strokeStart){
+  if(x < TIME_FIELD_X_MIN || x > TIME_FIELD_X_MAX || y < TIME_FIELD_Y_MIN || y > TIME_FIELD_Y_MAX){
+    penDown = false;
+    return;
+  }
+
+  if(strokeStart || !penDown){
+    if(strokeCount >= TIME_MAX_STROKES){
+      penDown = false;   // so the rest of this stroke is dropped too
+      return;
+    }
+    strokes[strokeCount].start = inkCount;
+    strokes[strokeCount].count = 0;
+    strokeCount++;
+    penDown = true;
+  }
+  else{
+    // the matcher resamples anyway; dense ink only costs RAM
+    const InkPoint& last = ink[inkCount - 1];
+    if(abs(x - last.x) < TIME_INK_STEP && abs(y - last.y) < TIME_INK_STEP){
+      return;
+    }
+  }
+
+  if(inkCount >= TIME_INK_POINTS){
+    return;
+  }
+
+  ink[inkCount].x = x;
+  ink[inkCount].y = y;
+  inkCount++;
+  strokes[strokeCount - 1].count++;
+}
+
+/*--------------------------------------------------*/
+/*--                recognize()                   --*/
+/*--------------------------------------------------*/
+/*    Strokes are sorted left to right and merged   */
+/*    into one character while they overlap by at   */
+/*    least half the narrower one (the bar of a 5,  */
+/*    the second stroke of a 4). A stroke much      */
+/*    smaller than the ink height is a dot of ":".  */
+/*--------------------------------------------------*/
+struct Box { int16_t minX, maxX, minY, maxY; };
+
+static bool isDot(const Box& b, int16_t dotSize){
+  return b.maxX - b.minX < dotSize && b.maxY - b.minY < dotSize;
+}
+
+bool TimeRecognizer::recognize(int* hour, int* minute, char* text, uint8_t textLen){
+  Box boxes[TIME_MAX_STROKES];
+  uint8_t order[TIME_MAX_STROKES];
+  uint8_t used = 0;
+  int16_t top = INT16_MAX, bottom = INT16_MIN;
+
+  for(uint8_t s = 0; s < strokeCount; s++){
+    if(strokes[s].count == 0){
+      continue;
+    }
+    Box& b = boxes[s];
+    b.minX = b.maxX = ink[strokes[s].start].x;
+    b.minY = b.maxY = ink[strokes[s].start].y;
+    for(uint16_t i = 1; i < strokes[s].count; i++){
+      const InkPoint& p = ink[strokes[s].start + i];
+      if(p.x < b.minX) b.minX = p.x;
+      if(p.x > b.maxX) b.maxX = p.x;
+      if(p.y < b.minY) b.minY = p.y;
+      if(p.y > b.maxY) b.maxY = p.y;
+    }
+    if(b.minY < top) top = b.minY;
+    if(b.maxY > bottom) bottom = b.maxY;
+
+    // insertion sort on the left edge
+    uint8_t i = used++;
+    while(i > 0 && boxes[order[i - 1]].minX > b.minX){
+      order[i] = order[i - 1];
+      i--;
+    }
+    order[i] = s;
+  }
+
+  if(used == 0){
+    return false;
+  }
+
+  char found[TIME_MAX_GLYPHS + 1];
+  uint8_t glyphs = 0;
+  int16_t dotSize = (bottom - top) / 4;
+
+  uint8_t s = 0;
+  while(s < used && glyphs < TIME_MAX_GLYPHS){
+    if(isDot(boxes[order[s]], dotSize)){
+      // both dots of a ":" give one colon
+      if(glyphs == 0 || found[glyphs - 1] != ':'){
+        found[glyphs++] = ':';
+      }
+      s++;
+      continue;
+    }
+
+    InkStroke group[TIME_MAX_STROKES];
+    uint8_t groupCount = 0;
+    Box g = boxes[order[s]];
+
+    while(s < used){
+      const Box& b = boxes[order[s]];
+      if(groupCount > 0){
+        if(isDot(b, dotSize)){
+          break;
+        }
+        int16_t overlap = (b.maxX < g.maxX ? b.maxX : g.maxX) - b.minX;
+        int16_t narrower = (b.maxX - b.minX < g.maxX - g.minX) ? b.maxX - b.minX : g.maxX - g.minX;
+        if(overlap <= 0 || overlap * 2 < narrower){
+          break;
+        }
+      }
+      group[groupCount++] = strokes[order[s]];
+      if(b.minX < g.minX) g.minX = b.minX;
+      if(b.maxX > g.maxX) g.maxX = b.maxX;
+      s++;
+    }
+
+    GlyphCloud cloud;
+    char label = 0;
+    if(makeCloud(ink, group, groupCount, cloud)){
+      label = timeGlyphSet.classify(cloud, TIME_REJECT);
+    }
+    found[glyphs++] = label ? label : '?';
+  }
+  found[glyphs] = 0;
+
+  if(text && textLen > 0){
+    strncpy(text, found, textLen - 1);
+    text[textLen - 1] = 0;
+  }
+
+  return parseTimeText(found, hour, minute);
+}
+
+/*--------------------------------------------------*/
+/*--              parseTimeText()                 --*/
+/*--------------------------------------------------*/
+/*    "9" "9pm" -> hour only, "930" "9:30" -> the   */
+/*    last two digits are minutes. am/pm turn a     */
+/*    1-12 hour into 24 hour time.                  */
+/*--------------------------------------------------*/
+bool parseTimeText(const char* text, int* hour, int* minute){
+  int digits[4];
+  int count = 0;
+  int colon = -1;
+  bool am = false, pm = false;
+
+  for(const char* c = text; *c; c++){
+    if(*c >= '0' && *c <= '9'){
+      if(count >= 4){
+        return false;
+      }
+      digits[count++] = *c - '0';
+    }
+    else if(*c == ':' && colon < 0){
+      colon = count;
+    }
+    else if(*c == 'a'){
+      am = true;
+    }
+    else if(*c == 'p'){
+      pm = true;
+    }
+    else if(*c != 'm'){
+      return false;
+    }
+  }
+
+  int hourDigits = count <= 2 ? count : count - 2;
+  if(colon >= 0){
+    hourDigits = colon;
+    if(count - colon != 2){
+      return false;
+    }
+  }
+  if(count == 0 || hourDigits < 1 || hourDigits > 2 || (am && pm)){
+    return false;
+  }
+
+  int h = 0, m = 0;
+  for(int i = 0; i < count; i++){
+    if(i < hourDigits){
+      h = h * 10 + digits[i];
+    }
+    else{
+      m = m * 10 + digits[i];
+    }
+  }
+
+  if(am || pm){
+    if(h < 1 || h > 12){
+      return false;
+    }
+    if(pm && h != 12){
+      h += 12;
+    }
+    if(am && h == 12){
+      h = 0;
+    }
+  }
+  if(h > 23 || m > 59){
+    return false;
+  }
+
+  *hour = h;
+  *minute = m;
+  return true;
+}
@@ -0,0 +1,55 @@
+# Fails the firmware build if the modules that run while writing a note
+# call into the heap (see "Zero heap" in platformio.ini).
+#
+# After linking, every object built from src/ and from the libraries
+# listed in HOT_LIBS is checked with nm for undefined references to the
+# allocator, new/delete or Arduino String. Allocations made inside the
+# board libraries (Bluefruit, SSD1306 at begin()) are not counted.
+
+Import("env")
+
+import glob
+import os
+import subprocess
+
+HOT_LIBS = ["Protocol", "Pen", "Recognizer", "Battery", "Ink", "Buttons"]
+
+HEAP_SYMBOLS = {
+    "malloc", "calloc", "realloc", "free", "strdup",
+    "_malloc_r", "_calloc_r", "_realloc_r", "_free_r",
+    "_Znwj", "_Znaj", "_ZdlPv", "_ZdaPv", "_ZdlPvj", "_ZdaPvj",
+}
+
+
+def hot_objects(build_dir):
+    objects = glob.glob(os.path.join(build_dir, "src", "**", "*.o"), recursive=True)
+    for lib in HOT_LIBS:
+        objects += glob.glob(os.path.join(build_dir, "lib*", lib, "**", "*.o"), recursive=True)
+    return objects
+
+
+def heap_references(nm, obj):
+    out = subprocess.check_output([nm, "-u", obj]).decode()
+    found = []
+    for line in out.splitlines():
+        symbol = line.split()[-1]
+        if symbol in HEAP_SYMBOLS or symbol.startswith(("_ZN6String", "_ZNK6String")):
+            found.append(symbol)
+    return found
+
+
+def check_heap(source, target, env):
+    nm = env.subst("$CC").replace("gcc", "nm")
+    build_dir = env.subst("$BUILD_DIR")
+    failed = False
+
+    for obj in hot_objects(build_dir):
+        for symbol in heap_references(nm, obj):
+            print("heap_check: %s uses %s" % (os.path.relpath(obj, build_dir), symbol))
+            failed = True
+
+    if failed:
+        env.Exit(1)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", check_heap)
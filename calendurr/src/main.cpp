@@ -3,11 +3,25 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
-#include <string>
+#include <string.h>
 #include <Arduino.h>
 #include <InternalFileSystem.h>
 #include <Adafruit_LittleFS.h>
 #include <cstdio>
+#include "DeviceTraits.h"
+#include "Advert.h"
+#include "Channels.h"
+#include "Fanout.h"
+#include "Protocol.h"
+#include "Reliable.h"
+#include "Strokes.h"
+#include "Recognizer.h"
+#include "PenFilter.h"
+#include "Resampler.h"
+#include "Battery.h"
+#include "InkMirror.h"
+#include "OledDma.h"
+#include "Button.h"
 
 using namespace Adafruit_LittleFS_Namespace;
 
@@ -16,19 +30,16 @@ using namespace Adafruit_LittleFS_Namespace;
 /*--------------------------------------------------*/
 
 /*------------------------------------------*/
-/*  Battery Pin - Analog Pin 6              */
-/*  batteryPercent - percent of battery     */
-/*  batteryChange - number of times the     */
-/*            battery voltage level has     */
-/*            changed (for hysteresis)      */
-/*  batteryCheckTime - keep track of time   */
-/*            since the battery percent was */
-/*            checked last                  */
+/*  Battery - VBAT on Analog Pin 6, read    */
+/*            through the SAADC directly    */
+/*  batteryGauge - smoothed percent, and    */
+/*            whether it changed            */
+/*  batterySampleMs - when the last VBAT    */
+/*            conversion was started        */
 /*------------------------------------------*/
-#define VBATPIN A6
-float batteryPercent;
-int batteryChange;
-int batteryCheckTime;
+BatteryGauge batteryGauge;
+BatteryAdc batteryAdc;
+uint32_t batterySampleMs;
 
 /*------------------------------------------*/
 /*  Oled Screen Details                     */
@@ -36,9 +47,46 @@ int batteryCheckTime;
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
 #define OLED_RESET -1
-#define SCREEN_ADDRESS 0x3D
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 
+/*------------------------------------------*/
+/*  OLED by EasyDMA (OLED_DMA=1) - frames   */
+/*            go out through TWIM1 while    */
+/*            the loop runs on              */
+/*  displayPending - a frame was drawn      */
+/*            while the last one was still  */
+/*            going out                     */
+/*  displayCpuUs/displayWireUs - loop time  */
+/*            and bus time of the last full */
+/*            frame (BOOT_TIMELINE prints   */
+/*            them)                         */
+/*------------------------------------------*/
+#if OLED_DMA
+OledDma oled(Device::Pins::oledAddress);
+boolean displayPending = false;
+uint32_t displayStartUs;
+#endif
+volatile uint32_t displayCpuUs = 0;
+volatile uint32_t displayWireUs = 0;
+
+/*------------------------------------------*/
+/*  Ink mirror (INK_MIRROR=1) - the note    */
+/*            being written, drawn on the   */
+/*            OLED as it is stored          */
+/*  inkShowing - the OLED shows ink instead */
+/*            of the date until "Send"      */
+/*  statusRedraw - whatsTheDate() draws     */
+/*            every line, not just changes  */
+/*------------------------------------------*/
+#if INK_MIRROR
+#define INK_I2C_CLOCK 400000   // what Adafruit_SSD1306 uses for display()
+#define INK_I2C_RESTORE 100000
+#define INK_I2C_CHUNK 31       // data bytes per transmission after the 0x40
+InkMirror inkMirror(NULL, SCREEN_WIDTH, SCREEN_HEIGHT);
+boolean inkShowing = false;
+#endif
+boolean statusRedraw = false;
+
 /*------------------------------------------*/
 /*  Internal File System for storing the    */
 /*  most recently used date.                */
@@ -47,55 +95,53 @@ Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 File file(InternalFS);
 
 /*------------------------------------------*/
-/*  SEND_BUTTON - to signal end of entry,   */
+/*  sendButton - to signal end of entry,    */
 /*            and sends the selected date.  */
-/*  BLE_BUTTON - will disconnect the        */
-/*            device from Bluetooth.        */
+/*  bleButton - will disconnect the         */
+/*            device from Bluetooth when    */
+/*            held for BUTTON_LONG_MS.      */
+/*  Both interrupt on every edge and are    */
+/*  handled as events in the loop (see      */
+/*  lib/Buttons/Button.h); nothing waits    */
+/*  for a release.                          */
 /*------------------------------------------*/
-#define SEND_BUTTON 25
-#define BLE_BUTTON 26
+Button sendButton;
+Button bleButton;
 
 /*------------------------------------------*/
 /*  Day and Month Variables:                */
 /*  day/month - number corresponding to day */
 /*        or month (e.g. month = 1 = Jan.)  */
-/*  m - name of month, accessed in 'months' */
 /*  lastDay/Month - num from last iteration */
 /*        to determine if change occurred   */
 /*  day/monthTime - time since last pin     */
 /*        change to prevent flickering      */
 /*        between interrupt calls           */
+/*  Pins, month names and lengths and the   */
+/*        dials' wrap-around are in         */
+/*        Device (DeviceTraits.h)           */
 /*------------------------------------------*/
-#define DAY_A 9
-#define DAY_B 10
-#define MONTH_A 12
-#define MONTH_B 13
 int dayB_status;
 int monthB_status;
 int day;
 int month;
-String m;
 int lastDay;
 int lastMonth;
 int dayTime;
 int monthTime;
 
-#define months {"January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"}
-
 /*------------------------------------------*/
-/*  Sensor Pins and Min/Max coordinates of  */
-/*  the screen.                             */
+/*  Sensor pins and the pad's bounds are    */
+/*  Device::Pins and Device::Pad.           */
+/*  PAD_RATIOMETRIC - the sense pin is read */
+/*            against VDD/4, the rail that  */
+/*            drives the pad, so readings   */
+/*            do not move as the battery    */
+/*            sags                          */
 /*------------------------------------------*/
-#define TOP_R 11
-#define TOP_L 6
-#define SENSE 14
-#define BOTTOM_L 5
-#define BOTTOM_R 0
-
-#define X_MAX 13000
-#define X_MIN 8850
-#define Y_MAX 13000
-#define Y_MIN 8500
+#ifndef PAD_RATIOMETRIC
+#define PAD_RATIOMETRIC 0
+#endif
 
 /*------------------------------------------*/
 /*  Coordinate and Processing variables     */
@@ -104,42 +150,419 @@ unsigned short int x_raw;
 unsigned short int y_raw;
 int x_pos, last_x, delX;
 int y_pos, last_y, delY;
-int filtered_x;
-int filtered_y;
-int avg_x, last_avg_x, last_avg_x_2, last_avg_x_3, last_avg_x_4;
-int avg_y, last_avg_y, last_avg_y_2, last_avg_y_3, last_avg_y_4;
-int temp_x, temp_x_2, temp_x_3, temp_x_4;
-int temp_y, temp_y_2, temp_y_3, temp_y_4;
 
-#define coeff 0.1 // Filter equation coefficient
+/*------------------------------------------*/
+/*  penFilter - smooths the coordinates     */
+/*            (PEN_FILTER, PenFilter.h)     */
+/*------------------------------------------*/
+#if PEN_FILTER == FILTER_ONE_EURO
+OneEuroFilter penFilter;
+#else
+AverageFilter penFilter(Device::Pad::filterCoeff);
+#endif
 
-unsigned int coordz[1000][2];
-int entriesCollected;
+/*------------------------------------------*/
+/*  coordz - the points of the note not yet */
+/*            sent (or acked), delta packed */
+/*            with their ticks (1.7-2 bytes */
+/*            a point, PointStore.h): over  */
+/*            4100 points in the 8 KB that  */
+/*            held 1000 unpacked            */
+/*------------------------------------------*/
+#define COORD_BYTES 8192
+uint8_t coordBytes[COORD_BYTES];
+PointStore coordz(coordBytes, sizeof(coordBytes));
 int numEntriesSame;
 
+/*------------------------------------------*/
+/*  resampler - spaces the filtered points  */
+/*            RESAMPLE_STEP apart along the */
+/*            stroke before they are stored */
+/*------------------------------------------*/
+#if PEN_RESAMPLE
+ArcResampler resampler;
+#endif
+
+/*------------------------------------------*/
+/*  pointClock - micros() -> ticks since    */
+/*            the previous stored point     */
+/*------------------------------------------*/
+#if NOTE_TIMESTAMPS
+PointClock pointClock;
+#endif
+
+/*------------------------------------------*/
+/*  latencyTracer - puts capture / coordz / */
+/*            notify times on every packet  */
+/*            and answers the phone's SYNC  */
+/*            (build with -DNOTE_LATENCY=1, */
+/*            see Latency.h)                */
+/*------------------------------------------*/
+#if NOTE_LATENCY
+#if !NOTE_TIMESTAMPS || NOTE_FRAMING != FRAMING_BINARY || NOTE_RELIABLE
+#error "NOTE_LATENCY needs NOTE_TIMESTAMPS and NOTE_FRAMING=FRAMING_BINARY, without NOTE_RELIABLE"
+#endif
+LatencyTracer latencyTracer;
+#endif
+
+/*------------------------------------------*/
+/*  NOTE_PROGRESSIVE - noteSender sends the */
+/*            preview of every send before  */
+/*            the rest (Progressive.h); the */
+/*            points wait in coordz for     */
+/*            the SEND press instead of     */
+/*            going out at pen lifts        */
+/*------------------------------------------*/
+#if NOTE_PROGRESSIVE && (NOTE_FRAMING != FRAMING_BINARY || NOTE_RELIABLE || NOTE_LATENCY)
+#error "NOTE_PROGRESSIVE needs NOTE_FRAMING=FRAMING_BINARY, without NOTE_RELIABLE or NOTE_LATENCY"
+#endif
+#if NOTE_CHANNELS && (NOTE_RELIABLE || NOTE_LATENCY || NOTE_PROGRESSIVE)
+#error "NOTE_CHANNELS replaces NOTE_RELIABLE, NOTE_LATENCY and NOTE_PROGRESSIVE transfers"
+#endif
+#if NOTE_CENTRALS > 1 && (NOTE_RELIABLE || NOTE_LATENCY || NOTE_CHANNELS)
+#error "NOTE_CENTRALS > 1 fans out the plain transfer; NOTE_RELIABLE, NOTE_LATENCY and NOTE_CHANNELS talk to one phone"
+#endif
+#if NOTE_CENTRALS < 1 || NOTE_CENTRALS > FANOUT_MAX_LINKS
+#error "NOTE_CENTRALS must be 1 to FANOUT_MAX_LINKS"
+#endif
+#if PEN_GESTURES && (NOTE_RELIABLE || NOTE_CHANNELS)
+#error "PEN_GESTURES erases the unsent points in coordz; NOTE_RELIABLE and NOTE_CHANNELS do not keep them there"
+#endif
+#if NOTE_STROKES && (NOTE_RELIABLE || NOTE_LATENCY || NOTE_PROGRESSIVE || NOTE_CHANNELS || NOTE_CENTRALS > 1)
+#error "NOTE_STROKES is a transfer of its own, to one phone"
+#endif
+
 /*------------------------------------------*/
 /*  Timing variables for send control       */
 /*------------------------------------------*/
 unsigned long lastCoordSendTime = 0;
 const unsigned long COORD_SEND_INTERVAL = 10; // Send coordinates every 100ms
-unsigned long messageCounter = 0; // To ensure each message is unique
-unsigned long lastButtonPress = 0;
-const unsigned long debounceTime = 300; // Debounce time for button
 
 /*------------------------------------------*/
 /*  BLE Service and Characteristic          */
-/*  configuration                           */
+/*  configuration (UUIDs: Device::Ble)      */
 /*------------------------------------------*/
-#define CALENDAR_SERVICE_UUID "19B10000-E8F2-537E-4F6C-D104768A1214"
-#define CALENDAR_DATA_CHAR_UUID "19B10001-E8F2-537E-4F6C-D104768A1214"
-
-BLEService calendarService(CALENDAR_SERVICE_UUID);
-BLECharacteristic dataCharacteristic(CALENDAR_DATA_CHAR_UUID);
+BLEService calendarService(Device::Ble::serviceUuid);
+BLECharacteristic dataCharacteristic(Device::Ble::dataUuid);
+BLECharacteristic controlCharacteristic(Device::Ble::controlUuid); // phone -> device (acks)
+#if NOTE_CHANNELS
+BLECharacteristic statusCharacteristic(Device::Ble::statusUuid);  // note markers (Channels.h)
+#endif
 BLEDis bledis; // Device Information Service
 BLEBas blebas; // Battery Service
 
 boolean isConnected = false;
 boolean lastConnected = false;
+volatile uint8_t centralCount = 0;   // connections up (isConnected: at least one)
+
+/*------------------------------------------*/
+/*  Bonded reconnect (BLE_BONDING=1):       */
+/*  Off by default: BluetoothPage.js does   */
+/*  not pair, and an unpaired page gets an  */
+/*  insufficient encryption error from the  */
+/*  characteristics below. With it on they  */
+/*  need an encrypted link, so the phone    */
+/*  pairs once (in its Bluetooth settings,  */
+/*  before the page connects) and Bluefruit */
+/*  keeps its keys (and the CCCDs) in       */
+/*  InternalFS. After that:                 */
+/*  - a high duty directed advertising      */
+/*    burst (1.28 s at most) goes to the    */
+/*    last bonded phone after a link drop,  */
+/*    and at power-on if its address is not */
+/*    a rotating private one, then normal   */
+/*    advertising takes over                */
+/*  - the phone keeps its GATT cache; when  */
+/*    GATT_LAYOUT changes, bonded phones    */
+/*    get a Service Changed indication once */
+/*                                          */
+/*  lastPeer - the last bonded phone, kept  */
+/*            with the GATT_LAYOUT it saw   */
+/*            in LAST_PEER                  */
+/*  linkDropped - the link went down on its */
+/*            own (not bleButton), so the   */
+/*            phone is likely still close   */
+/*  userDisconnect - bleButton was held     */
+/*  linkDownMs/firstNotifyMs - power-on or  */
+/*            drop to first notify, printed */
+/*            with BOOT_TIMELINE            */
+/*------------------------------------------*/
+#ifndef BLE_BONDING
+#define BLE_BONDING 0
+#endif
+
+#define GATT_LAYOUT (NOTE_CHANNELS ? 2 : 1)  // bump whenever a service or characteristic changes
+#define LAST_PEER "/lastpeer.bin"
+#define DIRECTED_BURST_S 1    // the SoftDevice stops high duty directed advertising at 1.28 s
+
+struct PeerRecord {
+  uint8_t layout;
+  ble_gap_addr_t addr;
+};
+PeerRecord lastPeer;
+bool lastPeerKnown = false;
+bool linkDropped = false;
+bool userDisconnect = false;
+uint32_t linkDownMs = 0;
+volatile uint32_t firstNotifyMs = 0;
+volatile bool firstNotifyPending = true;
+
+/*------------------------------------------*/
+/*  advertStatus - pending notes, coordz    */
+/*            fill and battery as the       */
+/*            running advertising shows     */
+/*            them (see Advert.h)           */
+/*  advertUndirected - that advertising is  */
+/*            the undirected kind, the only */
+/*            one with data                 */
+/*  advertChangedMs - when updateAdvert()   */
+/*            last restarted it             */
+/*------------------------------------------*/
+AdvertStatus advertStatus;
+bool advertUndirected = false;
+uint32_t advertChangedMs = 0;
+
+/*------------------------------------------*/
+/*  BleNoteLink - hands the note protocol   */
+/*  packets to dataCharacteristic.notify(). */
+/*  noteSender - builds every message sent  */
+/*            to the phone (see Protocol.h) */
+/*------------------------------------------*/
+class BleNoteLink : public NoteLink {
+  public:
+    uint16_t payloadSize(){
+      BLEConnection* conn = Bluefruit.Connection(Bluefruit.connHandle());
+      return conn ? conn->getMtu() - 3 : NOTE_MIN_PAYLOAD;
+    }
+    bool notify(const uint8_t* data, uint16_t len){
+      // Use notify instead of write to enable notifications on Android
+      bool ok = dataCharacteristic.notify(data, len);
+      if(ok && firstNotifyPending){
+        firstNotifyPending = false;
+        firstNotifyMs = millis() - linkDownMs;
+      }
+      return ok;
+    }
+    void pause(uint32_t ms){
+      delay(ms);
+    }
+    uint32_t now(){
+      return millis();
+    }
+    uint32_t clockUs(){
+      return micros();
+    }
+#if NOTE_CHANNELS
+    bool notifyStatus(const uint8_t* data, uint16_t len){
+      return statusCharacteristic.notify(data, len);
+    }
+#endif
+    bool connected(){
+      return Bluefruit.connected();
+    }
+};
+
+BleNoteLink bleLink;
+
+/*------------------------------------------*/
+/*  BleFanout - with NOTE_CENTRALS > 1 the  */
+/*            notes go to every connected   */
+/*            central from one encoded copy */
+/*            (see Fanout.h). The credits   */
+/*            come back through the         */
+/*            BLE_GATTS_EVT_HVN_TX_COMPLETE */
+/*            counts in hvnDone, which only */
+/*            ble_event_callback() writes   */
+/*            and service() reads           */
+/*  BLE_HVN_CREDITS - HVN queue slots of a  */
+/*            BANDWIDTH_MAX connection; too */
+/*            many only makes notify() wait */
+/*------------------------------------------*/
+#if NOTE_CENTRALS > 1
+#define BLE_HVN_CREDITS 3
+
+volatile uint32_t hvnDone[BLE_MAX_CONNECTION];
+
+class BleFanout : public NoteFanout {
+  public:
+    void pause(uint32_t ms){
+      delay(ms);
+      service();
+    }
+    uint32_t now(){
+      return millis();
+    }
+    uint32_t clockUs(){
+      return micros();
+    }
+
+    void open(uint16_t conn){
+      BLEConnection* connection = Bluefruit.Connection(conn);
+      hvnSeen[conn] = hvnDone[conn];
+      attach(conn, connection ? connection->getMtu() - 3 : NOTE_MIN_PAYLOAD, BLE_HVN_CREDITS);
+    }
+
+    // Credits and MTUs from the SoftDevice, then whatever they allow out
+    void service(){
+      for(uint8_t i = 0; i < FANOUT_MAX_LINKS; i++){
+        const FanoutLink& fanoutLink = link(i);
+        if(!fanoutLink.active){
+          continue;
+        }
+        uint16_t conn = fanoutLink.conn;
+        uint32_t done = hvnDone[conn];
+        credit(conn, done - hvnSeen[conn]);
+        hvnSeen[conn] = done;
+
+        BLEConnection* connection = Bluefruit.Connection(conn);
+        if(connection){
+          setPayload(conn, connection->getMtu() - 3);
+        }
+      }
+      pump();
+    }
+
+  protected:
+    bool sendTo(uint16_t conn, const uint8_t* data, uint16_t len){
+      bool ok = dataCharacteristic.notify(conn, data, len);
+      if(ok && firstNotifyPending){
+        firstNotifyPending = false;
+        firstNotifyMs = millis() - linkDownMs;
+      }
+      return ok;
+    }
+
+  private:
+    uint32_t hvnSeen[BLE_MAX_CONNECTION];
+};
+
+BleFanout bleFanout;
+NoteSender noteSender(bleFanout);
+#else
+NoteSender noteSender(bleLink);
+#endif
+
+/*------------------------------------------*/
+/*  reliableSender - sequence numbered      */
+/*            transfer acked by the phone   */
+/*            (build with -DNOTE_RELIABLE=1)*/
+/*  noteBase - note offset of the first     */
+/*            point in coordz, which only   */
+/*            holds the part of the note    */
+/*            not yet acked                 */
+/*------------------------------------------*/
+ReliableSender reliableSender(bleLink);
+uint16_t noteBase = 0;
+
+/*------------------------------------------*/
+/*  noteStream - note markers on the status */
+/*            characteristic, the points    */
+/*            pumped from coordz a few      */
+/*            packets per loop() pass       */
+/*            (build with -DNOTE_CHANNELS=1,*/
+/*            see Channels.h)               */
+/*------------------------------------------*/
+#if NOTE_CHANNELS
+NoteStream noteStream(bleLink);
+#endif
+
+/*------------------------------------------*/
+/*  strokeTable - where each stroke of the  */
+/*            note is in coordz, and        */
+/*            whether the phone has it      */
+/*  strokeSender - sends each stroke at its */
+/*            pen lift, DROPs the undone    */
+/*            ones (build with              */
+/*            -DNOTE_STROKES=1, see         */
+/*            Strokes.h)                    */
+/*  bleLongPress - the BLE button press     */
+/*            being released was long       */
+/*            (disconnect, not undo)        */
+/*------------------------------------------*/
+#if NOTE_STROKES
+StrokeTable strokeTable;
+StrokeSender strokeSender(bleLink, strokeTable);
+bool bleLongPress = false;
+#endif
+
+/*------------------------------------------*/
+/*  timeRecognizer - reads the time written */
+/*            in the time field of the pad  */
+/*            and sends it as TIME-n:h,m    */
+/*            (see Recognizer.h)            */
+/*  recognizeUs/recognizeWorstUs - micros() */
+/*            of the last and slowest       */
+/*            recognize() (BOOT_TIMELINE    */
+/*            prints them)                  */
+/*  TIME_CYCLES=1 - prints what recognize() */
+/*            cost at each send, counted by */
+/*            the DWT cycle counter         */
+/*------------------------------------------*/
+#if TIME_RECOGNIZER
+TimeRecognizer timeRecognizer;
+uint32_t recognizeUs = 0;
+uint32_t recognizeWorstUs = 0;
+#endif
+#ifndef TIME_CYCLES
+#define TIME_CYCLES 0
+#endif
+
+/*------------------------------------------*/
+/*  gestures - reads each stroke at the pen */
+/*            lift as a scribble / line     */
+/*            (erase) or a check mark       */
+/*            (send), see Recognizer.h      */
+/*------------------------------------------*/
+#if PEN_GESTURES
+GestureRecognizer gestures;
+#endif
+
+/*------------------------------------------*/
+/*  Startup order:                          */
+/*  setup() only does what advertising      */
+/*  needs (pins, BLE), then advertises; the */
+/*  filesystem, the date file, the OLED and */
+/*  the battery reading follow, one stage   */
+/*  per loop() pass (bootStage), while the  */
+/*  radio is already discoverable.          */
+/*  -DBOOT_DEFERRED=0 runs the stages in    */
+/*  setup() before advertising, as before.  */
+/*                                          */
+/*  bootMarks - micros() at the end of each */
+/*            phase, printed over Serial    */
+/*            once booted                   */
+/*            (-DBOOT_TIMELINE=1)           */
+/*------------------------------------------*/
+#ifndef BOOT_DEFERRED
+#define BOOT_DEFERRED 1
+#endif
+
+#ifndef BOOT_TIMELINE
+#define BOOT_TIMELINE 0
+#endif
+
+enum BootStage { BOOT_FILESYSTEM, BOOT_DISPLAY, BOOT_FIRST_FRAME, BOOT_BATTERY, BOOT_DONE };
+uint8_t bootStage = BOOT_FILESYSTEM;
+
+#if BOOT_TIMELINE
+#define BOOT_MARKS 10
+struct BootMark {
+  const char* phase;
+  uint32_t us;
+};
+BootMark bootMarks[BOOT_MARKS];
+uint8_t bootMarkCount = 0;
+
+void bootMark(const char* phase){
+  if(bootMarkCount < BOOT_MARKS){
+    bootMarks[bootMarkCount].phase = phase;
+    bootMarks[bootMarkCount].us = micros();
+    bootMarkCount++;
+  }
+}
+#else
+#define bootMark(phase)
+#endif
 
 #define MAX_BATCH_SIZE 20
 #define BATCH_SEND_INTERVAL 100
@@ -153,89 +576,154 @@ char batchBuffer[MAX_BATCH_SIZE * 15];
 /*------------------------------------------*/
 void connect_callback(uint16_t conn_handle);
 void disconnect_callback(uint16_t conn_handle, uint8_t reason);
+void control_write_callback(uint16_t conn_handle, BLECharacteristic* chr, uint8_t* data, uint16_t len);
+void ble_event_callback(ble_evt_t* event);
 void startAdv();
+void startUndirectedAdv();
+AdvertStatus currentAdvert();
+void updateAdvert();
+void adv_stop_callback();
+void secured_callback(uint16_t conn_handle);
+void loadLastPeer();
+void saveLastPeer();
 void readSensor();
+uint16_t readPad();
 void sendData();
 void dayChange();
 void monthChange();
+void sendButtonChange();
+void bleButtonChange();
 void whatsTheDate();
 void sendMessage(const char* msg);
+void sendCoordinates();
+void storePoint(const PenPoint& point);
+void endStroke();
+void gestureLift();
+void undoStroke();
+void startPointClock();
+void inkPoint(const PenPoint& point);
+void inkDone();
+void showDisplay();
+void displayService();
+void bootStep();
 
 /*--------------------------------------------------*/
 /*--                SETUP FUNCTION                --*/
 /*--------------------------------------------------*/
 void setup() {
   // Serial.begin(115200); // <- for debugging
+#if BOOT_TIMELINE || TIME_CYCLES
+  Serial.begin(115200);
+#endif
+#if TIME_CYCLES
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+  bootMark("setup");
 
   /*---------------------------------------------------*/
   /*   Pin setup for user input (sensor, button, dial) */
   /*---------------------------------------------------*/
   // set top and bottom pins to output, and initialize to low
-  pinMode(TOP_R, OUTPUT);
-  pinMode(TOP_L, OUTPUT);
-  pinMode(BOTTOM_L, OUTPUT);
-  pinMode(BOTTOM_R, OUTPUT);
-  digitalWrite(TOP_R, LOW);
-  digitalWrite(TOP_L, LOW);
-  digitalWrite(BOTTOM_L, LOW);
-  digitalWrite(BOTTOM_R, LOW);
+  pinMode(Device::Pins::topRight, OUTPUT);
+  pinMode(Device::Pins::topLeft, OUTPUT);
+  pinMode(Device::Pins::bottomLeft, OUTPUT);
+  pinMode(Device::Pins::bottomRight, OUTPUT);
+  digitalWrite(Device::Pins::topRight, LOW);
+  digitalWrite(Device::Pins::topLeft, LOW);
+  digitalWrite(Device::Pins::bottomLeft, LOW);
+  digitalWrite(Device::Pins::bottomRight, LOW);
   // set sense pin to input
-  pinMode(SENSE, INPUT);
+  pinMode(Device::Pins::sense, INPUT);
   // Buttons
-  pinMode(SEND_BUTTON, INPUT);
-  pinMode(BLE_BUTTON, INPUT);
+  pinMode(Device::Pins::sendButton, INPUT);
+  pinMode(Device::Pins::bleButton, INPUT);
   // RPGs
-  pinMode(DAY_A, INPUT);
-  pinMode(DAY_B, INPUT);
-  pinMode(MONTH_A, INPUT);
-  pinMode(MONTH_B, INPUT);
-  attachInterrupt(DAY_A, dayChange, RISING);
-  attachInterrupt(MONTH_A, monthChange, RISING);
+  pinMode(Device::Pins::dayA, INPUT);
+  pinMode(Device::Pins::dayB, INPUT);
+  pinMode(Device::Pins::monthA, INPUT);
+  pinMode(Device::Pins::monthB, INPUT);
+  attachInterrupt(Device::Pins::dayA, dayChange, RISING);
+  attachInterrupt(Device::Pins::monthA, monthChange, RISING);
+  sendButton.begin(!digitalRead(Device::Pins::sendButton), millis());
+  bleButton.begin(!digitalRead(Device::Pins::bleButton), millis());
+  attachInterrupt(Device::Pins::sendButton, sendButtonChange, CHANGE);
+  attachInterrupt(Device::Pins::bleButton, bleButtonChange, CHANGE);
   // RPG status
-  dayB_status = digitalRead(DAY_B);
-  monthB_status = digitalRead(MONTH_B);
+  dayB_status = digitalRead(Device::Pins::dayB);
+  monthB_status = digitalRead(Device::Pins::monthB);
 
   /*---------------------------------------------------*/
   /*    ADC and coordinate filtering/averaging setup   */
+  /*    (the battery is read in the BOOT_BATTERY stage)*/
   /*---------------------------------------------------*/
   numEntriesSame = 0;
 
-  analogReadResolution(14);
+  analogReadResolution(Device::Pad::adcBits);
+#if PAD_RATIOMETRIC
+  analogReference(AR_VDD4);
+#else
   analogReference(AR_INTERNAL_2_4);
-
-  float measuredvbat = analogRead(VBATPIN);
-  measuredvbat *= 2;    
-  measuredvbat *= 2.4;  // Multiply by 2.4V
-  measuredvbat /= 16384; // convert to voltage
- 
-  batteryPercent = (measuredvbat/3.7) * 100;
-  batteryChange = 0;
-  batteryCheckTime = millis();
+#endif
 
   /*---------------------------------------------------*/
   /*    Initialize Coordinate Processing Variables     */
   /*---------------------------------------------------*/
   last_x = 0; 
   last_y = 0;
-  filtered_x = 0;
-  filtered_y = 0;
-  avg_x = last_avg_x = last_avg_x_2 = last_avg_x_3 = last_avg_x_4 = 0;
-  avg_y = last_avg_y = last_avg_y_2 = last_avg_y_3 = last_avg_y_4 = 0;
-  temp_x = temp_x_2 = temp_x_3 = temp_x_4 = 0;
-  temp_y = temp_y_2 = temp_y_3 = temp_y_4 = 0;
+  penFilter.reset();
+
+#if TIME_RECOGNIZER
+  timeRecognizer.begin();
+#endif
+#if PEN_GESTURES
+  gestures.begin();
+#endif
+
+  /*---------------------------------------------------*/
+  /*  DATE DEFAULTS (1/1 until BOOT_FILESYSTEM reads   */
+  /*  the saved date)                                  */
+  /*---------------------------------------------------*/
+  day = 1;
+  month = 1;
+  monthTime = 0;
+  dayTime = 0;
+  lastMonth = 0;  // nothing drawn yet, so the first frame shows the date
+  lastDay = 0;
 
+  coordz.clear();
+#if NOTE_LATENCY
+  noteSender.tracer = &latencyTracer;
+#endif
+  isConnected = false; //Bluetooth is not connected
+  lastConnected = true; // so BT status is printed for the first time
+  bootMark("pins");
 
   /*---------------------------------------------------*/
   /*    Bluetooth BLE CONFIG                           */
   /*---------------------------------------------------*/
   Bluefruit.configPrphBandwidth(BANDWIDTH_MAX);
+#if BLE_BONDING
+  Bluefruit.configServiceChanged(true);
+#endif
+#if NOTE_CENTRALS > 1
+  Bluefruit.begin(NOTE_CENTRALS, 0);   // BANDWIDTH_MAX buffers for every one of them
+  Bluefruit.setEventCallback(ble_event_callback);
+#else
   Bluefruit.begin();
-  Bluefruit.setTxPower(8); // Increased from 4 to 8 for better range and stability
-  Bluefruit.setName("very cool calendar we made");
+#endif
+  Bluefruit.setTxPower(Device::Ble::txPower);
+  Bluefruit.setName(Device::Ble::name);
 
   // Set up callbacks
   Bluefruit.Periph.setConnectCallback(connect_callback);
   Bluefruit.Periph.setDisconnectCallback(disconnect_callback);
+  Bluefruit.Advertising.setStopCallback(adv_stop_callback);
+#if BLE_BONDING
+  Bluefruit.Security.setSecuredCallback(secured_callback);
+  loadLastPeer();
+#endif
 
   // Configure device information service
   bledis.setManufacturer("Aeris");
@@ -251,8 +739,12 @@ void setup() {
 
   // Configure the characteristic
   dataCharacteristic.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
+#if BLE_BONDING
+  dataCharacteristic.setPermission(SECMODE_ENC_NO_MITM, SECMODE_NO_ACCESS);
+#else
   dataCharacteristic.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
-  dataCharacteristic.setMaxLen(20); // Maximum payload size
+#endif
+  dataCharacteristic.setMaxLen(NOTE_MAX_PAYLOAD); // Maximum payload size (packed framings fill the MTU)
   dataCharacteristic.setFixedLen(false); // Variable length data
   dataCharacteristic.begin();
   
@@ -260,60 +752,120 @@ void setup() {
   uint8_t initialValue[] = "INIT";
   dataCharacteristic.write(initialValue, sizeof(initialValue) - 1);
 
+#if NOTE_CHANNELS
+  // Status characteristic: the note markers, ahead of the points
+  statusCharacteristic.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
+#if BLE_BONDING
+  statusCharacteristic.setPermission(SECMODE_ENC_NO_MITM, SECMODE_NO_ACCESS);
+#else
+  statusCharacteristic.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
+#endif
+  statusCharacteristic.setMaxLen(STATUS_MAX_LEN);
+  statusCharacteristic.setFixedLen(false);
+  statusCharacteristic.begin();
+#endif
+
+  // Control characteristic: the phone writes acks here (no response needed)
+  controlCharacteristic.setProperties(CHR_PROPS_WRITE_WO_RESP);
+#if BLE_BONDING
+  controlCharacteristic.setPermission(SECMODE_NO_ACCESS, SECMODE_ENC_NO_MITM);
+#else
+  controlCharacteristic.setPermission(SECMODE_NO_ACCESS, SECMODE_OPEN);
+#endif
+  controlCharacteristic.setMaxLen(RELIABLE_ACK_MAX_LEN);
+  controlCharacteristic.setFixedLen(false);
+  controlCharacteristic.setWriteCallback(control_write_callback);
+  controlCharacteristic.begin();
+  bootMark("ble");
+
+#if !BOOT_DEFERRED
+  while(bootStage != BOOT_DONE){
+    bootStep();
+  }
+#endif
 
-  /*---------------------------------------------------*/
-  /*  DATE SETUP (find previous value from previous    */
-  /*  instance if it exists, otherwise: 1/1)           */
-  /*---------------------------------------------------*/
-  day = 1;
-  month = 1;
-  monthTime = 0;
-  dayTime = 0;
-  lastMonth = 1;
-  lastDay = 1;
-
-  // FILE SETUP/READ SAVED DATE (if it exists)
-  InternalFS.begin();
+  startAdv();
+  bootMark("advertising");
+}
 
-  file.open(DATES, FILE_O_READ);
+/*--------------------------------------------------*/
+/*--                  bootStep()                  --*/
+/*--------------------------------------------------*/
+/*    Runs the next startup stage that advertising  */
+/*    does not need. Called from loop() until       */
+/*    bootStage is BOOT_DONE, one stage per pass,   */
+/*    so a connecting phone is served in between.   */
+/*--------------------------------------------------*/
+void bootStep(){
+  switch(bootStage){
+    case BOOT_FILESYSTEM:
+      // FILE SETUP/READ SAVED DATE (if it exists)
+      InternalFS.begin();
 
-  if(file){
-    uint32_t len;
-    char buffer[64] = {0};
+      file.open(DATES, FILE_O_READ);
 
-    len = file.read(buffer, sizeof(buffer));
-    buffer[len] = 0;
+      if(file){
+        uint32_t len;
+        char buffer[64] = {0};
 
-    sscanf(buffer, "%d,%d", &month, &day); //update the month and day values
+        len = file.read(buffer, sizeof(buffer) - 1);
+        buffer[len] = 0;
 
-    file.close();
-  }
+        sscanf(buffer, "%d,%d", &month, &day); //update the month and day values
 
-  //set month string to hold the correct month name
-  int i = month - 1;
-  m = (String[])months[i];
+        file.close();
+      }
 
-  /*---------------------------------------------------*/
-  /*    OLED SCREEN CONFIG                             */
-  /*---------------------------------------------------*/
-  if(!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
-    for(;;); // Don't proceed, loop forever
-  }
+      // a damaged file must not index past the month tables
+      if(month < 1 || month > 12){
+        month = 1;
+      }
+      if(day < 1 || day > Device::Dates::lastDay(month)){
+        day = 1;
+      }
+      bootMark("filesystem");
+      break;
 
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE, 0);
+    case BOOT_DISPLAY:
+      // OLED SCREEN CONFIG
+      if(!display.begin(SSD1306_SWITCHCAPVCC, Device::Pins::oledAddress)) {
+        for(;;); // Don't proceed, loop forever
+      }
 
-  /*---------------------------------------------------*/
-  /*    Final initializations                          */
-  /*---------------------------------------------------*/
-  entriesCollected = 0;
-  isConnected = false; //Bluetooth is not connected
-  lastConnected = true; // so BT status is printed for the first time
-  
-  whatsTheDate(); //print out the system status to the OLED
+      display.clearDisplay();
+      display.setTextSize(1);
+      display.setTextColor(SSD1306_WHITE, 0);
+#if INK_MIRROR
+      inkMirror.setFrame(display.getBuffer());   // allocated by begin()
+#endif
+#if OLED_DMA
+      // begin() sent the init commands through Wire; frames go by DMA
+      Wire.end();
+      oled.begin();
+#endif
+      bootMark("display");
+      break;
+
+    case BOOT_FIRST_FRAME:
+      whatsTheDate(); //print out the system status to the OLED
+      bootMark("first frame");
+      break;
+
+    case BOOT_BATTERY:
+    {
+      // one blocking sample seeds the gauge; whatsTheDate() shows it
+      uint16_t mv;
+      batteryAdc.start();
+      if(batteryAdc.collect(&mv)){
+        batteryGauge.addSample(mv);
+      }
+      batterySampleMs = millis();
+      bootMark("battery");
+      break;
+    }
+  }
 
-  startAdv();
+  bootStage++;
 }
 
 
@@ -322,40 +874,128 @@ int urmom = 0;
 /*--                  MAIN LOOP                   --*/
 /*--------------------------------------------------*/
 void loop() {
+  // the OLED and the saved date come up after advertising has started
+  if(bootStage != BOOT_DONE){
+    bootStep();
+    return;
+  }
+
+#if BOOT_TIMELINE
+  // micros() since reset at the end of each phase, once
+  static bool bootPrinted = false;
+  if(!bootPrinted){
+    bootPrinted = true;
+    for(uint8_t i = 0; i < bootMarkCount; i++){
+      Serial.printf("boot %-12s %8lu us\n", bootMarks[i].phase, (unsigned long)bootMarks[i].us);
+    }
+  }
+
+  // power-on or link drop to the first notify the phone got
+  if(firstNotifyMs){
+    BLEConnection* conn = Bluefruit.Connection(Bluefruit.connHandle());
+    Serial.printf("reconnect %lu ms to first notify (%s)\n", (unsigned long)firstNotifyMs,
+                  conn && conn->bonded() ? "bonded" : "not bonded");
+    firstNotifyMs = 0;
+  }
+
+  // CPU and bus time of the last full OLED frame, when it changes
+  static uint32_t displayPrintedUs = 0;
+  if(displayWireUs != displayPrintedUs){
+    displayPrintedUs = displayWireUs;
+    Serial.printf("display frame %lu us cpu, %lu us on the bus\n", (unsigned long)displayCpuUs,
+                  (unsigned long)displayWireUs);
+  }
+
+#if TIME_RECOGNIZER
+  // the time field read at the last send, and the slowest so far
+  static uint32_t recognizePrintedUs = 0;
+  if(recognizeUs != recognizePrintedUs){
+    recognizePrintedUs = recognizeUs;
+    Serial.printf("time field %lu us, worst %lu us\n", (unsigned long)recognizeUs,
+                  (unsigned long)recognizeWorstUs);
+  }
+#endif
+#endif
+
+  // VBAT started at the end of the last pass, done long before the touch reads
+  uint16_t vbatMv;
+  if(batteryAdc.collect(&vbatMv)){
+    batteryGauge.addSample(vbatMv);
+  }
+
   whatsTheDate();
+  displayService();
 
-  // Check if Send button is pressed (debounced)
-  if(!digitalRead(SEND_BUTTON)){
-    unsigned long currentTime = millis();
-    if (currentTime - lastButtonPress > debounceTime) {
-      lastButtonPress = currentTime;
+#if NOTE_LATENCY
+  if(isConnected){
+    latencyTracer.service(noteSender, micros());
+  }
+#endif
+
+  // Send button: a press sends the note (a second one within
+  // BUTTON_DOUBLE_MS is a double press and ignored, as the old 300 ms
+  // debounce did); sampling goes on while it is held
+  ButtonEvent event;
+  while((event = sendButton.poll(millis())) != BUTTON_NONE){
+    if(event == BUTTON_PRESS){
       // for(int i = 0; i <= entriesCollected; i++){
       //   char coordBuffer[20];
       //   sprintf(coordBuffer, "C:%d,%d", coordz[i][0], coordz[i][1]);
       //   sendMessage(coordBuffer);
       // }
-      entriesCollected = 0;
       sendData();
-      while (!digitalRead(SEND_BUTTON)) delay(10); // Wait for button release
     }
   }
 
-  // Check if BLE button is held for disconnect
-  if(!digitalRead(BLE_BUTTON)){
-    int timeStart = millis();
-    while(!digitalRead(BLE_BUTTON)){
-      int timeEnd = millis();
-      int timeHeld = timeEnd - timeStart;
-      
-      if(timeHeld >= 2000){
-        Bluefruit.disconnect(Bluefruit.connHandle());
-        break;
+  // BLE button held for BUTTON_LONG_MS: disconnect; with NOTE_STROKES a
+  // short press takes back the last stroke
+  while((event = bleButton.poll(millis())) != BUTTON_NONE){
+#if NOTE_STROKES
+    if(event == BUTTON_PRESS){
+      bleLongPress = false;
+    }
+    else if(event == BUTTON_RELEASE && !bleLongPress && !strokeSender.closed()){
+      undoStroke();
+    }
+    else if(event == BUTTON_LONG_PRESS){
+      bleLongPress = true;
+    }
+#endif
+    if(event == BUTTON_LONG_PRESS && Bluefruit.connected()){
+      userDisconnect = true;   // advertise normally afterwards
+#if NOTE_CENTRALS > 1
+      for(uint16_t conn = 0; conn < BLE_MAX_CONNECTION; conn++){
+        if(Bluefruit.connected(conn)){
+          Bluefruit.disconnect(conn);
+        }
       }
+#else
+      Bluefruit.disconnect(Bluefruit.connHandle());
+#endif
     }
   }
 
-  // Read from the sensor if connected, and periodically send data
+#if NOTE_RELIABLE
+  // finish a note that was cut off (stall or disconnect) before sampling more
+  if(isConnected && !reliableSender.complete()){
+    sendCoordinates();
+  }
+#elif NOTE_STROKES
+  // strokes go out between readings; a closed note is finished first
   if(isConnected){
+    strokeSender.service();
+    if(strokeSender.closed() && !strokeSender.complete()){
+      sendCoordinates();
+    }
+  }
+#endif
+
+  // Read from the sensor if connected, and periodically send data
+#if NOTE_STROKES
+  if(isConnected && !strokeSender.closed()){
+#else
+  if(isConnected && reliableSender.complete()){
+#endif
     readSensor();
     
     // if(entriesCollected > 99){
@@ -382,21 +1022,39 @@ void loop() {
     // }
   }
 
-  if(entriesCollected > 950){
-    display.setCursor(100, 5);
-    display.print("WAIT");
-    display.display();
-    for(int i = 0; i < entriesCollected; i++){
-      char coordBuffer[7];
-      sprintf(coordBuffer, "C:%d,%d", coordz[i][0], coordz[i][1]);
-      sendMessage(coordBuffer);
+#if NOTE_CHANNELS
+  // a few packets of points per pass, so a SEND press is never stuck behind them
+  if(isConnected){
+    noteStream.service(coordz);
+    if(noteStream.idle(coordz)){
+      coordz.clear();
+      noteStream.cleared();
     }
-    display.setCursor(100, 5);
-    display.print(" ok ");
-    display.display();
-    entriesCollected = 0;
+  }
+#endif
+
+#if NOTE_CENTRALS > 1
+  // the packets a slower central could not take yet
+  bleFanout.service();
+#endif
+
+  // pending notes / fill / battery in the advertising, when it runs
+  updateAdvert();
+
+  // flush before coordz (or the stroke table) fills up
+#if NOTE_STROKES
+  if(coordz.bytes() > COORD_BYTES - COORD_BYTES / 20 || !strokeTable.room()){
+#else
+  if(coordz.bytes() > COORD_BYTES - COORD_BYTES / 20){
+#endif
+    sendCoordinates();
   }
 
+  // converts while the rest of the loop and the next whatsTheDate() run
+  if(millis() - batterySampleMs >= BATTERY_PERIOD_MS){
+    batterySampleMs = millis();
+    batteryAdc.start();
+  }
 }
 
 /*--------------------------------------------------*/
@@ -406,8 +1064,395 @@ void loop() {
 /*    proper format                                 */
 /*--------------------------------------------------*/
 void sendMessage(const char* msg) {
-  // Use notify instead of write to enable notifications on Android
-  dataCharacteristic.notify((uint8_t*)msg, strlen(msg));
+  noteSender.sendMessage(msg);
+}
+
+/*--------------------------------------------------*/
+/*--              sendCoordinates()               --*/
+/*--------------------------------------------------*/
+/*    Flushes everything in coordz to the phone,    */
+/*    showing "WAIT" on the OLED while it sends.    */
+/*    In reliable mode coordz is only cleared once  */
+/*    the phone has acked it ("HOLD" until then).   */
+/*    With NOTE_STROKES it waits for the phone to   */
+/*    hold every stroke; the open one is cut at     */
+/*    the flush and goes on as a new stroke.        */
+/*--------------------------------------------------*/
+void sendCoordinates(){
+  display.setCursor(100, 5);
+  display.print("WAIT");
+  showDisplay();
+
+#if NOTE_RELIABLE
+  reliableSender.setPoints(coordz, noteBase);
+  if(!reliableSender.transmit(RELIABLE_STALL_MS)){
+    display.setCursor(100, 5);
+    display.print("HOLD");
+    showDisplay();
+    return;
+  }
+
+  noteBase += coordz.count();
+  if(reliableSender.closed()){
+    reliableSender.nextNote();
+    noteBase = 0;
+#if NOTE_TIMESTAMPS
+    startPointClock();
+#endif
+  }
+#elif NOTE_CHANNELS
+  noteStream.drain(coordz);
+  noteStream.cleared();
+#elif NOTE_STROKES
+  strokeSender.setPoints(coordz);
+  strokeTable.lift();
+  if(!strokeSender.transmit(STROKE_STALL_MS)){
+    display.setCursor(100, 5);
+    display.print("HOLD");
+    showDisplay();
+    return;
+  }
+
+  if(strokeSender.closed()){
+    strokeSender.nextNote();
+#if NOTE_TIMESTAMPS
+    startPointClock();
+#endif
+  }
+  else{
+    strokeTable.forget();   // undo stops at a flush
+#if TIME_RECOGNIZER
+    timeRecognizer.keep();
+#endif
+  }
+#else
+  noteSender.sendPoints(coordz);
+#endif
+
+  display.setCursor(100, 5);
+  display.print(" ok ");
+  showDisplay();
+
+  coordz.clear();
+#if PEN_GESTURES
+  gestures.reset();
+#endif
+}
+
+/*--------------------------------------------------*/
+/*--                 storePoint()                 --*/
+/*--------------------------------------------------*/
+/*    Keeps one pen point for sending (coordz only  */
+/*    fills up if the phone stops acking) and hands */
+/*    it to the time field and the gestures.        */
+/*--------------------------------------------------*/
+void storePoint(const PenPoint& point){
+#if NOTE_STROKES
+  if(coordz.room() && strokeTable.room()){
+    strokeTable.add(coordz.count(), point.x, point.y, point.strokeStart);
+#else
+  if(coordz.room()){
+#endif
+#if PEN_GESTURES
+    gestures.addPoint(point.x, point.y, point.strokeStart, coordz.count());
+#endif
+#if NOTE_TIMESTAMPS
+    uint32_t ticks = pointClock.ticks(point.us);
+    coordz.append(point.x, point.y, point.strokeStart, ticks);
+#if NOTE_LATENCY
+    latencyTracer.stored(ticks, point.us, micros());
+#endif
+#else
+    coordz.append(point.x, point.y, point.strokeStart);
+#endif
+  }
+
+#if INK_MIRROR
+  inkPoint(point);
+#endif
+
+#if TIME_RECOGNIZER
+  timeRecognizer.addPoint(point.x, point.y, point.strokeStart);
+#endif
+}
+
+#if NOTE_TIMESTAMPS
+/*--------------------------------------------------*/
+/*--              startPointClock()               --*/
+/*--------------------------------------------------*/
+/*    A note starts: the ticks of its first point   */
+/*    count from here.                              */
+/*--------------------------------------------------*/
+void startPointClock(){
+  uint32_t now = micros();
+  pointClock.start(now);
+#if NOTE_LATENCY
+  latencyTracer.start(now);
+#endif
+}
+#endif
+
+/*--------------------------------------------------*/
+/*--                 endStroke()                  --*/
+/*--------------------------------------------------*/
+/*    The pen was lifted (or the note is being      */
+/*    sent): keep where the stroke really ended.    */
+/*    Called on every pen-up reading; only the      */
+/*    first after a stroke stores anything, and the */
+/*    next point starts a new stroke.               */
+/*--------------------------------------------------*/
+void endStroke(){
+#if PEN_RESAMPLE
+  PenPoint point;
+  if(resampler.finish(&point)){
+    storePoint(point);
+  }
+#endif
+}
+
+#if PEN_GESTURES
+/*--------------------------------------------------*/
+/*--                gestureLift()                 --*/
+/*--------------------------------------------------*/
+/*    The pen is up: if the stroke was a gesture,   */
+/*    it and what it erased leave coordz, and a     */
+/*    check mark sends the note. Called on every    */
+/*    pen-up reading; only the first after a        */
+/*    stroke does anything. The OLED ink mirror     */
+/*    keeps the erased ink until the note is sent.  */
+/*--------------------------------------------------*/
+void gestureLift(){
+  uint16_t keep;
+  char gesture = gestures.strokeDone(&keep);
+  if(!gesture){
+    return;
+  }
+
+#if NOTE_STROKES
+  strokeTable.truncate(coordz, keep);
+#else
+  coordz.truncate(keep);
+#endif
+  if(gesture == GESTURE_SEND){
+    sendData();
+  }
+}
+#endif
+
+#if NOTE_STROKES
+/*--------------------------------------------------*/
+/*--                 undoStroke()                 --*/
+/*--------------------------------------------------*/
+/*    Takes the last stroke out of coordz and out   */
+/*    of everything that saw it: the time field and */
+/*    the gestures are rebuilt from what is left in */
+/*    coordz, and the ink mirror draws the stroke   */
+/*    over in black, then the rest again where it   */
+/*    crossed it. Ink from before a flush is not in */
+/*    coordz and is not redrawn.                    */
+/*--------------------------------------------------*/
+void undoStroke(){
+  uint16_t first;
+  if(!strokeTable.undoFrom(&first)){
+    return;
+  }
+
+#if INK_MIRROR
+  if(inkShowing){
+    inkMirror.setErase(true);
+    for(uint16_t i = first; i < coordz.count(); i++){
+      StoredPoint point = coordz.at(i);
+      inkMirror.addPoint(point.x, point.y, point.strokeStart || i == first);
+    }
+    inkMirror.setErase(false);
+  }
+#endif
+
+  strokeTable.undo(coordz);
+#if PEN_GESTURES
+  gestures.truncate(coordz.count());
+#endif
+#if TIME_RECOGNIZER
+  timeRecognizer.rewind();
+#endif
+
+  for(uint16_t i = 0; i < coordz.count(); i++){
+    StoredPoint point = coordz.at(i);
+    bool strokeStart = point.strokeStart || i == 0;
+#if TIME_RECOGNIZER
+    timeRecognizer.addPoint(point.x, point.y, strokeStart);
+#endif
+#if INK_MIRROR
+    if(inkShowing){
+      inkMirror.addPoint(point.x, point.y, strokeStart);
+    }
+#endif
+  }
+
+#if INK_MIRROR && OLED_DMA
+  displayService();
+#elif INK_MIRROR
+  if(inkMirror.dirty()){
+    inkMirror.flush(inkSendRun, NULL);
+  }
+#endif
+}
+#endif
+
+#if INK_MIRROR
+/*--------------------------------------------------*/
+/*--                 inkSendRun()                 --*/
+/*--------------------------------------------------*/
+/*    Sends the columns first..last of one page to  */
+/*    the SSD1306 instead of the whole frame that   */
+/*    display() would (1 KB, ~25 ms at 400 kHz).    */
+/*--------------------------------------------------*/
+void inkSendRun(uint8_t page, uint8_t first, uint8_t last, const uint8_t* bytes, void* context){
+  display.ssd1306_command(SSD1306_PAGEADDR);
+  display.ssd1306_command(page);
+  display.ssd1306_command(page);
+  display.ssd1306_command(SSD1306_COLUMNADDR);
+  display.ssd1306_command(first);
+  display.ssd1306_command(last);
+
+  Wire.setClock(INK_I2C_CLOCK);
+  uint8_t count = last - first + 1;
+  while(count > 0){
+    uint8_t chunk = count < INK_I2C_CHUNK ? count : INK_I2C_CHUNK;
+    Wire.beginTransmission(Device::Pins::oledAddress);
+    Wire.write((uint8_t)0x40);   // data follows
+    Wire.write(bytes, chunk);
+    Wire.endTransmission();
+    bytes += chunk;
+    count -= chunk;
+  }
+  Wire.setClock(INK_I2C_RESTORE);
+}
+
+/*--------------------------------------------------*/
+/*--                  inkPoint()                  --*/
+/*--------------------------------------------------*/
+/*    The first point of a note blanks the OLED     */
+/*    (one full display()); after that each point   */
+/*    only sends the pages its line touched, and    */
+/*    nothing at all if it landed on a lit pixel.   */
+/*--------------------------------------------------*/
+void inkPoint(const PenPoint& point){
+  if(!inkShowing){
+    display.clearDisplay();
+    inkMirror.clear();
+    showDisplay();
+    inkShowing = true;
+  }
+
+  inkMirror.addPoint(point.x, point.y, point.strokeStart);
+#if OLED_DMA
+  displayService();
+#else
+  if(inkMirror.dirty()){
+    inkMirror.flush(inkSendRun, NULL);
+  }
+#endif
+}
+
+/*--------------------------------------------------*/
+/*--                  inkDone()                   --*/
+/*--------------------------------------------------*/
+/*    The note was sent: back to the date screen.   */
+/*--------------------------------------------------*/
+void inkDone(){
+  if(inkShowing){
+    inkShowing = false;
+    display.clearDisplay();
+    statusRedraw = true;
+  }
+}
+#endif
+
+#if OLED_DMA && INK_MIRROR
+/*--------------------------------------------------*/
+/*--                inkQueueRun()                 --*/
+/*--------------------------------------------------*/
+/*    inkSendRun() for OLED_DMA: the run is copied  */
+/*    into the transfer, displayService() starts    */
+/*    it once every touched page is queued.         */
+/*--------------------------------------------------*/
+void inkQueueRun(uint8_t page, uint8_t first, uint8_t last, const uint8_t* bytes, void* context){
+  oled.queue(page, page, first, last, bytes);
+}
+
+// a full frame is going out anyway
+void inkSkipRun(uint8_t page, uint8_t first, uint8_t last, const uint8_t* bytes, void* context){
+}
+#endif
+
+#if OLED_DMA
+/*--------------------------------------------------*/
+/*--                displaySent()                 --*/
+/*--------------------------------------------------*/
+/*    Runs in the TWIM interrupt once a transfer    */
+/*    is out; the next one is left to the loop, so  */
+/*    the framebuffer is never read mid-drawing.    */
+/*--------------------------------------------------*/
+void displaySent(void* context){
+  if(context){
+    displayWireUs = micros() - displayStartUs;
+  }
+}
+#endif
+
+/*--------------------------------------------------*/
+/*--                showDisplay()                 --*/
+/*--------------------------------------------------*/
+/*    display.display() spins for the whole 1 KB.   */
+/*    With OLED_DMA the frame is copied and sent    */
+/*    by TWIM1; one drawn while the last is still   */
+/*    going out waits for displayService().         */
+/*--------------------------------------------------*/
+void showDisplay(){
+#if OLED_DMA
+  displayPending = true;
+  displayService();
+#else
+  uint32_t start = micros();
+  display.display();
+  displayCpuUs = displayWireUs = micros() - start;
+#endif
+}
+
+/*--------------------------------------------------*/
+/*--               displayService()               --*/
+/*--------------------------------------------------*/
+/*    Starts the next transfer once TWIM1 is free:  */
+/*    a pending frame, or else the pages the ink    */
+/*    touched. Called from the loop.                */
+/*--------------------------------------------------*/
+void displayService(){
+#if OLED_DMA
+  if(oled.busy()){
+    return;
+  }
+
+  if(displayPending){
+    uint32_t start = micros();
+    displayPending = false;
+#if INK_MIRROR
+    inkMirror.flush(inkSkipRun, NULL);
+#endif
+    oled.queue(0, SCREEN_HEIGHT / 8 - 1, 0, SCREEN_WIDTH - 1, display.getBuffer());
+    displayStartUs = start;
+    oled.start(displaySent, &displayStartUs);
+    displayCpuUs = micros() - start;
+    return;
+  }
+
+#if INK_MIRROR
+  if(inkShowing && inkMirror.dirty()){
+    inkMirror.flush(inkQueueRun, NULL);
+    oled.start(displaySent, NULL);
+  }
+#endif
+#endif
 }
 
 /*--------------------------------------------------*/
@@ -415,122 +1460,62 @@ void sendMessage(const char* msg) {
 /*--------------------------------------------------*/
 /*    Reads in ADC values for x and y. Shifts       */
 /*    values to more readable coordinates. Filters  */
-/*    the coordinates then averages them before     */
-/*    sending.                                      */
+/*    them (PEN_FILTER, lib/Pen/PenFilter.h) before */
+/*    storing.                                      */
 /*--------------------------------------------------*/
 void readSensor(){
     // set up pins to read in X coordinate
-    digitalWrite(TOP_R, HIGH);
-    digitalWrite(TOP_L, HIGH);
-    digitalWrite(BOTTOM_L, LOW);
-    digitalWrite(BOTTOM_R, LOW);
+    digitalWrite(Device::Pins::topRight, HIGH);
+    digitalWrite(Device::Pins::topLeft, HIGH);
+    digitalWrite(Device::Pins::bottomLeft, LOW);
+    digitalWrite(Device::Pins::bottomRight, LOW);
     
     delay(1);
     // read in x position
-    x_raw = analogRead(SENSE);
+    x_raw = readPad();
 
     // set up pins to read in Y coordinate
-    digitalWrite(TOP_R, HIGH);
-    digitalWrite(TOP_L, LOW);
-    digitalWrite(BOTTOM_L, HIGH);
-    digitalWrite(BOTTOM_R, LOW);
+    digitalWrite(Device::Pins::topRight, HIGH);
+    digitalWrite(Device::Pins::topLeft, LOW);
+    digitalWrite(Device::Pins::bottomLeft, HIGH);
+    digitalWrite(Device::Pins::bottomRight, LOW);
 
     delay(1);
     // read in y position
-    y_raw = analogRead(SENSE);
+    y_raw = readPad();
 
     // check if the read value is within the limits for the sensor
-    if(x_raw>=8000 && y_raw >= 8000){
+    if(x_raw >= Device::Pad::touchMin && y_raw >= Device::Pad::touchMin){
       // shift and scale the coordinates to better numbers 
-      y_pos = ((x_raw - X_MAX) * -1)/1;
-      x_pos = ((y_raw - Y_MAX) * -1)/1.25;
+      y_pos = ((x_raw - Device::Pad::xMax) * -1)/1;
+      x_pos = ((y_raw - Device::Pad::yMax) * -1)/1.25;
 
       // calculate the difference between the last value and current
       delX = last_x - x_pos;
       delY = last_y - y_pos;
 
       // if the difference is too large, assume sensor not reading input from the user
-      if(abs(delX)<250 && abs(delY)<250){
+      if(abs(delX) < Device::Pad::jumpMax && abs(delY) < Device::Pad::jumpMax){
         // do not perform calcualtions if the coordinates read in are the same as the previous reading's coordinates
         if(x_pos != last_x || y_pos != last_y){
-          // filter the coordinates (if there are no previous filtered values, just set to current x and y)
-          if(filtered_x != 0 && filtered_y != 0){
-            filtered_x = (coeff * x_pos) + (1 - coeff) * filtered_x;
-            filtered_y = (coeff * y_pos) + (1 - coeff) * filtered_y; 
-          }
-          else{
-            filtered_x = x_pos;
-            filtered_y = y_pos;
-          }
-
-          // average the coordinates with up to 5 of the most recent averages
-          if(avg_x != 0 && avg_y != 0){
-            /*----------------------------------------------------------*/
-            /* - keep track of the previous reading's averages -        */
-            /*                                                          */
-            /* before the averaging of the current loop:                */
-            /* - filtered_x/y holds the current value                   */
-            /* - avg_x/y holds the previous average                     */ 
-            /* - last_avg_x/y holds the average from two loops ago      */
-            /* - last_avg_x/y_2 holds the average from three loops ago  */
-            /* - last_avg_x/y_3 holds the average from four loops ago   */
-            /* - last_avg_x/y_4 holds the average from five loops ago   */
-            /*----------------------------------------------------------*/
-            temp_x = avg_x; 
-            temp_y = avg_y;
-            temp_x_2 = last_avg_x; 
-            temp_y_2 = last_avg_y;
-            temp_x_3 = last_avg_x_2; 
-            temp_y_3 = last_avg_y_2;
-            temp_x_4 = last_avg_x_3; 
-            temp_y_4 = last_avg_y_3;
-
-            // average the coordinates based on how many averages have been calculated per user input
-            if(last_avg_x_4 != 0 && last_avg_y_4 != 0){
-              avg_x = (last_avg_x_4 + last_avg_x_3 + last_avg_x_2 + last_avg_x + avg_x + filtered_x)/6;
-              avg_y = (last_avg_y_4 + last_avg_y_3 + last_avg_y_2 + last_avg_y + avg_y + filtered_y)/6;
-            }
-            else if(last_avg_x_3 != 0 && last_avg_y_3 != 0){
-              avg_x = (last_avg_x_3 + last_avg_x_2 + last_avg_x + avg_x + filtered_x)/5;
-              avg_y = (last_avg_y_3 + last_avg_y_2 + last_avg_y + avg_y + filtered_y)/5;
-            }
-            else if(last_avg_x_2 != 0 && last_avg_y_2 != 0){
-              avg_x = (last_avg_x_2 + last_avg_x + avg_x + filtered_x)/4;
-              avg_y = (last_avg_y_2 + last_avg_y + avg_y + filtered_y)/4;
-            }
-            else if(last_avg_x !=0 && last_avg_y != 0){
-              avg_x = (last_avg_x + avg_x + filtered_x)/3;
-              avg_y = (last_avg_y + avg_y + filtered_y)/3;
-            }
-            else{
-              avg_x = (avg_x + filtered_x)/2;
-              avg_y = (avg_y + filtered_y)/2;
-            }
-
-            // update the values of the previous averages
-            last_avg_x = temp_x;
-            last_avg_y = temp_y;
-            last_avg_x_2 = temp_x_2;
-            last_avg_y_2 = temp_y_2;
-            last_avg_x_3 = temp_x_3;
-            last_avg_y_3 = temp_y_3;
-            last_avg_x_4 = temp_x_4;
-            last_avg_y_4 = temp_y_4;
+          // filter the coordinates; the first reading after a reset starts a stroke
+          uint32_t now = micros();
+          boolean strokeStart = penFilter.add(x_pos, y_pos, now);
+          
+          // Store coordinates for sending, evenly spaced along the stroke
+#if PEN_RESAMPLE
+          if(strokeStart){
+            endStroke();
           }
-          else{
-            avg_x = filtered_x;
-            avg_y = filtered_y;
+          PenPoint point;
+          resampler.add(penFilter.x(), penFilter.y(), now);
+          while(resampler.next(&point)){
+            storePoint(point);
           }
-          
-          // Store coordinates for sending
-          coordz[entriesCollected][0] = avg_x;
-          coordz[entriesCollected][1] = avg_y;
-
-          // char coordBuffer[7];
-          // sprintf(coordBuffer, "C:%d,%d", avg_x, avg_y);
-          // sendMessage(coordBuffer);
-          // urmom++;
-          entriesCollected++;
+#else
+          PenPoint point = {penFilter.x(), penFilter.y(), now, (bool)strokeStart};
+          storePoint(point);
+#endif
           // Serial.println(urmom);
           
           numEntriesSame = 0;
@@ -540,18 +1525,7 @@ void readSensor(){
 
           // Reset values if the same coordinates are read multiple times
           if(numEntriesSame >= 5){
-            filtered_x = 0;
-            filtered_y = 0;
-            avg_x = 0;
-            avg_y = 0;
-            last_avg_x = 0;
-            last_avg_y = 0;
-            last_avg_x_2 = 0;
-            last_avg_y_2 = 0;
-            last_avg_x_3 = 0;
-            last_avg_y_3 = 0;
-            last_avg_x_4 = 0;
-            last_avg_y_4 = 0;
+            penFilter.reset();
 
             numEntriesSame = 0;
           }
@@ -559,52 +1533,26 @@ void readSensor(){
       }
       else {
         // Reset values if coordinate change is too large
-        filtered_x = 0;
-        filtered_y = 0;
-        avg_x = 0;
-        avg_y = 0;
-        last_avg_x = 0;
-        last_avg_y = 0;
-        last_avg_x_2 = 0;
-        last_avg_y_2 = 0;
-        last_avg_x_3 = 0;
-        last_avg_y_3 = 0;
-        last_avg_x_4 = 0;
-        last_avg_y_4 = 0;
+        penFilter.reset();
 
       }
     }
     else {
       // Reset values if coordinates are outside bounds
-      filtered_x = 0;
-      filtered_y = 0;
-      avg_x = 0;
-      avg_y = 0;
-      last_avg_x = 0;
-      last_avg_y = 0;
-      last_avg_x_2 = 0;
-      last_avg_y_2 = 0;
-      last_avg_x_3 = 0;
-      last_avg_y_3 = 0;
-      last_avg_x_4 = 0;
-      last_avg_y_4 = 0;
-
-      if(entriesCollected > 100){
-        display.setCursor(100, 5);
-        display.print("WAIT");
-        display.display();
-
-        for(int i = 0; i < entriesCollected; i++){
-          char coordBuffer[7];
-          sprintf(coordBuffer, "C:%d,%d", coordz[i][0], coordz[i][1]);
-          sendMessage(coordBuffer);
-        }
-        display.setCursor(100, 5);
-        display.print(" ok ");
-        display.display();
-
-        entriesCollected = 0;
+      penFilter.reset();
+
+      // the stroke's end goes into coordz before anything is sent
+      endStroke();
+#if PEN_GESTURES
+      gestureLift();
+#endif
+#if NOTE_STROKES
+      strokeTable.lift();
+#elif !NOTE_PROGRESSIVE && !NOTE_CHANNELS
+      if(coordz.count() > 100){
+        sendCoordinates();
       }
+#endif
       
     }
 
@@ -614,21 +1562,45 @@ void readSensor(){
     last_y = y_pos;
 }
 
+/*--------------------------------------------------*/
+/*--                  readPad()                   --*/
+/*--------------------------------------------------*/
+/*    One sense pin reading, in the 2.4 V reference */
+/*    counts the pad bounds and touchMin are in.    */
+/*    With PAD_RATIOMETRIC the SAADC gives the      */
+/*    fraction of VDD, the same for any drive       */
+/*    voltage; it is scaled to the counts a fixed   */
+/*    reference gave at boundsVddMv.                */
+/*--------------------------------------------------*/
+uint16_t readPad(){
+#if PAD_RATIOMETRIC
+  return (uint32_t)analogRead(Device::Pins::sense) * Device::Pad::boundsVddMv / Device::Pad::referenceMv;
+#else
+  return analogRead(Device::Pins::sense);
+#endif
+}
+
 /*--------------------------------------------------*/
 /*--                  sendData()                  --*/
 /*--------------------------------------------------*/
-/*    Called when SEND_BUTTON is pressed. Sends     */
-/*    "STOP", sends the set date, saves date to     */
-/*    memory, then sends "END" and "START" to       */
-/*    distinguish entries.                          */
+/*    Called when sendButton is pressed. Flushes    */
+/*    the remaining coordinates, sends "STOP",      */
+/*    saves the date to memory and sends it, then   */
+/*    sends "END" and "START" to distinguish        */
+/*    entries.                                      */
 /*--------------------------------------------------*/
 void sendData(){
+  endStroke();
+
   if(Bluefruit.connected()){
-    // Send "STOP" marker with timestamp to ensure uniqueness
-    char stopMsg[20];
-    sprintf(stopMsg, "STOP-%lu", messageCounter++);
-    sendMessage(stopMsg);
-    delay(5);  // Reduced delay between messages for faster response
+#if !NOTE_RELIABLE && !NOTE_CHANNELS && !NOTE_STROKES
+    // Send whatever is still buffered so the note is complete before "STOP"
+    if(coordz.count() > 0){
+      sendCoordinates();
+    }
+
+    noteSender.sendStop();
+#endif
     
     // Save date to internal storage and send it
     if(InternalFS.exists(DATES)){
@@ -641,63 +1613,238 @@ void sendData(){
       file.write(datBuffer, strlen(datBuffer));
       file.close();
       
-      // Send date with format that ensures uniqueness
-      char dateMsg[20];
-      sprintf(dateMsg, "DATE-%lu:%s", messageCounter++, datBuffer);
-      sendMessage(dateMsg);
-      delay(5); // Reduced delay
+#if !NOTE_RELIABLE && !NOTE_CHANNELS && !NOTE_STROKES
+      noteSender.sendDate(month, day);
+#endif
+    }
+
+    // Read the time field; it is left out if nothing sensible was written
+    int hour = -1, minute = -1;
+#if TIME_RECOGNIZER
+    char timeText[TIME_MAX_GLYPHS + 1] = "";
+    uint32_t recognizeStart = micros();
+#if TIME_CYCLES
+    uint32_t cycles = DWT->CYCCNT;
+#endif
+    bool timeRead = timeRecognizer.recognize(&hour, &minute, timeText, sizeof(timeText));
+#if TIME_CYCLES
+    cycles = DWT->CYCCNT - cycles;
+#endif
+    recognizeUs = micros() - recognizeStart;
+    if(recognizeUs > recognizeWorstUs){
+      recognizeWorstUs = recognizeUs;
+    }
+#if TIME_CYCLES
+    Serial.printf("time field \"%s\" %u points: %lu cycles, %lu us\n", timeText, timeRecognizer.points(),
+                  (unsigned long)cycles, (unsigned long)recognizeUs);
+#endif
+    if(!timeRead){
+      hour = minute = -1;
     }
+    timeRecognizer.reset();
+#endif
     
-    // Send "END" marker with timestamp
-    char endMsg[20];
-    sprintf(endMsg, "END-%lu", messageCounter++);
-    sendMessage(endMsg);
-    delay(5); // Reduced delay
+#if NOTE_RELIABLE
+    // CLOSE carries the date (and time) and ends the note once everything is acked
+    reliableSender.setPoints(coordz, noteBase);
+    reliableSender.close(month, day, hour, minute);
+    sendCoordinates();
+#elif NOTE_STROKES
+    // CLOSE carries the date (and time) once the phone holds every stroke
+    strokeTable.lift();
+    strokeSender.close(month, day, hour, minute);
+    sendCoordinates();
+#elif NOTE_CHANNELS
+    // STOP, DATE, TIME and END go out now; the loop sends the points after them
+    noteStream.close(coordz, month, day, hour, minute);
+    noteStream.start();
+#if NOTE_TIMESTAMPS
+    startPointClock();
+#endif
+#else
+    if(hour >= 0){
+      noteSender.sendTime(hour, minute);
+    }
+    noteSender.sendEnd();
     
     // Send "START" marker for next data set
-    char startMsg[20];
-    sprintf(startMsg, "START-%lu", messageCounter++);
-    sendMessage(startMsg);
+    noteSender.sendStart();
+#if NOTE_TIMESTAMPS
+    startPointClock();
+#endif
+#endif
   }
+#if !NOTE_RELIABLE && !NOTE_STROKES
+  else{
+    coordz.clear();
+#if NOTE_CHANNELS
+    noteStream.cleared();
+#endif
+#if TIME_RECOGNIZER
+    timeRecognizer.reset();
+#endif
+#if PEN_GESTURES
+    gestures.reset();
+#endif
+  }
+#endif
+
+#if INK_MIRROR
+  inkDone();
+#endif
 }
 
 /*--------------------------------------------------*/
 /*--                  startAdv()                  --*/
 /*--------------------------------------------------*/
-/*    Begin BLE advertising. Initializes how BLE    */
-/*    connection behaves.                           */
+/*    Begin BLE advertising: a directed burst to    */
+/*    the bonded phone if it is likely listening,   */
+/*    otherwise (and once the burst times out)      */
+/*    normal connectable advertising.               */
 /*--------------------------------------------------*/
 void startAdv(){
+  Bluefruit.Advertising.restartOnDisconnect(false);  // disconnect_callback() decides
+
+#if BLE_BONDING
+  bool rotating = lastPeer.addr.addr_type == BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_RESOLVABLE;
+  if(lastPeerKnown && (linkDropped || !rotating)){
+    Bluefruit.Advertising.clearData();
+    Bluefruit.ScanResponse.clearData();   // directed advertising carries no data
+    Bluefruit.Advertising.setType(BLE_GAP_ADV_TYPE_CONNECTABLE_NONSCANNABLE_DIRECTED_HIGH_DUTY_CYCLE);
+    Bluefruit.Advertising.setPeerAddress(lastPeer.addr);
+    advertUndirected = false;
+    Bluefruit.Advertising.start(DIRECTED_BURST_S);
+    return;
+  }
+#endif
+
+  startUndirectedAdv();
+}
+
+/*--------------------------------------------------*/
+/*--             startUndirectedAdv()             --*/
+/*--------------------------------------------------*/
+/*    Initializes how BLE connection behaves for    */
+/*    any phone in range.                           */
+/*--------------------------------------------------*/
+void startUndirectedAdv(){
+  Bluefruit.Advertising.clearData();
+  Bluefruit.ScanResponse.clearData();
+  Bluefruit.Advertising.setType(BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED);
+
   Bluefruit.Advertising.addFlags(BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE);
   Bluefruit.Advertising.addTxPower();
   
   // Include the calendar service UUID
   Bluefruit.Advertising.addService(calendarService);
+
+  // what a passive scan needs to decide whether to connect
+  uint8_t advert[ADVERT_DATA_LEN];
+  advertStatus = currentAdvert();
+  Bluefruit.Advertising.addManufacturerData(advert, buildAdvert(advertStatus, advert));
+  advertUndirected = true;
   
   Bluefruit.ScanResponse.addName();
   
-  Bluefruit.Advertising.restartOnDisconnect(true);
-  Bluefruit.Advertising.setInterval(32, 244);    // in unit of 0.625 ms
-  Bluefruit.Advertising.setFastTimeout(30);      // number of seconds in fast mode
+  Bluefruit.Advertising.setInterval(Device::Ble::advFastInterval, Device::Ble::advSlowInterval);
+  Bluefruit.Advertising.setFastTimeout(Device::Ble::advFastTimeoutS);
   Bluefruit.Advertising.start(0);                // 0 = Don't stop advertising 
 }
 
+/*--------------------------------------------------*/
+/*--               currentAdvert()                --*/
+/*--------------------------------------------------*/
+/*    coordz only ever holds one note, so pending   */
+/*    is 0 or 1: points not sent yet, or with       */
+/*    NOTE_RELIABLE a note the phone has not acked  */
+/*    (NOTE_STROKES: strokes it does not hold).     */
+/*--------------------------------------------------*/
+AdvertStatus currentAdvert(){
+  AdvertStatus status;
+#if NOTE_STROKES
+  status.pending = (coordz.count() > 0 || !strokeSender.complete()) ? 1 : 0;
+#else
+  status.pending = (coordz.count() > 0 || !reliableSender.complete()) ? 1 : 0;
+#endif
+  status.fill = (uint32_t)coordz.bytes() * 100 / COORD_BYTES;
+  status.battery = batteryGauge.millivolts() ? batteryGauge.percent() : ADVERT_UNKNOWN;
+  return status;
+}
+
+/*--------------------------------------------------*/
+/*--                updateAdvert()                --*/
+/*--------------------------------------------------*/
+/*    Called from the loop. The advertising data    */
+/*    can only change with a restart, so it waits   */
+/*    ADVERT_UPDATE_MS after the last one; the      */
+/*    battery percent already has hysteresis.       */
+/*--------------------------------------------------*/
+void updateAdvert(){
+  if(!advertUndirected || !Bluefruit.Advertising.isRunning() || millis() - advertChangedMs < ADVERT_UPDATE_MS){
+    return;
+  }
+  if(sameAdvert(currentAdvert(), advertStatus)){
+    return;
+  }
+
+  advertChangedMs = millis();
+  Bluefruit.Advertising.stop();
+  startUndirectedAdv();
+}
+
+/*--------------------------------------------------*/
+/*--             adv_stop_callback()              --*/
+/*--------------------------------------------------*/
+/*    Only a timed advertising run stops on its     */
+/*    own: the directed burst found nobody.         */
+/*--------------------------------------------------*/
+void adv_stop_callback(){
+  startUndirectedAdv();
+}
+
 /*--------------------------------------------------*/
 /*--              connect_callback()              --*/
 /*--------------------------------------------------*/
 /*    Event handler for when BLE connects           */
 /*--------------------------------------------------*/
 void connect_callback(uint16_t conn_handle){
+  centralCount++;
   isConnected = true;
-  
+
+#if NOTE_CENTRALS > 1
+  bleFanout.open(conn_handle);
+  if(centralCount < NOTE_CENTRALS){
+    startUndirectedAdv();   // room for another one
+  }
+  if(centralCount > 1){
+    // the others are mid-session; this one joins at the next packet
+    blebas.write(batteryGauge.percent());
+    return;
+  }
+#endif
+
+#if NOTE_RELIABLE
+  // Pick up an unfinished note where the phone left off
+  reliableSender.resume();
+#elif NOTE_STROKES
+  // Ask the phone which strokes it has, then send only the rest
+  strokeSender.setPoints(coordz);
+  strokeSender.resume();
+#elif NOTE_CHANNELS
+  noteStream.start();
+#if NOTE_TIMESTAMPS
+  startPointClock();
+#endif
+#else
   // Send initial START message
-  char startMsg[20];
-  sprintf(startMsg, "START-%lu", messageCounter++);
-  sendMessage(startMsg);
+  noteSender.sendStart();
+#if NOTE_TIMESTAMPS
+  startPointClock();
+#endif
+#endif
   
   // Update battery level
-  uint8_t battLevel = min(100, (int)batteryPercent);
-  blebas.write(battLevel);
+  blebas.write(batteryGauge.percent());
 }
 
 /*--------------------------------------------------*/
@@ -706,7 +1853,144 @@ void connect_callback(uint16_t conn_handle){
 /*    Event handler for when BLE disconnects        */
 /*--------------------------------------------------*/
 void disconnect_callback(uint16_t conn_handle, uint8_t reason){
-  isConnected = false;
+  if(centralCount > 0){
+    centralCount--;
+  }
+  isConnected = centralCount > 0;
+
+#if NOTE_CENTRALS > 1
+  bleFanout.detach(conn_handle);
+  if(isConnected){
+    // the others keep the note going; advertise for a new one
+    if(!Bluefruit.Advertising.isRunning()){
+      startUndirectedAdv();
+    }
+    return;
+  }
+  Bluefruit.Advertising.stop();   // the one started for another central; startAdv() decides
+#endif
+
+  linkDropped = !userDisconnect;
+  userDisconnect = false;
+  linkDownMs = millis();
+  firstNotifyPending = true;
+  startAdv();
+}
+
+/*--------------------------------------------------*/
+/*--             ble_event_callback()             --*/
+/*--------------------------------------------------*/
+/*    Every SoftDevice event (NOTE_CENTRALS > 1).   */
+/*    Counts the notifications each connection got  */
+/*    out, which frees their HVN queue slots.       */
+/*--------------------------------------------------*/
+#if NOTE_CENTRALS > 1
+void ble_event_callback(ble_evt_t* event){
+  if(event->header.evt_id == BLE_GATTS_EVT_HVN_TX_COMPLETE){
+    uint16_t conn = event->evt.gatts_evt.conn_handle;
+    if(conn < BLE_MAX_CONNECTION){
+      hvnDone[conn] += event->evt.gatts_evt.params.hvn_tx_complete.count;
+    }
+  }
+}
+#endif
+
+/*--------------------------------------------------*/
+/*--              secured_callback()              --*/
+/*--------------------------------------------------*/
+/*    The link is encrypted. For a bonded phone,    */
+/*    remember it for directed advertising and tell */
+/*    it once if the GATT layout it cached is old.  */
+/*--------------------------------------------------*/
+void secured_callback(uint16_t conn_handle){
+#if BLE_BONDING
+  BLEConnection* conn = Bluefruit.Connection(conn_handle);
+  if(!conn || !conn->bonded()){
+    return;
+  }
+
+  ble_gap_addr_t addr = conn->getPeerAddr();
+  bool samePeer = lastPeerKnown && memcmp(&addr, &lastPeer.addr, sizeof(addr)) == 0;
+  if(samePeer && lastPeer.layout != GATT_LAYOUT){
+    sd_ble_gatts_service_changed(conn_handle, 0x0001, 0xFFFF);
+  }
+
+  if(!samePeer || lastPeer.layout != GATT_LAYOUT){
+    lastPeer.addr = addr;
+    lastPeer.layout = GATT_LAYOUT;
+    lastPeerKnown = true;
+    saveLastPeer();
+  }
+#endif
+}
+
+/*--------------------------------------------------*/
+/*--                loadLastPeer()                --*/
+/*--------------------------------------------------*/
+/*    LAST_PEER sits next to Bluefruit's own bond   */
+/*    files; mounting InternalFS here (before the   */
+/*    BOOT_FILESYSTEM stage) costs nothing extra,   */
+/*    Bluefruit.begin() already did for the bonds.  */
+/*--------------------------------------------------*/
+void loadLastPeer(){
+  InternalFS.begin();
+  File peerFile(InternalFS);
+  if(peerFile.open(LAST_PEER, FILE_O_READ)){
+    lastPeerKnown = peerFile.read(&lastPeer, sizeof(lastPeer)) == sizeof(lastPeer);
+    peerFile.close();
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                saveLastPeer()                --*/
+/*--------------------------------------------------*/
+void saveLastPeer(){
+  if(InternalFS.exists(LAST_PEER)){
+    InternalFS.remove(LAST_PEER);
+  }
+  File peerFile(InternalFS);
+  if(peerFile.open(LAST_PEER, FILE_O_WRITE)){
+    peerFile.write((const uint8_t*)&lastPeer, sizeof(lastPeer));
+    peerFile.close();
+  }
+}
+
+/*--------------------------------------------------*/
+/*--           control_write_callback()           --*/
+/*--------------------------------------------------*/
+/*    The phone wrote to the control characteristic */
+/*    (an ack, or a SYNC with NOTE_LATENCY). Runs   */
+/*    in the BLE task, so it is only queued here    */
+/*    and handled in the loop.                      */
+/*--------------------------------------------------*/
+void control_write_callback(uint16_t conn_handle, BLECharacteristic* chr, uint8_t* data, uint16_t len){
+#if NOTE_LATENCY
+  if(len > 0 && data[0] == SYNC_TAG){
+    latencyTracer.post(data, len, micros());
+    return;
+  }
+#endif
+#if NOTE_STROKES
+  strokeSender.post(data, len);
+#else
+  reliableSender.post(data, len);
+#endif
+}
+
+/*--------------------------------------------------*/
+/*--       sendButtonChange() / bleButtonChange() --*/
+/*--------------------------------------------------*/
+/*  Interrupts attached to both edges of the        */
+/*  buttons (pressed pulls the pin low). Only note  */
+/*  the level; the loop debounces it and turns it   */
+/*  into events.                                    */
+/*--------------------------------------------------*/
+void sendButtonChange(){
+  sendButton.edge(!digitalRead(Device::Pins::sendButton), millis());
+}
+
+void bleButtonChange(){
+  bleButton.edge(!digitalRead(Device::Pins::bleButton), millis());
 }
 
 /*--------------------------------------------------*/
@@ -720,39 +2004,9 @@ void dayChange(){
   int diff = time - dayTime;
 
   if(abs(diff) > 10){
-    dayB_status = digitalRead(DAY_B);
+    dayB_status = digitalRead(Device::Pins::dayB);
 
-    if(dayB_status == 1){
-      day++;
-    }
-    else if(dayB_status == 0){
-      day--;
-    }
-  
-    if(month == 2){
-      if(day <= 0){
-        day = 28;
-      }
-      else if(day > 28){
-        day = 1;
-      }
-    }
-    else if(month == 1 || month == 3 || month == 5 || month == 7 || month == 8 || month == 10 || month == 12){
-      if(day <= 0){
-        day = 31;
-      }
-      else if(day > 31){
-        day = 1;
-      }
-    }
-    else{
-      if(day <= 0){
-        day = 30;
-      }
-      else if(day > 30){
-        day = 1;
-      }
-    }  
+    day = Device::Dates::turnDay(day, month, dayB_status == 1 ? 1 : -1);
   }
 
   dayTime = millis();
@@ -769,24 +2023,12 @@ void monthChange(){
   int diff = time - monthTime;
 
   if(abs(diff) > 10){
-    monthB_status = digitalRead(MONTH_B);
+    monthB_status = digitalRead(Device::Pins::monthB);
 
-    if(monthB_status == 1){
-      month++;
-    }
-    else if(monthB_status == 0){
-      month--;
-    }
-    
-    if(month >= 13){
-      month = 1;
-    }
-    else if(month <= 0){
-      month = 12;
-    }
+    month = Device::Dates::turnMonth(month, monthB_status == 1 ? 1 : -1);
 
-    int i = month - 1;
-    m = (String[])months[i];
+    // e.g. the 31st turned into April
+    day = Device::Dates::fitDay(day, month);
   }
   
   monthTime = millis();
@@ -800,24 +2042,29 @@ void monthChange(){
 /* percent on the OLED screen.                      */
 /*--------------------------------------------------*/
 void whatsTheDate(){
+#if INK_MIRROR
+  // the note has the screen; anything that changed is drawn after "Send"
+  if(inkShowing){
+    return;
+  }
+#endif
 
   bool changeNeeded = false;
 
-  if(lastMonth != month){
+  if(statusRedraw || lastMonth != month){
     display.setCursor(5,5);
     display.print("Month: ");
-    display.print(m);
-    if(sizeof(m) < 7){
-      display.println("      ");
-    }
-    else{
-      display.println("    ");
+    display.print(Device::Dates::monthNames[month - 1]);
+    // blank out what is left of a longer name
+    for(int i = strlen(Device::Dates::monthNames[month - 1]); i < 9; i++){
+      display.print(' ');
     }
+    display.println();
   
     changeNeeded = true;
   }
 
-  if(lastDay != day){
+  if(statusRedraw || lastDay != day){
     display.setCursor(5,15);
     display.print("Day: ");
     display.print(day);
@@ -825,7 +2072,7 @@ void whatsTheDate(){
     changeNeeded = true;
   }
 
-  if(lastConnected != isConnected){
+  if(statusRedraw || lastConnected != isConnected){
     if(isConnected){
       display.setCursor(5, 40);
       display.println("BLE: Connected    ");
@@ -837,54 +2084,25 @@ void whatsTheDate(){
     changeNeeded = true;
   }
 
-  int time = millis();
-  // 60000 ms = 1 minute
-  if(abs(time-batteryCheckTime) > 60000 || batteryCheckTime < 3000){
-    float lastPercent = batteryPercent;
-
-    float measuredvbat = analogRead(VBATPIN);
-    measuredvbat *= 2;    
-    measuredvbat *= 2.4;  // Multiply by 2.4V
-    measuredvbat /= 16384; // convert to voltage
-  
-    batteryPercent = (measuredvbat/3.7) * 100;
-
-    float delBattery = batteryPercent - lastPercent;
-    // only update battery percent if readings have been 
-    // different from the previous value > 5 times 
-    if(abs(delBattery) > 0){
-      batteryChange++;
-      if(batteryChange > 5){
-        batteryChange = 0;
-
-        display.setCursor(5, 50);
-        display.print("Battery: ");
-
-        if(batteryPercent >= 100){
-          display.print(100);
-          display.println("%  ");
-        }
-        else{
-          display.print(int(batteryPercent));
-          display.println("%  ");
-        }
-
-        changeNeeded = true;
-      }
-    else if(batteryChange > 0){
-        batteryPercent = lastPercent;
-      }
+  // only redrawn and sent when the smoothed percent has moved
+  bool batteryMoved = batteryGauge.changed();
+  if(statusRedraw || batteryMoved){
+    display.setCursor(5, 50);
+    display.print("Battery: ");
+    display.print(batteryGauge.percent());
+    display.println("%  ");
+    if(batteryMoved){
+      blebas.write(batteryGauge.percent());
     }
-
-    batteryCheckTime = millis();
+    changeNeeded = true;
   }
 
-  
   if(changeNeeded){
-    display.display();
+    showDisplay();
   }  
   
   lastMonth = month;
   lastDay = day;
   lastConnected = isConnected;
+  statusRedraw = false;
 }
\ No newline at end of file
@@ -0,0 +1,260 @@
+/*--------------------------------------------------*/
+/*--        BLE BENCHMARK RESULTS PARSER (host)   --*/
+/*--------------------------------------------------*/
+/*  Reads what the benchmark firmware reported (the */
+/*  H:/R: records, BleBench.h) from any text: a     */
+/*  Serial capture, a log exported from nRF Connect */
+/*  or LightBlue, or the results characteristic     */
+/*  values pasted into a file. One file per phone   */
+/*  or firmware build; they are lined up run by run */
+/*  so the same setting can be compared across      */
+/*  them. Passes repeated in one file are averaged. */
+/*                                                  */
+/*  pio run -e native_results                       */
+/*  .pio/build/native_results/program \             */
+/*      pixel7=pixel.log iphone13=iphone.log        */
+/*                                                  */
+/*  Arguments: [label=]FILE ... (label defaults to  */
+/*  the file name)                                  */
+/*  Options:                                        */
+/*    --metric M   bytes (B/s, default), packets    */
+/*                 (pkt/s), points (points/s) or    */
+/*                 failures (% of notifies refused) */
+/*    --csv        one line per run instead         */
+/*--------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "BleBench.h"
+
+/*------------------------------------------*/
+/*  RunKey - what a run was asked to do,    */
+/*  the same on every phone                 */
+/*------------------------------------------*/
+typedef std::tuple<char, char, uint16_t, uint16_t> RunKey;   // source, framing, payload, interval
+
+/*------------------------------------------*/
+/*  RunTotals - the passes of one run added */
+/*  up; rates are taken over the sums       */
+/*------------------------------------------*/
+struct RunTotals {
+  uint64_t ms = 0;
+  uint64_t bytes = 0;
+  uint64_t packets = 0;
+  uint64_t failures = 0;
+  uint64_t points = 0;
+  uint16_t mtu = 0;
+  uint16_t granted = 0;
+  int passes = 0;
+};
+
+struct Capture {
+  std::string label;
+  std::string build;
+  std::vector<BenchResult> records;
+  std::map<RunKey, RunTotals> runs;
+};
+
+static RunKey keyOf(const BenchResult& r){
+  return RunKey(r.source, framingCode(r.config.framing, r.config.timed), r.config.payload, r.config.interval);
+}
+
+static double metricOf(const RunTotals& t, const std::string& metric){
+  if(t.ms == 0){
+    return 0;
+  }
+  if(metric == "packets"){
+    return t.packets * 1000.0 / t.ms;
+  }
+  if(metric == "points"){
+    return t.points * 1000.0 / t.ms;
+  }
+  if(metric == "failures"){
+    uint64_t tried = t.packets + t.failures;
+    return tried ? 100.0 * t.failures / tried : 0;
+  }
+  return t.bytes * 1000.0 / t.ms;
+}
+
+/*--------------------------------------------------*/
+/*--               readCapture()                  --*/
+/*--------------------------------------------------*/
+/*    Every line with an R: record in it counts,    */
+/*    whatever a logging app put around it. The     */
+/*    build comes from the last H: line.            */
+/*--------------------------------------------------*/
+static bool readCapture(const char* arg, Capture& capture){
+  const char* path = arg;
+  const char* eq = strchr(arg, '=');
+  if(eq){
+    capture.label.assign(arg, eq - arg);
+    path = eq + 1;
+  }
+  else{
+    const char* slash = strrchr(arg, '/');
+    capture.label = slash ? slash + 1 : arg;
+  }
+
+  FILE* f = fopen(path, "r");
+  if(!f){
+    fprintf(stderr, "could not read %s\n", path);
+    return false;
+  }
+
+  char line[512];
+  while(fgets(line, sizeof(line), f)){
+    BenchResult r;
+    if(parseResult(line, &r)){
+      capture.records.push_back(r);
+      RunTotals& t = capture.runs[keyOf(r)];
+      t.ms += r.ms;
+      t.bytes += r.bytes;
+      t.packets += r.packets;
+      t.failures += r.failures;
+      t.points += r.points;
+      t.mtu = r.mtu;
+      t.granted = r.grantedInterval;
+      t.passes++;
+      continue;
+    }
+
+    const char* header = strstr(line, "H:");
+    if(header){
+      const char* end = strrchr(header, ',');
+      capture.build.assign(header + 2, end ? end - header - 2 : strcspn(header + 2, "\r\n"));
+    }
+  }
+
+  fclose(f);
+  return true;
+}
+
+static void printCsv(const std::vector<Capture>& captures){
+  printf("label,build,run,source,framing,payload,ci_req,ci,mtu,ms,bytes,packets,failures,points,bytes_s,packets_s\n");
+  for(const Capture& c : captures){
+    for(const BenchResult& r : c.records){
+      double s = r.ms ? r.ms / 1000.0 : 1;
+      printf("%s,%s,%u,%c,%c,%u,%u,%u,%u,%lu,%lu,%lu,%lu,%lu,%.0f,%.1f\n",
+             c.label.c_str(), c.build.c_str(), r.run, r.source,
+             framingCode(r.config.framing, r.config.timed), r.config.payload,
+             r.config.interval, r.grantedInterval, r.mtu, (unsigned long)r.ms,
+             (unsigned long)r.bytes, (unsigned long)r.packets, (unsigned long)r.failures,
+             (unsigned long)r.points, r.bytes / s, r.packets / s);
+    }
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                printTable()                  --*/
+/*--------------------------------------------------*/
+/*    One row per setting any capture ran, one      */
+/*    column per capture; "-" where it did not.     */
+/*    Then each capture's best setting.             */
+/*--------------------------------------------------*/
+static void printTable(const std::vector<Capture>& captures, const std::string& metric){
+  const char* unit = metric == "packets" ? "pkt/s" : metric == "points" ? "points/s" :
+                     metric == "failures" ? "% refused" : "B/s";
+
+  for(const Capture& c : captures){
+    printf("%-12s build %s, %zu runs\n", c.label.c_str(), c.build.empty() ? "?" : c.build.c_str(), c.records.size());
+  }
+  printf("\n%s; ci is asked for / granted, in ms\n", unit);
+
+  std::map<RunKey, bool> keys;
+  for(const Capture& c : captures){
+    for(const auto& run : c.runs){
+      keys[run.first] = true;
+    }
+  }
+
+  printf("%-3s %-3s %5s %6s", "src", "frm", "bytes", "ci");
+  for(const Capture& c : captures){
+    printf(" %12.12s %6s", c.label.c_str(), "ci");
+  }
+  printf("\n");
+
+  for(const auto& k : keys){
+    const RunKey& key = k.first;
+    printf("%-3c %-3c %5u %6.2f", std::get<0>(key), std::get<1>(key), std::get<2>(key), std::get<3>(key) * 1.25);
+    for(const Capture& c : captures){
+      auto found = c.runs.find(key);
+      if(found == c.runs.end()){
+        printf(" %12s %6s", "-", "-");
+      }
+      else{
+        printf(" %12.1f %6.2f", metricOf(found->second, metric), found->second.granted * 1.25);
+      }
+    }
+    printf("\n");
+  }
+
+  printf("\nbest (by %s)\n", unit);
+  bool lowest = metric == "failures";
+  for(const Capture& c : captures){
+    const RunKey* best = NULL;
+    double bestValue = 0;
+    for(const auto& run : c.runs){
+      double value = metricOf(run.second, metric);
+      if(!best || (lowest ? value < bestValue : value > bestValue)){
+        best = &run.first;
+        bestValue = value;
+      }
+    }
+    if(best){
+      const RunTotals& t = c.runs.at(*best);
+      printf("%-12s %c %c %3u B  ci %.2f ms  mtu %u  %.1f %s\n", c.label.c_str(),
+             std::get<0>(*best), std::get<1>(*best), std::get<2>(*best), t.granted * 1.25, t.mtu, bestValue, unit);
+    }
+  }
+}
+
+int main(int argc, char** argv){
+  std::string metric = "bytes";
+  bool csv = false;
+  std::vector<Capture> captures;
+
+  for(int i = 1; i < argc; i++){
+    const char* arg = argv[i];
+    if(!strcmp(arg, "--metric") && i + 1 < argc){ metric = argv[++i]; }
+    else if(!strcmp(arg, "--csv")){ csv = true; }
+    else if(arg[0] == '-'){
+      fprintf(stderr, "unknown option %s\n", arg);
+      return 1;
+    }
+    else{
+      Capture capture;
+      if(!readCapture(arg, capture)){
+        return 1;
+      }
+      captures.push_back(capture);
+    }
+  }
+
+  if(metric != "bytes" && metric != "packets" && metric != "points" && metric != "failures"){
+    fprintf(stderr, "--metric is bytes, packets, points or failures\n");
+    return 1;
+  }
+  size_t records = 0;
+  for(const Capture& c : captures){
+    records += c.records.size();
+  }
+  if(records == 0){
+    fprintf(stderr, "no R: records found\n");
+    return 1;
+  }
+
+  if(csv){
+    printCsv(captures);
+  }
+  else{
+    printTable(captures, metric);
+  }
+  return 0;
+}
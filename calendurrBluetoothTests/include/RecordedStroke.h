@@ -0,0 +1,264 @@
+#ifndef CALENDURR_RECORDED_STROKE_H
+#define CALENDURR_RECORDED_STROKE_H
+
+#include <stdint.h>
+
+// The first 1500 points of "python script to bmp/coordz.txt", a note
+// written on the breadboard, for the benchmark's recorded source (BENCH_RECORDED).
+// In flash: 6 KB.
+#define RECORDED_POINTS 1500
+
+static const uint16_t recordedStroke[RECORDED_POINTS][2] = {
+  {3483,900}, {3482,901}, {3482,901}, {3481,900}, {3480,900}, {3479,899},
+  {3477,900}, {3476,900}, {3477,900}, {3478,901}, {3477,902}, {3476,903},
+  {3476,904}, {3468,918}, {3469,918}, {3470,917}, {3471,918}, {3469,917},
+  {3469,917}, {3470,918}, {3471,920}, {3472,922}, {3473,924}, {3474,925},
+  {3474,926}, {3475,927}, {3475,927}, {3476,929}, {3477,930}, {3477,932},
+  {3476,934}, {3477,937}, {3477,938}, {3478,940}, {3478,942}, {3478,943},
+  {3478,944}, {3479,945}, {3478,947}, {3479,948}, {3479,950}, {3480,952},
+  {3480,952}, {3481,952}, {3481,954}, {3481,956}, {3480,956}, {3481,956},
+  {3481,956}, {3481,956}, {3482,957}, {3482,959}, {3482,959}, {3480,960},
+  {3479,961}, {3479,961}, {3479,961}, {3480,960}, {3481,960}, {3482,961},
+  {3481,961}, {3483,961}, {3484,959}, {3485,958}, {3484,958}, {3483,957},
+  {3484,956}, {3483,956}, {3483,954}, {3482,954}, {3482,954}, {3488,939},
+  {3487,938}, {3488,937}, {3487,937}, {3485,936}, {3488,926}, {3487,925},
+  {3488,925}, {3489,924}, {3489,922}, {3489,921}, {3489,921}, {3488,919},
+  {3490,918}, {3490,917}, {3491,916}, {3491,914}, {3493,914}, {3494,914},
+  {3494,913}, {3495,912}, {3495,912}, {3495,911}, {3494,910}, {3496,909},
+  {3497,909}, {3497,908}, {3496,909}, {3497,909}, {3498,909}, {3497,909},
+  {3497,909}, {3497,909}, {3498,910}, {3499,910}, {3500,911}, {3501,911},
+  {3501,911}, {3501,912}, {3501,913}, {3501,913}, {3502,913}, {3502,913},
+  {3502,914}, {3502,916}, {3503,918}, {3503,919}, {3503,919}, {3503,920},
+  {3503,921}, {3504,923}, {3505,924}, {3507,925}, {3508,926}, {3507,928},
+  {3507,928}, {3507,928}, {3508,929}, {3508,930}, {3506,932}, {3507,933},
+  {3509,933}, {3510,934}, {3511,935}, {3511,937}, {3512,938}, {3513,938},
+  {3513,940}, {3514,941}, {3514,941}, {3514,942}, {3516,943}, {3517,944},
+  {3517,945}, {3518,947}, {3518,948}, {3520,949}, {3521,951}, {3520,951},
+  {3520,952}, {3521,953}, {3521,955}, {3522,955}, {3521,955}, {3519,956},
+  {3519,955}, {3518,954}, {3519,955}, {3518,955}, {3518,954}, {3518,954},
+  {3519,954}, {3519,953}, {3521,954}, {3546,907}, {3545,907}, {3543,908},
+  {3542,907}, {3542,906}, {3543,906}, {3542,906}, {3542,907}, {3541,906},
+  {3539,906}, {3539,906}, {3538,906}, {3536,907}, {3537,906}, {3537,907},
+  {3536,908}, {3536,908}, {3538,909}, {3536,931}, {3537,929}, {3537,928},
+  {3535,927}, {3533,926}, {3533,925}, {3533,925}, {3533,924}, {3533,924},
+  {3533,925}, {3533,926}, {3532,926}, {3532,927}, {3531,928}, {3528,936},
+  {3529,935}, {3531,935}, {3530,936}, {3531,937}, {3539,944}, {3538,944},
+  {3538,944}, {3538,945}, {3539,943}, {3540,943}, {3540,944}, {3540,943},
+  {3542,944}, {3542,943}, {3544,942}, {3544,941}, {3544,941}, {3544,940},
+  {3544,940}, {3543,941}, {3544,944}, {3548,941}, {3548,941}, {3548,940},
+  {3548,939}, {3550,938}, {3551,938}, {3552,938}, {3555,938}, {3555,936},
+  {3556,935}, {3558,934}, {3556,933}, {3555,932}, {3557,931}, {3557,930},
+  {3559,928}, {3560,928}, {3560,927}, {3560,926}, {3560,925}, {3560,923},
+  {3561,921}, {3560,917}, {3572,915}, {3570,913}, {3569,912}, {3568,909},
+  {3566,908}, {3564,906}, {3562,905}, {3561,904}, {3559,903}, {3558,903},
+  {3558,902}, {3558,901}, {3556,900}, {3554,899}, {3553,898}, {3553,897},
+  {3552,897}, {3551,897}, {3551,895}, {3551,895}, {3549,896}, {3548,896},
+  {3547,895}, {3545,894}, {3545,894}, {3546,893}, {3546,894}, {3545,894},
+  {3543,894}, {3542,893}, {3542,893}, {3541,894}, {3541,895}, {3542,895},
+  {3542,895}, {3541,895}, {3539,895}, {3539,895}, {3583,898}, {3581,897},
+  {3582,898}, {3582,899}, {3581,900}, {3579,901}, {3577,900}, {3576,899},
+  {3576,899}, {3576,900}, {3575,900}, {3576,900}, {3576,898}, {3577,899},
+  {3576,899}, {3576,899}, {3575,899}, {3575,901}, {3576,903}, {3575,903},
+  {3574,904}, {3575,904}, {3576,904}, {3575,905}, {3574,906}, {3575,907},
+  {3574,907}, {3572,909}, {3573,910}, {3574,911}, {3574,911}, {3575,913},
+  {3576,917}, {3577,919}, {3577,919}, {3577,920}, {3578,921}, {3578,922},
+  {3578,922}, {3578,922}, {3580,924}, {3580,925}, {3581,926}, {3581,926},
+  {3583,938}, {3584,936}, {3583,936}, {3583,935}, {3584,935}, {3585,934},
+  {3587,934}, {3586,934}, {3586,933}, {3586,934}, {3587,934}, {3588,935},
+  {3588,934}, {3588,935}, {3588,934}, {3588,934}, {3588,934}, {3589,934},
+  {3591,934}, {3591,933}, {3590,934}, {3591,933}, {3591,932}, {3592,930},
+  {3592,927}, {3593,926}, {3594,925}, {3595,923}, {3599,909}, {3600,909},
+  {3600,908}, {3600,906}, {3601,905}, {3601,905}, {3602,904}, {3600,902},
+  {3600,899}, {3601,898}, {3600,897}, {3599,896}, {3599,896}, {3600,894},
+  {3599,892}, {3600,891}, {3599,890}, {3598,890}, {3598,890}, {3598,890},
+  {3599,891}, {3598,891}, {3597,891}, {3610,894}, {3609,894}, {3607,893},
+  {3606,894}, {3605,894}, {3604,894}, {3603,896}, {3603,898}, {3603,899},
+  {3604,903}, {3606,898}, {3606,899}, {3605,902}, {3603,912}, {3604,912},
+  {3605,912}, {3606,912}, {3606,912}, {3606,912}, {3607,912}, {3623,921},
+  {3620,920}, {3618,919}, {3617,919}, {3617,918}, {3618,918}, {3617,918},
+  {3617,918}, {3616,918}, {3616,918}, {3617,918}, {3618,918}, {3619,918},
+  {3619,918}, {3619,918}, {3619,919}, {3619,920}, {3618,919}, {3618,917},
+  {3618,916}, {3619,916}, {3620,916}, {3619,915}, {3619,914}, {3620,914},
+  {3622,914}, {3622,913}, {3625,912}, {3626,911}, {3627,911}, {3627,910},
+  {3627,909}, {3628,908}, {3628,907}, {3629,905}, {3629,905}, {3629,905},
+  {3631,903}, {3631,901}, {3632,900}, {3631,898}, {3631,897}, {3631,895},
+  {3624,884}, {3625,884}, {3625,883}, {3626,885}, {3626,885}, {3626,886},
+  {3625,885}, {3625,885}, {3625,885}, {3625,885}, {3625,885}, {3624,885},
+  {3624,885}, {3623,884}, {3624,885}, {3743,856}, {3744,855}, {3743,855},
+  {3742,854}, {3742,853}, {3741,853}, {3740,854}, {3739,855}, {3737,855},
+  {3736,856}, {3737,856}, {3737,856}, {3737,856}, {3736,857}, {3735,857},
+  {3734,858}, {3734,858}, {3735,860}, {3734,861}, {3734,861}, {3733,862},
+  {3732,862}, {3731,863}, {3730,863}, {3727,864}, {3727,864}, {3725,865},
+  {3725,866}, {3725,867}, {3720,883}, {3720,884}, {3719,884}, {3720,885},
+  {3720,887}, {3719,888}, {3719,888}, {3719,886}, {3720,886}, {3720,886},
+  {3720,887}, {3721,888}, {3724,889}, {3726,890}, {3727,891}, {3727,892},
+  {3727,892}, {3727,891}, {3727,892}, {3728,891}, {3729,891}, {3729,891},
+  {3729,891}, {3730,892}, {3730,891}, {3731,889}, {3732,889}, {3742,880},
+  {3741,879}, {3741,878}, {3741,878}, {3741,877}, {3741,876}, {3740,874},
+  {3740,873}, {3739,871}, {3739,869}, {3740,866}, {3741,863}, {3742,861},
+  {3743,859}, {3744,857}, {3742,856}, {3741,854}, {3741,852}, {3743,850},
+  {3742,845}, {3741,843}, {3741,842}, {3739,840}, {3739,838}, {3740,836},
+  {3741,835}, {3742,833}, {3742,831}, {3742,830}, {3742,829}, {3742,829},
+  {3742,828}, {3741,826}, {3741,825}, {3739,825}, {3738,825}, {3739,824},
+  {3738,824}, {3738,824}, {3738,825}, {3739,825}, {3739,825}, {3739,825},
+  {3740,825}, {3740,826}, {3740,826}, {3739,826}, {3741,827}, {3741,827},
+  {3742,826}, {3741,826}, {3739,827}, {3738,828}, {3737,830}, {3738,832},
+  {3739,832}, {3740,834}, {3739,835}, {3739,836}, {3739,838}, {3739,840},
+  {3739,843}, {3737,845}, {3738,848}, {3738,851}, {3740,852}, {3740,854},
+  {3739,856}, {3739,858}, {3739,860}, {3739,863}, {3740,865}, {3741,867},
+  {3742,868}, {3742,869}, {3743,870}, {3743,871}, {3744,872}, {3745,875},
+  {3746,876}, {3746,878}, {3745,877}, {3746,878}, {3747,878}, {3747,879},
+  {3748,879}, {3748,878}, {3747,879}, {3747,880}, {3747,880}, {3749,880},
+  {3749,881}, {3749,881}, {3748,882}, {3750,882}, {3751,881}, {3753,882},
+  {3753,883}, {3754,882}, {3753,882}, {3754,881}, {3753,880}, {3774,844},
+  {3772,843}, {3773,843}, {3775,845}, {3775,843}, {3775,843}, {3774,843},
+  {3773,842}, {3772,842}, {3772,843}, {3772,843}, {3768,848}, {3768,848},
+  {3767,848}, {3767,848}, {3768,849}, {3768,850}, {3767,852}, {3767,853},
+  {3767,855}, {3768,856}, {3768,858}, {3767,860}, {3767,863}, {3767,864},
+  {3767,866}, {3768,868}, {3766,869}, {3767,871}, {3768,872}, {3769,872},
+  {3769,873}, {3769,875}, {3770,876}, {3771,877}, {3772,877}, {3773,876},
+  {3774,875}, {3776,876}, {3776,877}, {3778,875}, {3779,876}, {3781,875},
+  {3783,876}, {3786,875}, {3787,875}, {3788,874}, {3790,873}, {3792,872},
+  {3794,870}, {3794,869}, {3793,867}, {3795,865}, {3796,863}, {3797,862},
+  {3798,861}, {3798,860}, {3798,858}, {3798,856}, {3799,854}, {3799,852},
+  {3799,851}, {3800,849}, {3801,848}, {3800,846}, {3800,845}, {3799,843},
+  {3798,840}, {3798,838}, {3797,836}, {3794,834}, {3792,833}, {3791,833},
+  {3792,833}, {3792,831}, {3791,830}, {3791,829}, {3789,830}, {3784,834},
+  {3785,833}, {3785,831}, {3783,830}, {3782,829}, {3782,829}, {3783,828},
+  {3783,827}, {3783,828}, {3784,829}, {3785,829}, {3784,831}, {3862,829},
+  {3861,828}, {3860,827}, {3858,826}, {3859,826}, {3858,825}, {3858,825},
+  {3857,825}, {3855,825}, {3854,825}, {3854,825}, {3856,826}, {3855,826},
+  {3856,825}, {3856,825}, {3854,825}, {3854,826}, {3855,825}, {3856,825},
+  {3857,825}, {3857,825}, {3856,826}, {3859,825}, {3859,826}, {3859,827},
+  {3860,827}, {3859,826}, {3860,826}, {3859,826}, {3859,826}, {3857,827},
+  {3866,841}, {3866,841}, {3863,839}, {3863,838}, {3862,837}, {3862,837},
+  {3861,837}, {3862,837}, {3862,836}, {3862,836}, {3863,837}, {3865,838},
+  {3867,838}, {3867,840}, {3867,840}, {3867,840}, {3866,841}, {3867,842},
+  {3867,843}, {3868,844}, {3869,844}, {3869,844}, {3870,845}, {3871,848},
+  {3873,849}, {3874,851}, {3873,851}, {3872,851}, {3874,851}, {3874,851},
+  {3874,852}, {3874,852}, {3874,853}, {3874,852}, {3876,853}, {3876,853},
+  {3875,853}, {3876,854}, {3875,855}, {3876,856}, {3877,857}, {3877,857},
+  {3877,857}, {3877,859}, {3878,859}, {3877,860}, {3878,860}, {3878,861},
+  {3878,862}, {3878,862}, {3879,862}, {3880,863}, {3880,863}, {3880,864},
+  {3880,864}, {3880,864}, {3880,863}, {3879,863}, {3881,862}, {3881,862},
+  {3882,863}, {3882,863}, {3881,863}, {3880,864}, {3881,864}, {3880,864},
+  {3878,864}, {3879,864}, {3879,864}, {3879,865}, {3880,865}, {3881,864},
+  {3881,865}, {3880,864}, {3881,865}, {3883,865}, {3883,866}, {3884,866},
+  {3884,864}, {3884,864}, {3885,862}, {3892,811}, {3893,810}, {3894,809},
+  {3894,809}, {3893,809}, {3893,809}, {3894,808}, {3892,807}, {3893,807},
+  {3894,808}, {3895,809}, {3894,810}, {3894,810}, {3893,812}, {3893,811},
+  {3891,811}, {3892,811}, {3891,813}, {3891,814}, {3891,814}, {3889,815},
+  {3889,816}, {3889,817}, {3890,818}, {3890,819}, {3888,820}, {3889,822},
+  {3889,823}, {3888,824}, {3887,826}, {3885,827}, {3886,828}, {3885,829},
+  {3885,831}, {3885,834}, {3884,836}, {3883,837}, {3882,838}, {3881,837},
+  {3881,838}, {3880,839}, {3881,840}, {3880,841}, {3881,843}, {3880,843},
+  {3880,845}, {3880,846}, {3890,861}, {3889,862}, {3888,862}, {3887,863},
+  {3886,863}, {3885,863}, {3885,863}, {3885,864}, {3885,864}, {3883,865},
+  {3882,866}, {3883,868}, {3878,877}, {3878,875}, {3878,875}, {3878,877},
+  {3878,877}, {3876,878}, {3876,877}, {3875,877}, {3876,877}, {3875,878},
+  {3874,879}, {3874,881}, {3873,882}, {3873,883}, {3874,884}, {3874,886},
+  {3874,888}, {3873,890}, {3874,891}, {3873,892}, {3873,893}, {3873,894},
+  {3872,895}, {3871,896}, {3870,896}, {3871,896}, {3870,898}, {3870,898},
+  {3871,899}, {3871,901}, {3871,901}, {3872,902}, {3871,903}, {3871,903},
+  {3870,903}, {3878,910}, {3876,909}, {3876,909}, {3867,906}, {3867,906},
+  {3904,812}, {3904,814}, {3903,815}, {3902,816}, {3903,816}, {3902,817},
+  {3902,818}, {3901,818}, {3901,817}, {3902,817}, {3902,817}, {3901,815},
+  {3901,815}, {3902,815}, {3903,816}, {3904,817}, {3904,818}, {3903,818},
+  {3903,818}, {3903,819}, {3904,819}, {3905,819}, {3905,820}, {3905,821},
+  {3903,821}, {3896,833}, {3896,831}, {3895,830}, {3895,830}, {3895,832},
+  {3896,833}, {3895,833}, {3895,831}, {3894,832}, {3893,832}, {3894,833},
+  {3895,834}, {3895,836}, {3895,837}, {3894,836}, {3893,835}, {3893,836},
+  {3894,834}, {3899,841}, {3899,842}, {3899,841}, {3899,842}, {3898,843},
+  {3898,843}, {3899,843}, {3899,843}, {3898,845}, {3898,846}, {3899,847},
+  {3899,848}, {3897,847}, {3907,844}, {3906,845}, {3905,846}, {3904,845},
+  {3903,846}, {3903,846}, {3902,847}, {3903,847}, {3904,848}, {3904,849},
+  {3904,850}, {3902,850}, {3903,851}, {3905,851}, {3905,851}, {3905,851},
+  {3905,851}, {3905,851}, {3906,852}, {3906,851}, {3907,851}, {3907,851},
+  {3908,852}, {3912,862}, {3913,859}, {3913,858}, {3914,857}, {3914,857},
+  {3915,856}, {3916,854}, {3916,853}, {3917,851}, {3918,849}, {3920,848},
+  {3919,847}, {3920,847}, {3921,847}, {3922,846}, {3922,845}, {3922,845},
+  {3922,844}, {3922,842}, {3921,842}, {3923,841}, {3924,841}, {3924,840},
+  {3924,839}, {3924,838}, {3923,837}, {3923,837}, {3923,837}, {3923,836},
+  {3924,835}, {3923,834}, {3922,833}, {3922,833}, {3922,831}, {3925,830},
+  {3926,829}, {3926,828}, {3926,827}, {3926,826}, {3926,826}, {3926,825},
+  {3926,825}, {3925,824}, {3926,823}, {3926,823}, {3926,822}, {3925,822},
+  {3925,821}, {3924,820}, {3923,819}, {3923,818}, {3924,816}, {3925,815},
+  {3925,814}, {3924,813}, {3923,810}, {3915,811}, {3917,809}, {3918,808},
+  {3917,806}, {3931,793}, {3930,795}, {3927,797}, {3925,799}, {3923,799},
+  {3921,800}, {3920,799}, {3919,800}, {3918,801}, {3917,803}, {3915,803},
+  {3914,803}, {3911,805}, {3910,806}, {3908,806}, {3908,806}, {3908,806},
+  {3909,806}, {3909,807}, {3909,807}, {3908,808}, {3907,809}, {3907,809},
+  {3908,809}, {3907,810}, {3907,808}, {3905,808}, {3905,808}, {3905,808},
+  {3906,809}, {3906,809}, {3905,810}, {3904,810}, {3935,808}, {3934,807},
+  {3934,807}, {3934,809}, {3934,810}, {3934,810}, {3934,810}, {3932,809},
+  {3932,809}, {3931,810}, {3931,810}, {3931,808}, {3936,813}, {3934,811},
+  {3934,810}, {3933,809}, {3934,817}, {3934,816}, {3933,817}, {3932,816},
+  {3932,816}, {3932,815}, {3931,815}, {3931,816}, {3929,816}, {3929,817},
+  {3930,816}, {3930,817}, {3929,818}, {3929,819}, {3929,819}, {3929,820},
+  {3929,820}, {3928,821}, {3929,823}, {3929,824}, {3928,824}, {3928,824},
+  {3929,824}, {3930,825}, {3930,827}, {3930,828}, {3931,830}, {3932,830},
+  {3934,830}, {3935,830}, {3934,831}, {3933,832}, {3934,833}, {3934,834},
+  {3933,835}, {3934,836}, {3934,838}, {3934,840}, {3934,842}, {3933,842},
+  {3933,843}, {3934,844}, {3932,845}, {3932,846}, {3933,848}, {3934,848},
+  {3934,848}, {3934,850}, {3934,850}, {3936,851}, {3938,851}, {3938,851},
+  {3937,852}, {3937,852}, {3937,850}, {3937,851}, {3937,852}, {3937,853},
+  {3937,851}, {3935,851}, {3936,849}, {3942,858}, {3941,857}, {3940,855},
+  {3940,853}, {3941,851}, {3942,849}, {3942,847}, {3943,846}, {3945,844},
+  {3945,843}, {3946,842}, {3946,842}, {3946,842}, {3946,841}, {3946,840},
+  {3946,840}, {3946,839}, {3947,839}, {3950,838}, {3951,829}, {3951,830},
+  {3950,829}, {3950,828}, {3951,826}, {3953,826}, {3953,823}, {3954,822},
+  {3954,823}, {3953,822}, {3953,821}, {3952,820}, {3956,817}, {3956,816},
+  {3956,814}, {3956,812}, {3956,811}, {3956,809}, {3957,808}, {3957,807},
+  {3958,808}, {3958,808}, {3959,808}, {3958,806}, {3957,805}, {3957,804},
+  {3957,803}, {3957,801}, {3957,800}, {3960,802}, {3960,801}, {3960,801},
+  {3960,801}, {3960,799}, {3959,799}, {3957,799}, {3957,800}, {3958,800},
+  {3958,799}, {3958,798}, {3958,798}, {3958,798}, {3959,796}, {3959,796},
+  {3959,796}, {3960,797}, {3959,797}, {3957,798}, {3957,800}, {3956,801},
+  {3956,802}, {3958,812}, {3957,812}, {3955,811}, {3955,811}, {3956,812},
+  {3955,813}, {3954,814}, {3954,815}, {3954,816}, {3957,815}, {3964,825},
+  {3963,825}, {3963,824}, {3961,825}, {3960,826}, {3959,826}, {3960,825},
+  {3960,827}, {3960,828}, {3960,828}, {3961,828}, {3961,829}, {3961,830},
+  {3961,831}, {3960,832}, {3961,833}, {3961,833}, {3962,835}, {3963,836},
+  {3964,836}, {3964,837}, {3964,838}, {3964,838}, {3963,839}, {3964,839},
+  {3964,840}, {3964,839}, {3965,838}, {3965,838}, {3966,839}, {3967,840},
+  {3968,839}, {3967,840}, {3968,841}, {3968,842}, {3969,842}, {3969,843},
+  {3971,844}, {3971,844}, {3971,845}, {3972,844}, {3971,845}, {3972,845},
+  {3972,845}, {3972,843}, {3675,925}, {3676,926}, {3676,926}, {3676,925},
+  {3676,926}, {3675,925}, {3676,926}, {3676,926}, {3676,926}, {3676,926},
+  {3677,925}, {3676,925}, {3678,926}, {3684,936}, {3684,935}, {3683,934},
+  {3682,933}, {3681,933}, {3683,931}, {3683,932}, {3683,932}, {3681,934},
+  {3681,935}, {3679,936}, {3677,937}, {3678,937}, {3677,939}, {3678,940},
+  {3683,952}, {3683,952}, {3682,952}, {3681,952}, {3681,953}, {3681,953},
+  {3682,952}, {3680,952}, {3679,953}, {3680,953}, {3679,954}, {3680,955},
+  {3681,956}, {3681,957}, {3681,958}, {3680,959}, {3681,959}, {3681,961},
+  {3681,962}, {3682,964}, {3682,964}, {3682,965}, {3682,965}, {3681,968},
+  {3680,968}, {3681,970}, {3680,971}, {3680,972}, {3682,974}, {3686,990},
+  {3686,989}, {3683,988}, {3683,988}, {3682,988}, {3681,988}, {3682,988},
+  {3682,989}, {3681,989}, {3680,989}, {3679,990}, {3679,990}, {3680,990},
+  {3681,992}, {3681,992}, {3680,993}, {3680,992}, {3688,1009}, {3687,1008},
+  {3685,1007}, {3685,1005}, {3685,1005}, {3686,1004}, {3686,1004}, {3687,1006},
+  {3688,1005}, {3686,1003}, {3687,1003}, {3686,1002}, {3687,1002}, {3685,1002},
+  {3684,1002}, {3684,1001}, {3683,1000}, {3684,1001}, {3684,1002}, {3685,1000},
+  {3683,998}, {3685,998}, {3686,999}, {3686,998}, {3685,998}, {3685,998},
+  {3685,999}, {3684,998}, {3684,998}, {3683,998}, {3683,998}, {3683,997},
+  {3684,997}, {3684,995}, {3683,995}, {3678,993}, {3678,993}, {3679,992},
+  {3679,992}, {3679,990}, {3680,989}, {3680,989}, {3679,988}, {3678,988},
+  {3678,986}, {3679,985}, {3678,985}, {3678,983}, {3678,982}, {3679,981},
+  {3678,981}, {3677,979}, {3676,977}, {3678,971}, {3677,971}, {3677,971},
+  {3676,971}, {3676,971}, {3674,971}, {3674,971}, {3673,972}, {3672,971},
+  {3671,969}, {3672,970}, {3670,969}, {3670,969}, {3670,970}, {3669,970},
+  {3668,970}, {3667,969}, {3667,967}, {3666,967}, {3665,967}, {3666,969},
+  {3665,968}, {3665,967}, {3665,966}, {3666,965}, {3665,966}, {3664,965},
+  {3663,964}, {3662,963}, {3661,962}, {3661,962}, {3661,962}, {3660,961},
+  {3661,961}, {3661,962}, {3659,963}, {3658,964}, {3658,964}, {3657,964},
+  {3657,965}, {3657,965}, {3658,966}, {3657,966}, {3656,966}, {3655,966},
+  {3654,967}, {3653,968}, {3652,970}, {3651,981}, {3651,980}, {3652,980},
+  {3652,980}, {3652,980}, {3650,981}, {3649,981}, {3650,982}, {3651,983},
+  {3651,985}, {3651,986}, {3651,987}, {3651,987}, {3652,988}, {3652,988},
+  {3652,988}, {3652,988}, {3652,989}, {3652,989}, {3652,990}, {3652,991},
+  {3653,991}, {3658,1006}, {3657,1004}, {3657,1003}, {3656,1001}, {3655,1001},
+  {3655,1001}, {3655,1000}, {3655,1001}, {3655,1002}, {3655,1002}, {3656,1002},
+  {3657,1003}, {3657,1003}, {3658,1004}, {3661,1002}, {3660,1001}, {3660,1001}
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "BleBench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Protocol.h"
+
+/*------------------------------------------*/
+/*  The matrix. Plain text sends one point  */
+/*  per notify whatever the payload, so it  */
+/*  only gets the smallest one.             */
+/*------------------------------------------*/
+static const uint16_t benchPayloads[] = {20, 100, 244};
+static const uint16_t benchIntervals[] = {6, 12, 24};    // 7.5, 15, 30 ms
+static const struct { uint8_t framing; bool timed; } benchFramings[] = {
+  {FRAMING_TEXT, false}, {FRAMING_TEXT_PACKED, false}, {FRAMING_BINARY, false}, {FRAMING_BINARY, true}
+};
+
+#define PAYLOADS (sizeof(benchPayloads) / sizeof(benchPayloads[0]))
+#define INTERVALS (sizeof(benchIntervals) / sizeof(benchIntervals[0]))
+#define FRAMINGS (sizeof(benchFramings) / sizeof(benchFramings[0]))
+
+uint8_t benchRuns(){
+  return INTERVALS * (1 + (FRAMINGS - 1) * PAYLOADS);
+}
+
+/*--------------------------------------------------*/
+/*--                benchConfig()                 --*/
+/*--------------------------------------------------*/
+/*    Interval outermost, so the phone is asked to  */
+/*    change it as rarely as possible.              */
+/*--------------------------------------------------*/
+BenchConfig benchConfig(uint8_t run){
+  uint8_t perInterval = 1 + (FRAMINGS - 1) * PAYLOADS;
+  uint8_t step = run % perInterval;
+  BenchConfig config;
+
+  config.interval = benchIntervals[(run / perInterval) % INTERVALS];
+  if(step == 0){
+    config.framing = benchFramings[0].framing;
+    config.timed = benchFramings[0].timed;
+    config.payload = benchPayloads[0];
+  }
+  else{
+    step--;
+    config.framing = benchFramings[1 + step / PAYLOADS].framing;
+    config.timed = benchFramings[1 + step / PAYLOADS].timed;
+    config.payload = benchPayloads[step % PAYLOADS];
+  }
+  return config;
+}
+
+char framingCode(uint8_t framing, bool timed){
+  switch(framing){
+    case FRAMING_TEXT: return 'T';
+    case FRAMING_TEXT_PACKED: return 'P';
+    case FRAMING_BINARY: return timed ? 'b' : 'B';
+  }
+  return '?';
+}
+
+bool framingFromCode(char code, uint8_t* framing, bool* timed){
+  *timed = code == 'b';
+  switch(code){
+    case 'T': *framing = FRAMING_TEXT; return true;
+    case 'P': *framing = FRAMING_TEXT_PACKED; return true;
+    case 'B':
+    case 'b': *framing = FRAMING_BINARY; return true;
+  }
+  return false;
+}
+
+int formatResult(const BenchResult& r, char* out, size_t size){
+  return snprintf(out, size, "R:%u,%c,%c,%u,%u,%u,%u,%lu,%lu,%lu,%lu,%lu\n",
+                  r.run, r.source, framingCode(r.config.framing, r.config.timed), r.config.payload,
+                  r.config.interval, r.grantedInterval, r.mtu, (unsigned long)r.ms,
+                  (unsigned long)r.bytes, (unsigned long)r.packets, (unsigned long)r.failures,
+                  (unsigned long)r.points);
+}
+
+int formatHeader(const char* build, char* out, size_t size){
+  return snprintf(out, size, "H:%s,%u\n", build, benchRuns());
+}
+
+bool parseResult(const char* line, BenchResult* r){
+  const char* start = strstr(line, "R:");
+  if(!start){
+    return false;
+  }
+
+  unsigned run, payload, interval, granted, mtu;
+  unsigned long ms, bytes, packets, failures, points;
+  char source, code;
+  if(sscanf(start, "R:%u,%c,%c,%u,%u,%u,%u,%lu,%lu,%lu,%lu,%lu", &run, &source, &code, &payload,
+            &interval, &granted, &mtu, &ms, &bytes, &packets, &failures, &points) != 12){
+    return false;
+  }
+  if(!framingFromCode(code, &r->config.framing, &r->config.timed)){
+    return false;
+  }
+
+  r->run = run;
+  r->source = source;
+  r->config.payload = payload;
+  r->config.interval = interval;
+  r->grantedInterval = granted;
+  r->mtu = mtu;
+  r->ms = ms;
+  r->bytes = bytes;
+  r->packets = packets;
+  r->failures = failures;
+  r->points = points;
+  return true;
+}
+
+StrokeSource::StrokeSource(uint32_t seed)
+  : state(seed ? seed : 0x9E3779B9u), recording(NULL), recordingCount(0), index(0),
+    x(0), y(0), dx(0), dy(0), left(0) {}
+
+void StrokeSource::useRecording(const uint16_t (*points)[2], uint16_t count){
+  recording = points;
+  recordingCount = count;
+  index = 0;
+}
+
+void StrokeSource::useSynthetic(){
+  recording = NULL;
+  left = 0;
+}
+
+// xorshift32, as TraceRandom on the host
+uint32_t StrokeSource::random(){
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+int StrokeSource::range(int lo, int hi){
+  return lo + (int)(random() % (uint32_t)(hi - lo + 1));
+}
+
+/*--------------------------------------------------*/
+/*--                   next()                     --*/
+/*--------------------------------------------------*/
+/*    Synthetic strokes are 20-120 points of 1-3    */
+/*    unit steps on a slowly turning heading, like  */
+/*    syntheticTrace() in calendurr/host/common.    */
+/*    A recording starts a stroke wherever it       */
+/*    jumps by more than 30 units (TRACE_PEN_LIFT). */
+/*--------------------------------------------------*/
+void StrokeSource::next(uint16_t* outX, uint16_t* outY, uint32_t* ticks, bool* strokeStart){
+  if(recording){
+    int px = recording[index][0];
+    int py = recording[index][1];
+    *strokeStart = index == 0 || abs(px - x) > 30 || abs(py - y) > 30;
+    x = px;
+    y = py;
+    index = index + 1 < recordingCount ? index + 1 : 0;
+  }
+  else{
+    *strokeStart = left == 0;
+    if(left == 0){
+      x = range(200, 3400);
+      y = range(200, 3900);
+      dx = range(-3, 3);
+      dy = range(-3, 3);
+      left = range(20, 120);
+    }
+    else{
+      if(range(0, 7) == 0){
+        dx = range(-3, 3);
+        dy = range(-3, 3);
+      }
+      if(dx == 0 && dy == 0){
+        dx = 1;
+      }
+      x = x + dx < 0 ? 0 : (x + dx > 3600 ? 3600 : x + dx);
+      y = y + dy < 0 ? 0 : (y + dy > 4100 ? 4100 : y + dy);
+    }
+    left--;
+  }
+
+  uint32_t us = *strokeStart ? range(150000, 600000) : range(2000, 3000) * (range(0, 9) == 0 ? 2 : 1);
+  *ticks = us / POINT_TICK_US;
+  *outX = x;
+  *outY = y;
+}
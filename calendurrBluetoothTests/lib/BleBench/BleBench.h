@@ -0,0 +1,124 @@
+#ifndef CALENDURR_BLE_BENCH_H
+#define CALENDURR_BLE_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*--------------------------------------------------*/
+/*--           BLE THROUGHPUT BENCHMARK           --*/
+/*--------------------------------------------------*/
+/*  What the benchmark firmware runs and how it     */
+/*  reports it, kept free of Arduino so the host    */
+/*  results parser reads records with the same      */
+/*  code that wrote them.                           */
+/*                                                  */
+/*  A pass is BENCH_RUNS runs of BENCH_RUN_MS each, */
+/*  one per framing x payload x connection          */
+/*  interval. Every run streams strokes through     */
+/*  calendurr's NoteSender as fast as notifies are  */
+/*  accepted, then sends one record:                */
+/*                                                  */
+/*    R:run,source,framing,payload,ci_req,ci,mtu,   */
+/*      ms,bytes,packets,failures,points            */
+/*                                                  */
+/*  framing is T (text), P (packed text), B         */
+/*  (binary) or b (binary with ticks); ci_req and   */
+/*  ci are connection intervals in 1.25 ms units,   */
+/*  asked for and granted. A pass starts with       */
+/*    H:build,runs                                  */
+/*  Records end in '\n' so notifies split at the    */
+/*  MTU can be joined back up.                      */
+/*--------------------------------------------------*/
+
+#ifndef BENCH_RUN_MS
+#define BENCH_RUN_MS 3000     // streaming time per run
+#endif
+
+#ifndef BENCH_SETTLE_MS
+#define BENCH_SETTLE_MS 600   // after asking for a connection interval
+#endif
+
+#define BENCH_SYNTHETIC 'S'
+#define BENCH_RECORDED 'R'
+
+#define BENCH_RECORD_MAX 96   // longest R: / H: line, with the '\n'
+
+/*------------------------------------------*/
+/*  BenchConfig - one run of the matrix     */
+/*  framing - FRAMING_* from Protocol.h     */
+/*  timed - points carry their ticks        */
+/*  payload - largest notify (capped by the */
+/*            MTU the phone agreed to)      */
+/*  interval - requested connection         */
+/*            interval, 1.25 ms units       */
+/*------------------------------------------*/
+struct BenchConfig {
+  uint8_t framing;
+  bool timed;
+  uint16_t payload;
+  uint16_t interval;
+};
+
+/*------------------------------------------*/
+/*  BenchResult - what one run measured     */
+/*  grantedInterval - what the phone set    */
+/*            (0 if unknown)                */
+/*------------------------------------------*/
+struct BenchResult {
+  uint8_t run;
+  char source;
+  BenchConfig config;
+  uint16_t grantedInterval;
+  uint16_t mtu;
+  uint32_t ms;
+  uint32_t bytes;
+  uint32_t packets;
+  uint32_t failures;
+  uint32_t points;
+};
+
+// Runs in a pass, and the config of each
+uint8_t benchRuns();
+BenchConfig benchConfig(uint8_t run);
+
+// One letter per framing / timed combination, and back
+char framingCode(uint8_t framing, bool timed);
+bool framingFromCode(char code, uint8_t* framing, bool* timed);
+
+// "R:..." / "H:..." with the trailing '\n'; returns the length
+int formatResult(const BenchResult& result, char* out, size_t size);
+int formatHeader(const char* build, char* out, size_t size);
+
+// Reads an R: record anywhere in line; false if there is none
+bool parseResult(const char* line, BenchResult* result);
+
+/*------------------------------------------*/
+/*  StrokeSource - an endless pen trace to  */
+/*  stream: handwriting-like synthetic      */
+/*  strokes (the host tools' generator) or  */
+/*  a recording replayed in a loop, with a  */
+/*  2-3 ms sample time in ticks and a pen   */
+/*  lift between strokes.                   */
+/*------------------------------------------*/
+class StrokeSource {
+  public:
+    StrokeSource(uint32_t seed);
+
+    // Replays points (x, y pairs) instead of generating strokes
+    void useRecording(const uint16_t (*points)[2], uint16_t count);
+    void useSynthetic();
+
+    void next(uint16_t* x, uint16_t* y, uint32_t* ticks, bool* strokeStart);
+
+  private:
+    uint32_t random();
+    int range(int lo, int hi);
+
+    uint32_t state;
+    const uint16_t (*recording)[2];
+    uint16_t recordingCount;
+    uint16_t index;
+    int x, y, dx, dy, left;
+};
+
+#endif
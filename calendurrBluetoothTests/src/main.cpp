@@ -3,78 +3,131 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
-#include <string>
+#include <string.h>
 #include <Arduino.h>
 #include <InternalFileSystem.h>
 #include <Adafruit_LittleFS.h>
 #include <cstdio>
+#include "DeviceTraits.h"
+#include "Protocol.h"
+#include "PointStore.h"
+#include "BleBench.h"
+#include "RecordedStroke.h"
 
 using namespace Adafruit_LittleFS_Namespace;
-using namespace std;
 
-#define VBATPIN A6
+/*--------------------------------------------------*/
+/*--        BLE THROUGHPUT BENCHMARK FIRMWARE     --*/
+/*--------------------------------------------------*/
+/*  Streams pen strokes to the phone as fast as it  */
+/*  takes them, through the same NoteSender the     */
+/*  calendar uses, once per framing x payload x     */
+/*  connection interval (BleBench.h). The OLED      */
+/*  shows bytes/s, packets/s and refused notifies   */
+/*  while a run goes; each finished run is sent as  */
+/*  an R: record on the results characteristic (and */
+/*  Serial) for host/results to compare.            */
+/*                                                  */
+/*  Start a pass with SEND, or by writing "RUN S"   */
+/*  (synthetic strokes) / "RUN R" (recorded) to the */
+/*  bench control characteristic; SEND or "STOP"    */
+/*  ends it. Holding BLE disconnects, as before.    */
+/*--------------------------------------------------*/
+
+// Pins, pad bounds, UUIDs and the calendar come from DeviceTraits.h
+// (DEVICE_VARIANT=VARIANT_BLE_TEST in platformio.ini)
+typedef Device::Pins Pins;
+typedef Device::Dates Dates;
+
+#ifndef BENCH_SOURCE
+#define BENCH_SOURCE BENCH_SYNTHETIC   // what SEND streams
+#endif
+
+#define BENCH_BATCH_BYTES 512   // points packed per sendPoints() call
+#define BENCH_SHOW_MS 1000      // OLED refresh while running (~25 ms each)
+#define BENCH_BUILD __DATE__ " " __TIME__
+
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
 #define OLED_RESET -1
-#define SCREEN_ADDRESS 0x3D
 #define DATES "/wutduhdate.txt"
 
 File file(InternalFS);
 
-#define SEND_BUTTON 25
-#define BLE_BUTTON 26
-
-#define DAY_A 9
-#define DAY_B 10
 int dayB_status;
-#define MONTH_A 12
-#define MONTH_B 13
 int monthB_status;
 int day;
 int month;
-String d;
-String m;
 int monthTime;
 int dayTime;
-
-#define months {"January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"}
-
-#define TOP_R 11
-#define TOP_L 6
-#define SENSE 14
-#define BOTTOM_L 5
-#define BOTTOM_R 0
-
-#define X_MAX 13000
-#define X_MIN 8850
-#define Y_MAX 13000
-#define Y_MIN 8500
-
-unsigned short int x_raw, y_raw;
-int x_pos, y_pos, last_x, last_y, delX, delY;
-int filtered_x, filtered_y, avg_x, avg_y;
-int last_avg_x, last_avg_y, temp_x, temp_y;
-int last_avg_x_2, last_avg_y_2, temp_x_2, temp_y_2;
-int last_avg_x_3, last_avg_y_3, temp_x_3, temp_y_3;
-int last_avg_x_4, last_avg_y_4, temp_x_4, temp_y_4;
-#define coeff 0.1
-
-unsigned int coordz[1][2];
-int numEntriesSame;
+int batteryPercent;
+int batteryChange;
 
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
-BLEService calendarService("19B10000-E8F2-537E-4F6C-D104768A1214");
-BLECharacteristic dataCharacteristic("19B10001-E8F2-537E-4F6C-D104768A1214");
+BLEService calendarService(Device::Ble::serviceUuid);
+BLECharacteristic dataCharacteristic(Device::Ble::dataUuid);
+BLECharacteristic benchControl(Device::Ble::benchControlUuid);   // phone -> "RUN S" / "RUN R" / "STOP"
+BLECharacteristic benchResults(Device::Ble::benchResultsUuid);   // H: / R: records
 bool isConnected = false;
 
 unsigned long lastButtonPress = 0;
 const unsigned long debounceTime = 300;
 
+/*------------------------------------------*/
+/*  BenchLink - notifies on the data        */
+/*  characteristic, no bigger than the run  */
+/*  allows (payloadLimit) or the MTU does   */
+/*------------------------------------------*/
+class BenchLink : public NoteLink {
+  public:
+    BenchLink() : payloadLimit(NOTE_MAX_PAYLOAD) {}
+
+    uint16_t payloadSize(){
+      BLEConnection* conn = Bluefruit.Connection(Bluefruit.connHandle());
+      uint16_t size = conn ? conn->getMtu() - 3 : NOTE_MIN_PAYLOAD;
+      return size < payloadLimit ? size : payloadLimit;
+    }
+    bool notify(const uint8_t* data, uint16_t len){
+      return dataCharacteristic.notify(data, len);
+    }
+    void pause(uint32_t ms){ delay(ms); }
+    uint32_t now(){ return millis(); }
+    bool connected(){ return Bluefruit.connected(); }
+
+    uint16_t payloadLimit;
+};
+
+/*------------------------------------------*/
+/*  Benchmark state                         */
+/*  benchRunning/benchRun - pass under way, */
+/*            next run of it                */
+/*  benchSource - BENCH_SYNTHETIC/RECORDED  */
+/*  start/stopRequested - set by SEND or    */
+/*            the control characteristic    */
+/*  lastResult - shown when idle            */
+/*------------------------------------------*/
+BenchLink benchLink;
+NoteSender benchSender(benchLink);
+StrokeSource strokes(1);
+uint8_t batchBytes[BENCH_BATCH_BYTES];
+
+bool benchRunning = false;
+uint8_t benchRun = 0;
+char benchSource = BENCH_SOURCE;
+volatile bool startRequested = false;
+volatile bool stopRequested = false;
+volatile char requestedSource = BENCH_SOURCE;
+BenchResult lastResult;
+bool haveResult = false;
+
 void connect_callback(uint16_t conn_handle);
 void disconnect_callback(uint16_t conn_handle, uint8_t reason);
+void control_write_callback(uint16_t conn_handle, BLECharacteristic* chr, uint8_t* data, uint16_t len);
 void startAdv();
-void readSensor();
-void sendData();
+void startPass(char source);
+void runBenchmark(uint8_t run);
+void showRun(const BenchResult& result, uint32_t ms);
+void sendRecord(const char* line, int len);
 void dayChange();
 void monthChange();
 void whatsTheDate();
@@ -82,92 +135,244 @@ void whatsTheDate();
 void setup() {
   Serial.begin(115200);
 
-  pinMode(TOP_R, OUTPUT); pinMode(TOP_L, OUTPUT);
-  pinMode(BOTTOM_L, OUTPUT); pinMode(BOTTOM_R, OUTPUT);
-  digitalWrite(TOP_R, LOW); digitalWrite(TOP_L, LOW);
-  digitalWrite(BOTTOM_L, LOW); digitalWrite(BOTTOM_R, LOW);
-  pinMode(SENSE, INPUT);
+  pinMode(Pins::topRight, OUTPUT); pinMode(Pins::topLeft, OUTPUT);
+  pinMode(Pins::bottomLeft, OUTPUT); pinMode(Pins::bottomRight, OUTPUT);
+  digitalWrite(Pins::topRight, LOW); digitalWrite(Pins::topLeft, LOW);
+  digitalWrite(Pins::bottomLeft, LOW); digitalWrite(Pins::bottomRight, LOW);
+  pinMode(Pins::sense, INPUT);
 
-  pinMode(SEND_BUTTON, INPUT);
-  pinMode(BLE_BUTTON, INPUT);
-  pinMode(DAY_A, INPUT); pinMode(DAY_B, INPUT);
-  pinMode(MONTH_A, INPUT); pinMode(MONTH_B, INPUT);
+  pinMode(Pins::sendButton, INPUT);
+  pinMode(Pins::bleButton, INPUT);
+  pinMode(Pins::dayA, INPUT); pinMode(Pins::dayB, INPUT);
+  pinMode(Pins::monthA, INPUT); pinMode(Pins::monthB, INPUT);
 
-  attachInterrupt(DAY_A, dayChange, RISING);
-  attachInterrupt(MONTH_A, monthChange, RISING);
+  attachInterrupt(Pins::dayA, dayChange, RISING);
+  attachInterrupt(Pins::monthA, monthChange, RISING);
 
   InternalFS.begin();
   file.open(DATES, FILE_O_READ);
   if(file){
     char buffer[64] = {0};
-    uint32_t len = file.read(buffer, sizeof(buffer));
+    uint32_t len = file.read(buffer, sizeof(buffer) - 1);
     buffer[len] = 0;
     sscanf(buffer, "%d,%d", &month, &day);
     file.close();
   } else {
     day = 1; month = 1;
   }
-  int i = month - 1;
-  m = (String[])months[i];
+  if(month < 1 || month > 12) month = 1;
+  day = Dates::fitDay(day, month);
 
-  analogReadResolution(14);
+  analogReadResolution(Device::Battery::bits);
   analogReference(AR_INTERNAL_2_4);
-  float measuredvbat = analogRead(VBATPIN) * 2 * 2.4 / 16384;
-  batteryPercent = (measuredvbat / 3.7) * 100;
+  batteryPercent = Device::Battery::millivolts(analogRead(Pins::vbat)) * 100 / 3700;
   batteryChange = 0;
 
-  if(!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) while(1);
+  if(!display.begin(SSD1306_SWITCHCAPVCC, Pins::oledAddress)) while(1);
   display.clearDisplay(); display.setTextSize(1); display.setTextColor(SSD1306_WHITE);
 
+  // largest MTU, data length and queue the SoftDevice allows
+  Bluefruit.configPrphBandwidth(BANDWIDTH_MAX);
   Bluefruit.begin();
-  Bluefruit.setTxPower(4);
-  Bluefruit.setName("very cool calendar we made");
+  Bluefruit.setTxPower(Device::Ble::txPower);
+  Bluefruit.setName(Device::Ble::name);
   Bluefruit.Periph.setConnectCallback(connect_callback);
   Bluefruit.Periph.setDisconnectCallback(disconnect_callback);
 
   calendarService.begin();
-  dataCharacteristic.setProperties(CHR_PROPS_READ);
+  dataCharacteristic.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
   dataCharacteristic.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
-  dataCharacteristic.setFixedLen(20);
+  dataCharacteristic.setMaxLen(NOTE_MAX_PAYLOAD);
+  dataCharacteristic.setFixedLen(false);
   dataCharacteristic.begin();
-  uint8_t initVal[1] = {'0'};
-  dataCharacteristic.write(initVal, 1);
+
+  benchControl.setProperties(CHR_PROPS_WRITE | CHR_PROPS_WRITE_WO_RESP);
+  benchControl.setPermission(SECMODE_NO_ACCESS, SECMODE_OPEN);
+  benchControl.setMaxLen(20);
+  benchControl.setFixedLen(false);
+  benchControl.setWriteCallback(control_write_callback);
+  benchControl.begin();
+
+  benchResults.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
+  benchResults.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
+  benchResults.setMaxLen(BENCH_RECORD_MAX);
+  benchResults.setFixedLen(false);
+  benchResults.begin();
 
   startAdv();
   whatsTheDate();
 }
 
 void loop() {
-  whatsTheDate();
-
-  if (!digitalRead(SEND_BUTTON)) {
+  // SEND starts a pass, or ends the one running
+  if (!digitalRead(Pins::sendButton)) {
     unsigned long currentTime = millis();
     if (currentTime - lastButtonPress > debounceTime) {
       lastButtonPress = currentTime;
-      sendData();
-      while (!digitalRead(SEND_BUTTON)) delay(10);
+      if (benchRunning) {
+        stopRequested = true;
+      } else {
+        requestedSource = BENCH_SOURCE;
+        startRequested = true;
+      }
+      while (!digitalRead(Pins::sendButton)) delay(10);
     }
   }
 
-  if (!digitalRead(BLE_BUTTON)) {
+  if (!digitalRead(Pins::bleButton)) {
     int timeStart = millis();
-    while (!digitalRead(BLE_BUTTON)) {
+    while (!digitalRead(Pins::bleButton)) {
       if ((millis() - timeStart) >= 2000) {
         Bluefruit.disconnect(Bluefruit.connHandle());
         break;
       }
     }
   }
+
+  if (startRequested) {
+    startRequested = false;
+    if (Bluefruit.connected()) startPass(requestedSource);
+  }
+  if (stopRequested || !Bluefruit.connected()) {
+    stopRequested = false;
+    benchRunning = false;
+  }
+
+  if (benchRunning) {
+    runBenchmark(benchRun);
+    benchRun++;
+    if (benchRun >= benchRuns()) benchRunning = false;
+  } else {
+    whatsTheDate();
+  }
+}
+
+/*--------------------------------------------------*/
+/*--                 startPass()                  --*/
+/*--------------------------------------------------*/
+void startPass(char source) {
+  benchSource = source;
+  if (source == BENCH_RECORDED) {
+    strokes.useRecording(recordedStroke, RECORDED_POINTS);
+  } else {
+    benchSource = BENCH_SYNTHETIC;
+    strokes.useSynthetic();
+  }
+
+  char line[BENCH_RECORD_MAX];
+  int len = formatHeader(BENCH_BUILD, line, sizeof(line));
+  sendRecord(line, len);
+
+  benchRun = 0;
+  benchRunning = true;
+}
+
+/*--------------------------------------------------*/
+/*--               runBenchmark()                 --*/
+/*--------------------------------------------------*/
+/*    Asks for the run's connection interval (the   */
+/*    phone may grant another one, which is what    */
+/*    gets reported), then keeps packing a batch of */
+/*    points and handing it to the sender until     */
+/*    BENCH_RUN_MS are up. notify() waits for a     */
+/*    free buffer, so this is as fast as the link   */
+/*    goes; a notify that still fails is counted.   */
+/*--------------------------------------------------*/
+void runBenchmark(uint8_t run) {
+  BenchConfig config = benchConfig(run);
+  BLEConnection* conn = Bluefruit.Connection(Bluefruit.connHandle());
+  if (!conn) return;
+
+  if (conn->getConnectionInterval() != config.interval) {
+    conn->requestConnectionParameter(config.interval);
+    delay(BENCH_SETTLE_MS);
+  }
+
+  BenchResult result;
+  memset(&result, 0, sizeof(result));
+  result.run = run;
+  result.source = benchSource;
+  result.config = config;
+  result.grantedInterval = conn->getConnectionInterval();
+  result.mtu = conn->getMtu();
+
+  PointStore batch(batchBytes, sizeof(batchBytes), config.timed);
+  benchSender.framing = config.framing;
+  benchSender.packets = benchSender.bytes = benchSender.failures = 0;
+  benchLink.payloadLimit = config.payload;
+
+  uint32_t start = millis();
+  uint32_t shown = start;
+  while (millis() - start < BENCH_RUN_MS && Bluefruit.connected() && !stopRequested) {
+    batch.clear();
+    while (batch.room()) {
+      uint16_t x, y;
+      uint32_t ticks;
+      bool strokeStart;
+      strokes.next(&x, &y, &ticks, &strokeStart);
+      batch.append(x, y, strokeStart, ticks);
+    }
+    benchSender.sendPoints(batch);
+    result.points += batch.count();
+
+    if (millis() - shown >= BENCH_SHOW_MS) {
+      shown = millis();
+      result.bytes = benchSender.bytes;
+      result.packets = benchSender.packets;
+      result.failures = benchSender.failures;
+      showRun(result, shown - start);
+    }
+  }
+
+  result.ms = millis() - start;
+  result.bytes = benchSender.bytes;
+  result.packets = benchSender.packets;
+  result.failures = benchSender.failures;
+  showRun(result, result.ms);
+
+  char line[BENCH_RECORD_MAX];
+  int len = formatResult(result, line, sizeof(line));
+  sendRecord(line, len);
+
+  lastResult = result;
+  haveResult = true;
 }
 
-void sendData() {
-  if (!Bluefruit.connected()) return;
+/*--------------------------------------------------*/
+/*--                  showRun()                   --*/
+/*--------------------------------------------------*/
+/*    Live figures for the run so far.              */
+/*--------------------------------------------------*/
+void showRun(const BenchResult& result, uint32_t ms) {
+  if (ms == 0) ms = 1;
+  display.clearDisplay();
+  display.setCursor(5, 5);
+  display.printf("Run %u/%u %c %c %uB", result.run + 1, benchRuns(), result.source,
+                 framingCode(result.config.framing, result.config.timed), result.config.payload);
+  display.setCursor(5, 15);
+  display.printf("CI %u.%02u ms MTU %u", result.grantedInterval * 5 / 4,
+                 result.grantedInterval * 125 % 100, result.mtu);
+  display.setCursor(5, 30);
+  display.printf("B/s   %lu", (unsigned long)((uint64_t)result.bytes * 1000 / ms));
+  display.setCursor(5, 40);
+  display.printf("pkt/s %lu", (unsigned long)((uint64_t)result.packets * 1000 / ms));
+  display.setCursor(5, 50);
+  display.printf("fail  %lu", (unsigned long)result.failures);
+  display.display();
+}
 
-  const char* parts[] = {"START", "430 280", "STOP", "4,27", "END"};
-  for (int i = 0; i < 5; i++) {
-    const char* msg = parts[i];
-    dataCharacteristic.write((uint8_t*)msg, strlen(msg));
-    delay(200);
+/*--------------------------------------------------*/
+/*--                sendRecord()                  --*/
+/*--------------------------------------------------*/
+/*    The record stays readable on the results      */
+/*    characteristic and is notified if the phone   */
+/*    subscribed (split at the MTU if it must be).  */
+/*--------------------------------------------------*/
+void sendRecord(const char* line, int len) {
+  Serial.print(line);
+  benchResults.write(line, len);
+  if (benchResults.notifyEnabled()) {
+    benchResults.notify(line, len);
   }
 }
 
@@ -177,53 +382,74 @@ void startAdv() {
   Bluefruit.Advertising.addService(calendarService);
   Bluefruit.Advertising.addName();
   Bluefruit.Advertising.restartOnDisconnect(true);
-  Bluefruit.Advertising.setInterval(32, 244);
-  Bluefruit.Advertising.setFastTimeout(30);
+  Bluefruit.Advertising.setInterval(Device::Ble::advFastInterval, Device::Ble::advSlowInterval);
+  Bluefruit.Advertising.setFastTimeout(Device::Ble::advFastTimeoutS);
   Bluefruit.Advertising.start(0);
 }
 
 void connect_callback(uint16_t conn_handle) {
   isConnected = true;
-  const char* msg = "START";
-  dataCharacteristic.write((uint8_t*)msg, strlen(msg));
+
+  // the fastest link the phone will agree to; each run sets its interval
+  BLEConnection* conn = Bluefruit.Connection(conn_handle);
+  conn->requestPHY();
+  conn->requestDataLengthUpdate();
+  conn->requestMtuExchange(NOTE_MAX_PAYLOAD + 3);
 }
 
 void disconnect_callback(uint16_t conn_handle, uint8_t reason) {
   isConnected = false;
 }
 
+/*--------------------------------------------------*/
+/*--          control_write_callback()            --*/
+/*--------------------------------------------------*/
+/*    "RUN", "RUN S" or "RUN R" starts a pass,      */
+/*    "STOP" ends it. Runs in the BLE task, so it   */
+/*    only leaves requests for loop().              */
+/*--------------------------------------------------*/
+void control_write_callback(uint16_t conn_handle, BLECharacteristic* chr, uint8_t* data, uint16_t len) {
+  if (len >= 3 && !memcmp(data, "RUN", 3)) {
+    requestedSource = (len >= 5 && data[4] == BENCH_RECORDED) ? BENCH_RECORDED : BENCH_SYNTHETIC;
+    startRequested = true;
+  } else if (len >= 4 && !memcmp(data, "STOP", 4)) {
+    stopRequested = true;
+  }
+}
+
 void dayChange() {
   int time = millis();
   if (abs(time - dayTime) > 10) {
-    dayB_status = digitalRead(DAY_B);
-    day += (dayB_status == 1) ? 1 : -1;
-    if (month == 2) day = constrain(day, 1, 28);
-    else if (month == 4 || month == 6 || month == 9 || month == 11) day = constrain(day, 1, 30);
-    else day = constrain(day, 1, 31);
+    dayB_status = digitalRead(Pins::dayB);
+    day = Dates::turnDay(day, month, (dayB_status == 1) ? 1 : -1);
     dayTime = millis();
   }
 }
 
 void monthChange() {
-  monthB_status = digitalRead(MONTH_B);
-  month += (monthB_status == 1) ? 1 : -1;
-  if (month > 12) month = 1;
-  if (month < 1) month = 12;
-  int i = month - 1;
-  m = (String[])months[i];
+  monthB_status = digitalRead(Pins::monthB);
+  month = Dates::turnMonth(month, (monthB_status == 1) ? 1 : -1);
+  day = Dates::fitDay(day, month);
 }
 
+// Idle screen: the date, the last run and how to start one
 void whatsTheDate() {
   display.clearDisplay();
-  display.setCursor(5, 5); display.print("Month: "); display.println(m);
+  display.setCursor(5, 5); display.print("Month: "); display.println(Dates::monthNames[month - 1]);
   display.setCursor(5, 15); display.print("Day: "); display.println(day);
+  display.setCursor(5, 27);
+  if (haveResult && lastResult.ms > 0) {
+    display.printf("Last %c%u: %lu B/s", framingCode(lastResult.config.framing, lastResult.config.timed),
+                   lastResult.config.payload, (unsigned long)((uint64_t)lastResult.bytes * 1000 / lastResult.ms));
+  } else {
+    display.print("SEND: benchmark");
+  }
   display.setCursor(5, 40); display.println(isConnected ? "BLE: Connected" : "BLE: Not Connected");
 
-  float lastPercent = batteryPercent;
-  float measuredvbat = analogRead(VBATPIN) * 2 * 2.4 / 16384;
+  int lastPercent = batteryPercent;
   display.setCursor(5, 50); display.print("Battery: ");
-  batteryPercent = (measuredvbat / 3.7) * 100;
-  float delBattery = batteryPercent - lastPercent;
+  batteryPercent = Device::Battery::millivolts(analogRead(Pins::vbat)) * 100 / 3700;
+  int delBattery = batteryPercent - lastPercent;
 
   if (abs(delBattery) > 0) {
     batteryChange++;
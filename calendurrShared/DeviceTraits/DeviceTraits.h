@@ -0,0 +1,208 @@
+#ifndef CALENDURR_DEVICE_TRAITS_H
+#define CALENDURR_DEVICE_TRAITS_H
+
+#include <stdint.h>
+
+/*--------------------------------------------------*/
+/*--          DEVICE TRAITS (both firmwares)      --*/
+/*--------------------------------------------------*/
+/*  Everything calendurr and calendurrBluetoothTests*/
+/*  used to #define each on their own: pins, pad    */
+/*  bounds and filter, battery divider, BLE UUIDs   */
+/*  and advertising, month names and how the day    */
+/*  dial behaves at the ends of a month. Each       */
+/*  variant is a struct of constexpr members picked */
+/*  by DEVICE_VARIANT, so every value is a compile  */
+/*  time constant and costs nothing at run time:    */
+/*                                                  */
+/*    #include "DeviceTraits.h"                     */
+/*    pinMode(Device::Pins::sense, INPUT);          */
+/*    day = Device::Dates::turnDay(day, month, 1);  */
+/*                                                  */
+/*  Both projects find this library through         */
+/*  lib_extra_dirs = ../calendurrShared. Another    */
+/*  board is another DeviceTraits specialisation.   */
+/*                                                  */
+/*  The build options (NOTE_*, PEN_*, OLED_DMA,     */
+/*  PAD_RATIOMETRIC, ...) stay -D macros: they pick */
+/*  which code, globals and libraries are compiled  */
+/*  at all, which a constexpr member cannot do in   */
+/*  the firmwares' C++11.                           */
+/*--------------------------------------------------*/
+
+#define VARIANT_CALENDAR 0   // calendurr
+#define VARIANT_BLE_TEST 1   // calendurrBluetoothTests
+
+#ifndef DEVICE_VARIANT
+#define DEVICE_VARIANT VARIANT_CALENDAR
+#endif
+
+/*------------------------------------------*/
+/*  FeatherPins - the breadboard wiring on  */
+/*  the Feather nRF52840                    */
+/*------------------------------------------*/
+struct FeatherPins {
+  // resistive pad drive corners and the sense line (A0)
+  static constexpr uint8_t topRight = 11;
+  static constexpr uint8_t topLeft = 6;
+  static constexpr uint8_t bottomLeft = 5;
+  static constexpr uint8_t bottomRight = 0;
+  static constexpr uint8_t sense = 14;
+
+  static constexpr uint8_t sendButton = 25;
+  static constexpr uint8_t bleButton = 26;
+
+  // rotary dials, A fires the interrupt and B gives the direction
+  static constexpr uint8_t dayA = 9;
+  static constexpr uint8_t dayB = 10;
+  static constexpr uint8_t monthA = 12;
+  static constexpr uint8_t monthB = 13;
+
+  static constexpr uint8_t vbat = 20;      // A6, P0.29
+  static constexpr uint8_t vbatAin = 5;    // the same pin as a SAADC input
+
+  static constexpr uint8_t oledAddress = 0x3D;
+};
+
+/*------------------------------------------*/
+/*  ResistivePad - raw 14 bit readings and  */
+/*  the filter after them                   */
+/*  xMax/yMax - raw value at the pad edge   */
+/*            coordinates count up from     */
+/*  touchMin - both readings at least this: */
+/*            the pen is down               */
+/*  jumpMax - a bigger step between samples */
+/*            is not the pen                */
+/*  filterCoeff - weight of a new sample    */
+/*  referenceMv/boundsVddMv - the bounds    */
+/*            are against the 2.4 V         */
+/*            reference, with the pad       */
+/*            driven from this VDD          */
+/*------------------------------------------*/
+struct ResistivePad {
+  static constexpr uint16_t xMax = 13000;
+  static constexpr uint16_t xMin = 8850;
+  static constexpr uint16_t yMax = 13000;
+  static constexpr uint16_t yMin = 8500;
+  static constexpr uint16_t touchMin = 8000;
+  static constexpr int jumpMax = 250;
+  static constexpr float filterCoeff = 0.1f;
+  static constexpr uint8_t adcBits = 14;
+  static constexpr uint16_t referenceMv = 2400;
+  static constexpr uint16_t boundsVddMv = 3300;
+};
+
+/*------------------------------------------*/
+/*  FeatherBattery - VBAT halved by the     */
+/*  on-board divider, read against the      */
+/*  2.4 V internal reference                */
+/*------------------------------------------*/
+struct FeatherBattery {
+  static constexpr uint16_t referenceMv = 2400;
+  static constexpr uint8_t divider = 2;
+  static constexpr uint8_t bits = 14;
+  static constexpr uint16_t fullScaleMv = referenceMv * divider;
+
+  static constexpr uint16_t millivolts(uint16_t raw){
+    return (uint32_t)raw * fullScaleMv >> bits;
+  }
+};
+
+/*------------------------------------------*/
+/*  CalendarBle - GATT and advertising      */
+/*  Intervals are in 0.625 ms units.        */
+/*------------------------------------------*/
+struct CalendarBle {
+  static constexpr const char* serviceUuid = "19B10000-E8F2-537E-4F6C-D104768A1214";
+  static constexpr const char* dataUuid = "19B10001-E8F2-537E-4F6C-D104768A1214";
+  static constexpr const char* controlUuid = "19B10002-E8F2-537E-4F6C-D104768A1214";
+  static constexpr const char* statusUuid = "19B10003-E8F2-537E-4F6C-D104768A1214";
+  static constexpr const char* name = "very cool calendar we made";
+  static constexpr int8_t txPower = 8;
+  static constexpr uint16_t advFastInterval = 32;   // 20 ms
+  static constexpr uint16_t advSlowInterval = 244;  // 152.5 ms
+  static constexpr uint16_t advFastTimeoutS = 30;
+};
+
+// The BLE test sketch kept the old transmit power, and adds the
+// benchmark's own characteristics to the calendar service
+struct BleTestBle : CalendarBle {
+  static constexpr int8_t txPower = 4;
+  static constexpr const char* benchControlUuid = "19B100F0-E8F2-537E-4F6C-D104768A1214";
+  static constexpr const char* benchResultsUuid = "19B100F1-E8F2-537E-4F6C-D104768A1214";
+};
+
+/*------------------------------------------*/
+/*  CalendarDates - month names and lengths */
+/*  (February is always 28), and what the   */
+/*  day dial does past either end of a      */
+/*  month: wrap around, or stop there       */
+/*------------------------------------------*/
+template<bool wrapDays>
+struct CalendarDates {
+  static constexpr const char* const monthNames[12] = {
+    "January", "February", "March", "April", "May", "June",
+    "July", "August", "September", "October", "November", "December"
+  };
+  static constexpr uint8_t daysInMonth[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  static constexpr bool wraps = wrapDays;
+
+  static constexpr int lastDay(int month){
+    return daysInMonth[month - 1];
+  }
+
+  // day after the dial moved by step (+1 / -1)
+  static constexpr int turnDay(int day, int month, int step){
+    return wrapDays
+      ? (day + step < 1 ? lastDay(month) : (day + step > lastDay(month) ? 1 : day + step))
+      : (day + step < 1 ? 1 : (day + step > lastDay(month) ? lastDay(month) : day + step));
+  }
+
+  // the month dial always wraps around the year
+  static constexpr int turnMonth(int month, int step){
+    return month + step < 1 ? 12 : (month + step > 12 ? 1 : month + step);
+  }
+
+  // a day left over from a longer month
+  static constexpr int fitDay(int day, int month){
+    return day > lastDay(month) ? lastDay(month) : (day < 1 ? 1 : day);
+  }
+};
+
+template<bool wrapDays>
+constexpr const char* const CalendarDates<wrapDays>::monthNames[12];
+template<bool wrapDays>
+constexpr uint8_t CalendarDates<wrapDays>::daysInMonth[12];
+
+/*------------------------------------------*/
+/*  DeviceTraits - one specialisation per   */
+/*  firmware variant                        */
+/*------------------------------------------*/
+template<int variant>
+struct DeviceTraits;
+
+template<>
+struct DeviceTraits<VARIANT_CALENDAR> {
+  typedef FeatherPins Pins;
+  typedef ResistivePad Pad;
+  typedef FeatherBattery Battery;
+  typedef CalendarBle Ble;
+  typedef CalendarDates<true> Dates;
+};
+
+template<>
+struct DeviceTraits<VARIANT_BLE_TEST> {
+  typedef FeatherPins Pins;
+  typedef ResistivePad Pad;
+  typedef FeatherBattery Battery;
+  typedef BleTestBle Ble;
+  typedef CalendarDates<false> Dates;
+};
+
+typedef DeviceTraits<DEVICE_VARIANT> Device;
+
+static_assert(Device::Battery::fullScaleMv == 4800, "VBAT full scale");
+static_assert(Device::Pad::xMin < Device::Pad::xMax && Device::Pad::yMin < Device::Pad::yMax, "pad bounds");
+
+#endif